@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/iconv.h"
+#include "harness.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The number of bytes of UTF-8 text converted by each iteration of the
+ * character set conversion benchmarks. This is comparable to the size of a
+ * large clipboard.
+ */
+#define BENCH_ICONV_LENGTH 65536
+
+/**
+ * Text resembling typical clipboard contents, mostly ASCII with Windows line
+ * endings and occasional multibyte characters, repeated to fill the buffer
+ * converted.
+ */
+#define BENCH_ICONV_SAMPLE "The quick brown fox jumps over the lazy dog. " \
+    "Voix ambiguë d'un cœur qui, au zéphyr, préfère les jattes de kiwis.\r\n"
+
+/**
+ * The UTF-8 text to convert, along with its UTF-16 equivalent.
+ */
+static char bench_iconv_utf8[BENCH_ICONV_LENGTH];
+static char bench_iconv_utf16[BENCH_ICONV_LENGTH * 2];
+
+/**
+ * Buffer receiving the output of each conversion.
+ */
+static char bench_iconv_output[BENCH_ICONV_LENGTH * 2];
+
+/**
+ * Parameters describing a single character set conversion.
+ */
+typedef struct bench_iconv_conversion {
+
+    /**
+     * The function to use to read input characters.
+     */
+    guac_iconv_read* reader;
+
+    /**
+     * The input to convert.
+     */
+    const char* input;
+
+    /**
+     * The length of the input, in bytes.
+     */
+    int length;
+
+    /**
+     * The function to use to write output characters.
+     */
+    guac_iconv_write* writer;
+
+} bench_iconv_conversion;
+
+static void bench_iconv_convert(void* data) {
+
+    bench_iconv_conversion* conversion = (bench_iconv_conversion*) data;
+
+    const char* input = conversion->input;
+    char* output = bench_iconv_output;
+
+    guac_iconv(conversion->reader, &input, conversion->length,
+            conversion->writer, &output, sizeof(bench_iconv_output));
+
+}
+
+void bench_iconv() {
+
+    /* Fill buffer with repeated sample text, avoiding splitting any
+     * multibyte character */
+    int length = 0;
+    while (length + sizeof(BENCH_ICONV_SAMPLE) < sizeof(bench_iconv_utf8)) {
+        memcpy(bench_iconv_utf8 + length, BENCH_ICONV_SAMPLE,
+                sizeof(BENCH_ICONV_SAMPLE) - 1);
+        length += sizeof(BENCH_ICONV_SAMPLE) - 1;
+    }
+
+    /* Produce UTF-16 equivalent */
+    const char* input = bench_iconv_utf8;
+    char* output = bench_iconv_utf16;
+    guac_iconv(GUAC_READ_UTF8, &input, length,
+            GUAC_WRITE_UTF16, &output, sizeof(bench_iconv_utf16));
+
+    int utf16_length = output - bench_iconv_utf16;
+
+    bench_iconv_conversion utf8_to_utf16 = {
+        .reader = GUAC_READ_UTF8,
+        .input  = bench_iconv_utf8,
+        .length = length,
+        .writer = GUAC_WRITE_UTF16
+    };
+
+    bench_iconv_conversion utf16_to_utf8 = {
+        .reader = GUAC_READ_UTF16,
+        .input  = bench_iconv_utf16,
+        .length = utf16_length,
+        .writer = GUAC_WRITE_UTF8
+    };
+
+    bench_iconv_conversion utf8_normalized = {
+        .reader = GUAC_READ_UTF8_NORMALIZED,
+        .input  = bench_iconv_utf8,
+        .length = length,
+        .writer = GUAC_WRITE_UTF8_CRLF
+    };
+
+    bench_iconv_conversion utf8_to_cp1252 = {
+        .reader = GUAC_READ_UTF8,
+        .input  = bench_iconv_utf8,
+        .length = length,
+        .writer = GUAC_WRITE_CP1252
+    };
+
+    guac_bench_run("iconv_utf8_to_utf16", bench_iconv_convert,
+            &utf8_to_utf16, length);
+    guac_bench_run("iconv_utf16_to_utf8", bench_iconv_convert,
+            &utf16_to_utf8, utf16_length);
+    guac_bench_run("iconv_utf8_normalized_to_crlf", bench_iconv_convert,
+            &utf8_normalized, length);
+    guac_bench_run("iconv_utf8_to_cp1252", bench_iconv_convert,
+            &utf8_to_cp1252, length);
+
+}
+
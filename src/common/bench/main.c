@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+
+#include <stdlib.h>
+
+/**
+ * Runs all character set conversion benchmarks.
+ */
+void bench_iconv();
+
+/**
+ * Runs all drawing surface benchmarks.
+ */
+void bench_surface();
+
+int main() {
+
+    /* Use identical data for every run */
+    srand(0);
+
+    guac_bench_begin();
+    bench_iconv();
+    bench_surface();
+    guac_bench_end();
+
+    return 0;
+
+}
+
@@ -0,0 +1,329 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/display.h"
+#include "replay.h"
+
+#include <guacamole/client.h>
+#include <guacamole/error.h>
+#include <guacamole/metrics.h>
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The number of bytes read at a time by each thread draining the loopback
+ * connection of a simulated viewer.
+ */
+#define BENCH_REPLAY_DRAIN_BUFFER_SIZE 65536
+
+/**
+ * Reads and discards all data received over the given file descriptor until
+ * end-of-stream is reached, closing the file descriptor once done. This
+ * function is suitable for use as the start routine of a pthread.
+ *
+ * @param data
+ *     The file descriptor to drain, cast to a pointer.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* bench_replay_drain(void* data) {
+
+    int fd = (int) (intptr_t) data;
+    char buffer[BENCH_REPLAY_DRAIN_BUFFER_SIZE];
+
+    while (read(fd, buffer, sizeof(buffer)) > 0);
+
+    close(fd);
+    return NULL;
+
+}
+
+/**
+ * Opens a TCP connection to a temporary listening socket on the loopback
+ * interface, returning both ends of the resulting connection.
+ *
+ * @param drain_fd
+ *     Pointer to the int in which the receiving end of the connection should
+ *     be stored.
+ *
+ * @return
+ *     The sending end of the connection, or -1 if the connection cannot be
+ *     established.
+ */
+static int bench_replay_open_loopback(int* drain_fd) {
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+
+    socklen_t addr_length = sizeof(addr);
+
+    /* Listen on any available port */
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        return -1;
+
+    if (bind(listener, (struct sockaddr*) &addr, sizeof(addr))
+            || listen(listener, 1)
+            || getsockname(listener, (struct sockaddr*) &addr, &addr_length)) {
+        close(listener);
+        return -1;
+    }
+
+    /* Connect to that port, accepting the resulting connection */
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr))) {
+        if (fd >= 0)
+            close(fd);
+        close(listener);
+        return -1;
+    }
+
+    *drain_fd = accept(listener, NULL, NULL);
+    close(listener);
+
+    if (*drain_fd < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+
+}
+
+/**
+ * Adds a new simulated viewer to the given connection, storing that viewer
+ * at the given index within the connection's viewers. Data sent to the
+ * viewer is counted within the connection's metrics and written to the sink
+ * specified by the connection's options.
+ *
+ * @param connection
+ *     The simulated connection to add a viewer to.
+ *
+ * @param index
+ *     The index of the new viewer.
+ *
+ * @return
+ *     Zero if the viewer was added successfully, non-zero otherwise.
+ */
+static int bench_replay_add_viewer(bench_replay_connection* connection,
+        int index) {
+
+    int fd;
+
+    /* Write to a loopback connection drained by a separate thread */
+    if (connection->options->sink == BENCH_REPLAY_SINK_LOOPBACK) {
+
+        int drain_fd;
+        fd = bench_replay_open_loopback(&drain_fd);
+        if (fd < 0)
+            return 1;
+
+        if (pthread_create(&connection->drains[index], NULL,
+                    bench_replay_drain, (void*) (intptr_t) drain_fd)) {
+            close(drain_fd);
+            close(fd);
+            return 1;
+        }
+
+    }
+
+    /* Otherwise, simply discard all data */
+    else {
+        fd = open("/dev/null", O_WRONLY);
+        if (fd < 0)
+            return 1;
+    }
+
+    guac_user* user = guac_user_alloc();
+    user->client = connection->client;
+    user->socket = guac_socket_open(fd);
+    user->owner = (index == 0);
+
+    /* Count data sent as guac_user_handle_connection() would */
+    user->metrics = guac_metrics_add_user(&connection->metrics, user->user_id);
+    user->socket->user_metrics = user->metrics;
+    user->socket->metrics = &connection->metrics;
+
+    guac_client_add_user(connection->client, user, 0, NULL);
+    connection->viewers[index] = user;
+    return 0;
+
+}
+
+/**
+ * Removes and frees the simulated viewer stored at the given index within
+ * the given connection, if any, waiting for any associated loopback
+ * connection to be fully drained.
+ *
+ * @param connection
+ *     The simulated connection to remove a viewer from.
+ *
+ * @param index
+ *     The index of the viewer to remove.
+ */
+static void bench_replay_remove_viewer(bench_replay_connection* connection,
+        int index) {
+
+    guac_user* user = connection->viewers[index];
+    if (user == NULL)
+        return;
+
+    guac_client_remove_user(connection->client, user);
+    guac_metrics_remove_user(user->metrics);
+
+    /* Closing the socket signals the end of data to any drain thread */
+    guac_socket_free(user->socket);
+    if (connection->options->sink == BENCH_REPLAY_SINK_LOOPBACK)
+        pthread_join(connection->drains[index], NULL);
+
+    guac_user_free(user);
+    connection->viewers[index] = NULL;
+
+}
+
+bench_replay_connection* bench_replay_connection_alloc(
+        const bench_replay_options* options) {
+
+    bench_replay_connection* connection =
+        calloc(1, sizeof(bench_replay_connection));
+    if (connection == NULL)
+        return NULL;
+
+    connection->options = options;
+    connection->client = guac_client_alloc();
+    if (connection->client == NULL) {
+        free(connection);
+        return NULL;
+    }
+
+    guac_metrics_init(&connection->metrics,
+            connection->client->connection_id, "replay");
+    guac_client_set_metrics(connection->client, &connection->metrics);
+
+    for (int i = 0; i < options->viewers; i++) {
+        if (bench_replay_add_viewer(connection, i)) {
+            bench_replay_connection_free(connection);
+            return NULL;
+        }
+    }
+
+    /* The recording itself defines the size of the default layer */
+    connection->display = guac_common_display_alloc(connection->client, 0, 0);
+    return connection;
+
+}
+
+void* bench_replay_connection_run(void* data) {
+
+    bench_replay_connection* connection = (bench_replay_connection*) data;
+
+    int fd = open(connection->options->path, O_RDONLY);
+    if (fd < 0) {
+        connection->failed = 1;
+        return NULL;
+    }
+
+    guac_socket* socket = guac_socket_open(fd);
+    guac_parser* parser = guac_parser_alloc();
+
+    /* Apply each instruction, flushing a frame at each "sync" */
+    while (!guac_parser_read(parser, socket, -1))
+        bench_replay_handle_instruction(connection, parser->opcode,
+                parser->argc, parser->argv);
+
+    /* Fail on read/parse error */
+    if (guac_error != GUAC_STATUS_CLOSED)
+        connection->failed = 1;
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+    return NULL;
+
+}
+
+void bench_replay_connection_flush(bench_replay_connection* connection) {
+
+    struct timespec cpu_start;
+    struct timespec cpu_end;
+
+    uint64_t start = guac_metrics_current_time();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+
+    /* Encode pending changes and send to all viewers */
+    guac_common_display_flush(connection->display);
+    guac_client_end_frame(connection->client);
+    guac_socket_flush(connection->client->socket);
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    uint64_t latency = guac_metrics_current_time() - start;
+
+    connection->encode_cpu +=
+          (uint64_t) (cpu_end.tv_sec - cpu_start.tv_sec) * 1000000000
+        + cpu_end.tv_nsec - cpu_start.tv_nsec;
+
+    /* Grow latency storage as necessary */
+    if (connection->frames == connection->latencies_size) {
+
+        int size = connection->latencies_size ? connection->latencies_size * 2 : 1024;
+        uint64_t* latencies = realloc(connection->latencies,
+                size * sizeof(uint64_t));
+        if (latencies == NULL)
+            return;
+
+        connection->latencies = latencies;
+        connection->latencies_size = size;
+
+    }
+
+    connection->latencies[connection->frames++] = latency;
+
+}
+
+void bench_replay_connection_free(bench_replay_connection* connection) {
+
+    for (int i = 0; i < BENCH_REPLAY_MAX_VIEWERS; i++)
+        bench_replay_remove_viewer(connection, i);
+
+    for (int i = 0; i < BENCH_REPLAY_MAX_STREAMS; i++)
+        free(connection->streams[i].data);
+
+    if (connection->display != NULL)
+        guac_common_display_free(connection->display);
+
+    guac_client_free(connection->client);
+    free(connection->latencies);
+    free(connection);
+
+}
+
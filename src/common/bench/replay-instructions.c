@@ -0,0 +1,512 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/display.h"
+#include "common/surface.h"
+#include "jpeg.h"
+#include "png.h"
+#include "replay.h"
+
+#ifdef ENABLE_WEBP
+#include "webp.h"
+#endif
+
+#include <cairo/cairo.h>
+#include <guacamole/protocol.h>
+#include <guacamole/timestamp.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Handler for a single type of instruction read from a replayed recording.
+ *
+ * @param connection
+ *     The simulated connection replaying the recording.
+ *
+ * @param argc
+ *     The number of arguments of the instruction.
+ *
+ * @param argv
+ *     The arguments of the instruction.
+ *
+ * @return
+ *     Zero if the instruction was handled successfully, non-zero if the
+ *     instruction was malformed.
+ */
+typedef int bench_replay_instruction_handler(
+        bench_replay_connection* connection, int argc, char** argv);
+
+/**
+ * Mapping of instruction opcode to corresponding handler.
+ */
+typedef struct bench_replay_instruction_handler_mapping {
+
+    /**
+     * The opcode of the instruction handled.
+     */
+    const char* opcode;
+
+    /**
+     * The handler for instructions having the associated opcode.
+     */
+    bench_replay_instruction_handler* handler;
+
+} bench_replay_instruction_handler_mapping;
+
+/**
+ * Returns the surface of the layer or buffer having the given index,
+ * allocating that layer or buffer if it has not yet been referenced.
+ *
+ * @param connection
+ *     The simulated connection replaying the recording.
+ *
+ * @param index
+ *     The index of the layer or buffer, as used within the recording.
+ *
+ * @return
+ *     The surface of the layer or buffer having the given index, or NULL if
+ *     the index is out of range.
+ */
+static guac_common_surface* bench_replay_get_surface(
+        bench_replay_connection* connection, int index) {
+
+    guac_common_display* display = connection->display;
+
+    /* The default layer always exists */
+    if (index == 0)
+        return display->default_surface;
+
+    /* Visible layers have positive indices */
+    if (index > 0) {
+
+        if (index >= BENCH_REPLAY_MAX_LAYERS)
+            return NULL;
+
+        if (connection->layers[index] == NULL)
+            connection->layers[index] =
+                guac_common_display_alloc_layer(display, 0, 0);
+
+        return connection->layers[index]->surface;
+
+    }
+
+    /* Off-screen buffers have negative indices */
+    int buffer = -1 - index;
+    if (buffer >= BENCH_REPLAY_MAX_BUFFERS)
+        return NULL;
+
+    if (connection->buffers[buffer] == NULL)
+        connection->buffers[buffer] =
+            guac_common_display_alloc_buffer(display, 0, 0);
+
+    return connection->buffers[buffer]->surface;
+
+}
+
+/**
+ * Returns the image stream having the given index, or NULL if the index is
+ * out of range.
+ *
+ * @param connection
+ *     The simulated connection replaying the recording.
+ *
+ * @param index
+ *     The index of the stream, as used within the recording.
+ *
+ * @return
+ *     The image stream having the given index, or NULL if the index is out of
+ *     range.
+ */
+static bench_replay_stream* bench_replay_get_stream(
+        bench_replay_connection* connection, int index) {
+
+    if (index < 0 || index >= BENCH_REPLAY_MAX_STREAMS)
+        return NULL;
+
+    return &connection->streams[index];
+
+}
+
+/**
+ * Decodes the given image data using the decoder associated with the given
+ * mimetype, the same decoders used by guacenc.
+ *
+ * @param mimetype
+ *     The mimetype of the image data.
+ *
+ * @param data
+ *     The image data to decode.
+ *
+ * @param length
+ *     The number of bytes of image data.
+ *
+ * @return
+ *     A newly-allocated Cairo surface containing the decoded image, or NULL
+ *     if the image cannot be decoded.
+ */
+static cairo_surface_t* bench_replay_decode(const char* mimetype,
+        unsigned char* data, int length) {
+
+    if (strcmp(mimetype, "image/png") == 0)
+        return guacenc_png_decoder(data, length);
+
+    if (strcmp(mimetype, "image/jpeg") == 0)
+        return guacenc_jpeg_decoder(data, length);
+
+#ifdef ENABLE_WEBP
+    if (strcmp(mimetype, "image/webp") == 0)
+        return guacenc_webp_decoder(data, length);
+#endif
+
+    return NULL;
+
+}
+
+static int bench_replay_handle_size(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 3)
+        return 1;
+
+    guac_common_surface* surface =
+        bench_replay_get_surface(connection, atoi(argv[0]));
+    if (surface == NULL)
+        return 1;
+
+    guac_common_surface_resize(surface, atoi(argv[1]), atoi(argv[2]));
+    return 0;
+
+}
+
+static int bench_replay_handle_rect(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 5)
+        return 1;
+
+    /* Rectangle is only drawn once filled */
+    connection->rect_layer = atoi(argv[0]);
+    connection->rect_x = atoi(argv[1]);
+    connection->rect_y = atoi(argv[2]);
+    connection->rect_width = atoi(argv[3]);
+    connection->rect_height = atoi(argv[4]);
+    return 0;
+
+}
+
+static int bench_replay_handle_cfill(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 6)
+        return 1;
+
+    /* Only rectangular paths are supported */
+    int layer = atoi(argv[1]);
+    if (layer != connection->rect_layer)
+        return 1;
+
+    guac_common_surface* surface = bench_replay_get_surface(connection, layer);
+    if (surface == NULL)
+        return 1;
+
+    guac_common_surface_set(surface,
+            connection->rect_x, connection->rect_y,
+            connection->rect_width, connection->rect_height,
+            atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+
+    return 0;
+
+}
+
+static int bench_replay_handle_copy(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 9)
+        return 1;
+
+    guac_common_surface* src = bench_replay_get_surface(connection, atoi(argv[0]));
+    guac_common_surface* dst = bench_replay_get_surface(connection, atoi(argv[6]));
+    if (src == NULL || dst == NULL)
+        return 1;
+
+    guac_common_surface_copy(src, atoi(argv[1]), atoi(argv[2]),
+            atoi(argv[3]), atoi(argv[4]), dst, atoi(argv[7]), atoi(argv[8]));
+
+    return 0;
+
+}
+
+static int bench_replay_handle_transfer(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 9)
+        return 1;
+
+    guac_common_surface* src = bench_replay_get_surface(connection, atoi(argv[0]));
+    guac_common_surface* dst = bench_replay_get_surface(connection, atoi(argv[6]));
+    if (src == NULL || dst == NULL)
+        return 1;
+
+    guac_common_surface_transfer(src, atoi(argv[1]), atoi(argv[2]),
+            atoi(argv[3]), atoi(argv[4]),
+            (guac_transfer_function) atoi(argv[5]),
+            dst, atoi(argv[7]), atoi(argv[8]));
+
+    return 0;
+
+}
+
+static int bench_replay_handle_img(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 6)
+        return 1;
+
+    bench_replay_stream* stream =
+        bench_replay_get_stream(connection, atoi(argv[0]));
+    if (stream == NULL)
+        return 1;
+
+    stream->open = 1;
+    stream->layer = atoi(argv[2]);
+    stream->x = atoi(argv[4]);
+    stream->y = atoi(argv[5]);
+    stream->length = 0;
+
+    strncpy(stream->mimetype, argv[3], sizeof(stream->mimetype) - 1);
+    stream->mimetype[sizeof(stream->mimetype) - 1] = '\0';
+
+    return 0;
+
+}
+
+static int bench_replay_handle_blob(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 2)
+        return 1;
+
+    bench_replay_stream* stream =
+        bench_replay_get_stream(connection, atoi(argv[0]));
+    if (stream == NULL || !stream->open)
+        return 1;
+
+    /* Decode base64 in place */
+    int length = guac_protocol_decode_base64(argv[1]);
+
+    /* Grow buffer as necessary, retaining the buffer for future streams */
+    if (stream->length + length > stream->size) {
+
+        int size = stream->size ? stream->size : 8192;
+        while (stream->length + length > size)
+            size *= 2;
+
+        unsigned char* data = realloc(stream->data, size);
+        if (data == NULL)
+            return 1;
+
+        stream->data = data;
+        stream->size = size;
+
+    }
+
+    memcpy(stream->data + stream->length, argv[1], length);
+    stream->length += length;
+    return 0;
+
+}
+
+static int bench_replay_handle_end(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 1)
+        return 1;
+
+    bench_replay_stream* stream =
+        bench_replay_get_stream(connection, atoi(argv[0]));
+    if (stream == NULL || !stream->open)
+        return 1;
+
+    stream->open = 0;
+
+    guac_common_surface* surface =
+        bench_replay_get_surface(connection, stream->layer);
+    if (surface == NULL)
+        return 1;
+
+    cairo_surface_t* image = bench_replay_decode(stream->mimetype,
+            stream->data, stream->length);
+    if (image == NULL)
+        return 1;
+
+    guac_common_surface_draw(surface, stream->x, stream->y, image);
+    cairo_surface_destroy(image);
+    return 0;
+
+}
+
+static int bench_replay_handle_move(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 5)
+        return 1;
+
+    /* Only visible, non-default layers may be moved */
+    int index = atoi(argv[0]);
+    if (index <= 0)
+        return 1;
+
+    guac_common_surface* surface = bench_replay_get_surface(connection, index);
+    if (surface == NULL)
+        return 1;
+
+    /* Resolve parent, which must also be a visible layer */
+    int parent_index = atoi(argv[1]);
+    if (parent_index < 0)
+        return 1;
+
+    guac_common_surface* parent =
+        bench_replay_get_surface(connection, parent_index);
+    if (parent == NULL)
+        return 1;
+
+    guac_common_surface_set_parent(surface, parent->layer);
+    guac_common_surface_move(surface, atoi(argv[2]), atoi(argv[3]));
+    guac_common_surface_stack(surface, atoi(argv[4]));
+    return 0;
+
+}
+
+static int bench_replay_handle_shade(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 2)
+        return 1;
+
+    guac_common_surface* surface =
+        bench_replay_get_surface(connection, atoi(argv[0]));
+    if (surface == NULL)
+        return 1;
+
+    guac_common_surface_set_opacity(surface, atoi(argv[1]));
+    return 0;
+
+}
+
+static int bench_replay_handle_dispose(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 1)
+        return 1;
+
+    int index = atoi(argv[0]);
+
+    /* Free visible layer, if allocated */
+    if (index > 0 && index < BENCH_REPLAY_MAX_LAYERS) {
+        if (connection->layers[index] != NULL) {
+            guac_common_display_free_layer(connection->display,
+                    connection->layers[index]);
+            connection->layers[index] = NULL;
+        }
+        return 0;
+    }
+
+    /* Free off-screen buffer, if allocated */
+    int buffer = -1 - index;
+    if (index < 0 && buffer < BENCH_REPLAY_MAX_BUFFERS) {
+        if (connection->buffers[buffer] != NULL) {
+            guac_common_display_free_buffer(connection->display,
+                    connection->buffers[buffer]);
+            connection->buffers[buffer] = NULL;
+        }
+        return 0;
+    }
+
+    return 1;
+
+}
+
+static int bench_replay_handle_sync(bench_replay_connection* connection,
+        int argc, char** argv) {
+
+    if (argc < 1)
+        return 1;
+
+    guac_timestamp timestamp = strtoll(argv[0], NULL, 10);
+
+    /* Timing is relative to the first frame */
+    if (connection->first_sync == 0) {
+        connection->first_sync = timestamp;
+        connection->start = guac_timestamp_current();
+    }
+
+    /* Wait until the frame would have been sent originally */
+    else if (connection->options->realtime) {
+        guac_timestamp elapsed = guac_timestamp_current() - connection->start;
+        guac_timestamp remaining = timestamp - connection->first_sync - elapsed;
+        if (remaining > 0)
+            guac_timestamp_msleep(remaining);
+    }
+
+    bench_replay_connection_flush(connection);
+    return 0;
+
+}
+
+/**
+ * All instructions which affect the display, along with their handlers.
+ * Instructions not listed here are ignored.
+ */
+static bench_replay_instruction_handler_mapping bench_replay_handler_map[] = {
+    {"blob",     bench_replay_handle_blob},
+    {"img",      bench_replay_handle_img},
+    {"end",      bench_replay_handle_end},
+    {"sync",     bench_replay_handle_sync},
+    {"copy",     bench_replay_handle_copy},
+    {"transfer", bench_replay_handle_transfer},
+    {"size",     bench_replay_handle_size},
+    {"rect",     bench_replay_handle_rect},
+    {"cfill",    bench_replay_handle_cfill},
+    {"move",     bench_replay_handle_move},
+    {"shade",    bench_replay_handle_shade},
+    {"dispose",  bench_replay_handle_dispose},
+    {NULL,       NULL}
+};
+
+int bench_replay_handle_instruction(bench_replay_connection* connection,
+        const char* opcode, int argc, char** argv) {
+
+    /* Search through mapping for instruction handler having given opcode */
+    bench_replay_instruction_handler_mapping* current = bench_replay_handler_map;
+    while (current->opcode != NULL) {
+
+        if (strcmp(current->opcode, opcode) == 0)
+            return current->handler(connection, argc, argv);
+
+        current++;
+
+    }
+
+    /* Ignore any unknown instructions */
+    return 0;
+
+}
+
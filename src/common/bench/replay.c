@@ -0,0 +1,282 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "replay.h"
+
+#include <guacamole/metrics.h>
+
+#include <sys/resource.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Comparison function for sorting frame latencies with qsort().
+ *
+ * @param a
+ *     Pointer to the first uint64_t latency.
+ *
+ * @param b
+ *     Pointer to the second uint64_t latency.
+ *
+ * @return
+ *     A negative value, zero, or a positive value if the first latency is
+ *     less than, equal to, or greater than the second latency, respectively.
+ */
+static int bench_replay_compare_latency(const void* a, const void* b) {
+
+    uint64_t latency_a = *((const uint64_t*) a);
+    uint64_t latency_b = *((const uint64_t*) b);
+
+    return (latency_a > latency_b) - (latency_a < latency_b);
+
+}
+
+/**
+ * Returns the given percentile of the given sorted frame latencies, in
+ * milliseconds.
+ *
+ * @param latencies
+ *     The frame latencies, in microseconds, sorted in ascending order.
+ *
+ * @param count
+ *     The number of frame latencies.
+ *
+ * @param percentile
+ *     The percentile to return, from 0 to 100 inclusive.
+ *
+ * @return
+ *     The requested percentile, in milliseconds, or zero if there are no
+ *     latencies.
+ */
+static double bench_replay_percentile(const uint64_t* latencies, int count,
+        int percentile) {
+
+    if (count == 0)
+        return 0;
+
+    return latencies[(int64_t) (count - 1) * percentile / 100] / 1000.0;
+
+}
+
+/**
+ * Writes the combined results of all given simulated connections to STDOUT
+ * as a single JSON object.
+ *
+ * @param options
+ *     The options shared by all simulated connections.
+ *
+ * @param connections
+ *     All simulated connections, each of which must have finished replaying
+ *     its recording.
+ *
+ * @param count
+ *     The number of simulated connections.
+ *
+ * @param duration
+ *     The wall-clock time taken to replay all recordings, in microseconds.
+ */
+static void bench_replay_report(const bench_replay_options* options,
+        bench_replay_connection** connections, int count, uint64_t duration) {
+
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t encode_cpu = 0;
+    uint64_t images[GUAC_METRICS_IMAGE_FORMATS] = { 0 };
+    uint64_t stream_time[GUAC_METRICS_IMAGE_FORMATS] = { 0 };
+
+    for (int i = 0; i < count; i++) {
+
+        bench_replay_connection* connection = connections[i];
+        frames += connection->frames;
+        encode_cpu += connection->encode_cpu;
+
+        for (int j = 0; j < GUAC_METRICS_IMAGE_FORMATS; j++) {
+            images[j] += connection->metrics.images[j];
+            stream_time[j] += connection->metrics.stream_time[j];
+        }
+
+        for (int j = 0; j < BENCH_REPLAY_MAX_VIEWERS; j++)
+            bytes += connection->metrics.users[j].bytes_sent;
+
+    }
+
+    /* Combine and sort all latencies to determine percentiles */
+    uint64_t* latencies = malloc((frames ? frames : 1) * sizeof(uint64_t));
+    if (latencies == NULL)
+        frames = 0;
+
+    uint64_t offset = 0;
+    for (int i = 0; latencies != NULL && i < count; i++) {
+        for (int j = 0; j < connections[i]->frames; j++)
+            latencies[offset++] = connections[i]->latencies[j];
+    }
+
+    qsort(latencies, frames, sizeof(uint64_t), bench_replay_compare_latency);
+
+    /* CPU time of the entire process, including decoding of the recording */
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+
+    double seconds = duration / 1000000.0;
+
+    printf("{\n");
+    printf("    \"connections\": %i, \"viewers\": %i, \"realtime\": %s, "
+            "\"sink\": \"%s\",\n", count, options->viewers,
+            options->realtime ? "true" : "false",
+            options->sink == BENCH_REPLAY_SINK_LOOPBACK ? "loopback" : "null");
+    printf("    \"seconds\": %.3f, \"cpu_seconds\": %.3f, "
+            "\"encode_cpu_seconds\": %.3f,\n",
+            seconds, cpu, encode_cpu / 1000000000.0);
+    printf("    \"frames\": %" PRIu64 ", \"frames_per_s\": %.1f,\n",
+            frames, seconds > 0 ? frames / seconds : 0);
+    printf("    \"bytes\": %" PRIu64 ", \"mb_per_s\": %.1f,\n",
+            bytes, seconds > 0 ? bytes / seconds / 1000000.0 : 0);
+    printf("    \"images\": {\"png\": %" PRIu64 ", \"jpeg\": %" PRIu64 ", "
+            "\"webp\": %" PRIu64 "},\n", images[GUAC_METRICS_PNG],
+            images[GUAC_METRICS_JPEG], images[GUAC_METRICS_WEBP]);
+    printf("    \"image_stream_seconds\": {\"png\": %.3f, \"jpeg\": %.3f, "
+            "\"webp\": %.3f},\n",
+            stream_time[GUAC_METRICS_PNG] / 1000000.0,
+            stream_time[GUAC_METRICS_JPEG] / 1000000.0,
+            stream_time[GUAC_METRICS_WEBP] / 1000000.0);
+    printf("    \"latency_ms\": {\"p50\": %.3f, \"p90\": %.3f, "
+            "\"p99\": %.3f, \"max\": %.3f}\n",
+            bench_replay_percentile(latencies, frames, 50),
+            bench_replay_percentile(latencies, frames, 90),
+            bench_replay_percentile(latencies, frames, 99),
+            bench_replay_percentile(latencies, frames, 100));
+    printf("}\n");
+
+    free(latencies);
+
+}
+
+/**
+ * Prints usage information for this tool to STDERR.
+ *
+ * @param name
+ *     The name of this tool, as invoked.
+ */
+static void bench_replay_usage(const char* name) {
+    fprintf(stderr, "USAGE: %s [-c CONNECTIONS] [-v VIEWERS] [-r] [-l] "
+            "RECORDING\n\n"
+            "    -c  Number of simulated connections (default 1)\n"
+            "    -v  Number of viewers per connection, at most %i "
+            "(default 1)\n"
+            "    -r  Honor the original timing of the recording\n"
+            "    -l  Send to viewers over loopback TCP rather than "
+            "/dev/null\n", name, BENCH_REPLAY_MAX_VIEWERS);
+}
+
+int main(int argc, char* argv[]) {
+
+    int count = 1;
+    bench_replay_options options = {
+        .viewers = 1,
+        .realtime = 0,
+        .sink = BENCH_REPLAY_SINK_NULL
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:v:rl")) != -1) {
+        switch (opt) {
+
+            case 'c':
+                count = atoi(optarg);
+                break;
+
+            case 'v':
+                options.viewers = atoi(optarg);
+                break;
+
+            case 'r':
+                options.realtime = 1;
+                break;
+
+            case 'l':
+                options.sink = BENCH_REPLAY_SINK_LOOPBACK;
+                break;
+
+            default:
+                bench_replay_usage(argv[0]);
+                return 1;
+
+        }
+    }
+
+    /* Exactly one recording must be given */
+    if (optind != argc - 1 || count < 1 || options.viewers < 1
+            || options.viewers > BENCH_REPLAY_MAX_VIEWERS) {
+        bench_replay_usage(argv[0]);
+        return 1;
+    }
+
+    options.path = argv[optind];
+
+    bench_replay_connection** connections =
+        calloc(count, sizeof(bench_replay_connection*));
+
+    for (int i = 0; i < count; i++) {
+        connections[i] = bench_replay_connection_alloc(&options);
+        if (connections[i] == NULL) {
+            fprintf(stderr, "Unable to allocate simulated connection.\n");
+            return 1;
+        }
+    }
+
+    uint64_t start = guac_metrics_current_time();
+
+    /* Replay all connections concurrently */
+    for (int i = 0; i < count; i++) {
+        if (pthread_create(&connections[i]->thread, NULL,
+                    bench_replay_connection_run, connections[i])) {
+            fprintf(stderr, "Unable to start simulated connection.\n");
+            return 1;
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_join(connections[i]->thread, NULL);
+        failed |= connections[i]->failed;
+    }
+
+    uint64_t duration = guac_metrics_current_time() - start;
+
+    if (failed)
+        fprintf(stderr, "%s: Recording could not be replayed in its "
+                "entirety.\n", options.path);
+
+    bench_replay_report(&options, connections, count, duration);
+
+    for (int i = 0; i < count; i++)
+        bench_replay_connection_free(connections[i]);
+
+    free(connections);
+    return failed;
+
+}
+
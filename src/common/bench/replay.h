@@ -0,0 +1,373 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_BENCH_REPLAY_H
+#define GUAC_BENCH_REPLAY_H
+
+#include "config.h"
+#include "common/display.h"
+
+#include <guacamole/client.h>
+#include <guacamole/metrics.h>
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * The maximum number of visible layers which may be referenced by a replayed
+ * recording, including the default layer.
+ */
+#define BENCH_REPLAY_MAX_LAYERS 64
+
+/**
+ * The maximum number of off-screen buffers which may be referenced by a
+ * replayed recording.
+ */
+#define BENCH_REPLAY_MAX_BUFFERS 4096
+
+/**
+ * The maximum number of image streams which may be simultaneously open
+ * within a replayed recording.
+ */
+#define BENCH_REPLAY_MAX_STREAMS 64
+
+/**
+ * The maximum number of simulated viewers per connection. Each viewer
+ * occupies one of the user slots of the connection's guac_metrics, which is
+ * where the bytes sent to each viewer are counted.
+ */
+#define BENCH_REPLAY_MAX_VIEWERS GUAC_METRICS_MAX_USERS
+
+/**
+ * The maximum length of the mimetype of any image stream, including null
+ * terminator.
+ */
+#define BENCH_REPLAY_MIMETYPE_LENGTH 32
+
+/**
+ * The destination of all data sent to simulated viewers.
+ */
+typedef enum bench_replay_sink {
+
+    /**
+     * Data is written to "/dev/null", measuring only the cost of producing
+     * that data.
+     */
+    BENCH_REPLAY_SINK_NULL,
+
+    /**
+     * Data is written to a TCP connection over the loopback interface, which
+     * is continuously drained by a separate thread, additionally measuring
+     * the cost of pushing that data through the network stack.
+     */
+    BENCH_REPLAY_SINK_LOOPBACK
+
+} bench_replay_sink;
+
+/**
+ * The options shared by all simulated connections.
+ */
+typedef struct bench_replay_options {
+
+    /**
+     * The path to the recording being replayed.
+     */
+    const char* path;
+
+    /**
+     * The number of simulated viewers of each connection.
+     */
+    int viewers;
+
+    /**
+     * Non-zero if the original timing of the recording should be honored,
+     * zero if the recording should be replayed as quickly as possible.
+     */
+    int realtime;
+
+    /**
+     * The destination of all data sent to simulated viewers.
+     */
+    bench_replay_sink sink;
+
+} bench_replay_options;
+
+/**
+ * An image stream within a replayed recording, the contents of which are
+ * buffered until the stream ends.
+ */
+typedef struct bench_replay_stream {
+
+    /**
+     * Non-zero if this stream is currently open, zero otherwise.
+     */
+    int open;
+
+    /**
+     * The index of the layer or buffer that the image should be drawn to.
+     */
+    int layer;
+
+    /**
+     * The mimetype of the image being received.
+     */
+    char mimetype[BENCH_REPLAY_MIMETYPE_LENGTH];
+
+    /**
+     * The X coordinate of the upper-left corner of the destination
+     * rectangle.
+     */
+    int x;
+
+    /**
+     * The Y coordinate of the upper-left corner of the destination
+     * rectangle.
+     */
+    int y;
+
+    /**
+     * The image data received thus far.
+     */
+    unsigned char* data;
+
+    /**
+     * The number of bytes of image data received thus far.
+     */
+    int length;
+
+    /**
+     * The number of bytes currently allocated for the image data.
+     */
+    int size;
+
+} bench_replay_stream;
+
+/**
+ * A single simulated connection, replaying a recording through its own
+ * guac_common_display to its own set of simulated viewers.
+ */
+typedef struct bench_replay_connection {
+
+    /**
+     * The options shared by all simulated connections.
+     */
+    const bench_replay_options* options;
+
+    /**
+     * The thread replaying the recording.
+     */
+    pthread_t thread;
+
+    /**
+     * The client broadcasting all drawing operations to the simulated
+     * viewers.
+     */
+    guac_client* client;
+
+    /**
+     * The display whose layers and buffers are drawn to by the recording.
+     */
+    guac_common_display* display;
+
+    /**
+     * All simulated viewers of this connection.
+     */
+    guac_user* viewers[BENCH_REPLAY_MAX_VIEWERS];
+
+    /**
+     * The threads draining each viewer's side of a loopback connection, if
+     * the loopback sink is in use.
+     */
+    pthread_t drains[BENCH_REPLAY_MAX_VIEWERS];
+
+    /**
+     * All layers referenced by the recording, indexed by the layer index
+     * used within the recording. The default layer is stored within the
+     * display itself and is not present here.
+     */
+    guac_common_display_layer* layers[BENCH_REPLAY_MAX_LAYERS];
+
+    /**
+     * All buffers referenced by the recording, indexed by the absolute value
+     * of the buffer index used within the recording, minus one.
+     */
+    guac_common_display_layer* buffers[BENCH_REPLAY_MAX_BUFFERS];
+
+    /**
+     * All image streams referenced by the recording, indexed by stream
+     * index.
+     */
+    bench_replay_stream streams[BENCH_REPLAY_MAX_STREAMS];
+
+    /**
+     * The index of the layer or buffer affected by the most recent "rect"
+     * instruction.
+     */
+    int rect_layer;
+
+    /**
+     * The X coordinate of the rectangle defined by the most recent "rect"
+     * instruction.
+     */
+    int rect_x;
+
+    /**
+     * The Y coordinate of the rectangle defined by the most recent "rect"
+     * instruction.
+     */
+    int rect_y;
+
+    /**
+     * The width of the rectangle defined by the most recent "rect"
+     * instruction.
+     */
+    int rect_width;
+
+    /**
+     * The height of the rectangle defined by the most recent "rect"
+     * instruction.
+     */
+    int rect_height;
+
+    /**
+     * The timestamp of the first "sync" instruction within the recording, or
+     * zero if no "sync" instruction has yet been read.
+     */
+    guac_timestamp first_sync;
+
+    /**
+     * The time that the first frame of the recording was sent.
+     */
+    guac_timestamp start;
+
+    /**
+     * Performance metrics for this connection, including the number of bytes
+     * sent to each viewer and the time spent encoding each image format.
+     */
+    guac_metrics metrics;
+
+    /**
+     * The latency of every frame sent, from the point the frame's "sync"
+     * instruction was read to the point all viewers had been sent the
+     * resulting frame, in microseconds.
+     */
+    uint64_t* latencies;
+
+    /**
+     * The number of frames sent, and thus the number of values stored within
+     * latencies.
+     */
+    int frames;
+
+    /**
+     * The number of values which may be stored within latencies before it
+     * must be reallocated.
+     */
+    int latencies_size;
+
+    /**
+     * The CPU time consumed by this connection's thread while flushing
+     * frames, in nanoseconds. This includes the cost of encoding images and
+     * of writing the encoded frames to all viewers.
+     */
+    uint64_t encode_cpu;
+
+    /**
+     * Non-zero if the recording could not be replayed in its entirety, zero
+     * otherwise.
+     */
+    int failed;
+
+} bench_replay_connection;
+
+/**
+ * Allocates a new simulated connection, including its simulated viewers.
+ * The recording is not replayed until bench_replay_connection_run() is
+ * invoked.
+ *
+ * @param options
+ *     The options shared by all simulated connections.
+ *
+ * @return
+ *     A newly-allocated simulated connection, or NULL if the connection or
+ *     any of its viewers cannot be allocated.
+ */
+bench_replay_connection* bench_replay_connection_alloc(
+        const bench_replay_options* options);
+
+/**
+ * Replays the recording associated with the given simulated connection in
+ * its entirety. This function is suitable for use as the start routine of a
+ * pthread.
+ *
+ * @param data
+ *     The bench_replay_connection to replay the recording of.
+ *
+ * @return
+ *     Always NULL.
+ */
+void* bench_replay_connection_run(void* data);
+
+/**
+ * Disconnects all viewers of the given simulated connection and frees all
+ * associated resources.
+ *
+ * @param connection
+ *     The simulated connection to free.
+ */
+void bench_replay_connection_free(bench_replay_connection* connection);
+
+/**
+ * Handles a single instruction read from the recording associated with the
+ * given simulated connection, applying any drawing operations to the
+ * connection's display. Instructions which do not affect the display are
+ * ignored.
+ *
+ * @param connection
+ *     The simulated connection replaying the recording.
+ *
+ * @param opcode
+ *     The opcode of the instruction read.
+ *
+ * @param argc
+ *     The number of arguments of the instruction read.
+ *
+ * @param argv
+ *     The arguments of the instruction read.
+ *
+ * @return
+ *     Zero if the instruction was handled successfully or ignored, non-zero
+ *     if the instruction was malformed.
+ */
+int bench_replay_handle_instruction(bench_replay_connection* connection,
+        const char* opcode, int argc, char** argv);
+
+/**
+ * Sends all pending changes to the display of the given simulated connection
+ * as a single frame, recording the latency of that frame and the CPU time
+ * required.
+ *
+ * @param connection
+ *     The simulated connection whose display should be flushed.
+ */
+void bench_replay_connection_flush(bench_replay_connection* connection);
+
+#endif
+
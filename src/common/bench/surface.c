@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/surface.h"
+#include "harness.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The width of the surface drawn to, in pixels.
+ */
+#define BENCH_SURFACE_WIDTH 1024
+
+/**
+ * The height of the surface drawn to, in pixels.
+ */
+#define BENCH_SURFACE_HEIGHT 768
+
+/**
+ * The width and height of each tile drawn by the large update benchmark, in
+ * pixels.
+ */
+#define BENCH_SURFACE_TILE_SIZE 64
+
+/**
+ * The width and height of each glyph drawn by the small update benchmark, in
+ * pixels.
+ */
+#define BENCH_SURFACE_GLYPH_SIZE 8
+
+/**
+ * The number of glyphs drawn by each iteration of the small update
+ * benchmark, comparable to a line of text.
+ */
+#define BENCH_SURFACE_GLYPHS 80
+
+/**
+ * A surface being drawn to, along with the image data drawn.
+ */
+typedef struct bench_surface_data {
+
+    /**
+     * The surface being drawn to.
+     */
+    guac_common_surface* surface;
+
+    /**
+     * The image data to draw.
+     */
+    cairo_surface_t* image;
+
+    /**
+     * The number of times the image has been drawn, used to vary the draw
+     * location.
+     */
+    int draws;
+
+} bench_surface_data;
+
+/**
+ * Allocates a new RGB24 image of the given size, filled with random pixels.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ *
+ * @return
+ *     A newly-allocated image filled with random pixels.
+ */
+static cairo_surface_t* bench_surface_create_image(int width, int height) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            width, height);
+
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+
+    for (int y = 0; y < height; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < width; x++)
+            row[x] = rand() & 0xFFFFFF;
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Draws a single tile to a different location of the surface each
+ * iteration, flushing the surface after each draw.
+ */
+static void bench_surface_draw_tile(void* data) {
+
+    bench_surface_data* bench = (bench_surface_data*) data;
+
+    int columns = BENCH_SURFACE_WIDTH / BENCH_SURFACE_TILE_SIZE;
+    int rows = BENCH_SURFACE_HEIGHT / BENCH_SURFACE_TILE_SIZE;
+    int tile = bench->draws++ % (columns * rows);
+
+    guac_common_surface_draw(bench->surface,
+            (tile % columns) * BENCH_SURFACE_TILE_SIZE,
+            (tile / columns) * BENCH_SURFACE_TILE_SIZE,
+            bench->image);
+
+    guac_common_surface_flush(bench->surface);
+
+}
+
+/**
+ * Draws a line of small glyphs, flushing the surface only once the entire
+ * line has been drawn, such that the individual updates are combined.
+ */
+static void bench_surface_draw_glyphs(void* data) {
+
+    bench_surface_data* bench = (bench_surface_data*) data;
+
+    int lines = BENCH_SURFACE_HEIGHT / BENCH_SURFACE_GLYPH_SIZE;
+    int y = (bench->draws++ % lines) * BENCH_SURFACE_GLYPH_SIZE;
+
+    for (int i = 0; i < BENCH_SURFACE_GLYPHS; i++)
+        guac_common_surface_draw(bench->surface,
+                i * BENCH_SURFACE_GLYPH_SIZE, y, bench->image);
+
+    guac_common_surface_flush(bench->surface);
+
+}
+
+void bench_surface() {
+
+    /* Output is broadcast to zero users and thus discarded */
+    guac_client* client = guac_client_alloc();
+    if (client == NULL)
+        return;
+
+    guac_common_surface* surface = guac_common_surface_alloc(client,
+            client->socket, GUAC_DEFAULT_LAYER,
+            BENCH_SURFACE_WIDTH, BENCH_SURFACE_HEIGHT);
+
+    bench_surface_data tiles = {
+        .surface = surface,
+        .image = bench_surface_create_image(BENCH_SURFACE_TILE_SIZE,
+                BENCH_SURFACE_TILE_SIZE)
+    };
+
+    bench_surface_data glyphs = {
+        .surface = surface,
+        .image = bench_surface_create_image(BENCH_SURFACE_GLYPH_SIZE,
+                BENCH_SURFACE_GLYPH_SIZE)
+    };
+
+    guac_bench_run("surface_draw_flush_tile", bench_surface_draw_tile,
+            &tiles, BENCH_SURFACE_TILE_SIZE * BENCH_SURFACE_TILE_SIZE * 4);
+
+    guac_bench_run("surface_draw_flush_glyphs", bench_surface_draw_glyphs,
+            &glyphs, BENCH_SURFACE_GLYPHS * BENCH_SURFACE_GLYPH_SIZE
+                * BENCH_SURFACE_GLYPH_SIZE * 4);
+
+    cairo_surface_destroy(tiles.image);
+    cairo_surface_destroy(glyphs.image);
+    guac_common_surface_free(surface);
+    guac_client_free(client);
+
+}
+
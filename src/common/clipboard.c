@@ -16,7 +16,6 @@
  * specific language governing permissions and limitations
  * under the License.
  */
-
 #include "config.h"
 #include "common/clipboard.h"
 
@@ -25,21 +24,276 @@
 #include <guacamole/stream.h>
 #include <guacamole/string.h>
 #include <guacamole/user.h>
+
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The FNV-1a 64-bit offset basis.
+ */
+#define GUAC_COMMON_CLIPBOARD_FNV_OFFSET 0xcbf29ce484222325ULL
+
+/**
+ * The FNV-1a 64-bit prime.
+ */
+#define GUAC_COMMON_CLIPBOARD_FNV_PRIME 0x100000001b3ULL
+
+/**
+ * The initial size of the in-memory clipboard buffer, in bytes.
+ */
+#define GUAC_COMMON_CLIPBOARD_INITIAL_LENGTH 4096
+
+/**
+ * Updates the given FNV-1a hash with the given data.
+ *
+ * @param hash
+ *     The hash to update.
+ *
+ * @param data
+ *     The data to include in the hash.
+ *
+ * @param length
+ *     The number of bytes of data to include.
+ *
+ * @return
+ *     The updated hash.
+ */
+static uint64_t guac_common_clipboard_hash(uint64_t hash, const char* data,
+        int length) {
+
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= GUAC_COMMON_CLIPBOARD_FNV_PRIME;
+    }
+
+    return hash;
+
+}
+
+/**
+ * Allocates new in-memory storage of the given size, having a single
+ * reference.
+ *
+ * @param available
+ *     The number of bytes the storage must be able to hold.
+ *
+ * @return
+ *     Newly-allocated in-memory storage.
+ */
+static guac_common_clipboard_storage* guac_common_clipboard_storage_alloc(
+        int available) {
+
+    guac_common_clipboard_storage* storage =
+        malloc(sizeof(guac_common_clipboard_storage));
+
+    storage->refcount = 1;
+    storage->buffer = malloc(available);
+    storage->available = available;
+    storage->fd = -1;
+
+    return storage;
+
+}
+
+/**
+ * Allocates new storage backed by an unlinked temporary file, having a single
+ * reference. The file is mapped in its entirety into memory, with disk space
+ * being reserved for the given number of bytes.
+ *
+ * @param available
+ *     The number of bytes the storage must initially be able to hold.
+ *
+ * @return
+ *     Newly-allocated file-backed storage, or NULL if the temporary file
+ *     cannot be created, mapped, or grown to the given size.
+ */
+static guac_common_clipboard_storage* guac_common_clipboard_storage_spill(
+        int available) {
+
+    const char* tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL)
+        tmpdir = "/tmp";
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/guac-clipboard-XXXXXX", tmpdir);
+
+    int fd = mkstemp(path);
+    if (fd == -1)
+        return NULL;
+
+    /* The file need only exist for as long as it is open */
+    unlink(path);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    /* Reserve space up front such that a full disk is reported here, rather
+     * than as SIGBUS when the mapping is written */
+    if (posix_fallocate(fd, 0, available)) {
+        close(fd);
+        return NULL;
+    }
+
+    char* buffer = mmap(NULL, GUAC_COMMON_CLIPBOARD_MAX_LENGTH,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (buffer == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    guac_common_clipboard_storage* storage =
+        malloc(sizeof(guac_common_clipboard_storage));
+
+    storage->refcount = 1;
+    storage->buffer = buffer;
+    storage->available = available;
+    storage->fd = fd;
+
+    return storage;
+
+}
+
+/**
+ * Releases a reference to the given storage, freeing the storage if no
+ * references remain. The lock of the owning clipboard must be held.
+ *
+ * @param storage
+ *     The storage to release.
+ */
+static void guac_common_clipboard_storage_release(
+        guac_common_clipboard_storage* storage) {
+
+    if (--storage->refcount > 0)
+        return;
+
+    if (storage->fd != -1) {
+        munmap(storage->buffer, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+        close(storage->fd);
+    }
+    else
+        free(storage->buffer);
+
+    free(storage);
+
+}
+
+/**
+ * Replaces the storage of the given clipboard, updating the buffer and
+ * available fields accordingly. The current contents are copied to the new
+ * storage. The clipboard lock must be held.
+ *
+ * @param clipboard
+ *     The clipboard whose storage should be replaced.
+ *
+ * @param storage
+ *     The new storage, which must be able to hold the current contents.
+ */
+static void guac_common_clipboard_set_storage(guac_common_clipboard* clipboard,
+        guac_common_clipboard_storage* storage) {
+
+    memcpy(storage->buffer, clipboard->buffer, clipboard->length);
+    guac_common_clipboard_storage_release(clipboard->storage);
+
+    clipboard->storage = storage;
+    clipboard->buffer = storage->buffer;
+    clipboard->available = storage->available;
+
+}
+
+/**
+ * Attempts to grow the storage of the given clipboard such that it can hold
+ * at least the given number of bytes. Storage which is shared with an
+ * in-progress broadcast is replaced rather than modified. The clipboard lock
+ * must be held.
+ *
+ * @param clipboard
+ *     The clipboard whose storage should be grown.
+ *
+ * @param needed
+ *     The number of bytes the storage should be able to hold. This must not
+ *     exceed GUAC_COMMON_CLIPBOARD_MAX_LENGTH.
+ */
+static void guac_common_clipboard_grow(guac_common_clipboard* clipboard,
+        int needed) {
+
+    guac_common_clipboard_storage* storage = clipboard->storage;
+    int shared = storage->refcount > 1;
+
+    /* Grow in-memory storage geometrically up to the in-memory limit */
+    if (needed <= GUAC_COMMON_CLIPBOARD_MEMORY_LENGTH) {
+
+        int available = storage->available * 2;
+        if (available < needed)
+            available = needed;
+        if (available > GUAC_COMMON_CLIPBOARD_MEMORY_LENGTH)
+            available = GUAC_COMMON_CLIPBOARD_MEMORY_LENGTH;
+
+        if (shared)
+            guac_common_clipboard_set_storage(clipboard,
+                    guac_common_clipboard_storage_alloc(available));
+
+        else {
+            storage->buffer = realloc(storage->buffer, available);
+            storage->available = available;
+            clipboard->buffer = storage->buffer;
+            clipboard->available = available;
+        }
+
+        return;
+
+    }
+
+    /* Reserve space within the temporary file in large increments */
+    int available = (needed + GUAC_COMMON_CLIPBOARD_SPILL_INCREMENT - 1)
+        / GUAC_COMMON_CLIPBOARD_SPILL_INCREMENT
+        * GUAC_COMMON_CLIPBOARD_SPILL_INCREMENT;
+    if (available > GUAC_COMMON_CLIPBOARD_MAX_LENGTH)
+        available = GUAC_COMMON_CLIPBOARD_MAX_LENGTH;
+
+    /* The mapping of an unshared temporary file can simply be extended */
+    if (storage->fd != -1 && !shared) {
+        if (posix_fallocate(storage->fd, 0, available) == 0) {
+            storage->available = available;
+            clipboard->available = available;
+        }
+        return;
+    }
+
+    /* Otherwise, move contents to a new temporary file, leaving the contents
+     * truncated to the current storage if this is not possible */
+    guac_common_clipboard_storage* spilled =
+        guac_common_clipboard_storage_spill(available);
+
+    if (spilled != NULL)
+        guac_common_clipboard_set_storage(clipboard, spilled);
+
+}
 
 guac_common_clipboard* guac_common_clipboard_alloc() {
 
-    guac_common_clipboard* clipboard = malloc(sizeof(guac_common_clipboard));
+    guac_common_clipboard* clipboard = calloc(1, sizeof(guac_common_clipboard));
 
     /* Init clipboard */
     clipboard->mimetype[0] = '\0';
-    clipboard->buffer = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
-    clipboard->available = GUAC_COMMON_CLIPBOARD_MAX_LENGTH;
+    clipboard->storage = guac_common_clipboard_storage_alloc(
+            GUAC_COMMON_CLIPBOARD_INITIAL_LENGTH);
+    clipboard->buffer = clipboard->storage->buffer;
+    clipboard->available = clipboard->storage->available;
     clipboard->length = 0;
+    clipboard->hash = guac_common_clipboard_hash(
+            GUAC_COMMON_CLIPBOARD_FNV_OFFSET, "", 1);
+    clipboard->broadcast = 1;
 
     pthread_mutex_init(&(clipboard->lock), NULL);
+    pthread_mutex_init(&(clipboard->send_lock), NULL);
+    pthread_mutex_init(&(clipboard->transfer_lock), NULL);
+    pthread_cond_init(&(clipboard->transfer_acked), NULL);
 
     return clipboard;
 
@@ -47,65 +301,380 @@ guac_common_clipboard* guac_common_clipboard_alloc() {
 
 void guac_common_clipboard_free(guac_common_clipboard* clipboard) {
 
-    /* Destroy lock */
+    /* Destroy locks */
     pthread_mutex_destroy(&(clipboard->lock));
+    pthread_mutex_destroy(&(clipboard->send_lock));
+    pthread_mutex_destroy(&(clipboard->transfer_lock));
+    pthread_cond_destroy(&(clipboard->transfer_acked));
 
-    /* Free buffer */
-    free(clipboard->buffer);
+    /* Free storage */
+    guac_common_clipboard_storage_release(clipboard->storage);
+
+    /* Free transfer state */
+    for (int i = 0; i < GUAC_COMMON_CLIPBOARD_MAX_USERS; i++)
+        free(clipboard->users[i].user_id);
 
     /* Free base structure */
     free(clipboard);
 }
 
 /**
- * Callback for guac_client_foreach_user() which sends clipboard data to each
- * connected client.
+ * The state of a single broadcast of clipboard contents to all connected
+ * users, as performed by guac_common_clipboard_send().
+ */
+typedef struct guac_common_clipboard_broadcast {
+
+    /**
+     * The clipboard being broadcast.
+     */
+    guac_common_clipboard* clipboard;
+
+    /**
+     * The storage containing the contents being broadcast, referenced for the
+     * duration of the broadcast.
+     */
+    guac_common_clipboard_storage* storage;
+
+    /**
+     * The mimetype of the contents being broadcast.
+     */
+    char mimetype[256];
+
+    /**
+     * The contents being broadcast.
+     */
+    const char* buffer;
+
+    /**
+     * The number of bytes being broadcast.
+     */
+    int length;
+
+    /**
+     * The hash of the contents being broadcast.
+     */
+    uint64_t hash;
+
+    /**
+     * The clipboard epoch at the start of the broadcast.
+     */
+    uint64_t epoch;
+
+    /**
+     * The clipboard generation at the start of the broadcast.
+     */
+    uint64_t generation;
+
+    /**
+     * The offset within the contents of the block currently being sent.
+     */
+    int offset;
+
+    /**
+     * The number of bytes within the block currently being sent.
+     */
+    int block_size;
+
+    /**
+     * The number of times the connected users have been iterated during this
+     * broadcast.
+     */
+    int iteration;
+
+    /**
+     * Whether the broadcast was abandoned because the clipboard was reset
+     * before the broadcast completed.
+     */
+    int superseded;
+
+} guac_common_clipboard_broadcast;
+
+/**
+ * Returns the transfer state of the user having the given ID. If no such
+ * state exists and allocate is non-zero, the unused or least-recently-used
+ * entry not involved in an in-progress transfer is assigned to the user. The
+ * transfer lock must be held.
+ *
+ * @param clipboard
+ *     The clipboard tracking the transfer state.
+ *
+ * @param user_id
+ *     The unique ID of the user.
+ *
+ * @param allocate
+ *     Non-zero if a new entry should be assigned if no entry exists for the
+ *     user, zero otherwise.
+ *
+ * @return
+ *     The transfer state of the user, or NULL if no such state exists and
+ *     none could be assigned.
+ */
+static guac_common_clipboard_user* guac_common_clipboard_get_user(
+        guac_common_clipboard* clipboard, const char* user_id, int allocate) {
+
+    guac_common_clipboard_user* oldest = NULL;
+
+    for (int i = 0; i < GUAC_COMMON_CLIPBOARD_MAX_USERS; i++) {
+
+        guac_common_clipboard_user* entry = &(clipboard->users[i]);
+        if (entry->user_id != NULL && strcmp(entry->user_id, user_id) == 0)
+            return entry;
+
+        if (entry->stream == NULL && (oldest == NULL
+                    || entry->user_id == NULL
+                    || (oldest->user_id != NULL
+                        && entry->last_used < oldest->last_used)))
+            oldest = entry;
+
+    }
+
+    if (!allocate || oldest == NULL)
+        return NULL;
+
+    free(oldest->user_id);
+    memset(oldest, 0, sizeof(guac_common_clipboard_user));
+    oldest->user_id = strdup(user_id);
+
+    return oldest;
+
+}
+
+/**
+ * Forgets the in-progress transfers of any users that were not seen during
+ * the most recent iteration of the connected users, as such users must have
+ * left. The transfer lock must be held.
+ *
+ * @param broadcast
+ *     The broadcast whose transfers should be checked.
+ */
+static void guac_common_clipboard_forget_departed(
+        guac_common_clipboard_broadcast* broadcast) {
+
+    guac_common_clipboard* clipboard = broadcast->clipboard;
+
+    for (int i = 0; i < GUAC_COMMON_CLIPBOARD_MAX_USERS; i++) {
+        guac_common_clipboard_user* entry = &(clipboard->users[i]);
+        if (entry->stream != NULL && entry->iteration != broadcast->iteration)
+            entry->stream = NULL;
+    }
+
+}
+
+/**
+ * Handler for acknowledgements of clipboard blobs, recording the
+ * acknowledgement within the transfer state of the acknowledging user.
+ *
+ * @param user
+ *     The user acknowledging clipboard data.
+ *
+ * @param stream
+ *     The stream over which clipboard data was sent.
+ *
+ * @param message
+ *     An arbitrary human-readable message describing the status.
+ *
+ * @param status
+ *     The status of the received clipboard data. Any status other than
+ *     GUAC_PROTOCOL_STATUS_SUCCESS rejects the remainder of the transfer.
+ *
+ * @return
+ *     Always zero.
+ */
+static int __ack_user_clipboard(guac_user* user, guac_stream* stream,
+        char* message, guac_protocol_status status) {
+
+    guac_common_clipboard* clipboard = (guac_common_clipboard*) stream->data;
+
+    pthread_mutex_lock(&(clipboard->transfer_lock));
+
+    guac_common_clipboard_user* entry =
+        guac_common_clipboard_get_user(clipboard, user->user_id, 0);
+
+    /* Ignore acknowledgements of transfers which are no longer in progress */
+    if (entry != NULL && entry->stream == stream) {
+
+        if (status != GUAC_PROTOCOL_STATUS_SUCCESS) {
+            guac_user_log(user, GUAC_LOG_DEBUG, "Clipboard stream %i "
+                    "rejected: %s (0x%X)", stream->index, message, status);
+            entry->rejected = 1;
+        }
+        else
+            entry->blocks_acked++;
+
+        pthread_cond_broadcast(&(clipboard->transfer_acked));
+
+    }
+
+    pthread_mutex_unlock(&(clipboard->transfer_lock));
+    return 0;
+
+}
+
+/**
+ * Callback for guac_client_foreach_user() which begins a clipboard transfer
+ * to each connected user that has not already received identical contents.
+ * If no transfer state can be tracked for a user, the entire contents are
+ * sent to that user immediately.
  *
  * @param user
  *     The user to send the clipboard data to.
  *
- * @param
- *     A pointer to the guac_common_clipboard structure containing the
- *     clipboard data that should be sent to the given user.
+ * @param data
+ *     A pointer to the guac_common_clipboard_broadcast describing the
+ *     contents being broadcast.
  *
  * @return
  *     Always NULL.
  */
-static void* __send_user_clipboard(guac_user* user, void* data) {
+static void* __begin_user_clipboard(guac_user* user, void* data) {
+
+    guac_common_clipboard_broadcast* broadcast =
+        (guac_common_clipboard_broadcast*) data;
+    guac_common_clipboard* clipboard = broadcast->clipboard;
 
-    guac_common_clipboard* clipboard = (guac_common_clipboard*) data;
+    pthread_mutex_lock(&(clipboard->transfer_lock));
 
-    char* current = clipboard->buffer;
-    int remaining = clipboard->length;
+    guac_common_clipboard_user* entry =
+        guac_common_clipboard_get_user(clipboard, user->user_id, 1);
+
+    /* Skip users already holding these exact contents */
+    if (entry != NULL && entry->sent && entry->hash == broadcast->hash
+            && entry->epoch == broadcast->epoch) {
+        entry->last_used = ++clipboard->transfer_sequence;
+        pthread_mutex_unlock(&(clipboard->transfer_lock));
+        guac_user_log(user, GUAC_LOG_DEBUG, "Skipping clipboard broadcast "
+                "(user already has identical contents).");
+        return NULL;
+    }
 
     /* Begin stream */
     guac_stream* stream = guac_user_alloc_stream(user);
-    guac_protocol_send_clipboard(user->socket, stream, clipboard->mimetype);
+    stream->ack_handler = __ack_user_clipboard;
+    stream->data = clipboard;
+
+    if (entry != NULL) {
+        entry->last_used = ++clipboard->transfer_sequence;
+        entry->sent = 0;
+        entry->stream = stream;
+        entry->iteration = broadcast->iteration;
+        entry->blocks_sent = 0;
+        entry->blocks_acked = 0;
+        entry->unpaced = 0;
+        entry->rejected = 0;
+    }
+
+    pthread_mutex_unlock(&(clipboard->transfer_lock));
+
+    guac_protocol_send_clipboard(user->socket, stream, broadcast->mimetype);
 
     guac_user_log(user, GUAC_LOG_DEBUG,
             "Created stream %i for %s clipboard data.",
-            stream->index, clipboard->mimetype);
+            stream->index, broadcast->mimetype);
+
+    /* Without transfer state, the contents can only be sent all at once */
+    if (entry == NULL) {
+        guac_protocol_send_blobs(user->socket, stream, broadcast->buffer,
+                broadcast->length);
+        guac_protocol_send_end(user->socket, stream);
+        guac_user_free_stream(user, stream);
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Callback for guac_client_foreach_user() which sends the current block of
+ * clipboard data to each connected user with an in-progress transfer.
+ *
+ * @param user
+ *     The user to send the clipboard data to.
+ *
+ * @param data
+ *     A pointer to the guac_common_clipboard_broadcast describing the
+ *     contents being broadcast and the current block.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __send_user_clipboard_block(guac_user* user, void* data) {
+
+    guac_common_clipboard_broadcast* broadcast =
+        (guac_common_clipboard_broadcast*) data;
+    guac_common_clipboard* clipboard = broadcast->clipboard;
+
+    pthread_mutex_lock(&(clipboard->transfer_lock));
+
+    guac_common_clipboard_user* entry =
+        guac_common_clipboard_get_user(clipboard, user->user_id, 0);
+
+    if (entry == NULL || entry->stream == NULL) {
+        pthread_mutex_unlock(&(clipboard->transfer_lock));
+        return NULL;
+    }
+
+    entry->iteration = broadcast->iteration;
+
+    /* Send nothing further to users that have rejected the transfer */
+    if (entry->rejected) {
+        pthread_mutex_unlock(&(clipboard->transfer_lock));
+        return NULL;
+    }
+
+    guac_stream* stream = entry->stream;
+    entry->blocks_sent++;
+
+    pthread_mutex_unlock(&(clipboard->transfer_lock));
 
-    /* Split clipboard into chunks */
-    while (remaining > 0) {
+    guac_protocol_send_blob(user->socket, stream,
+            broadcast->buffer + broadcast->offset, broadcast->block_size);
 
-        /* Calculate size of next block */
-        int block_size = GUAC_COMMON_CLIPBOARD_BLOCK_SIZE;
-        if (remaining < block_size)
-            block_size = remaining; 
+    return NULL;
+
+}
+
+/**
+ * Callback for guac_client_foreach_user() which completes the clipboard
+ * transfer to each connected user with an in-progress transfer.
+ *
+ * @param user
+ *     The user whose transfer should be completed.
+ *
+ * @param data
+ *     A pointer to the guac_common_clipboard_broadcast describing the
+ *     contents being broadcast.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __end_user_clipboard(guac_user* user, void* data) {
 
-        /* Send block */
-        guac_protocol_send_blob(user->socket, stream, current, block_size);
-        guac_user_log(user, GUAC_LOG_DEBUG,
-                "Sent %i bytes of clipboard data on stream %i.",
-                block_size, stream->index);
+    guac_common_clipboard_broadcast* broadcast =
+        (guac_common_clipboard_broadcast*) data;
+    guac_common_clipboard* clipboard = broadcast->clipboard;
+
+    pthread_mutex_lock(&(clipboard->transfer_lock));
+
+    guac_common_clipboard_user* entry =
+        guac_common_clipboard_get_user(clipboard, user->user_id, 0);
+
+    if (entry == NULL || entry->stream == NULL) {
+        pthread_mutex_unlock(&(clipboard->transfer_lock));
+        return NULL;
+    }
 
-        /* Next block */
-        remaining -= block_size;
-        current += block_size;
+    guac_stream* stream = entry->stream;
+    entry->stream = NULL;
 
+    /* Record contents only if fully received */
+    if (!entry->rejected && !broadcast->superseded) {
+        entry->sent = 1;
+        entry->hash = broadcast->hash;
+        entry->epoch = broadcast->epoch;
     }
 
+    pthread_mutex_unlock(&(clipboard->transfer_lock));
+
     guac_user_log(user, GUAC_LOG_DEBUG,
             "Clipboard stream %i complete.",
             stream->index);
@@ -118,16 +687,154 @@ static void* __send_user_clipboard(guac_user* user, void* data) {
 
 }
 
-void guac_common_clipboard_send(guac_common_clipboard* clipboard, guac_client* client) {
+/**
+ * Waits until no in-progress transfer to a user that acknowledges clipboard
+ * data has more than GUAC_COMMON_CLIPBOARD_WINDOW blocks outstanding. Users
+ * that fail to acknowledge data within GUAC_COMMON_CLIPBOARD_ACK_TIMEOUT
+ * milliseconds are no longer waited for.
+ *
+ * @param clipboard
+ *     The clipboard being broadcast.
+ */
+static void guac_common_clipboard_wait_window(guac_common_clipboard* clipboard) {
+
+    pthread_mutex_lock(&(clipboard->transfer_lock));
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += GUAC_COMMON_CLIPBOARD_ACK_TIMEOUT / 1000;
+    deadline.tv_nsec += (GUAC_COMMON_CLIPBOARD_ACK_TIMEOUT % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    for (;;) {
+
+        /* Find any paced transfer whose window is full */
+        guac_common_clipboard_user* full = NULL;
+        for (int i = 0; i < GUAC_COMMON_CLIPBOARD_MAX_USERS; i++) {
+            guac_common_clipboard_user* entry = &(clipboard->users[i]);
+            if (entry->stream != NULL && !entry->rejected && !entry->unpaced
+                    && entry->blocks_acked > 0
+                    && entry->blocks_sent - entry->blocks_acked
+                        >= GUAC_COMMON_CLIPBOARD_WINDOW) {
+                full = entry;
+                break;
+            }
+        }
+
+        if (full == NULL)
+            break;
+
+        /* Stop pacing users that have stopped acknowledging data */
+        if (pthread_cond_timedwait(&(clipboard->transfer_acked),
+                    &(clipboard->transfer_lock), &deadline) == ETIMEDOUT)
+            full->unpaced = 1;
+
+    }
+
+    pthread_mutex_unlock(&(clipboard->transfer_lock));
+
+}
+
+/**
+ * Sends the contents of the clipboard along the given client, splitting the
+ * contents as necessary, as described by guac_common_clipboard_send().
+ *
+ * @param clipboard
+ *     The clipboard whose contents should be sent.
+ *
+ * @param client
+ *     The client to send the clipboard contents on.
+ *
+ * @param paced
+ *     Non-zero if transfers to users that acknowledge received blobs should
+ *     be paced by those acknowledgements, zero if all blocks should be sent
+ *     without waiting.
+ */
+static void guac_common_clipboard_broadcast_contents(
+        guac_common_clipboard* clipboard, guac_client* client, int paced) {
 
+    guac_common_clipboard_broadcast broadcast = { .clipboard = clipboard };
+
+    pthread_mutex_lock(&(clipboard->send_lock));
+
+    /* Take a reference to the current contents, such that the clipboard can
+     * be modified while those contents are being sent */
     pthread_mutex_lock(&(clipboard->lock));
+    broadcast.storage = clipboard->storage;
+    broadcast.storage->refcount++;
+    broadcast.buffer = clipboard->buffer;
+    broadcast.length = clipboard->length;
+    broadcast.hash = clipboard->hash;
+    broadcast.epoch = clipboard->epoch;
+    broadcast.generation = clipboard->generation;
+    memcpy(broadcast.mimetype, clipboard->mimetype, sizeof(broadcast.mimetype));
+    clipboard->broadcast = 1;
+    pthread_mutex_unlock(&(clipboard->lock));
 
     guac_client_log(client, GUAC_LOG_DEBUG, "Broadcasting clipboard to all connected users.");
-    guac_client_foreach_user(client, __send_user_clipboard, clipboard);
+    guac_client_foreach_user(client, __begin_user_clipboard, &broadcast);
+
+    /* Send each block to all users, releasing the lock on the connected
+     * users between blocks */
+    while (broadcast.offset < broadcast.length) {
+
+        /* Abandon contents which have since been replaced */
+        pthread_mutex_lock(&(clipboard->lock));
+        broadcast.superseded = (clipboard->generation != broadcast.generation);
+        pthread_mutex_unlock(&(clipboard->lock));
+
+        if (broadcast.superseded) {
+            guac_client_log(client, GUAC_LOG_DEBUG, "Clipboard changed "
+                    "during broadcast. Abandoning outdated contents.");
+            break;
+        }
+
+        if (paced)
+            guac_common_clipboard_wait_window(clipboard);
+
+        broadcast.block_size = broadcast.length - broadcast.offset;
+        if (broadcast.block_size > GUAC_COMMON_CLIPBOARD_BLOCK_SIZE)
+            broadcast.block_size = GUAC_COMMON_CLIPBOARD_BLOCK_SIZE;
+
+        broadcast.iteration++;
+        guac_client_foreach_user(client, __send_user_clipboard_block,
+                &broadcast);
+
+        pthread_mutex_lock(&(clipboard->transfer_lock));
+        guac_common_clipboard_forget_departed(&broadcast);
+        pthread_mutex_unlock(&(clipboard->transfer_lock));
+
+        broadcast.offset += broadcast.block_size;
+
+    }
+
+    guac_client_foreach_user(client, __end_user_clipboard, &broadcast);
     guac_client_log(client, GUAC_LOG_DEBUG, "Broadcast of clipboard complete.");
 
+    /* Clear state of any transfers to users that left before completion */
+    pthread_mutex_lock(&(clipboard->transfer_lock));
+    for (int i = 0; i < GUAC_COMMON_CLIPBOARD_MAX_USERS; i++)
+        clipboard->users[i].stream = NULL;
+    pthread_mutex_unlock(&(clipboard->transfer_lock));
+
+    pthread_mutex_lock(&(clipboard->lock));
+    guac_common_clipboard_storage_release(broadcast.storage);
     pthread_mutex_unlock(&(clipboard->lock));
 
+    pthread_mutex_unlock(&(clipboard->send_lock));
+
+}
+
+void guac_common_clipboard_send(guac_common_clipboard* clipboard, guac_client* client) {
+    guac_common_clipboard_broadcast_contents(clipboard, client, 1);
+}
+
+void guac_common_clipboard_send_unpaced(guac_common_clipboard* clipboard,
+        guac_client* client) {
+    guac_common_clipboard_broadcast_contents(clipboard, client, 0);
 }
 
 void guac_common_clipboard_reset(guac_common_clipboard* clipboard,
@@ -135,12 +842,35 @@ void guac_common_clipboard_reset(guac_common_clipboard* clipboard,
 
     pthread_mutex_lock(&(clipboard->lock));
 
-    /* Clear clipboard contents */
+    /* Contents never broadcast likely came from a user, so what was last
+     * sent to each user can no longer be trusted to match their clipboard */
+    if (!clipboard->broadcast)
+        clipboard->epoch++;
+
+    clipboard->broadcast = 0;
+    clipboard->generation++;
+
+    /* Clear clipboard contents, releasing any temporary file or storage
+     * still being broadcast */
+    guac_common_clipboard_storage* storage = clipboard->storage;
+    if (storage->refcount > 1 || storage->fd != -1) {
+        guac_common_clipboard_storage_release(storage);
+        clipboard->storage = guac_common_clipboard_storage_alloc(
+                GUAC_COMMON_CLIPBOARD_INITIAL_LENGTH);
+        clipboard->buffer = clipboard->storage->buffer;
+        clipboard->available = clipboard->storage->available;
+    }
+
     clipboard->length = 0;
 
     /* Assign given mimetype */
     guac_strlcpy(clipboard->mimetype, mimetype, sizeof(clipboard->mimetype));
 
+    /* Hash mimetype (including its terminator) ahead of contents */
+    clipboard->hash = guac_common_clipboard_hash(
+            GUAC_COMMON_CLIPBOARD_FNV_OFFSET, clipboard->mimetype,
+            strlen(clipboard->mimetype) + 1);
+
     pthread_mutex_unlock(&(clipboard->lock));
 
 }
@@ -149,18 +879,55 @@ void guac_common_clipboard_append(guac_common_clipboard* clipboard, const char*
 
     pthread_mutex_lock(&(clipboard->lock));
 
-    /* Truncate data to available length */
-    int remaining = clipboard->available - clipboard->length;
+    /* Truncate data to maximum length */
+    int remaining = GUAC_COMMON_CLIPBOARD_MAX_LENGTH - clipboard->length;
+    if (remaining < length)
+        length = remaining;
+
+    /* Grow storage as necessary, detaching from any in-progress broadcast */
+    int needed = clipboard->length + length;
+    if (needed > clipboard->available
+            || (clipboard->storage->refcount > 1 && length > 0))
+        guac_common_clipboard_grow(clipboard, needed);
+
+    /* Truncate data to available length if storage could not be grown */
+    remaining = clipboard->available - clipboard->length;
     if (remaining < length)
         length = remaining;
 
     /* Append to buffer */
     memcpy(clipboard->buffer + clipboard->length, data, length);
 
-    /* Update length */
+    /* Update length and hash */
     clipboard->length += length;
+    clipboard->hash = guac_common_clipboard_hash(clipboard->hash, data,
+            length);
 
     pthread_mutex_unlock(&(clipboard->lock));
 
 }
 
+guac_common_clipboard_storage* guac_common_clipboard_acquire(
+        guac_common_clipboard* clipboard, const char** buffer, int* length) {
+
+    pthread_mutex_lock(&(clipboard->lock));
+
+    guac_common_clipboard_storage* storage = clipboard->storage;
+    storage->refcount++;
+    *buffer = clipboard->buffer;
+    *length = clipboard->length;
+
+    pthread_mutex_unlock(&(clipboard->lock));
+
+    return storage;
+
+}
+
+void guac_common_clipboard_release(guac_common_clipboard* clipboard,
+        guac_common_clipboard_storage* storage) {
+
+    pthread_mutex_lock(&(clipboard->lock));
+    guac_common_clipboard_storage_release(storage);
+    pthread_mutex_unlock(&(clipboard->lock));
+
+}
@@ -16,14 +16,15 @@
  * specific language governing permissions and limitations
  * under the License.
  */
-
 #ifndef __GUAC_CLIPBOARD_H
 #define __GUAC_CLIPBOARD_H
 
 #include "config.h"
 
 #include <guacamole/client.h>
+#include <guacamole/stream.h>
 #include <pthread.h>
+#include <stdint.h>
 
 /**
  * The maximum number of bytes to send in an individual blob when
@@ -34,7 +35,146 @@
 /**
  * The maximum number of bytes to allow within the clipboard.
  */
-#define GUAC_COMMON_CLIPBOARD_MAX_LENGTH 262144
+#define GUAC_COMMON_CLIPBOARD_MAX_LENGTH 16777216
+
+/**
+ * The maximum number of bytes of clipboard data to store in memory. Contents
+ * larger than this are moved to an unlinked temporary file, which is mapped
+ * into memory such that the contents remain contiguous while allowing the
+ * kernel to write them out to disk.
+ */
+#define GUAC_COMMON_CLIPBOARD_MEMORY_LENGTH 262144
+
+/**
+ * The number of bytes by which the temporary file backing spilled clipboard
+ * contents is grown at a time.
+ */
+#define GUAC_COMMON_CLIPBOARD_SPILL_INCREMENT 1048576
+
+/**
+ * The maximum number of blocks of clipboard data which may be sent to a user
+ * without being acknowledged. This limit applies only to users whose clients
+ * are observed to acknowledge clipboard blobs.
+ */
+#define GUAC_COMMON_CLIPBOARD_WINDOW 16
+
+/**
+ * The number of milliseconds to wait for a user to acknowledge clipboard
+ * data before ceasing to pace that user's transfer by its acknowledgements.
+ */
+#define GUAC_COMMON_CLIPBOARD_ACK_TIMEOUT 5000
+
+/**
+ * The maximum number of users for which clipboard transfer state is tracked.
+ * If exceeded, the least-recently-used state is discarded.
+ */
+#define GUAC_COMMON_CLIPBOARD_MAX_USERS 64
+
+/**
+ * Reference-counted storage for clipboard contents. Storage is shared between
+ * the clipboard and any in-progress broadcast of its contents, and is never
+ * moved or modified while shared, such that a broadcast may stream the
+ * contents without holding the clipboard lock.
+ */
+typedef struct guac_common_clipboard_storage {
+
+    /**
+     * The number of references to this storage. Guarded by the lock of the
+     * owning clipboard.
+     */
+    int refcount;
+
+    /**
+     * The stored data. If the storage is backed by a temporary file, this is
+     * a mapping of that file large enough to hold
+     * GUAC_COMMON_CLIPBOARD_MAX_LENGTH bytes.
+     */
+    char* buffer;
+
+    /**
+     * The number of bytes which may currently be stored within the buffer.
+     */
+    int available;
+
+    /**
+     * The file descriptor of the unlinked temporary file backing this storage,
+     * or -1 if the storage is in memory.
+     */
+    int fd;
+
+} guac_common_clipboard_storage;
+
+/**
+ * The state of clipboard transfers to a single user, tracked such that
+ * unchanged contents need not be sent to that user again and such that
+ * in-progress transfers can be paced by the user's acknowledgements.
+ */
+typedef struct guac_common_clipboard_user {
+
+    /**
+     * The unique ID of the user, or NULL if this entry is unused.
+     */
+    char* user_id;
+
+    /**
+     * Sequence number of the last broadcast involving this user, used to
+     * select the least-recently-used entry for reuse.
+     */
+    uint64_t last_used;
+
+    /**
+     * Whether the contents described by hash and epoch have been completely
+     * sent to this user.
+     */
+    int sent;
+
+    /**
+     * The hash of the contents last completely sent to this user.
+     */
+    uint64_t hash;
+
+    /**
+     * The value of the clipboard epoch at the time the contents were last
+     * completely sent to this user.
+     */
+    uint64_t epoch;
+
+    /**
+     * The stream of the in-progress transfer to this user, or NULL if no
+     * transfer is in progress.
+     */
+    guac_stream* stream;
+
+    /**
+     * The iteration of the in-progress broadcast in which this user was last
+     * seen among the connected users.
+     */
+    int iteration;
+
+    /**
+     * The number of blobs sent during the in-progress transfer.
+     */
+    int blocks_sent;
+
+    /**
+     * The number of blobs acknowledged during the in-progress transfer.
+     */
+    int blocks_acked;
+
+    /**
+     * Whether the user has stopped acknowledging blobs in a timely manner,
+     * such that the in-progress transfer is no longer paced by
+     * acknowledgements.
+     */
+    int unpaced;
+
+    /**
+     * Whether the user has rejected the in-progress transfer with an error
+     * acknowledgement, such that no further blobs should be sent.
+     */
+    int rejected;
+
+} guac_common_clipboard_user;
 
 /**
  * Generic clipboard structure.
@@ -42,9 +182,9 @@
 typedef struct guac_common_clipboard {
 
     /**
-     * Lock which restricts simultaneous access to the clipboard, guaranteeing
-     * ordered modifications to the clipboard and that changes to the clipboard
-     * are not allowed while the clipboard is being broadcast to all users.
+     * Lock which restricts simultaneous access to the clipboard contents,
+     * guaranteeing ordered modifications to the clipboard. This lock is held
+     * only briefly while contents are broadcast to users.
      */
     pthread_mutex_t lock;
 
@@ -54,7 +194,7 @@ typedef struct guac_common_clipboard {
     char mimetype[256];
 
     /**
-     * Arbitrary clipboard data.
+     * Arbitrary clipboard data. This points into the current storage.
      */
     char* buffer;
 
@@ -68,6 +208,62 @@ typedef struct guac_common_clipboard {
      */
     int available;
 
+    /**
+     * The storage containing the current clipboard contents.
+     */
+    guac_common_clipboard_storage* storage;
+
+    /**
+     * FNV-1a hash of the current mimetype and contents.
+     */
+    uint64_t hash;
+
+    /**
+     * Counter which is incremented each time the clipboard is reset.
+     */
+    uint64_t generation;
+
+    /**
+     * Counter which is incremented whenever contents which were never
+     * broadcast are replaced. Such contents likely came from a user, whose
+     * local clipboard may no longer match what was last sent to them, and
+     * thus previously-sent contents must not be considered current.
+     */
+    uint64_t epoch;
+
+    /**
+     * Whether the current contents have been broadcast to all users.
+     */
+    int broadcast;
+
+    /**
+     * Lock which is held for the duration of each broadcast, ensuring that
+     * broadcasts do not interleave.
+     */
+    pthread_mutex_t send_lock;
+
+    /**
+     * Lock which guards the transfer state of all users.
+     */
+    pthread_mutex_t transfer_lock;
+
+    /**
+     * Condition which is signalled whenever a user acknowledges or rejects
+     * clipboard data.
+     */
+    pthread_cond_t transfer_acked;
+
+    /**
+     * Counter used to order the transfer state of users by recency of use.
+     */
+    uint64_t transfer_sequence;
+
+    /**
+     * The transfer state of all users that have recently received clipboard
+     * data.
+     */
+    guac_common_clipboard_user users[GUAC_COMMON_CLIPBOARD_MAX_USERS];
+
 } guac_common_clipboard;
 
 /**
@@ -84,13 +280,30 @@ void guac_common_clipboard_free(guac_common_clipboard* clipboard);
 
 /**
  * Sends the contents of the clipboard along the given client, splitting
- * the contents as necessary.
+ * the contents as necessary. Users which have already received identical
+ * contents are skipped. Neither the clipboard lock nor the lock guarding
+ * the client's users is held for the duration of the transfer, and transfers
+ * to users whose clients acknowledge received blobs are paced by those
+ * acknowledgements.
  *
  * @param clipboard The clipboard whose contents should be sent.
  * @param client The client to send the clipboard contents on.
  */
 void guac_common_clipboard_send(guac_common_clipboard* clipboard, guac_client* client);
 
+/**
+ * Sends the contents of the clipboard along the given client, exactly as
+ * guac_common_clipboard_send() does, except that transfers are never paced by
+ * acknowledgements. This function never waits for users to acknowledge
+ * received blobs, and should be used by callers which hold locks that must
+ * not be held for the duration of a paced transfer.
+ *
+ * @param clipboard The clipboard whose contents should be sent.
+ * @param client The client to send the clipboard contents on.
+ */
+void guac_common_clipboard_send_unpaced(guac_common_clipboard* clipboard,
+        guac_client* client);
+
 /**
  * Clears the clipboard contents and assigns a new mimetype for future data.
  *
@@ -102,7 +315,9 @@ void guac_common_clipboard_reset(guac_common_clipboard* clipboard, const char* m
 /**
  * Appends the given data to the current clipboard contents. The data must
  * match the mimetype chosen for the clipboard data by
- * guac_common_clipboard_reset().
+ * guac_common_clipboard_reset(). Contents beyond
+ * GUAC_COMMON_CLIPBOARD_MEMORY_LENGTH bytes are spilled to a temporary file,
+ * and contents beyond GUAC_COMMON_CLIPBOARD_MAX_LENGTH bytes are truncated.
  *
  * @param clipboard The clipboard to append data to.
  * @param data The data to append.
@@ -110,5 +325,33 @@ void guac_common_clipboard_reset(guac_common_clipboard* clipboard, const char* m
  */
 void guac_common_clipboard_append(guac_common_clipboard* clipboard, const char* data, int length);
 
+/**
+ * Takes a reference to the current clipboard contents, such that those
+ * contents may be read without holding the clipboard lock. The contents
+ * referenced remain valid and unmodified, even if the clipboard is reset or
+ * appended to, until the reference is released with
+ * guac_common_clipboard_release().
+ *
+ * @param clipboard The clipboard whose contents should be referenced.
+ * @param buffer Pointer to the location in which to store a pointer to the
+ *               referenced contents.
+ * @param length Pointer to the location in which to store the number of bytes
+ *               within the referenced contents.
+ * @return The storage containing the referenced contents, which must later be
+ *         passed to guac_common_clipboard_release().
+ */
+guac_common_clipboard_storage* guac_common_clipboard_acquire(
+        guac_common_clipboard* clipboard, const char** buffer, int* length);
+
+/**
+ * Releases a reference to clipboard contents previously taken with
+ * guac_common_clipboard_acquire().
+ *
+ * @param clipboard The clipboard whose contents were referenced.
+ * @param storage The storage returned by guac_common_clipboard_acquire().
+ */
+void guac_common_clipboard_release(guac_common_clipboard* clipboard,
+        guac_common_clipboard_storage* storage);
+
 #endif
 
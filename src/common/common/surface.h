@@ -30,6 +30,7 @@
 #include <guacamole/socket.h>
 
 #include <pthread.h>
+#include <stdint.h>
 
 /**
  * The maximum number of updates to allow within the bitmap queue.
@@ -58,6 +59,29 @@
  */
 #define GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE 5
 
+/**
+ * The width and height of each tile within the bitmap cache, in pixels. Only
+ * tiles aligned to a grid of this size which are completely covered by an
+ * update are considered for caching.
+ */
+#define GUAC_COMMON_SURFACE_CACHE_TILE_SIZE 64
+
+/**
+ * The number of tiles within each row of the client-side buffer which stores
+ * the contents of the bitmap cache.
+ */
+#define GUAC_COMMON_SURFACE_CACHE_COLUMNS 16
+
+/**
+ * The maximum number of tiles which may be stored within the bitmap cache of
+ * a single surface. This value must be a multiple of
+ * GUAC_COMMON_SURFACE_CACHE_COLUMNS. With 64x64 tiles, 256 tiles occupy a
+ * 1024x1024 buffer, and thus each visible layer which has been flushed
+ * losslessly costs 4 MiB of server-side memory for the copy used to verify
+ * matches, plus a client-side buffer of the same size.
+ */
+#define GUAC_COMMON_SURFACE_CACHE_SIZE 256
+
 /**
  * Representation of a cell in the refresh heat map. This cell is used to keep
  * track of how often an area on a surface is refreshed.
@@ -99,6 +123,77 @@ typedef struct guac_common_surface_bitmap_rect {
 
 } guac_common_surface_bitmap_rect;
 
+/**
+ * A single tile within the bitmap cache, describing image data which has
+ * already been sent to the client and is stored within the client-side buffer
+ * of the cache.
+ */
+typedef struct guac_common_surface_cache_entry {
+
+    /**
+     * Non-zero if this entry currently contains a cached tile, zero if the
+     * entry is unused.
+     */
+    int used;
+
+    /**
+     * The hash of the contents of the cached tile, as produced by
+     * guac_hash_surface().
+     */
+    unsigned int hash;
+
+    /**
+     * The value of the cache clock when this entry was last stored or
+     * matched. The entry having the lowest value is the least recently used.
+     */
+    unsigned int last_used;
+
+} guac_common_surface_cache_entry;
+
+/**
+ * Cache of tiles which have previously been sent to the client, allowing
+ * identical image data to be redrawn with a "copy" instruction rather than
+ * being encoded and sent again. Cached tiles are stored client-side within a
+ * single buffer, with a server-side copy of the same image data used to verify
+ * matches. Each tile newly stored within the cache costs one additional
+ * 64x64 "copy" instruction into that buffer at the time it is sent. See
+ * GUAC_COMMON_SURFACE_CACHE_SIZE regarding the memory required.
+ */
+typedef struct guac_common_surface_cache {
+
+    /**
+     * The client-side buffer containing all cached tiles. The tile of the
+     * entry at index N is stored at tile column
+     * N % GUAC_COMMON_SURFACE_CACHE_COLUMNS and tile row
+     * N / GUAC_COMMON_SURFACE_CACHE_COLUMNS.
+     */
+    guac_layer* buffer;
+
+    /**
+     * Server-side copy of the contents of the client-side buffer, in ARGB32
+     * format.
+     */
+    unsigned char* data;
+
+    /**
+     * The size of each row of the server-side copy of the cached image data,
+     * in bytes.
+     */
+    int stride;
+
+    /**
+     * Counter which is incremented each time a cache entry is used, providing
+     * the relative ordering required for least-recently-used eviction.
+     */
+    unsigned int clock;
+
+    /**
+     * All entries within the cache.
+     */
+    guac_common_surface_cache_entry entries[GUAC_COMMON_SURFACE_CACHE_SIZE];
+
+} guac_common_surface_cache;
+
 /**
  * Surface which backs a Guacamole buffer or layer, automatically
  * combining updates when possible.
@@ -241,6 +336,47 @@ typedef struct guac_common_surface {
      */
     guac_common_surface_heat_cell* heat_map;
 
+    /**
+     * Cache of tiles which have previously been sent to the client, or NULL
+     * if no tiles have yet been cached. Only visible layers maintain a bitmap
+     * cache.
+     */
+    guac_common_surface_cache* cache;
+
+    /**
+     * Scratch storage for the hashes of each row of the source of a draw
+     * operation being checked for vertically-scrolled content, or NULL if no
+     * draw has yet been checked. This storage, like all other scroll
+     * detection storage, can accommodate draws of up to scroll_capacity rows,
+     * and is reused across draws.
+     */
+    uint32_t* scroll_src_hashes;
+
+    /**
+     * Scratch storage for the hashes of each row of the destination of a draw
+     * operation being checked for vertically-scrolled content.
+     */
+    uint32_t* scroll_dst_hashes;
+
+    /**
+     * Scratch storage for the open addressing hash table indexing destination
+     * rows by hash, having room for the smallest power of two at least twice
+     * scroll_capacity.
+     */
+    int* scroll_table;
+
+    /**
+     * Scratch storage for the number of rows suggesting each possible
+     * vertical offset, having room for twice scroll_capacity offsets.
+     */
+    int* scroll_votes;
+
+    /**
+     * The maximum number of rows of a draw operation which the scroll
+     * detection scratch storage can accommodate.
+     */
+    int scroll_capacity;
+
     /**
      * Mutex which is locked internally when access to the surface must be
      * synchronized. All public functions of guac_common_surface should be
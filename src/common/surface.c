@@ -23,6 +23,7 @@
 
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
+#include <guacamole/hash.h>
 #include <guacamole/layer.h>
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
@@ -73,6 +74,25 @@
  */
 #define GUAC_SURFACE_FILL_PATTERN_FACTOR 3
 
+/**
+ * The minimum width of a draw operation, in pixels, for the operation to be
+ * checked for vertically-scrolled content.
+ */
+#define GUAC_SURFACE_SCROLL_MIN_WIDTH 64
+
+/**
+ * The minimum height of a draw operation, in pixels, for the operation to be
+ * checked for vertically-scrolled content.
+ */
+#define GUAC_SURFACE_SCROLL_MIN_HEIGHT 64
+
+/**
+ * The minimum number of rows which must be saved by representing part of a
+ * draw operation as a "copy" of existing content before scrolled content is
+ * handled in that way.
+ */
+#define GUAC_SURFACE_SCROLL_MIN_ROWS 16
+
 /* Define cairo_format_stride_for_width() if missing */
 #ifndef HAVE_CAIRO_FORMAT_STRIDE_FOR_WIDTH
 #define cairo_format_stride_for_width(format, width) (width*4)
@@ -1223,6 +1243,365 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
 
 }
 
+/**
+ * Produces a hash of the given row of ARGB32 pixels. The given mask is
+ * applied (with a bitwise OR) to each pixel prior to hashing, allowing pixels
+ * which differ only in bits covered by the mask to be considered identical.
+ *
+ * @param row
+ *     The first pixel of the row to hash.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ *
+ * @param mask
+ *     The mask to apply to each pixel prior to hashing.
+ *
+ * @return
+ *     An arbitrary 32-bit hash of the given row.
+ */
+static uint32_t __guac_common_surface_hash_row(const unsigned char* row,
+        int width, uint32_t mask) {
+
+    const uint32_t* current = (const uint32_t*) row;
+    uint32_t hash = 2166136261U;
+    int x;
+
+    /* FNV-1a, one pixel at a time */
+    for (x = 0; x < width; x++) {
+        hash ^= *(current++) | mask;
+        hash *= 16777619U;
+    }
+
+    return hash;
+
+}
+
+/**
+ * Returns whether the given row of source pixels would leave the given row of
+ * the destination surface unchanged if drawn opaquely.
+ *
+ * @param src
+ *     The first pixel of the source row.
+ *
+ * @param dst
+ *     The first pixel of the destination row.
+ *
+ * @param width
+ *     The number of pixels in each row.
+ *
+ * @return
+ *     Non-zero if the rows are identical once the alpha channel of the source
+ *     row is ignored, zero otherwise.
+ */
+static int __guac_common_surface_row_equal(const unsigned char* src,
+        const unsigned char* dst, int width) {
+
+    const uint32_t* src_current = (const uint32_t*) src;
+    const uint32_t* dst_current = (const uint32_t*) dst;
+    int x;
+
+    for (x = 0; x < width; x++) {
+        if ((*(src_current++) | 0xFF000000) != *(dst_current++))
+            return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Returns the size of the open addressing hash table used to index the given
+ * number of rows when checking a draw operation for scrolled content. This
+ * is the smallest power of two which is at least twice the number of rows.
+ *
+ * @param height
+ *     The number of rows to index.
+ *
+ * @return
+ *     The number of slots within the hash table.
+ */
+static int __guac_common_surface_scroll_table_size(int height) {
+
+    int table_size = 1;
+    while (table_size < height * 2)
+        table_size <<= 1;
+
+    return table_size;
+
+}
+
+/**
+ * Ensures that the scroll detection scratch storage of the given surface can
+ * accommodate draw operations of the given number of rows, growing that
+ * storage if necessary.
+ *
+ * @param surface
+ *     The surface whose scratch storage should be checked.
+ *
+ * @param height
+ *     The number of rows which must be accommodated.
+ */
+static void __guac_common_surface_scroll_reserve(guac_common_surface* surface,
+        int height) {
+
+    if (height <= surface->scroll_capacity)
+        return;
+
+    free(surface->scroll_src_hashes);
+    free(surface->scroll_dst_hashes);
+    free(surface->scroll_table);
+    free(surface->scroll_votes);
+
+    surface->scroll_src_hashes = malloc(sizeof(uint32_t) * height);
+    surface->scroll_dst_hashes = malloc(sizeof(uint32_t) * height);
+    surface->scroll_table = malloc(sizeof(int)
+            * __guac_common_surface_scroll_table_size(height));
+    surface->scroll_votes = malloc(sizeof(int) * height * 2);
+    surface->scroll_capacity = height;
+
+}
+
+/**
+ * Searches for image data within the given opaque draw operation which is
+ * already present within the destination surface, offset vertically, as
+ * would be the case if the contents of the destination rectangle had been
+ * scrolled. Candidate offsets are found by matching hashes of individual rows
+ * of the source and destination, and the best candidate is verified pixel by
+ * pixel.
+ *
+ * @param src_buffer
+ *     The buffer being drawn.
+ *
+ * @param src_stride
+ *     The number of bytes in each row of the source buffer.
+ *
+ * @param sx
+ *     The X coordinate of the source rectangle.
+ *
+ * @param sy
+ *     The Y coordinate of the source rectangle.
+ *
+ * @param dst
+ *     The destination surface.
+ *
+ * @param rect
+ *     The destination rectangle, which must be within the bounds of the
+ *     destination surface.
+ *
+ * @param offset
+ *     Pointer to an int which will receive the vertical offset of the
+ *     scrolled content, in pixels, relative to its current location within
+ *     the destination surface.
+ *
+ * @param start
+ *     Pointer to an int which will receive the first row of the destination
+ *     rectangle, relative to the top of that rectangle, which can be copied
+ *     from existing content.
+ *
+ * @param length
+ *     Pointer to an int which will receive the number of rows which can be
+ *     copied from existing content.
+ *
+ * @return
+ *     Non-zero if scrolled content was found and it is worth redrawing that
+ *     content with a "copy" instruction, zero otherwise.
+ */
+static int __guac_common_surface_find_scroll(unsigned char* src_buffer,
+        int src_stride, int sx, int sy, guac_common_surface* dst,
+        const guac_common_rect* rect, int* offset, int* start, int* length) {
+
+    int width = rect->width;
+    int height = rect->height;
+
+    int i, j;
+    int found = 0;
+
+    /* Ignore draws which are too small to benefit */
+    if (width < GUAC_SURFACE_SCROLL_MIN_WIDTH
+            || height < GUAC_SURFACE_SCROLL_MIN_HEIGHT)
+        return 0;
+
+    src_buffer += src_stride * sy + 4 * sx;
+    unsigned char* dst_buffer = dst->buffer + dst->stride * rect->y
+                              + 4 * rect->x;
+
+    /* Open addressing hash table of destination rows, sized to a power of
+     * two at least twice the number of rows */
+    int table_size = __guac_common_surface_scroll_table_size(height);
+
+    /* Reuse the surface's scratch storage rather than allocating per draw */
+    __guac_common_surface_scroll_reserve(dst, height);
+
+    uint32_t* src_hashes = dst->scroll_src_hashes;
+    uint32_t* dst_hashes = dst->scroll_dst_hashes;
+    int* table = dst->scroll_table;
+    int* votes = dst->scroll_votes;
+
+    memset(table, 0, sizeof(int) * table_size);
+    memset(votes, 0, sizeof(int) * height * 2);
+
+    /* Hash all rows, indexing destination rows by hash */
+    for (i = 0; i < height; i++) {
+
+        src_hashes[i] = __guac_common_surface_hash_row(
+                src_buffer + i * src_stride, width, 0xFF000000);
+
+        dst_hashes[i] = __guac_common_surface_hash_row(
+                dst_buffer + i * dst->stride, width, 0);
+
+        /* Only the first of any run of identical rows is indexed */
+        if (i > 0 && dst_hashes[i] == dst_hashes[i - 1])
+            continue;
+
+        int slot = dst_hashes[i] & (table_size - 1);
+        while (table[slot] != 0 && dst_hashes[table[slot] - 1] != dst_hashes[i])
+            slot = (slot + 1) & (table_size - 1);
+
+        if (table[slot] == 0)
+            table[slot] = i + 1;
+
+    }
+
+    /* Vote for the vertical offset suggested by each distinct source row */
+    for (i = 0; i < height; i++) {
+
+        /* Rows identical to their predecessor (such as blank background)
+         * cannot indicate an offset reliably */
+        if (i > 0 && src_hashes[i] == src_hashes[i - 1])
+            continue;
+
+        int slot = src_hashes[i] & (table_size - 1);
+        while (table[slot] != 0) {
+
+            j = table[slot] - 1;
+            if (dst_hashes[j] == src_hashes[i]) {
+                if (j != i)
+                    votes[j - i + height]++;
+                break;
+            }
+
+            slot = (slot + 1) & (table_size - 1);
+
+        }
+
+    }
+
+    /* Select the most popular non-zero offset */
+    int best = 0;
+    for (i = 1; i < height * 2; i++) {
+        if (votes[i] > votes[best])
+            best = i;
+    }
+
+    if (votes[best] > 0) {
+
+        int dy = best - height;
+
+        int run_start = 0;
+        int run_length = 0;
+        int run_savings = 0;
+
+        int current_start = 0;
+        int current_length = 0;
+        int current_savings = 0;
+
+        /* Find the longest run of rows which truly match at that offset */
+        for (i = 0; i < height; i++) {
+
+            j = i + dy;
+
+            if (j >= 0 && j < height && src_hashes[i] == dst_hashes[j]
+                    && __guac_common_surface_row_equal(
+                        src_buffer + i * src_stride,
+                        dst_buffer + j * dst->stride, width)) {
+
+                if (current_length == 0) {
+                    current_start = i;
+                    current_savings = 0;
+                }
+
+                current_length++;
+
+                /* Rows which are already unchanged would not be resent
+                 * regardless */
+                if (src_hashes[i] != dst_hashes[i])
+                    current_savings++;
+
+                if (current_savings > run_savings) {
+                    run_start = current_start;
+                    run_length = current_length;
+                    run_savings = current_savings;
+                }
+
+            }
+
+            else
+                current_length = 0;
+
+        }
+
+        /* Only use the run if it saves enough data */
+        if (run_savings >= GUAC_SURFACE_SCROLL_MIN_ROWS) {
+            *offset = dy;
+            *start = run_start;
+            *length = run_length;
+            found = 1;
+        }
+
+    }
+
+    return found;
+
+}
+
+/**
+ * Moves the given rows of the given surface vertically by the given offset,
+ * both within the backing buffer of the surface and within the remote
+ * display, where the move is performed with a "copy" instruction. Any pending
+ * updates to the surface are flushed before the "copy" instruction is sent.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param rect
+ *     The destination rectangle of the moved rows, which must be within the
+ *     bounds of the surface.
+ *
+ * @param offset
+ *     The vertical offset of the source rows relative to the destination
+ *     rectangle, in pixels.
+ */
+static void __guac_common_surface_scroll(guac_common_surface* surface,
+        const guac_common_rect* rect, int offset) {
+
+    int sx = rect->x;
+    int sy = rect->y + offset;
+
+    guac_common_rect drect = *rect;
+
+    /* Existing content must be up-to-date before being copied */
+    __guac_common_surface_flush(surface);
+
+    guac_protocol_send_copy(surface->socket, surface->layer, sx, sy,
+            rect->width, rect->height, GUAC_COMP_OVER, surface->layer,
+            rect->x, rect->y);
+    surface->realized = 1;
+
+    __guac_common_surface_transfer(surface, &sx, &sy,
+            GUAC_TRANSFER_BINARY_SRC, surface, &drect);
+
+}
+
+/**
+ * Frees the bitmap cache of the given surface, including its client-side
+ * buffer. If the surface has no bitmap cache, this function has no effect.
+ *
+ * @param surface
+ *     The surface whose bitmap cache should be freed.
+ */
+static void __guac_common_surface_cache_free(guac_common_surface* surface);
+
 guac_common_surface* guac_common_surface_alloc(guac_client* client,
         guac_socket* socket, const guac_layer* layer, int w, int h) {
 
@@ -1274,6 +1653,14 @@ void guac_common_surface_free(guac_common_surface* surface) {
 
     pthread_mutex_destroy(&surface->_lock);
 
+    /* Release any client-side cached tiles */
+    __guac_common_surface_cache_free(surface);
+
+    free(surface->scroll_src_hashes);
+    free(surface->scroll_dst_hashes);
+    free(surface->scroll_table);
+    free(surface->scroll_votes);
+
     free(surface->heat_map);
     free(surface->buffer);
     free(surface);
@@ -1363,8 +1750,23 @@ void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
+    /* Redraw any scrolled content with a "copy" of existing content, such
+     * that only the newly-exposed content is sent as image data */
+    int opaque = (format != CAIRO_FORMAT_ARGB32);
+    int offset, start, length;
+    if (opaque && __guac_common_surface_find_scroll(buffer, stride, sx, sy,
+                surface, &rect, &offset, &start, &length)) {
+
+        guac_common_rect scrolled;
+        guac_common_rect_init(&scrolled, rect.x, rect.y + start,
+                rect.width, length);
+
+        __guac_common_surface_scroll(surface, &scrolled, offset);
+
+    }
+
     /* Update backing surface */
-    __guac_common_surface_put(buffer, stride, &sx, &sy, surface, &rect, format != CAIRO_FORMAT_ARGB32);
+    __guac_common_surface_put(buffer, stride, &sx, &sy, surface, &rect, opaque);
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
@@ -1832,6 +2234,550 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
 
 }
 
+/**
+ * Returns a new Cairo surface representing the image data stored within the
+ * given entry of the given bitmap cache. The returned Cairo surface must
+ * eventually be freed with cairo_surface_destroy().
+ *
+ * @param cache
+ *     The bitmap cache containing the entry.
+ *
+ * @param index
+ *     The index of the cache entry.
+ *
+ * @return
+ *     A new Cairo surface representing the server-side copy of the image data
+ *     stored within the given cache entry.
+ */
+static cairo_surface_t* __guac_common_surface_cache_get_tile(
+        guac_common_surface_cache* cache, int index) {
+
+    int x = (index % GUAC_COMMON_SURFACE_CACHE_COLUMNS)
+          * GUAC_COMMON_SURFACE_CACHE_TILE_SIZE;
+
+    int y = (index / GUAC_COMMON_SURFACE_CACHE_COLUMNS)
+          * GUAC_COMMON_SURFACE_CACHE_TILE_SIZE;
+
+    return cairo_image_surface_create_for_data(
+            cache->data + y * cache->stride + x * 4, CAIRO_FORMAT_RGB24,
+            GUAC_COMMON_SURFACE_CACHE_TILE_SIZE,
+            GUAC_COMMON_SURFACE_CACHE_TILE_SIZE, cache->stride);
+
+}
+
+/**
+ * Returns a new Cairo surface representing the given tile of the given
+ * surface. The returned Cairo surface must eventually be freed with
+ * cairo_surface_destroy().
+ *
+ * @param surface
+ *     The surface containing the tile.
+ *
+ * @param tile
+ *     The rectangle of the tile, which must be within the bounds of the
+ *     surface.
+ *
+ * @return
+ *     A new Cairo surface representing the image data within the given tile.
+ */
+static cairo_surface_t* __guac_common_surface_get_tile(
+        guac_common_surface* surface, const guac_common_rect* tile) {
+
+    return cairo_image_surface_create_for_data(
+            surface->buffer + tile->y * surface->stride + tile->x * 4,
+            CAIRO_FORMAT_RGB24, tile->width, tile->height, surface->stride);
+
+}
+
+/**
+ * Allocates the bitmap cache of the given surface, including its client-side
+ * buffer. If the surface already has a bitmap cache, this function has no
+ * effect.
+ *
+ * @param surface
+ *     The surface whose bitmap cache should be allocated.
+ */
+static void __guac_common_surface_cache_alloc(guac_common_surface* surface) {
+
+    int width = GUAC_COMMON_SURFACE_CACHE_COLUMNS
+              * GUAC_COMMON_SURFACE_CACHE_TILE_SIZE;
+
+    int height = GUAC_COMMON_SURFACE_CACHE_SIZE
+               / GUAC_COMMON_SURFACE_CACHE_COLUMNS
+               * GUAC_COMMON_SURFACE_CACHE_TILE_SIZE;
+
+    /* Do not reallocate existing cache */
+    if (surface->cache != NULL)
+        return;
+
+    guac_common_surface_cache* cache =
+        calloc(1, sizeof(guac_common_surface_cache));
+
+    cache->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+    cache->data = calloc(height, cache->stride);
+
+    /* Cached tiles are stored client-side within a single buffer */
+    cache->buffer = guac_client_alloc_buffer(surface->client);
+    guac_protocol_send_size(surface->socket, cache->buffer, width, height);
+
+    surface->cache = cache;
+
+}
+
+static void __guac_common_surface_cache_free(guac_common_surface* surface) {
+
+    guac_common_surface_cache* cache = surface->cache;
+    if (cache == NULL)
+        return;
+
+    guac_protocol_send_dispose(surface->socket, cache->buffer);
+    guac_client_free_buffer(surface->client, cache->buffer);
+
+    free(cache->data);
+    free(cache);
+
+    surface->cache = NULL;
+
+}
+
+/**
+ * Searches the given bitmap cache for a tile whose contents are identical to
+ * the given image data.
+ *
+ * @param cache
+ *     The bitmap cache to search.
+ *
+ * @param tile
+ *     The image data to search for.
+ *
+ * @param hash
+ *     The hash of the given image data, as produced by guac_hash_surface().
+ *
+ * @return
+ *     The index of the matching cache entry, or -1 if no such entry exists.
+ */
+static int __guac_common_surface_cache_find(guac_common_surface_cache* cache,
+        cairo_surface_t* tile, unsigned int hash) {
+
+    int i;
+
+    for (i = 0; i < GUAC_COMMON_SURFACE_CACHE_SIZE; i++) {
+
+        guac_common_surface_cache_entry* entry = &cache->entries[i];
+
+        /* Skip unused entries and obvious mismatches */
+        if (!entry->used || entry->hash != hash)
+            continue;
+
+        /* Verify that contents truly match, as hashes may collide */
+        cairo_surface_t* cached =
+            __guac_common_surface_cache_get_tile(cache, i);
+        int cmp = guac_surface_cmp(tile, cached);
+        cairo_surface_destroy(cached);
+
+        if (cmp == 0)
+            return i;
+
+    }
+
+    /* No match */
+    return -1;
+
+}
+
+/**
+ * Stores all opaque tiles within the given rectangle in the bitmap cache of
+ * the given surface, evicting the least recently used tiles as necessary.
+ * The contents of the given rectangle MUST have just been sent to the client
+ * losslessly, as cached tiles are populated by copying from the surface's
+ * layer.
+ *
+ * @param surface
+ *     The surface whose bitmap cache should be updated.
+ *
+ * @param rect
+ *     The rectangle which was just sent to the client.
+ */
+static void __guac_common_surface_cache_store(guac_common_surface* surface,
+        const guac_common_rect* rect) {
+
+    const int size = GUAC_COMMON_SURFACE_CACHE_TILE_SIZE;
+
+    int row, column, i;
+
+    /* Determine range of tiles fully covered by the rectangle */
+    int min_column = (rect->x + size - 1) / size;
+    int min_row    = (rect->y + size - 1) / size;
+    int max_column = (rect->x + rect->width)  / size;
+    int max_row    = (rect->y + rect->height) / size;
+
+    /* Only visible layers are cached, and only full tiles may be cached */
+    if (surface->layer->index < 0 || min_column >= max_column
+            || min_row >= max_row)
+        return;
+
+    __guac_common_surface_cache_alloc(surface);
+    guac_common_surface_cache* cache = surface->cache;
+
+    for (row = min_row; row < max_row; row++) {
+        for (column = min_column; column < max_column; column++) {
+
+            guac_common_rect tile_rect;
+            guac_common_rect_init(&tile_rect, column * size, row * size,
+                    size, size);
+
+            /* Only opaque tiles can be redrawn accurately with "copy" */
+            if (!__guac_common_surface_is_opaque(surface, &tile_rect))
+                continue;
+
+            cairo_surface_t* tile =
+                __guac_common_surface_get_tile(surface, &tile_rect);
+
+            unsigned int hash = guac_hash_surface(tile);
+            int index = __guac_common_surface_cache_find(cache, tile, hash);
+
+            cairo_surface_destroy(tile);
+
+            /* Refresh existing entry if tile is already cached */
+            if (index != -1) {
+                cache->entries[index].last_used = ++cache->clock;
+                continue;
+            }
+
+            /* Otherwise, use the first unused entry or the least recently
+             * used entry */
+            index = 0;
+            for (i = 0; i < GUAC_COMMON_SURFACE_CACHE_SIZE; i++) {
+
+                guac_common_surface_cache_entry* entry = &cache->entries[i];
+
+                if (!entry->used) {
+                    index = i;
+                    break;
+                }
+
+                if (entry->last_used < cache->entries[index].last_used)
+                    index = i;
+
+            }
+
+            int cache_x = (index % GUAC_COMMON_SURFACE_CACHE_COLUMNS) * size;
+            int cache_y = (index / GUAC_COMMON_SURFACE_CACHE_COLUMNS) * size;
+
+            /* Store server-side copy of tile */
+            unsigned char* src = surface->buffer
+                               + tile_rect.y * surface->stride
+                               + tile_rect.x * 4;
+
+            unsigned char* dst = cache->data
+                               + cache_y * cache->stride
+                               + cache_x * 4;
+
+            for (i = 0; i < size; i++) {
+                memcpy(dst, src, size * 4);
+                src += surface->stride;
+                dst += cache->stride;
+            }
+
+            /* Store client-side copy of tile */
+            guac_protocol_send_copy(surface->socket, surface->layer,
+                    tile_rect.x, tile_rect.y, size, size, GUAC_COMP_OVER,
+                    cache->buffer, cache_x, cache_y);
+
+            guac_common_surface_cache_entry* entry = &cache->entries[index];
+            entry->used = 1;
+            entry->hash = hash;
+            entry->last_used = ++cache->clock;
+
+        }
+    }
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface directly via an "img" instruction, selecting the image
+ * format which seems most appropriate for the contents of that rectangle. If
+ * the update is sent losslessly, the tiles it covers are stored within the
+ * bitmap cache of the surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_to_image(guac_common_surface* surface) {
+
+    int opaque = __guac_common_surface_is_opaque(surface,
+                &surface->dirty_rect);
+
+    /* Prefer WebP when reasonable */
+    if (__guac_common_surface_should_use_webp(surface,
+                &surface->dirty_rect))
+        __guac_common_surface_flush_to_webp(surface, opaque);
+
+    /* If not WebP, JPEG is the next best (lossy) choice */
+    else if (opaque && __guac_common_surface_should_use_jpeg(
+                surface, &surface->dirty_rect))
+        __guac_common_surface_flush_to_jpeg(surface);
+
+    /* Use PNG if no lossy formats are appropriate */
+    else {
+        guac_common_rect rect = surface->dirty_rect;
+        __guac_common_surface_flush_to_png(surface, opaque);
+        __guac_common_surface_cache_store(surface, &rect);
+    }
+
+}
+
+/**
+ * Flushes the given rectangles of the given surface as image data, as part of
+ * a flush in progress within __guac_common_surface_flush_from_cache().
+ *
+ * @param surface
+ *     The surface being flushed.
+ *
+ * @param rects
+ *     The rectangles to flush as image data.
+ *
+ * @param count
+ *     The number of rectangles within the given array.
+ */
+static void __guac_common_surface_flush_residuals(
+        guac_common_surface* surface, const guac_common_rect* rects,
+        int count) {
+
+    int i;
+
+    for (i = 0; i < count; i++) {
+        surface->dirty_rect = rects[i];
+        surface->dirty = 1;
+        __guac_common_surface_flush_to_image(surface);
+    }
+
+}
+
+/**
+ * Adds the given horizontal band of rectangles to the set of rectangles which
+ * must be flushed as image data by __guac_common_surface_flush_from_cache().
+ * Rectangles which are directly beneath pending rectangles of the same
+ * horizontal extent are combined with those rectangles. Pending rectangles
+ * which cannot be extended any further are flushed.
+ *
+ * @param surface
+ *     The surface being flushed.
+ *
+ * @param pending
+ *     The array of pending rectangles. This array must have enough space to
+ *     store all rectangles within the given band.
+ *
+ * @param pending_length
+ *     A pointer to the number of rectangles within the array of pending
+ *     rectangles. This value will be updated by this function.
+ *
+ * @param band
+ *     The rectangles to add, which must all have the same Y coordinate and
+ *     height, must not overlap, and must be sorted from left to right.
+ *
+ * @param band_length
+ *     The number of rectangles within the given band.
+ */
+static void __guac_common_surface_add_residuals(guac_common_surface* surface,
+        guac_common_rect* pending, int* pending_length,
+        const guac_common_rect* band, int band_length) {
+
+    int i, j;
+    int length = 0;
+
+    /* Extend or flush each pending rectangle */
+    for (i = 0; i < *pending_length; i++) {
+
+        guac_common_rect* current = &pending[i];
+        int extended = 0;
+
+        for (j = 0; j < band_length; j++) {
+            if (band[j].x == current->x && band[j].width == current->width
+                    && band[j].y == current->y + current->height) {
+                extended = 1;
+                break;
+            }
+        }
+
+        /* Flush any rectangle which cannot be extended */
+        if (!extended) {
+            __guac_common_surface_flush_residuals(surface, current, 1);
+            continue;
+        }
+
+        current->height += band[j].height;
+        pending[length++] = *current;
+
+    }
+
+    /* Add any rectangles which did not extend existing rectangles */
+    for (j = 0; j < band_length; j++) {
+
+        int extended = 0;
+
+        for (i = 0; i < length; i++) {
+            if (band[j].x == pending[i].x && band[j].width == pending[i].width
+                    && band[j].y + band[j].height
+                        == pending[i].y + pending[i].height) {
+                extended = 1;
+                break;
+            }
+        }
+
+        if (!extended)
+            pending[length++] = band[j];
+
+    }
+
+    *pending_length = length;
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface. Tiles within that rectangle which are already present
+ * within the surface's bitmap cache are drawn via "copy" instructions from the
+ * cache, while the remainder of the rectangle is sent as image data.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_from_cache(
+        guac_common_surface* surface) {
+
+    const int size = GUAC_COMMON_SURFACE_CACHE_TILE_SIZE;
+
+    guac_common_surface_cache* cache = surface->cache;
+    guac_common_rect rect = surface->dirty_rect;
+
+    int row, column;
+
+    /* Determine range of tiles fully covered by the rectangle */
+    int min_column = (rect.x + size - 1) / size;
+    int min_row    = (rect.y + size - 1) / size;
+    int max_column = (rect.x + rect.width)  / size;
+    int max_row    = (rect.y + rect.height) / size;
+
+    /* Flush directly as image data if nothing can be pulled from cache */
+    if (cache == NULL || min_column >= max_column || min_row >= max_row) {
+        __guac_common_surface_flush_to_image(surface);
+        return;
+    }
+
+    surface->dirty = 0;
+
+    /* Each band of rectangles can contain at most one rectangle per tile,
+     * plus the partial tiles at either end */
+    int max_band_length = max_column - min_column + 2;
+    guac_common_rect* pending =
+        malloc(sizeof(guac_common_rect) * max_band_length);
+
+    guac_common_rect* band =
+        malloc(sizeof(guac_common_rect) * max_band_length);
+
+    int pending_length = 0;
+    int band_length;
+
+    /* Image data above the first full row of tiles cannot be cached */
+    guac_common_rect_init(&band[0], rect.x, rect.y, rect.width,
+            min_row * size - rect.y);
+    if (band[0].height > 0)
+        __guac_common_surface_add_residuals(surface, pending, &pending_length,
+                band, 1);
+
+    for (row = min_row; row < max_row; row++) {
+
+        guac_common_rect* residual = NULL;
+        band_length = 0;
+
+        /* Image data left of the full tiles cannot be cached */
+        if (rect.x < min_column * size) {
+            residual = &band[band_length++];
+            guac_common_rect_init(residual, rect.x, row * size,
+                    min_column * size - rect.x, size);
+        }
+
+        for (column = min_column; column < max_column; column++) {
+
+            guac_common_rect tile_rect;
+            guac_common_rect_init(&tile_rect, column * size, row * size,
+                    size, size);
+
+            /* Search cache for opaque tiles */
+            int index = -1;
+            if (__guac_common_surface_is_opaque(surface, &tile_rect)) {
+                cairo_surface_t* tile =
+                    __guac_common_surface_get_tile(surface, &tile_rect);
+                index = __guac_common_surface_cache_find(cache, tile,
+                        guac_hash_surface(tile));
+                cairo_surface_destroy(tile);
+            }
+
+            /* Draw matching tiles from cache */
+            if (index != -1) {
+
+                guac_protocol_send_copy(surface->socket, cache->buffer,
+                        (index % GUAC_COMMON_SURFACE_CACHE_COLUMNS) * size,
+                        (index / GUAC_COMMON_SURFACE_CACHE_COLUMNS) * size,
+                        size, size, GUAC_COMP_OVER, surface->layer,
+                        tile_rect.x, tile_rect.y);
+
+                cache->entries[index].last_used = ++cache->clock;
+                residual = NULL;
+
+            }
+
+            /* Extend current residual rectangle with missed tiles */
+            else if (residual != NULL)
+                residual->width += size;
+
+            /* Start new residual rectangle if necessary */
+            else {
+                residual = &band[band_length++];
+                *residual = tile_rect;
+            }
+
+        }
+
+        /* Image data right of the full tiles cannot be cached */
+        if (rect.x + rect.width > max_column * size) {
+
+            int width = rect.x + rect.width - max_column * size;
+
+            if (residual != NULL)
+                residual->width += width;
+            else {
+                residual = &band[band_length++];
+                guac_common_rect_init(residual, max_column * size, row * size,
+                        width, size);
+            }
+
+        }
+
+        __guac_common_surface_add_residuals(surface, pending, &pending_length,
+                band, band_length);
+
+    }
+
+    /* Image data below the last full row of tiles cannot be cached */
+    guac_common_rect_init(&band[0], rect.x, max_row * size, rect.width,
+            rect.y + rect.height - max_row * size);
+    if (band[0].height > 0)
+        __guac_common_surface_add_residuals(surface, pending, &pending_length,
+                band, 1);
+
+    /* Flush any remaining residual image data */
+    __guac_common_surface_flush_residuals(surface, pending, pending_length);
+
+    free(pending);
+    free(band);
+
+    surface->realized = 1;
+
+}
+
 /**
  * Comparator for instances of guac_common_surface_bitmap_rect, the elements
  * which make up a surface's bitmap buffer.
@@ -1945,22 +2891,8 @@ static void __guac_common_surface_flush(guac_common_surface* surface) {
 
                 flushed++;
 
-                int opaque = __guac_common_surface_is_opaque(surface,
-                            &surface->dirty_rect);
-
-                /* Prefer WebP when reasonable */
-                if (__guac_common_surface_should_use_webp(surface,
-                            &surface->dirty_rect))
-                    __guac_common_surface_flush_to_webp(surface, opaque);
-
-                /* If not WebP, JPEG is the next best (lossy) choice */
-                else if (opaque && __guac_common_surface_should_use_jpeg(
-                            surface, &surface->dirty_rect))
-                    __guac_common_surface_flush_to_jpeg(surface);
-
-                /* Use PNG if no lossy formats are appropriate */
-                else
-                    __guac_common_surface_flush_to_png(surface, opaque);
+                /* Redraw previously-sent tiles from cache where possible */
+                __guac_common_surface_flush_from_cache(surface);
 
             }
 
@@ -2019,6 +2951,18 @@ void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
     guac_protocol_send_size(socket, surface->layer,
             surface->width, surface->height);
 
+    /* Cached tiles do not exist client-side for the new user, and must be
+     * resent before they can be used */
+    if (surface->cache != NULL) {
+        memset(surface->cache->entries, 0, sizeof(surface->cache->entries));
+        guac_protocol_send_size(socket, surface->cache->buffer,
+                GUAC_COMMON_SURFACE_CACHE_COLUMNS
+                    * GUAC_COMMON_SURFACE_CACHE_TILE_SIZE,
+                GUAC_COMMON_SURFACE_CACHE_SIZE
+                    / GUAC_COMMON_SURFACE_CACHE_COLUMNS
+                    * GUAC_COMMON_SURFACE_CACHE_TILE_SIZE);
+    }
+
     /* Send contents of layer, if non-empty */
     if (surface->width > 0 && surface->height > 0) {
 
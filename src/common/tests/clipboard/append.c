@@ -0,0 +1,159 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "common/clipboard.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Appends the given number of bytes of predictable test data to the given
+ * clipboard, in blocks of the size used by the Guacamole protocol.
+ *
+ * @param clipboard
+ *     The clipboard to append data to.
+ *
+ * @param offset
+ *     The offset of the first byte of test data to append.
+ *
+ * @param length
+ *     The number of bytes of test data to append.
+ */
+static void append_test_data(guac_common_clipboard* clipboard, int offset,
+        int length) {
+
+    char block[GUAC_COMMON_CLIPBOARD_BLOCK_SIZE];
+
+    while (length > 0) {
+
+        int block_size = sizeof(block);
+        if (block_size > length)
+            block_size = length;
+
+        for (int i = 0; i < block_size; i++)
+            block[i] = (char) ((offset + i) * 31 + 7);
+
+        guac_common_clipboard_append(clipboard, block, block_size);
+
+        offset += block_size;
+        length -= block_size;
+
+    }
+
+}
+
+/**
+ * Returns whether the clipboard contains exactly the given number of bytes of
+ * test data, as appended by append_test_data().
+ *
+ * @param clipboard
+ *     The clipboard to check.
+ *
+ * @param length
+ *     The number of bytes of test data expected.
+ *
+ * @return
+ *     Non-zero if the clipboard contains the expected test data, zero
+ *     otherwise.
+ */
+static int has_test_data(guac_common_clipboard* clipboard, int length) {
+
+    if (clipboard->length != length)
+        return 0;
+
+    for (int i = 0; i < length; i++) {
+        if (clipboard->buffer[i] != (char) (i * 31 + 7))
+            return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Test which verifies that guac_common_clipboard_append() stores contents
+ * exceeding the in-memory limit intact, up to the maximum clipboard length,
+ * and that guac_common_clipboard_reset() clears such contents.
+ */
+void test_clipboard__append() {
+
+    guac_common_clipboard* clipboard = guac_common_clipboard_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(clipboard);
+
+    /* Small contents remain in memory */
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    append_test_data(clipboard, 0, 1000);
+    CU_ASSERT_STRING_EQUAL(clipboard->mimetype, "text/plain");
+    CU_ASSERT(has_test_data(clipboard, 1000));
+
+    /* Contents beyond the in-memory limit are stored intact */
+    int length = GUAC_COMMON_CLIPBOARD_MEMORY_LENGTH * 3 + 1234;
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    append_test_data(clipboard, 0, length);
+    CU_ASSERT(has_test_data(clipboard, length));
+
+    /* Contents are truncated at the maximum length */
+    guac_common_clipboard_reset(clipboard, "application/octet-stream");
+    append_test_data(clipboard, 0, GUAC_COMMON_CLIPBOARD_MAX_LENGTH + 5000);
+    CU_ASSERT_EQUAL(clipboard->length, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+    CU_ASSERT(has_test_data(clipboard, GUAC_COMMON_CLIPBOARD_MAX_LENGTH));
+
+    /* Reset clears large contents */
+    guac_common_clipboard_reset(clipboard, "text/html");
+    CU_ASSERT_EQUAL(clipboard->length, 0);
+    CU_ASSERT_STRING_EQUAL(clipboard->mimetype, "text/html");
+    append_test_data(clipboard, 0, 100);
+    CU_ASSERT(has_test_data(clipboard, 100));
+
+    guac_common_clipboard_free(clipboard);
+
+}
+
+/**
+ * Test which verifies that the clipboard hash depends on both the mimetype
+ * and the contents of the clipboard, and not on how those contents were
+ * divided across calls to guac_common_clipboard_append().
+ */
+void test_clipboard__hash() {
+
+    guac_common_clipboard* clipboard = guac_common_clipboard_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(clipboard);
+
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    guac_common_clipboard_append(clipboard, "hello world", 11);
+    uint64_t whole = clipboard->hash;
+
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    guac_common_clipboard_append(clipboard, "hello", 5);
+    guac_common_clipboard_append(clipboard, " world", 6);
+    CU_ASSERT(clipboard->hash == whole);
+
+    guac_common_clipboard_reset(clipboard, "text/html");
+    guac_common_clipboard_append(clipboard, "hello world", 11);
+    CU_ASSERT(clipboard->hash != whole);
+
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    guac_common_clipboard_append(clipboard, "hello World", 11);
+    CU_ASSERT(clipboard->hash != whole);
+
+    guac_common_clipboard_free(clipboard);
+
+}
+
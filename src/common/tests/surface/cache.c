@@ -0,0 +1,346 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The width and height of each tile drawn by these tests, in pixels.
+ */
+#define TILE_SIZE GUAC_COMMON_SURFACE_CACHE_TILE_SIZE
+
+/**
+ * The number of tile columns within the surfaces tested.
+ */
+#define TILE_COLUMNS 4
+
+/**
+ * The number of tile rows within the surfaces tested.
+ */
+#define TILE_ROWS 4
+
+/**
+ * A surface under test, along with the file receiving all instructions sent
+ * when that surface is flushed.
+ */
+typedef struct test_surface {
+
+    /**
+     * The client owning the layer of the surface.
+     */
+    guac_client* client;
+
+    /**
+     * The file receiving all instructions sent by the surface.
+     */
+    FILE* file;
+
+    /**
+     * The socket writing to the file.
+     */
+    guac_socket* socket;
+
+    /**
+     * The surface being tested.
+     */
+    guac_common_surface* surface;
+
+    /**
+     * The number of bytes of the file which have already been inspected.
+     */
+    off_t read_offset;
+
+} test_surface;
+
+/**
+ * Allocates a new lossless surface backing a visible layer, sending all
+ * instructions to a temporary file.
+ *
+ * @return
+ *     A newly-allocated test_surface, which must be freed with
+ *     test_surface_free().
+ */
+static test_surface* test_surface_alloc() {
+
+    test_surface* test = calloc(1, sizeof(test_surface));
+
+    test->client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test->client);
+
+    test->file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test->file);
+
+    test->socket = guac_socket_open(dup(fileno(test->file)));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test->socket);
+
+    test->surface = guac_common_surface_alloc(test->client, test->socket,
+            guac_client_alloc_layer(test->client),
+            TILE_COLUMNS * TILE_SIZE, TILE_ROWS * TILE_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test->surface);
+
+    /* Cached tiles are only stored after being sent as PNG */
+    guac_common_surface_set_lossless(test->surface, 1);
+
+    return test;
+
+}
+
+/**
+ * Frees the given test_surface and all associated resources.
+ *
+ * @param test
+ *     The test_surface to free.
+ */
+static void test_surface_free(test_surface* test) {
+    guac_common_surface_free(test->surface);
+    guac_socket_free(test->socket);
+    guac_client_free(test->client);
+    fclose(test->file);
+    free(test);
+}
+
+/**
+ * Draws an opaque tile whose contents are uniquely determined by the given
+ * seed at the given tile position, flushing the surface such that all
+ * resulting instructions are written to the test file.
+ *
+ * @param test
+ *     The test_surface to draw to.
+ *
+ * @param column
+ *     The tile column to draw at.
+ *
+ * @param row
+ *     The tile row to draw at.
+ *
+ * @param seed
+ *     Arbitrary value determining the contents of the tile.
+ */
+static void test_surface_draw_tile(test_surface* test, int column, int row,
+        unsigned int seed) {
+
+    cairo_surface_t* tile = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            TILE_SIZE, TILE_SIZE);
+
+    unsigned char* data = cairo_image_surface_get_data(tile);
+    int stride = cairo_image_surface_get_stride(tile);
+
+    /* Vary every pixel such that no two rows or tiles are alike */
+    for (int y = 0; y < TILE_SIZE; y++) {
+        uint32_t* pixel = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < TILE_SIZE; x++)
+            pixel[x] = 0xFF000000 | ((seed * 0x9E3779B1u + x * 0x85EBCA6Bu
+                        + y * 0xC2B2AE35u) & 0xFFFFFF);
+    }
+
+    cairo_surface_mark_dirty(tile);
+
+    guac_common_surface_draw(test->surface, column * TILE_SIZE,
+            row * TILE_SIZE, tile);
+    guac_common_surface_flush(test->surface);
+    guac_socket_flush(test->socket);
+
+    cairo_surface_destroy(tile);
+
+}
+
+/**
+ * Returns all instructions written to the test file since the last call to
+ * this function, as a newly-allocated, null-terminated string.
+ *
+ * @param test
+ *     The test_surface whose output should be read.
+ *
+ * @return
+ *     A newly-allocated string containing the new output, which must be
+ *     freed with free().
+ */
+static char* test_surface_read(test_surface* test) {
+
+    struct stat file_stat;
+    CU_ASSERT_EQUAL_FATAL(fstat(fileno(test->file), &file_stat), 0);
+
+    size_t length = file_stat.st_size - test->read_offset;
+    char* output = malloc(length + 1);
+
+    CU_ASSERT_EQUAL_FATAL(pread(fileno(test->file), output, length,
+                test->read_offset), length);
+
+    output[length] = '\0';
+    test->read_offset = file_stat.st_size;
+
+    return output;
+
+}
+
+/**
+ * Counts the number of occurrences of the given substring within the given
+ * string.
+ *
+ * @param str
+ *     The string to search.
+ *
+ * @param substr
+ *     The substring to count.
+ *
+ * @return
+ *     The number of occurrences of substr within str.
+ */
+static int count(const char* str, const char* substr) {
+
+    int occurrences = 0;
+    while ((str = strstr(str, substr)) != NULL) {
+        occurrences++;
+        str += strlen(substr);
+    }
+
+    return occurrences;
+
+}
+
+/**
+ * Draws a tile whose contents are uniquely determined by the given seed,
+ * verifying whether that tile was drawn from the bitmap cache (with a single
+ * "copy" and no image data) or sent as image data.
+ *
+ * @param test
+ *     The test_surface to draw to.
+ *
+ * @param column
+ *     The tile column to draw at.
+ *
+ * @param row
+ *     The tile row to draw at.
+ *
+ * @param seed
+ *     Arbitrary value determining the contents of the tile.
+ *
+ * @param cached
+ *     Non-zero if the tile is expected to be drawn from the bitmap cache,
+ *     zero if the tile is expected to be sent as image data.
+ */
+static void assert_draw(test_surface* test, int column, int row,
+        unsigned int seed, int cached) {
+
+    test_surface_draw_tile(test, column, row, seed);
+    char* output = test_surface_read(test);
+
+    if (cached) {
+        CU_ASSERT_EQUAL(count(output, "3.img,"), 0);
+        CU_ASSERT_EQUAL(count(output, "4.copy,"), 1);
+    }
+    else
+        CU_ASSERT_EQUAL(count(output, "3.img,"), 1);
+
+    free(output);
+
+}
+
+/**
+ * Verifies that a tile which has already been sent is redrawn elsewhere via
+ * a "copy" from the bitmap cache, while a tile which has never been sent is
+ * sent as image data.
+ */
+void test_surface__cache_hit_miss() {
+
+    test_surface* test = test_surface_alloc();
+
+    /* First appearance of a tile must be sent */
+    assert_draw(test, 0, 0, 1, 0);
+
+    /* Later appearances are drawn from cache */
+    assert_draw(test, 1, 0, 1, 1);
+    assert_draw(test, 2, 0, 1, 1);
+
+    /* Tiles never sent must be sent */
+    assert_draw(test, 1, 0, 2, 0);
+
+    test_surface_free(test);
+
+}
+
+/**
+ * Verifies that the least recently used tile is evicted once the bitmap
+ * cache is full, while more recently used tiles remain cached.
+ */
+void test_surface__cache_eviction() {
+
+    test_surface* test = test_surface_alloc();
+
+    /* Fill cache with distinct tiles, then add one more, evicting tile 0 */
+    for (int i = 0; i <= GUAC_COMMON_SURFACE_CACHE_SIZE; i++)
+        assert_draw(test, i % TILE_COLUMNS, (i / TILE_COLUMNS) % TILE_ROWS,
+                i, 0);
+
+    /* Tiles other than the oldest remain cached */
+    assert_draw(test, 0, 0, 1, 1);
+    assert_draw(test, 1, 0, GUAC_COMMON_SURFACE_CACHE_SIZE - 1, 1);
+
+    /* The oldest tile was evicted */
+    assert_draw(test, 2, 0, 0, 0);
+
+    test_surface_free(test);
+
+}
+
+/**
+ * Verifies that the bitmap cache is invalidated when the surface is
+ * duplicated to a new user, as that user lacks the cached tiles.
+ */
+void test_surface__cache_dup() {
+
+    test_surface* test = test_surface_alloc();
+
+    assert_draw(test, 0, 0, 1, 0);
+    assert_draw(test, 1, 0, 1, 1);
+
+    /* Duplicate surface to a new user */
+    guac_user* user = guac_user_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(user);
+
+    FILE* user_file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(user_file);
+
+    guac_socket* user_socket = guac_socket_open(dup(fileno(user_file)));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(user_socket);
+
+    guac_common_surface_dup(test->surface, user, user_socket);
+
+    guac_socket_free(user_socket);
+    guac_user_free(user);
+    fclose(user_file);
+
+    /* Previously-cached tile must be sent again */
+    assert_draw(test, 2, 0, 1, 0);
+
+    test_surface_free(test);
+
+}
@@ -0,0 +1,246 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The width of the surfaces and images drawn by these tests, in pixels.
+ */
+#define TEST_WIDTH 128
+
+/**
+ * The height of the surfaces and images drawn by these tests, in pixels.
+ */
+#define TEST_HEIGHT 128
+
+/**
+ * The number of rows by which content is scrolled.
+ */
+#define TEST_SCROLL 24
+
+/**
+ * Returns the color of the given row of a test image having the given seed.
+ * Each row of the image is a solid color, distinct from all other rows of
+ * that image and from all rows of images having other seeds.
+ *
+ * @param seed
+ *     Arbitrary value determining the contents of the image.
+ *
+ * @param row
+ *     The row whose color should be returned.
+ *
+ * @return
+ *     The opaque ARGB32 color of the row.
+ */
+static uint32_t row_color(int seed, int row) {
+    return 0xFF000000 | (seed << 16) | row;
+}
+
+/**
+ * Creates an opaque image containing rows of the test image having the given
+ * seed, starting at the given row.
+ *
+ * @param seed
+ *     Arbitrary value determining the contents of the image.
+ *
+ * @param first_row
+ *     The row of the test image to place at the top of the created image.
+ *
+ * @return
+ *     A newly-created Cairo surface, which must be destroyed with
+ *     cairo_surface_destroy().
+ */
+static cairo_surface_t* create_image(int seed, int first_row) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            TEST_WIDTH, TEST_HEIGHT);
+
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+
+    for (int y = 0; y < TEST_HEIGHT; y++) {
+        uint32_t* pixel = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < TEST_WIDTH; x++)
+            pixel[x] = row_color(seed, first_row + y);
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Draws the given image to the given surface, flushes the surface, and
+ * returns all instructions sent as a result, verifying that the surface
+ * contents match the image afterwards.
+ *
+ * @param file
+ *     The file receiving all instructions sent by the surface.
+ *
+ * @param socket
+ *     The socket writing to the file.
+ *
+ * @param surface
+ *     The surface to draw to.
+ *
+ * @param image
+ *     The image to draw.
+ *
+ * @return
+ *     A newly-allocated string containing all instructions sent, which must
+ *     be freed with free().
+ */
+static char* draw_image(FILE* file, guac_socket* socket,
+        guac_common_surface* surface, cairo_surface_t* image) {
+
+    struct stat file_stat;
+    CU_ASSERT_EQUAL_FATAL(fstat(fileno(file), &file_stat), 0);
+    off_t offset = file_stat.st_size;
+
+    guac_common_surface_draw(surface, 0, 0, image);
+    guac_common_surface_flush(surface);
+    guac_socket_flush(socket);
+
+    /* Surface must contain exactly the drawn image */
+    unsigned char* expected = cairo_image_surface_get_data(image);
+    int expected_stride = cairo_image_surface_get_stride(image);
+    for (int y = 0; y < TEST_HEIGHT; y++) {
+        const uint32_t* expected_row = (uint32_t*) (expected
+                + y * expected_stride);
+        const uint32_t* actual_row = (uint32_t*) (surface->buffer
+                + y * surface->stride);
+        for (int x = 0; x < TEST_WIDTH; x++)
+            CU_ASSERT_EQUAL_FATAL(actual_row[x] | 0xFF000000,
+                    expected_row[x] | 0xFF000000);
+    }
+
+    CU_ASSERT_EQUAL_FATAL(fstat(fileno(file), &file_stat), 0);
+    size_t length = file_stat.st_size - offset;
+
+    char* output = malloc(length + 1);
+    CU_ASSERT_EQUAL_FATAL(pread(fileno(file), output, length, offset),
+            length);
+    output[length] = '\0';
+
+    return output;
+
+}
+
+/**
+ * Draws an image to a new surface, followed by the given second image,
+ * returning all instructions sent as a result of drawing the second image.
+ *
+ * @param first
+ *     The first image to draw.
+ *
+ * @param second
+ *     The second image to draw.
+ *
+ * @return
+ *     A newly-allocated string containing all instructions sent while
+ *     drawing the second image, which must be freed with free().
+ */
+static char* draw_sequence(cairo_surface_t* first, cairo_surface_t* second) {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    FILE* file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    guac_socket* socket = guac_socket_open(dup(fileno(file)));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    /* Off-screen buffers have no bitmap cache, so any "copy" sent must be
+     * the result of scroll detection */
+    guac_common_surface* surface = guac_common_surface_alloc(client, socket,
+            guac_client_alloc_buffer(client), TEST_WIDTH, TEST_HEIGHT);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(surface);
+    guac_common_surface_set_lossless(surface, 1);
+
+    free(draw_image(file, socket, surface, first));
+    char* output = draw_image(file, socket, surface, second);
+
+    guac_common_surface_free(surface);
+    guac_socket_free(socket);
+    guac_client_free(client);
+    fclose(file);
+
+    return output;
+
+}
+
+/**
+ * Verifies that content scrolled upwards or downwards within an opaque draw
+ * is redrawn using a "copy" of the existing content.
+ */
+void test_surface__scroll_detected() {
+
+    cairo_surface_t* original = create_image(1, TEST_SCROLL);
+    cairo_surface_t* up = create_image(1, TEST_SCROLL * 2);
+    cairo_surface_t* down = create_image(1, 0);
+
+    /* Content moved upwards, exposing new rows at the bottom */
+    char* output = draw_sequence(original, up);
+    CU_ASSERT_EQUAL(strncmp(output, "4.copy,", 7), 0);
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, "3.img,"));
+    free(output);
+
+    /* Content moved downwards, exposing new rows at the top */
+    output = draw_sequence(original, down);
+    CU_ASSERT_EQUAL(strncmp(output, "4.copy,", 7), 0);
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, "3.img,"));
+    free(output);
+
+    cairo_surface_destroy(original);
+    cairo_surface_destroy(up);
+    cairo_surface_destroy(down);
+
+}
+
+/**
+ * Verifies that draws of content which is not present elsewhere within the
+ * surface are sent as image data alone.
+ */
+void test_surface__scroll_not_detected() {
+
+    cairo_surface_t* original = create_image(1, 0);
+    cairo_surface_t* replacement = create_image(2, 0);
+
+    char* output = draw_sequence(original, replacement);
+    CU_ASSERT_PTR_NULL(strstr(output, "4.copy,"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, "3.img,"));
+    free(output);
+
+    cairo_surface_destroy(original);
+    cairo_surface_destroy(replacement);
+
+}
@@ -32,7 +32,7 @@ int guacd_conf_parse_args(guacd_config* config, int argc, char** argv) {
 
     /* Parse arguments */
     int opt;
-    while ((opt = getopt(argc, argv, "l:b:p:L:C:K:fv")) != -1) {
+    while ((opt = getopt(argc, argv, "l:b:p:M:R:N:L:C:K:fv")) != -1) {
 
         /* -l: Bind port */
         if (opt == 'l') {
@@ -62,6 +62,24 @@ int guacd_conf_parse_args(guacd_config* config, int argc, char** argv) {
             config->pidfile = strdup(optarg);
         }
 
+        /* -M: Metrics socket */
+        else if (opt == 'M') {
+            free(config->metrics_socket);
+            config->metrics_socket = strdup(optarg);
+        }
+
+        /* -R: Registry directory */
+        else if (opt == 'R') {
+            free(config->registry_path);
+            config->registry_path = strdup(optarg);
+        }
+
+        /* -N: Address of this node within registry */
+        else if (opt == 'N') {
+            free(config->registry_node);
+            config->registry_node = strdup(optarg);
+        }
+
         /* -L: Log level */
         else if (opt == 'L') {
 
@@ -105,6 +123,9 @@ int guacd_conf_parse_args(guacd_config* config, int argc, char** argv) {
                     " [-l LISTENPORT]"
                     " [-b LISTENADDRESS]"
                     " [-p PIDFILE]"
+                    " [-M METRICS_SOCKET]"
+                    " [-R REGISTRY_PATH]"
+                    " [-N NODE_ADDRESS]"
                     " [-L LEVEL]"
 #ifdef ENABLE_SSL
                     " [-C CERTIFICATE_FILE]"
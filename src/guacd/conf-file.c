@@ -60,6 +60,27 @@ static int guacd_conf_callback(const char* section, const char* param, const cha
             return 0;
         }
 
+        /* Metrics socket */
+        else if (strcmp(param, "metrics_socket") == 0) {
+            free(config->metrics_socket);
+            config->metrics_socket = strdup(value);
+            return 0;
+        }
+
+        /* Registry directory */
+        else if (strcmp(param, "registry_path") == 0) {
+            free(config->registry_path);
+            config->registry_path = strdup(value);
+            return 0;
+        }
+
+        /* Address of this node within registry */
+        else if (strcmp(param, "registry_node") == 0) {
+            free(config->registry_node);
+            config->registry_node = strdup(value);
+            return 0;
+        }
+
     }
 
     /* Options related to daemon startup */
@@ -179,6 +200,9 @@ guacd_config* guacd_conf_load() {
     conf->bind_host = strdup(GUACD_DEFAULT_BIND_HOST);
     conf->bind_port = strdup(GUACD_DEFAULT_BIND_PORT);
     conf->pidfile = NULL;
+    conf->metrics_socket = NULL;
+    conf->registry_path = NULL;
+    conf->registry_node = NULL;
     conf->foreground = 0;
     conf->print_version = 0;
     conf->max_log_level = GUAC_LOG_INFO;
@@ -56,6 +56,25 @@ typedef struct guacd_config {
      */
     char* pidfile;
 
+    /**
+     * The path of the UNIX domain socket along which connection metrics
+     * should be served, if any.
+     */
+    char* metrics_socket;
+
+    /**
+     * The path of the directory, shared by all guacd nodes, in which the
+     * node owning each connection should be recorded, if any.
+     */
+    char* registry_path;
+
+    /**
+     * The address of this guacd node, in "HOST:PORT" form, as recorded
+     * within the registry for other nodes to reach, if any. If NULL, the
+     * local hostname and bind port are used.
+     */
+    char* registry_node;
+
     /**
      * Whether guacd should run in the foreground.
      */
@@ -19,11 +19,18 @@
 
 #include "config.h"
 
+/* splice() is a Linux-specific extension */
+#ifdef HAVE_SPLICE
+#define _GNU_SOURCE
+#endif
+
 #include "connection.h"
 #include "log.h"
+#include "metrics.h"
 #include "move-fd.h"
 #include "proc.h"
 #include "proc-map.h"
+#include "registry.h"
 
 #include <guacamole/client.h>
 #include <guacamole/error.h>
@@ -39,11 +46,25 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * The maximum number of bytes to transfer with each call to splice().
+ */
+#define GUACD_SPLICE_CHUNK_SIZE 65536
+
+/**
+ * The maximum length of the "select" instruction resent when forwarding a
+ * joining user to another guacd node, including null terminator.
+ */
+#define GUACD_FORWARD_SELECT_LENGTH 128
 
 /**
  * Behaves exactly as write(), but writes as much as possible, returning
@@ -82,6 +103,88 @@ static int __write_all(int fd, char* buffer, int length) {
 
 }
 
+#ifdef HAVE_SPLICE
+/**
+ * Continuously transfers data from one file descriptor to another using
+ * splice(), such that the data never passes through user space. Data is
+ * transferred until no further data can be read or an error occurs. If
+ * splice() is not supported for the given file descriptors, no data is
+ * transferred and non-zero is returned, in which case the caller must
+ * transfer the data by other means.
+ *
+ * @param in_fd
+ *     The file descriptor to read data from.
+ *
+ * @param out_fd
+ *     The file descriptor to write data to.
+ *
+ * @return
+ *     Zero if data was transferred until no further data could be
+ *     transferred, non-zero if splice() is not supported for the given file
+ *     descriptors.
+ */
+static int guacd_connection_splice(int in_fd, int out_fd) {
+
+    /* Data must pass through an intermediate pipe */
+    int pipe_fds[2];
+    if (pipe(pipe_fds))
+        return 1;
+
+    int transferred = 0;
+    int unsupported = 0;
+
+    for (;;) {
+
+        /* Move available data from input into pipe */
+        ssize_t length = splice(in_fd, NULL, pipe_fds[1], NULL,
+                GUACD_SPLICE_CHUNK_SIZE, SPLICE_F_MOVE);
+
+        if (length < 0 && errno == EINTR)
+            continue;
+
+        /* Fail over to the caller if splice() cannot be used at all */
+        if (length < 0 && !transferred
+                && (errno == EINVAL || errno == ENOSYS)) {
+            unsupported = 1;
+            break;
+        }
+
+        /* Stop upon EOF or error */
+        if (length <= 0)
+            break;
+
+        transferred = 1;
+
+        /* Move all data from pipe into output */
+        while (length > 0) {
+
+            ssize_t written = splice(pipe_fds[0], NULL, out_fd, NULL,
+                    length, SPLICE_F_MOVE);
+
+            if (written < 0 && errno == EINTR)
+                continue;
+
+            if (written <= 0)
+                break;
+
+            length -= written;
+
+        }
+
+        /* Stop if output failed */
+        if (length > 0)
+            break;
+
+    }
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    return unsupported;
+
+}
+#endif
+
 /**
  * Continuously reads from a guac_socket, writing all data read to a file
  * descriptor. Any data already buffered from that guac_socket by a given
@@ -137,11 +240,23 @@ void* guacd_connection_io_thread(void* data) {
     pthread_t write_thread;
     pthread_create(&write_thread, NULL, guacd_connection_write_thread, params);
 
-    /* Transfer data from file descriptor to socket */
-    while ((length = read(params->fd, buffer, sizeof(buffer))) > 0) {
-        if (guac_socket_write(params->socket, buffer, length))
-            break;
-        guac_socket_flush(params->socket);
+    int transferred = 0;
+
+#ifdef HAVE_SPLICE
+    /* Transfer data from file descriptor directly to the file descriptor of
+     * the socket, if possible, ensuring nothing remains buffered within the
+     * socket beforehand */
+    if (params->socket_fd != -1 && !guac_socket_flush(params->socket))
+        transferred = !guacd_connection_splice(params->fd, params->socket_fd);
+#endif
+
+    /* Otherwise, transfer data from file descriptor to socket */
+    if (!transferred) {
+        while ((length = read(params->fd, buffer, sizeof(buffer))) > 0) {
+            if (guac_socket_write(params->socket, buffer, length))
+                break;
+            guac_socket_flush(params->socket);
+        }
     }
 
     /* Wait for write thread to die */
@@ -176,10 +291,16 @@ void* guacd_connection_io_thread(void* data) {
  *     The socket associated with the user to be added to the existing
  *     process.
  *
+ * @param socket_fd
+ *     The file descriptor underlying the given socket, if data may be written
+ *     directly to that file descriptor rather than through the socket, or -1
+ *     if all data must be written through the socket.
+ *
  * @return
  *     Zero if the user was added successfully, non-zero if an error occurred.
  */
-static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* socket) {
+static int guacd_add_user(guacd_proc* proc, guac_parser* parser,
+        guac_socket* socket, int socket_fd) {
 
     int sockets[2];
 
@@ -205,6 +326,74 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
     params->parser = parser;
     params->socket = socket;
     params->fd = user_fd;
+    params->socket_fd = socket_fd;
+
+    /* Start I/O thread */
+    pthread_t io_thread;
+    pthread_create(&io_thread,  NULL, guacd_connection_io_thread,  params);
+    pthread_detach(io_thread);
+
+    return 0;
+
+}
+
+/**
+ * Forwards the given socket to the guacd node owning the connection having
+ * the given ID, such that the user joins that connection as if they had
+ * connected to the owning node directly. The "select" instruction already
+ * read from the socket is resent to the owning node, and all further data is
+ * transferred in both directions via I/O threads, exactly as for users of
+ * local connections. The given socket, parser, and any associated resources
+ * will be freed unless forwarding fails.
+ *
+ * @param node
+ *     The address of the guacd node owning the connection.
+ *
+ * @param id
+ *     The ID of the connection being joined.
+ *
+ * @param parser
+ *     The parser associated with the given guac_socket (used to handle the
+ *     user's connection handshake thus far).
+ *
+ * @param socket
+ *     The socket associated with the user joining the connection.
+ *
+ * @param socket_fd
+ *     The file descriptor underlying the given socket, if data may be written
+ *     directly to that file descriptor rather than through the socket, or -1
+ *     if all data must be written through the socket.
+ *
+ * @return
+ *     Zero if the user was forwarded successfully, non-zero if an error
+ *     occurred.
+ */
+static int guacd_forward_user(const char* node, const char* id,
+        guac_parser* parser, guac_socket* socket, int socket_fd) {
+
+    int node_fd = guacd_registry_connect(node);
+    if (node_fd < 0)
+        return 1;
+
+    /* Resend "select" (connection IDs consist only of ASCII characters, thus
+     * the length in characters is the length in bytes) */
+    char instruction[GUACD_FORWARD_SELECT_LENGTH];
+    int length = snprintf(instruction, sizeof(instruction), "6.select,%i.%s;",
+            (int) strlen(id), id);
+
+    if (length >= sizeof(instruction)
+            || __write_all(node_fd, instruction, length) < 0) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to forward user to node \"%s\".",
+                node);
+        close(node_fd);
+        return 1;
+    }
+
+    guacd_connection_io_thread_params* params = malloc(sizeof(guacd_connection_io_thread_params));
+    params->parser = parser;
+    params->socket = socket;
+    params->fd = node_fd;
+    params->socket_fd = socket_fd;
 
     /* Start I/O thread */
     pthread_t io_thread;
@@ -227,15 +416,30 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
  * @param map
  *     The map of existing client processes.
  *
+ * @param registry
+ *     The registry recording the node owning each connection, or NULL if
+ *     only processes within the given map may be joined.
+ *
+ * @param enable_metrics
+ *     Non-zero if any new client process should record metrics for retrieval
+ *     via the metrics socket, zero otherwise.
+ *
  * @param socket
  *     The socket associated with the new connection that must be routed to
  *     a new or existing process within the given map.
  *
+ * @param socket_fd
+ *     The file descriptor underlying the given socket, if data may be written
+ *     directly to that file descriptor rather than through the socket, or -1
+ *     if all data must be written through the socket.
+ *
  * @return
  *     Zero if the connection was successfully routed, non-zero if routing has
  *     failed.
  */
-static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
+static int guacd_route_connection(guacd_proc_map* map,
+        guacd_registry* registry, int enable_metrics, guac_socket* socket,
+        int socket_fd) {
 
     guac_parser* parser = guac_parser_alloc();
 
@@ -278,6 +482,29 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
         proc = guacd_proc_map_retrieve(map, identifier);
         new_process = 0;
 
+        /* Forward user to owning node if connection exists elsewhere */
+        char* node;
+        if (proc == NULL && registry != NULL
+                && (node = guacd_registry_lookup(registry, identifier)) != NULL) {
+
+            guacd_log(GUAC_LOG_INFO, "Joining connection \"%s\" via node "
+                    "\"%s\"", identifier, node);
+
+            int forward_failed = guacd_forward_user(node, identifier, parser,
+                    socket, socket_fd);
+
+            free(node);
+
+            if (!forward_failed)
+                return 0;
+
+            guac_protocol_send_error(socket, "Owning node unreachable.",
+                    GUAC_PROTOCOL_STATUS_UPSTREAM_UNAVAILABLE);
+            guac_parser_free(parser);
+            return 1;
+
+        }
+
         /* Warn and ward off client if requested connection does not exist */
         if (proc == NULL) {
             guacd_log(GUAC_LOG_INFO, "Connection \"%s\" does not exist", identifier);
@@ -298,7 +525,7 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
                 identifier);
 
         /* Create new process */
-        proc = guacd_create_proc(identifier);
+        proc = guacd_create_proc(identifier, enable_metrics);
         new_process = 1;
 
     }
@@ -311,7 +538,7 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
     }
 
     /* Add new user (in the case of a new process, this will be the owner */
-    int add_user_failed = guacd_add_user(proc, parser, socket);
+    int add_user_failed = guacd_add_user(proc, parser, socket, socket_fd);
 
     /* If new process was created, manage that process */
     if (new_process) {
@@ -326,10 +553,17 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
             /* Store process, allowing other users to join */
             guacd_proc_map_add(map, proc);
 
+            /* Allow users of other nodes to join */
+            if (registry != NULL)
+                guacd_registry_add(registry, proc->client->connection_id);
+
             /* Wait for child to finish */
             waitpid(proc->pid, NULL, 0);
 
             /* Remove client */
+            if (registry != NULL)
+                guacd_registry_remove(registry, proc->client->connection_id);
+
             if (guacd_proc_map_remove(map, proc->client->connection_id) == NULL)
                 guacd_log(GUAC_LOG_ERROR, "Internal failure removing "
                         "client \"%s\". Client record will never be freed.",
@@ -350,6 +584,10 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
         /* Free skeleton client */
         guac_client_free(proc->client);
 
+        /* Free metrics shared with the process */
+        if (proc->metrics != NULL)
+            guacd_metrics_free(proc->metrics);
+
         /* Clean up */
         close(proc->fd_socket);
         free(proc);
@@ -370,6 +608,9 @@ void* guacd_connection_thread(void* data) {
 
     guac_socket* socket;
 
+    /* Data may be written directly to unencrypted connections */
+    int socket_fd = connected_socket_fd;
+
 #ifdef ENABLE_SSL
 
     SSL_CTX* ssl_context = params->ssl_context;
@@ -383,6 +624,15 @@ void* guacd_connection_thread(void* data) {
             free(params);
             return NULL;
         }
+
+        /* Data may be written directly to encrypted connections only if
+         * encryption is being handled by the kernel */
+        guac_socket_ssl_data* ssl_data = (guac_socket_ssl_data*) socket->data;
+        if (ssl_data->ktls_send)
+            guacd_log(GUAC_LOG_DEBUG, "Using kernel TLS for outbound data.");
+        else
+            socket_fd = -1;
+
     }
     else
         socket = guac_socket_open(connected_socket_fd);
@@ -393,7 +643,8 @@ void* guacd_connection_thread(void* data) {
 #endif
 
     /* Route connection according to Guacamole, creating a new process if needed */
-    if (guacd_route_connection(map, socket))
+    if (guacd_route_connection(map, params->registry, params->enable_metrics,
+                socket, socket_fd))
         guac_socket_free(socket);
 
     free(params);
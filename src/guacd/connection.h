@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include "proc-map.h"
+#include "registry.h"
 
 #ifdef ENABLE_SSL
 #include <openssl/ssl.h>
@@ -38,6 +39,18 @@ typedef struct guacd_connection_thread_params {
      */
     guacd_proc_map* map;
 
+    /**
+     * The registry recording the node owning each connection, or NULL if
+     * joins are limited to connections owned by this guacd.
+     */
+    guacd_registry* registry;
+
+    /**
+     * Non-zero if new client processes should record metrics for retrieval
+     * via the metrics socket, zero otherwise.
+     */
+    int enable_metrics;
+
 #ifdef ENABLE_SSL
     /**
      * SSL context for encrypted connections to guacd. If SSL is not active,
@@ -98,6 +111,17 @@ typedef struct guacd_connection_io_thread_params {
      */
     int fd;
 
+    /**
+     * The file descriptor underlying the guac_socket, if data written directly
+     * to that file descriptor is equivalent to data written through the
+     * guac_socket (the connection is unencrypted, or encryption is handled
+     * by the kernel), or -1 if all data must be written through the
+     * guac_socket. If available, data is transferred from the
+     * connection-specific process to this file descriptor without passing
+     * through user space where possible.
+     */
+    int socket_fd;
+
 } guacd_connection_io_thread_params;
 
 /**
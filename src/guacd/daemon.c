@@ -24,7 +24,9 @@
 #include "conf-file.h"
 #include "connection.h"
 #include "log.h"
+#include "metrics.h"
 #include "proc-map.h"
+#include "registry.h"
 
 #ifdef ENABLE_SSL
 #include <openssl/ssl.h>
@@ -469,6 +471,37 @@ int main(int argc, char* argv[]) {
         return 3;
     }
 
+    /* Serve connection metrics if requested */
+    if (config->metrics_socket != NULL
+            && guacd_metrics_listen(map, config->metrics_socket))
+        exit(EXIT_FAILURE);
+
+    /* Record the node owning each connection if requested, defaulting to the
+     * local hostname and bound port as the address of this node */
+    guacd_registry* registry = NULL;
+    if (config->registry_path != NULL) {
+
+        char node[GUACD_REGISTRY_NODE_LENGTH];
+        const char* node_address = config->registry_node;
+
+        if (node_address == NULL) {
+            char hostname[GUACD_REGISTRY_NODE_LENGTH - sizeof(bound_port)];
+            if (gethostname(hostname, sizeof(hostname))) {
+                guacd_log(GUAC_LOG_ERROR, "Unable to determine hostname: %s",
+                        strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            hostname[sizeof(hostname) - 1] = '\0';
+            snprintf(node, sizeof(node), "%s:%s", hostname, bound_port);
+            node_address = node;
+        }
+
+        registry = guacd_registry_alloc(config->registry_path, node_address);
+        if (registry == NULL)
+            exit(EXIT_FAILURE);
+
+    }
+
     /* Daemon loop */
     for (;;) {
 
@@ -492,6 +525,8 @@ int main(int argc, char* argv[]) {
         }
 
         params->map = map;
+        params->registry = registry;
+        params->enable_metrics = (config->metrics_socket != NULL);
         params->connected_socket_fd = connected_socket_fd;
 
 #ifdef ENABLE_SSL
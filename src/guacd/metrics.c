@@ -0,0 +1,648 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+/* MAP_ANONYMOUS is not part of X/Open */
+#define _DEFAULT_SOURCE
+
+#include "log.h"
+#include "metrics.h"
+#include "proc.h"
+#include "proc-map.h"
+
+#include <guacamole/metrics.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * The names of each image format for which metrics are recorded, as used
+ * within the "format" label of the exposed metrics. This array is indexed by
+ * guac_metrics_image_format.
+ */
+static const char* GUACD_METRICS_IMAGE_FORMAT_NAMES[] = {
+    [GUAC_METRICS_PNG]  = "png",
+    [GUAC_METRICS_JPEG] = "jpeg",
+    [GUAC_METRICS_WEBP] = "webp"
+};
+
+/**
+ * Parameters for the thread serving requests along the metrics socket.
+ */
+typedef struct guacd_metrics_server_params {
+
+    /**
+     * The map of all connection processes whose metrics should be served.
+     */
+    guacd_proc_map* map;
+
+    /**
+     * The file descriptor of the listening UNIX domain socket.
+     */
+    int socket_fd;
+
+} guacd_metrics_server_params;
+
+/**
+ * Point-in-time copies of the metrics of all connections.
+ */
+typedef struct guacd_metrics_snapshot {
+
+    /**
+     * Array of copies of the metrics of each connection.
+     */
+    guac_metrics* connections;
+
+    /**
+     * The number of connections whose metrics are stored within the
+     * connections array.
+     */
+    int count;
+
+    /**
+     * The number of entries which may be stored within the connections array
+     * before it must be reallocated.
+     */
+    int size;
+
+} guacd_metrics_snapshot;
+
+guac_metrics* guacd_metrics_alloc(const char* connection_id,
+        const char* protocol) {
+
+    /* Allocate storage which remains shared across fork() */
+    guac_metrics* metrics = mmap(NULL, sizeof(guac_metrics),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (metrics == MAP_FAILED)
+        return NULL;
+
+    guac_metrics_init(metrics, connection_id, protocol);
+    return metrics;
+
+}
+
+void guacd_metrics_free(guac_metrics* metrics) {
+    munmap(metrics, sizeof(guac_metrics));
+}
+
+/**
+ * Callback for guacd_proc_map_foreach() which copies the metrics of the given
+ * process into the guacd_metrics_snapshot provided.
+ *
+ * @param proc
+ *     The process whose metrics should be copied.
+ *
+ * @param data
+ *     The guacd_metrics_snapshot receiving the copy.
+ */
+static void guacd_metrics_copy(guacd_proc* proc, void* data) {
+
+    guacd_metrics_snapshot* snapshot = (guacd_metrics_snapshot*) data;
+
+    /* Skip processes for which metrics are not available */
+    if (proc->metrics == NULL)
+        return;
+
+    /* Expand snapshot as necessary */
+    if (snapshot->count == snapshot->size) {
+
+        int size = snapshot->size ? snapshot->size * 2 : 16;
+        guac_metrics* connections = realloc(snapshot->connections,
+                sizeof(guac_metrics) * size);
+
+        if (connections == NULL)
+            return;
+
+        snapshot->connections = connections;
+        snapshot->size = size;
+
+    }
+
+    memcpy(&(snapshot->connections[snapshot->count++]), proc->metrics,
+            sizeof(guac_metrics));
+
+}
+
+/**
+ * Writes the given string as a Prometheus label value, including surrounding
+ * quotes and escaping any characters which require escaping.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param value
+ *     The label value to write.
+ */
+static void guacd_metrics_write_label_value(FILE* output, const char* value) {
+
+    fputc('"', output);
+
+    for (; *value != '\0'; value++) {
+
+        if (*value == '\\' || *value == '"')
+            fprintf(output, "\\%c", *value);
+        else if (*value == '\n')
+            fputs("\\n", output);
+        else
+            fputc(*value, output);
+
+    }
+
+    fputc('"', output);
+
+}
+
+/**
+ * Writes the "connection" and "protocol" labels identifying the connection
+ * described by the given metrics, without surrounding braces.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param metrics
+ *     The metrics of the connection being identified.
+ */
+static void guacd_metrics_write_connection_labels(FILE* output,
+        const guac_metrics* metrics) {
+
+    fputs("connection=", output);
+    guacd_metrics_write_label_value(output, metrics->connection_id);
+
+    fputs(",protocol=", output);
+    guacd_metrics_write_label_value(output, metrics->protocol);
+
+}
+
+/**
+ * Writes the "connection", "protocol", and "user" labels identifying the
+ * given user of the connection described by the given metrics, including
+ * surrounding braces.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param metrics
+ *     The metrics of the connection that the user has joined.
+ *
+ * @param user
+ *     The metrics of the user being identified.
+ */
+static void guacd_metrics_write_user_labels(FILE* output,
+        const guac_metrics* metrics, const guac_metrics_user* user) {
+
+    fputc('{', output);
+    guacd_metrics_write_connection_labels(output, metrics);
+    fputs(",user=", output);
+    guacd_metrics_write_label_value(output, user->user_id);
+    fputc('}', output);
+
+}
+
+/**
+ * Writes the HELP and TYPE lines which must precede the samples of a
+ * Prometheus metric family.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param name
+ *     The name of the metric family.
+ *
+ * @param type
+ *     The Prometheus type of the metric family, such as "counter" or
+ *     "gauge".
+ *
+ * @param help
+ *     A human-readable description of the metric family.
+ */
+static void guacd_metrics_write_family(FILE* output, const char* name,
+        const char* type, const char* help) {
+    fprintf(output, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * Writes all metrics within the given snapshot in Prometheus text format.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param snapshot
+ *     The snapshot of connection metrics to write.
+ */
+static void guacd_metrics_write(FILE* output,
+        const guacd_metrics_snapshot* snapshot) {
+
+    int i, j;
+
+    guacd_metrics_write_family(output, "guacd_connections", "gauge",
+            "Number of active connections.");
+    fprintf(output, "guacd_connections %i\n", snapshot->count);
+
+    guacd_metrics_write_family(output, "guacd_connection_users", "gauge",
+            "Number of users of the connection for which metrics are "
+            "being recorded.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        int users = 0;
+        for (j = 0; j < GUAC_METRICS_MAX_USERS; j++) {
+            if (metrics->users[j].state == GUAC_METRICS_SLOT_READY)
+                users++;
+        }
+
+        fputs("guacd_connection_users{", output);
+        guacd_metrics_write_connection_labels(output, metrics);
+        fprintf(output, "} %i\n", users);
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_connection_frames_total",
+            "counter", "Number of frames sent.");
+    for (i = 0; i < snapshot->count; i++) {
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+        fputs("guacd_connection_frames_total{", output);
+        guacd_metrics_write_connection_labels(output, metrics);
+        fprintf(output, "} %" PRIu64 "\n", metrics->frames);
+    }
+
+    guacd_metrics_write_family(output, "guacd_connection_dropped_frames_total",
+            "counter", "Number of logical frames combined with other frames "
+            "rather than sent individually.");
+    for (i = 0; i < snapshot->count; i++) {
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+        fputs("guacd_connection_dropped_frames_total{", output);
+        guacd_metrics_write_connection_labels(output, metrics);
+        fprintf(output, "} %" PRIu64 "\n", metrics->dropped_frames);
+    }
+
+    guacd_metrics_write_family(output, "guacd_connection_instructions_total",
+            "counter", "Number of instructions sent, by opcode.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_MAX_OPCODES; j++) {
+
+            const guac_metrics_opcode* opcode = &(metrics->opcodes[j]);
+            if (opcode->state != GUAC_METRICS_SLOT_READY)
+                continue;
+
+            fputs("guacd_connection_instructions_total{", output);
+            guacd_metrics_write_connection_labels(output, metrics);
+            fputs(",opcode=", output);
+            guacd_metrics_write_label_value(output, opcode->opcode);
+            fprintf(output, "} %" PRIu64 "\n", opcode->instructions);
+
+        }
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_connection_images_total",
+            "counter", "Number of images encoded, by format.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_IMAGE_FORMATS; j++) {
+            fputs("guacd_connection_images_total{", output);
+            guacd_metrics_write_connection_labels(output, metrics);
+            fprintf(output, ",format=\"%s\"} %" PRIu64 "\n",
+                    GUACD_METRICS_IMAGE_FORMAT_NAMES[j], metrics->images[j]);
+        }
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_connection_image_stream_seconds_total",
+            "counter", "Time spent encoding and sending images, by format.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_IMAGE_FORMATS; j++) {
+            fputs("guacd_connection_image_stream_seconds_total{", output);
+            guacd_metrics_write_connection_labels(output, metrics);
+            fprintf(output, ",format=\"%s\"} %.6f\n",
+                    GUACD_METRICS_IMAGE_FORMAT_NAMES[j],
+                    metrics->stream_time[j] / 1000000.0);
+        }
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_user_sent_bytes_total",
+            "counter", "Number of bytes sent to the user, after any "
+            "compression.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_MAX_USERS; j++) {
+
+            const guac_metrics_user* user = &(metrics->users[j]);
+            if (user->state != GUAC_METRICS_SLOT_READY)
+                continue;
+
+            fputs("guacd_user_sent_bytes_total", output);
+            guacd_metrics_write_user_labels(output, metrics, user);
+            fprintf(output, " %" PRIu64 "\n", user->bytes_sent);
+
+        }
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_user_pending_frames", "gauge",
+            "Number of frames sent to the user which the user has not yet "
+            "acknowledged.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_MAX_USERS; j++) {
+
+            const guac_metrics_user* user = &(metrics->users[j]);
+            if (user->state != GUAC_METRICS_SLOT_READY)
+                continue;
+
+            /* Counters may be observed mid-update, so never report fewer
+             * than zero pending frames */
+            uint64_t pending = 0;
+            if (metrics->frames > user->acknowledged_frames)
+                pending = metrics->frames - user->acknowledged_frames;
+
+            fputs("guacd_user_pending_frames", output);
+            guacd_metrics_write_user_labels(output, metrics, user);
+            fprintf(output, " %" PRIu64 "\n", pending);
+
+        }
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_user_round_trip_seconds",
+            "gauge", "Most recent estimate of the network round-trip time "
+            "of the user.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_MAX_USERS; j++) {
+
+            const guac_metrics_user* user = &(metrics->users[j]);
+            if (user->state != GUAC_METRICS_SLOT_READY)
+                continue;
+
+            fputs("guacd_user_round_trip_seconds", output);
+            guacd_metrics_write_user_labels(output, metrics, user);
+            fprintf(output, " %.3f\n", user->round_trip_time / 1000.0);
+
+        }
+
+    }
+
+    guacd_metrics_write_family(output, "guacd_user_processing_lag_seconds",
+            "gauge", "Most recent estimate of the time the user spends "
+            "processing received frames.");
+    for (i = 0; i < snapshot->count; i++) {
+
+        const guac_metrics* metrics = &(snapshot->connections[i]);
+
+        for (j = 0; j < GUAC_METRICS_MAX_USERS; j++) {
+
+            const guac_metrics_user* user = &(metrics->users[j]);
+            if (user->state != GUAC_METRICS_SLOT_READY)
+                continue;
+
+            fputs("guacd_user_processing_lag_seconds", output);
+            guacd_metrics_write_user_labels(output, metrics, user);
+            fprintf(output, " %.3f\n", user->processing_lag / 1000.0);
+
+        }
+
+    }
+
+}
+
+/**
+ * Handles a single connection to the metrics socket, discarding the request
+ * received and responding with the current metrics of all connections. The
+ * given file descriptor is closed once the response has been sent.
+ *
+ * @param map
+ *     The map of all connection processes whose metrics should be sent.
+ *
+ * @param fd
+ *     The file descriptor of the accepted connection.
+ */
+static void guacd_metrics_handle_request(guacd_proc_map* map, int fd) {
+
+    char request[GUACD_METRICS_MAX_REQUEST_LENGTH];
+    int length = 0;
+
+    /* Do not wait indefinitely for the request, nor for a client that has
+     * stopped reading the response */
+    struct timeval timeout = {
+        .tv_sec  = GUACD_METRICS_REQUEST_TIMEOUT,
+        .tv_usec = 0
+    };
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    /* Read (and ignore) the request headers, which end with a blank line */
+    while (length < sizeof(request) - 1) {
+
+        ssize_t received = read(fd, request + length,
+                sizeof(request) - 1 - length);
+
+        if (received <= 0)
+            break;
+
+        length += received;
+        request[length] = '\0';
+
+        if (strstr(request, "\r\n\r\n") != NULL
+                || strstr(request, "\n\n") != NULL)
+            break;
+
+    }
+
+    /* Build the response in memory, such that it can be abandoned after a
+     * single timed-out write */
+    char* response;
+    size_t response_length;
+    FILE* output = open_memstream(&response, &response_length);
+    if (output == NULL) {
+        close(fd);
+        return;
+    }
+
+    /* Copy metrics of all connections */
+    guacd_metrics_snapshot snapshot = { 0 };
+    guacd_proc_map_foreach(map, guacd_metrics_copy, &snapshot);
+
+    fputs("HTTP/1.0 200 OK\r\n"
+          "Content-Type: text/plain; version=0.0.4\r\n"
+          "Connection: close\r\n"
+          "\r\n", output);
+
+    guacd_metrics_write(output, &snapshot);
+
+    fclose(output);
+    free(snapshot.connections);
+
+    /* Send response, giving up if the client stops reading */
+    size_t sent = 0;
+    while (sent < response_length) {
+
+        ssize_t written = write(fd, response + sent, response_length - sent);
+        if (written <= 0)
+            break;
+
+        sent += written;
+
+    }
+
+    free(response);
+    close(fd);
+
+}
+
+/**
+ * Accepts and handles connections to the metrics socket until the socket is
+ * closed.
+ *
+ * @param data
+ *     A pointer to a guacd_metrics_server_params structure describing the
+ *     socket to serve and the map of connection processes.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacd_metrics_server_thread(void* data) {
+
+    guacd_metrics_server_params* params = (guacd_metrics_server_params*) data;
+
+    for (;;) {
+
+        int fd = accept(params->socket_fd, NULL, NULL);
+        if (fd < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            guacd_log(GUAC_LOG_ERROR, "Unable to accept connection to "
+                    "metrics socket: %s", strerror(errno));
+            break;
+
+        }
+
+        guacd_metrics_handle_request(params->map, fd);
+
+    }
+
+    close(params->socket_fd);
+    free(params);
+    return NULL;
+
+}
+
+int guacd_metrics_listen(guacd_proc_map* map, const char* path) {
+
+    struct sockaddr_un address = {
+        .sun_family = AF_UNIX
+    };
+
+    /* Verify path fits within socket address */
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        guacd_log(GUAC_LOG_ERROR, "Path of metrics socket is too long: %s",
+                path);
+        return 1;
+    }
+
+    strcpy(address.sun_path, path);
+
+    /* Refuse to replace anything other than a stale socket */
+    int stale_socket = 0;
+    struct stat file_stat;
+    if (lstat(path, &file_stat) == 0) {
+
+        if (!S_ISSOCK(file_stat.st_mode)) {
+            guacd_log(GUAC_LOG_ERROR, "Refusing to replace \"%s\" with "
+                    "metrics socket: File exists and is not a socket.", path);
+            return 1;
+        }
+
+        stale_socket = 1;
+
+    }
+
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to create metrics socket: %s",
+                strerror(errno));
+        return 1;
+    }
+
+    /* Replace any stale socket left by a previous instance of guacd */
+    if (stale_socket)
+        unlink(path);
+
+    if (bind(socket_fd, (struct sockaddr*) &address, sizeof(address))
+            || listen(socket_fd, 5)) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to listen on metrics socket "
+                "\"%s\": %s", path, strerror(errno));
+        close(socket_fd);
+        return 1;
+    }
+
+    guacd_metrics_server_params* params =
+        malloc(sizeof(guacd_metrics_server_params));
+
+    params->map = map;
+    params->socket_fd = socket_fd;
+
+    /* Serve requests in the background */
+    pthread_t server_thread;
+    if (pthread_create(&server_thread, NULL, guacd_metrics_server_thread,
+                params)) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to start metrics thread.");
+        close(socket_fd);
+        free(params);
+        return 1;
+    }
+
+    pthread_detach(server_thread);
+
+    guacd_log(GUAC_LOG_INFO, "Serving metrics on UNIX socket \"%s\"", path);
+    return 0;
+
+}
+
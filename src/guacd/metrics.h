@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_METRICS_H
+#define GUACD_METRICS_H
+
+#include "config.h"
+
+#include "proc-map.h"
+
+#include <guacamole/metrics.h>
+
+/**
+ * The number of seconds to wait for a client of the metrics socket to send
+ * its request before responding anyway.
+ */
+#define GUACD_METRICS_REQUEST_TIMEOUT 1
+
+/**
+ * The maximum number of bytes of any request received along the metrics
+ * socket. Requests are read only to be discarded, and any data beyond this
+ * limit is ignored.
+ */
+#define GUACD_METRICS_MAX_REQUEST_LENGTH 8192
+
+/**
+ * Allocates storage for the performance metrics of a new connection, shared
+ * with any child processes subsequently created with fork(). The storage is
+ * initialized with guac_metrics_init().
+ *
+ * @param connection_id
+ *     The ID of the connection described by the metrics.
+ *
+ * @param protocol
+ *     The name of the protocol used by the connection.
+ *
+ * @return
+ *     Newly-allocated, shared storage for connection metrics, or NULL if the
+ *     storage could not be allocated. The returned storage must eventually be
+ *     freed with guacd_metrics_free().
+ */
+guac_metrics* guacd_metrics_alloc(const char* connection_id,
+        const char* protocol);
+
+/**
+ * Frees storage allocated by guacd_metrics_alloc(). Other processes which
+ * share this storage are unaffected.
+ *
+ * @param metrics
+ *     The storage to free.
+ */
+void guacd_metrics_free(guac_metrics* metrics);
+
+/**
+ * Begins serving the metrics of all connections within the given map along a
+ * new UNIX domain socket at the given path. Each connection to the socket
+ * receives a single HTTP response containing the current metrics in
+ * Prometheus text format, regardless of the request made. Requests are
+ * handled by a new, detached thread.
+ *
+ * @param map
+ *     The map of all connection processes whose metrics should be served.
+ *
+ * @param path
+ *     The filesystem path at which the UNIX domain socket should be created.
+ *     Any existing socket at this path is replaced. If a file other than a
+ *     socket exists at this path, the metrics socket is not created.
+ *
+ * @return
+ *     Zero if the socket was successfully created and is being served,
+ *     non-zero otherwise.
+ */
+int guacd_metrics_listen(guacd_proc_map* map, const char* path);
+
+#endif
+
@@ -18,17 +18,18 @@
  */
 
 #include "config.h"
-#include "common/list.h"
 #include "proc.h"
 #include "proc-map.h"
 
 #include <guacamole/client.h>
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 /**
- * Returns a hash code based on the given connection ID.
+ * Returns a hash code based on the given connection ID, using the 32-bit
+ * FNV-1a algorithm.
  *
  * @param str
  *     The string containing the connection ID.
@@ -38,92 +39,124 @@
  */
 static unsigned int __guacd_client_hash(const char* str) {
 
-    unsigned int hash_value = 0;
+    unsigned int hash_value = 2166136261u;
     int c;
 
     /* Apply each character in string to the hash code */
-    while ((c = *(str++)))
-        hash_value = hash_value * 65599 + c;
+    while ((c = (unsigned char) *(str++)))
+        hash_value = (hash_value ^ c) * 16777619u;
 
     return hash_value;
 
 }
 
 /**
- * Locates the bucket corresponding to the hash code indicated by the given id,
- * where the hash code is dictated by __guacd_client_hash().  Each bucket is an
- * instance of guac_common_list.
+ * Locates the slot within the given map which contains the process having
+ * the given connection ID. If no such process is stored, the empty slot at
+ * which that process would be stored is returned instead. The map must be
+ * locked, and must contain at least one empty slot.
  *
  * @param map
- *     The map to retrieve the hash bucket from.
+ *     The map to search.
  *
  * @param id
- *     The ID whose hash code determines the bucket being retrieved.
+ *     The connection ID of the process to locate.
+ *
+ * @param hash
+ *     The hash code of the given connection ID, as returned by
+ *     __guacd_client_hash().
  *
  * @return
- *     The bucket corresponding to the hash code for the given ID, represented
- *     by a guac_common_list.
+ *     The index of the slot containing the process having the given
+ *     connection ID, or of the empty slot at which that process would be
+ *     stored.
  */
-static guac_common_list* __guacd_proc_find_bucket(guacd_proc_map* map,
-        const char* id) {
+static unsigned int __guacd_proc_find(guacd_proc_map* map, const char* id,
+        unsigned int hash) {
+
+    unsigned int mask = map->__size - 1;
+    unsigned int index = hash & mask;
+
+    /* Probe linearly until a match or an empty slot is found */
+    guacd_proc_map_entry* entry;
+    while ((entry = &map->__entries[index])->proc != NULL) {
 
-    const int index = __guacd_client_hash(id) % GUACD_PROC_MAP_BUCKETS;
-    return map->__buckets[index];
+        if (entry->hash == hash
+                && strcmp(entry->proc->client->connection_id, id) == 0)
+            break;
+
+        index = (index + 1) & mask;
+
+    }
+
+    return index;
 
 }
 
 /**
- * Given a bucket of guacd_proc instances, returns the guacd_proc having the
- * guac_client with the given ID, or NULL if no such client is stored.
+ * Moves all processes within the given map into a newly-allocated table
+ * having the given number of slots, freeing the old table. The map must be
+ * locked for writing.
  *
- * @param bucket
- *     The bucket of guacd_proc instances to search, represented as a
- *     guac_common_list.
+ * @param map
+ *     The map to resize.
  *
- * @param id
- *     The ID of the guac_client whose corresponding guacd_proc instance should
- *     be located within the bucket.
+ * @param size
+ *     The number of slots within the new table, which must be a power of two
+ *     greater than the number of processes stored.
  *
  * @return
- *     The guac_common_list_element containing the guacd_proc instance
- *     corresponding to the guac_client having the given ID, or NULL of no such
- *     element exists.
+ *     Zero if the map was resized successfully, non-zero if the new table
+ *     could not be allocated, in which case the map is left untouched.
  */
-static guac_common_list_element* __guacd_proc_find(guac_common_list* bucket,
-        const char* id) {
+static int __guacd_proc_map_resize(guacd_proc_map* map, unsigned int size) {
 
-    guac_common_list_element* current = bucket->head;
+    guacd_proc_map_entry* entries = calloc(size,
+            sizeof(guacd_proc_map_entry));
+    if (entries == NULL)
+        return 1;
 
-    /* Search for matching element within bucket */
-    while (current != NULL) {
+    unsigned int mask = size - 1;
 
-        /* Check connection ID */
-        guacd_proc* proc = (guacd_proc*) current->data;
-        if (strcmp(proc->client->connection_id, id) == 0)
-            break;
+    /* Reinsert each process at the first empty slot from its home slot */
+    for (unsigned int i = 0; i < map->__size; i++) {
+
+        guacd_proc_map_entry* entry = &map->__entries[i];
+        if (entry->proc == NULL)
+            continue;
+
+        unsigned int index = entry->hash & mask;
+        while (entries[index].proc != NULL)
+            index = (index + 1) & mask;
+
+        entries[index] = *entry;
 
-        current = current->next;
     }
 
-    return current;
+    free(map->__entries);
+    map->__entries = entries;
+    map->__size = size;
+    return 0;
 
 }
 
 guacd_proc_map* guacd_proc_map_alloc() {
 
     guacd_proc_map* map = malloc(sizeof(guacd_proc_map));
-    guac_common_list** current;
-
-    int i;
-
-    /* Init all buckets */
-    current = map->__buckets;
+    if (map == NULL)
+        return NULL;
 
-    for (i=0; i<GUACD_PROC_MAP_BUCKETS; i++) {
-        *current = guac_common_list_alloc();
-        current++;
+    map->__entries = calloc(GUACD_PROC_MAP_INITIAL_SIZE,
+            sizeof(guacd_proc_map_entry));
+    if (map->__entries == NULL) {
+        free(map);
+        return NULL;
     }
 
+    map->__size = GUACD_PROC_MAP_INITIAL_SIZE;
+    map->__count = 0;
+    pthread_rwlock_init(&map->__lock, NULL);
+
     return map;
 
 }
@@ -131,72 +164,116 @@ guacd_proc_map* guacd_proc_map_alloc() {
 int guacd_proc_map_add(guacd_proc_map* map, guacd_proc* proc) {
 
     const char* identifier = proc->client->connection_id;
-    guac_common_list* bucket = __guacd_proc_find_bucket(map, identifier);
-    guac_common_list_element* found;
-
-    /* Retrieve corresponding element, if any */
-    guac_common_list_lock(bucket);
-    found = __guacd_proc_find(bucket, identifier);
-
-    /* If no such element, we can add the new client successfully */
-    if (found == NULL) {
-        guac_common_list_add(bucket, proc);
-        guac_common_list_unlock(bucket);
-        return 0;
+    unsigned int hash = __guacd_client_hash(identifier);
+
+    pthread_rwlock_wrlock(&map->__lock);
+
+    /* Refuse to exceed the maximum number of connections */
+    if (map->__count >= GUACD_CLIENT_MAX_CONNECTIONS) {
+        pthread_rwlock_unlock(&map->__lock);
+        return 1;
     }
 
-    /* Otherwise, fail - already exists */
-    guac_common_list_unlock(bucket);
-    return 1;
+    /* Keep the table at most half full, such that probes remain short */
+    if ((map->__count + 1) * 2 > map->__size
+            && __guacd_proc_map_resize(map, map->__size * 2)) {
+        pthread_rwlock_unlock(&map->__lock);
+        return 1;
+    }
 
-}
+    /* Fail if a process having the same ID already exists */
+    guacd_proc_map_entry* entry =
+        &map->__entries[__guacd_proc_find(map, identifier, hash)];
+    if (entry->proc != NULL) {
+        pthread_rwlock_unlock(&map->__lock);
+        return 1;
+    }
 
-guacd_proc* guacd_proc_map_retrieve(guacd_proc_map* map, const char* id) {
+    entry->hash = hash;
+    entry->proc = proc;
+    map->__count++;
 
-    guacd_proc* proc;
+    pthread_rwlock_unlock(&map->__lock);
+    return 0;
 
-    guac_common_list* bucket = __guacd_proc_find_bucket(map, id);
-    guac_common_list_element* found;
+}
 
-    /* Retrieve corresponding element, if any */
-    guac_common_list_lock(bucket);
-    found = __guacd_proc_find(bucket, id);
+guacd_proc* guacd_proc_map_retrieve(guacd_proc_map* map, const char* id) {
 
-    /* If no such element, fail */
-    if (found == NULL) {
-        guac_common_list_unlock(bucket);
-        return NULL;
-    }
+    unsigned int hash = __guacd_client_hash(id);
 
-    proc = (guacd_proc*) found->data;
+    pthread_rwlock_rdlock(&map->__lock);
+    guacd_proc* proc = map->__entries[__guacd_proc_find(map, id, hash)].proc;
+    pthread_rwlock_unlock(&map->__lock);
 
-    guac_common_list_unlock(bucket);
     return proc;
 
 }
 
 guacd_proc* guacd_proc_map_remove(guacd_proc_map* map, const char* id) {
 
-    guacd_proc* proc;
+    unsigned int hash = __guacd_client_hash(id);
 
-    guac_common_list* bucket = __guacd_proc_find_bucket(map, id);
-    guac_common_list_element* found;
+    pthread_rwlock_wrlock(&map->__lock);
 
-    /* Retrieve corresponding element, if any */
-    guac_common_list_lock(bucket);
-    found = __guacd_proc_find(bucket, id);
+    unsigned int mask = map->__size - 1;
+    unsigned int hole = __guacd_proc_find(map, id, hash);
 
-    /* If no such element, fail */
-    if (found == NULL) {
-        guac_common_list_unlock(bucket);
+    /* If no such process, fail */
+    guacd_proc* proc = map->__entries[hole].proc;
+    if (proc == NULL) {
+        pthread_rwlock_unlock(&map->__lock);
         return NULL;
     }
 
-    proc = (guacd_proc*) found->data;
-    guac_common_list_remove(bucket, found);
+    map->__entries[hole].proc = NULL;
+    map->__count--;
+
+    /* Shift any following processes back into the hole if doing so brings
+     * them no further from their home slot, such that no probe sequence is
+     * broken by the removal */
+    unsigned int index = hole;
+    for (;;) {
+
+        index = (index + 1) & mask;
+
+        guacd_proc_map_entry* entry = &map->__entries[index];
+        if (entry->proc == NULL)
+            break;
+
+        unsigned int home = entry->hash & mask;
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            map->__entries[hole] = *entry;
+            entry->proc = NULL;
+            hole = index;
+        }
+
+    }
+
+    /* Release memory once the table is mostly empty (failure to do so is
+     * harmless) */
+    if (map->__size > GUACD_PROC_MAP_INITIAL_SIZE
+            && map->__count * 8 < map->__size)
+        __guacd_proc_map_resize(map, map->__size / 2);
 
-    guac_common_list_unlock(bucket);
+    pthread_rwlock_unlock(&map->__lock);
     return proc;
 
 }
 
+void guacd_proc_map_foreach(guacd_proc_map* map,
+        guacd_proc_map_foreach_callback* callback, void* data) {
+
+    pthread_rwlock_rdlock(&map->__lock);
+
+    /* Visit each process while the map is locked against removal */
+    for (unsigned int i = 0; i < map->__size; i++) {
+        guacd_proc* proc = map->__entries[i].proc;
+        if (proc != NULL)
+            callback(proc, data);
+    }
+
+    pthread_rwlock_unlock(&map->__lock);
+
+}
+
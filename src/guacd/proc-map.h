@@ -22,11 +22,12 @@
 #define _GUACD_PROC_MAP_H
 
 #include "config.h"
-#include "common/list.h"
 #include "proc.h"
 
 #include <guacamole/client.h>
 
+#include <pthread.h>
+
 /**
  * The maximum number of concurrent connections to a single instance
  * of guacd.
@@ -34,20 +35,58 @@
 #define GUACD_CLIENT_MAX_CONNECTIONS 65536
 
 /**
- * The number of hash buckets in each process map.
+ * The number of slots initially allocated within each process map. The map
+ * grows and shrinks as processes are added and removed, but never shrinks
+ * below this size. This value must be a power of two.
  */
-#define GUACD_PROC_MAP_BUCKETS GUACD_CLIENT_MAX_CONNECTIONS*2
+#define GUACD_PROC_MAP_INITIAL_SIZE 64
 
 /**
- * Set of all active connections to guacd, indexed by connection ID.
+ * A single slot within the open-addressed table of a guacd_proc_map.
+ */
+typedef struct guacd_proc_map_entry {
+
+    /**
+     * The hash code of the connection ID of the stored process, cached to
+     * avoid comparing IDs of processes which cannot match and to avoid
+     * rehashing IDs when the table is resized.
+     */
+    unsigned int hash;
+
+    /**
+     * The stored process, or NULL if this slot is empty.
+     */
+    guacd_proc* proc;
+
+} guacd_proc_map_entry;
+
+/**
+ * Set of all active connections to guacd, indexed by connection ID. Processes
+ * are stored within a single open-addressed table using linear probing, which
+ * is resized as necessary to keep the table at most half full.
  */
 typedef struct guacd_proc_map {
 
     /**
-     * Internal hash buckets. Each bucket is a linked list containing all
-     * guac_client instances which hash to this bucket location.
+     * Lock which is held for reading during lookups and iteration, and for
+     * writing while processes are added or removed.
+     */
+    pthread_rwlock_t __lock;
+
+    /**
+     * The slots of the table. The number of slots is always a power of two.
+     */
+    guacd_proc_map_entry* __entries;
+
+    /**
+     * The total number of slots within the table.
      */
-    guac_common_list* __buckets[GUACD_PROC_MAP_BUCKETS];
+    unsigned int __size;
+
+    /**
+     * The number of processes currently stored within the table.
+     */
+    unsigned int __count;
 
 } guacd_proc_map;
 
@@ -60,6 +99,18 @@ typedef struct guacd_proc_map {
  */
 guacd_proc_map* guacd_proc_map_alloc();
 
+/**
+ * Callback which is invoked by guacd_proc_map_foreach() for each process
+ * stored within a guacd_proc_map.
+ *
+ * @param proc
+ *     The process currently being visited.
+ *
+ * @param data
+ *     The arbitrary data provided to guacd_proc_map_foreach().
+ */
+typedef void guacd_proc_map_foreach_callback(guacd_proc* proc, void* data);
+
 /**
  * Adds the given process to the client process map. On success, zero is
  * returned. If adding the client fails (due to lack of space, or duplicate
@@ -112,5 +163,23 @@ guacd_proc* guacd_proc_map_retrieve(guacd_proc_map* map, const char* id);
  */
 guacd_proc* guacd_proc_map_remove(guacd_proc_map* map, const char* id);
 
+/**
+ * Invokes the given callback for each process stored within the given map.
+ * Each process is guaranteed to remain within the map (and thus not be freed)
+ * for the duration of the callback invoked for that process, but processes
+ * may be added or removed concurrently with the iteration as a whole.
+ *
+ * @param map
+ *     The map whose processes should be visited.
+ *
+ * @param callback
+ *     The callback to invoke for each process.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given callback.
+ */
+void guacd_proc_map_foreach(guacd_proc_map* map,
+        guacd_proc_map_foreach_callback* callback, void* data);
+
 #endif
 
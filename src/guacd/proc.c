@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include "log.h"
+#include "metrics.h"
 #include "move-fd.h"
 #include "proc.h"
 #include "proc-map.h"
@@ -388,7 +389,7 @@ cleanup_process:
 
 }
 
-guacd_proc* guacd_create_proc(const char* protocol) {
+guacd_proc* guacd_create_proc(const char* protocol, int enable_metrics) {
 
     int sockets[2];
 
@@ -422,6 +423,21 @@ guacd_proc* guacd_create_proc(const char* protocol) {
     /* Init logging */
     proc->client->log_handler = guacd_client_log;
 
+    /* Record metrics in storage visible to the parent process, if requested */
+    if (enable_metrics) {
+
+        proc->metrics = guacd_metrics_alloc(proc->client->connection_id,
+                protocol);
+
+        if (proc->metrics != NULL)
+            guac_client_set_metrics(proc->client, proc->metrics);
+        else
+            guacd_log(GUAC_LOG_WARNING, "Unable to allocate storage for "
+                    "metrics of connection \"%s\": %s",
+                    proc->client->connection_id, strerror(errno));
+
+    }
+
     /* Fork */
     proc->pid = fork();
     if (proc->pid < 0) {
@@ -429,6 +445,8 @@ guacd_proc* guacd_create_proc(const char* protocol) {
         close(parent_socket);
         close(child_socket);
         guac_client_free(proc->client);
+        if (proc->metrics != NULL)
+            guacd_metrics_free(proc->metrics);
         free(proc);
         return NULL;
     }
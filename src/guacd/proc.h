@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include <guacamole/client.h>
+#include <guacamole/metrics.h>
 #include <guacamole/parser.h>
 
 #include <unistd.h>
@@ -78,6 +79,14 @@ typedef struct guacd_proc {
      */
     guac_client* client;
 
+    /**
+     * Storage for the performance metrics of the connection, shared between
+     * the parent and child processes, or NULL if metrics are not enabled or
+     * shared storage could not be allocated. Only the child process updates
+     * these metrics.
+     */
+    guac_metrics* metrics;
+
 } guacd_proc;
 
 /**
@@ -89,12 +98,16 @@ typedef struct guacd_proc {
  * @param protocol
  *     The protocol for which this process is client being created.
  *
+ * @param enable_metrics
+ *     Non-zero if the process should record metrics within storage visible to
+ *     the parent process, zero if no metrics should be recorded.
+ *
  * @return
  *     A newly-allocated process structure pointing to the file descriptor of
  *     the background process specific to the specified protocol, or NULL of
  *     the process could not be created.
  */
-guacd_proc* guacd_create_proc(const char* protocol);
+guacd_proc* guacd_create_proc(const char* protocol, int enable_metrics);
 
 /**
  * Signals the given process to stop accepting new users and clean up. This
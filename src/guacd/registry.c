@@ -0,0 +1,251 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "log.h"
+#include "registry.h"
+
+#include <guacamole/client.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The maximum length of any connection ID accepted by the registry,
+ * excluding null terminator.
+ */
+#define GUACD_REGISTRY_MAX_ID_LENGTH 64
+
+/**
+ * Returns whether the given string is a plausible connection ID which may
+ * safely be used as a filename within the registry directory. Only the
+ * connection ID prefix, alphanumeric characters, and hyphens are allowed,
+ * such that IDs received from joining users can never refer to files
+ * outside the registry.
+ *
+ * @param id
+ *     The string to test.
+ *
+ * @return
+ *     Non-zero if the given string is a valid connection ID, zero otherwise.
+ */
+static int guacd_registry_valid_id(const char* id) {
+
+    if (*(id++) != GUAC_CLIENT_ID_PREFIX)
+        return 0;
+
+    int length = 0;
+    for (; *id != '\0'; id++) {
+
+        if (!isalnum((unsigned char) *id) && *id != '-')
+            return 0;
+
+        if (++length > GUACD_REGISTRY_MAX_ID_LENGTH)
+            return 0;
+
+    }
+
+    return length > 0;
+
+}
+
+guacd_registry* guacd_registry_alloc(const char* path, const char* node) {
+
+    /* Registry must be writable for connections to be recorded */
+    if (access(path, W_OK | X_OK)) {
+        guacd_log(GUAC_LOG_ERROR, "Registry directory \"%s\" cannot be "
+                "used: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    if (strlen(node) >= GUACD_REGISTRY_NODE_LENGTH
+            || strchr(node, ':') == NULL) {
+        guacd_log(GUAC_LOG_ERROR, "Invalid registry node address \"%s\" "
+                "(must be of the form HOST:PORT)", node);
+        return NULL;
+    }
+
+    guacd_registry* registry = malloc(sizeof(guacd_registry));
+    registry->path = strdup(path);
+    registry->node = strdup(node);
+
+    guacd_log(GUAC_LOG_INFO, "Registering connections within \"%s\" as "
+            "node \"%s\"", path, node);
+
+    return registry;
+
+}
+
+void guacd_registry_free(guacd_registry* registry) {
+    free(registry->path);
+    free(registry->node);
+    free(registry);
+}
+
+int guacd_registry_add(guacd_registry* registry, const char* id) {
+
+    char path[PATH_MAX];
+    char temp_path[PATH_MAX];
+
+    if (!guacd_registry_valid_id(id))
+        return 1;
+
+    snprintf(path, sizeof(path), "%s/%s", registry->path, id);
+    snprintf(temp_path, sizeof(temp_path), "%s/.%s", registry->path, id);
+
+    /* Write node address to temporary file */
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        guacd_log(GUAC_LOG_WARNING, "Unable to register connection \"%s\": "
+                "%s", id, strerror(errno));
+        return 1;
+    }
+
+    int length = strlen(registry->node);
+    int written = write(fd, registry->node, length);
+    close(fd);
+
+    /* Atomically replace any existing entry, such that other nodes never
+     * read a partially-written address */
+    if (written != length || rename(temp_path, path)) {
+        guacd_log(GUAC_LOG_WARNING, "Unable to register connection \"%s\".",
+                id);
+        unlink(temp_path);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+void guacd_registry_remove(guacd_registry* registry, const char* id) {
+
+    char path[PATH_MAX];
+
+    if (!guacd_registry_valid_id(id))
+        return;
+
+    snprintf(path, sizeof(path), "%s/%s", registry->path, id);
+    if (unlink(path))
+        guacd_log(GUAC_LOG_WARNING, "Unable to remove connection \"%s\" "
+                "from registry: %s", id, strerror(errno));
+
+}
+
+char* guacd_registry_lookup(guacd_registry* registry, const char* id) {
+
+    char path[PATH_MAX];
+    char node[GUACD_REGISTRY_NODE_LENGTH];
+
+    if (!guacd_registry_valid_id(id))
+        return NULL;
+
+    snprintf(path, sizeof(path), "%s/%s", registry->path, id);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    int length = read(fd, node, sizeof(node) - 1);
+    close(fd);
+
+    if (length <= 0)
+        return NULL;
+
+    node[length] = '\0';
+
+    /* Connections owned by this node are found locally, if at all */
+    if (strcmp(node, registry->node) == 0)
+        return NULL;
+
+    return strdup(node);
+
+}
+
+int guacd_registry_connect(const char* node) {
+
+    char host[GUACD_REGISTRY_NODE_LENGTH];
+
+    /* Split address at final colon, allowing for IPv6 hosts */
+    const char* port = strrchr(node, ':');
+    if (port == NULL || port - node >= sizeof(host))
+        return -1;
+
+    int host_length = port - node;
+    memcpy(host, node, host_length);
+    host[host_length] = '\0';
+    port++;
+
+    /* Strip brackets from IPv6 addresses */
+    char* host_start = host;
+    if (host[0] == '[' && host_length > 1 && host[host_length - 1] == ']') {
+        host[host_length - 1] = '\0';
+        host_start++;
+    }
+
+    struct addrinfo* addresses;
+    struct addrinfo hints = {
+        .ai_family   = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_protocol = IPPROTO_TCP
+    };
+
+    int retval = getaddrinfo(host_start, port, &hints, &addresses);
+    if (retval != 0) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to resolve node \"%s\": %s",
+                node, gai_strerror(retval));
+        return -1;
+    }
+
+    /* Attempt connection to each address until success */
+    int fd = -1;
+    for (struct addrinfo* current = addresses; current != NULL;
+            current = current->ai_next) {
+
+        fd = socket(current->ai_family, SOCK_STREAM, 0);
+        if (fd < 0)
+            continue;
+
+        if (connect(fd, current->ai_addr, current->ai_addrlen) == 0)
+            break;
+
+        close(fd);
+        fd = -1;
+
+    }
+
+    freeaddrinfo(addresses);
+
+    if (fd < 0)
+        guacd_log(GUAC_LOG_ERROR, "Unable to connect to node \"%s\".", node);
+
+    return fd;
+
+}
+
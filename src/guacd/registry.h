@@ -0,0 +1,138 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_REGISTRY_H
+#define GUACD_REGISTRY_H
+
+#include "config.h"
+
+/**
+ * The maximum length of the address of any guacd node stored within the
+ * registry, including null terminator.
+ */
+#define GUACD_REGISTRY_NODE_LENGTH 256
+
+/**
+ * Registry recording which guacd node owns each active connection, allowing
+ * users to join connections owned by other nodes. The registry is a
+ * directory shared by all nodes, such as over a network filesystem, which
+ * contains one file per connection. Each file is named after the connection
+ * ID and contains the address of the owning node.
+ */
+typedef struct guacd_registry {
+
+    /**
+     * The path of the directory containing the registry.
+     */
+    char* path;
+
+    /**
+     * The address of this guacd node, in "HOST:PORT" form, as it should be
+     * reached by other guacd nodes.
+     */
+    char* node;
+
+} guacd_registry;
+
+/**
+ * Allocates a new registry stored within the given directory, associating
+ * all connections registered by this guacd with the given node address.
+ *
+ * @param path
+ *     The path of the directory containing the registry, which must already
+ *     exist and be writable.
+ *
+ * @param node
+ *     The address of this guacd node, in "HOST:PORT" form, as it should be
+ *     reached by other guacd nodes.
+ *
+ * @return
+ *     A newly-allocated registry, or NULL if the given directory cannot be
+ *     used.
+ */
+guacd_registry* guacd_registry_alloc(const char* path, const char* node);
+
+/**
+ * Frees the given registry. Connections already registered remain within
+ * the registry.
+ *
+ * @param registry
+ *     The registry to free.
+ */
+void guacd_registry_free(guacd_registry* registry);
+
+/**
+ * Records that the connection having the given ID is owned by this guacd
+ * node.
+ *
+ * @param registry
+ *     The registry to update.
+ *
+ * @param id
+ *     The ID of the connection.
+ *
+ * @return
+ *     Zero if the connection was registered successfully, non-zero
+ *     otherwise.
+ */
+int guacd_registry_add(guacd_registry* registry, const char* id);
+
+/**
+ * Removes the connection having the given ID from the registry.
+ *
+ * @param registry
+ *     The registry to update.
+ *
+ * @param id
+ *     The ID of the connection.
+ */
+void guacd_registry_remove(guacd_registry* registry, const char* id);
+
+/**
+ * Returns the address of the guacd node which owns the connection having the
+ * given ID, if that node is not this node.
+ *
+ * @param registry
+ *     The registry to search.
+ *
+ * @param id
+ *     The ID of the connection, as received from a joining user.
+ *
+ * @return
+ *     A newly-allocated string containing the address of the owning node,
+ *     which must eventually be freed with free(), or NULL if the connection
+ *     is not registered, is owned by this node, or the given ID is not a
+ *     valid connection ID.
+ */
+char* guacd_registry_lookup(guacd_registry* registry, const char* id);
+
+/**
+ * Opens a TCP connection to the guacd node having the given address.
+ *
+ * @param node
+ *     The address of the guacd node, in "HOST:PORT" form.
+ *
+ * @return
+ *     The file descriptor of the new connection, or -1 if the connection
+ *     cannot be established.
+ */
+int guacd_registry_connect(const char* node);
+
+#endif
+
@@ -26,13 +26,18 @@
 #include "guacamole/user.h"
 #include "raw_encoder.h"
 
+#ifdef ENABLE_OGG
+#include "ogg_encoder.h"
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 
 /**
  * Sets the encoder associated with the given guac_audio_stream, automatically
  * invoking its begin_handler. The guac_audio_stream MUST NOT already be
- * associated with an encoder.
+ * associated with an encoder. If the encoder cannot be initialized for the
+ * PCM format of the stream, no encoder is assigned.
  *
  * @param audio
  *     The guac_audio_stream whose encoder is being set.
@@ -43,10 +48,19 @@
 static void guac_audio_stream_set_encoder(guac_audio_stream* audio,
         guac_audio_encoder* encoder) {
 
+    /* Clear any state left by a previous encoder */
+    audio->data = NULL;
+
     /* Call handler, if defined */
     if (encoder != NULL && encoder->begin_handler)
         encoder->begin_handler(audio);
 
+#ifdef ENABLE_OGG
+    /* The Ogg encoder allocates no state if the PCM format is unsupported */
+    if (encoder == ogg_encoder && audio->data == NULL)
+        encoder = NULL;
+#endif
+
     /* Assign encoder, which may be NULL */
     audio->encoder = encoder;
 
@@ -83,6 +97,23 @@ static void* guac_audio_assign_encoder(guac_user* user, void* data) {
     if (user == NULL || audio->encoder != NULL)
         return audio->encoder;
 
+#ifdef ENABLE_OGG
+    /* Prefer compressed audio if supported, regardless of the order that
+     * mimetypes are declared, as raw PCM requires roughly ten times the
+     * bandwidth */
+    if (bps == 16) {
+        for (i=0; user->info.audio_mimetypes[i] != NULL; i++) {
+            if (strcmp(user->info.audio_mimetypes[i],
+                        ogg_encoder->mimetype) == 0) {
+                guac_audio_stream_set_encoder(audio, ogg_encoder);
+                if (audio->encoder != NULL)
+                    return audio->encoder;
+                break;
+            }
+        }
+    }
+#endif
+
     /* For each supported mimetype, check for an associated encoder */
     for (i=0; user->info.audio_mimetypes[i] != NULL; i++) {
 
@@ -171,6 +202,12 @@ void guac_audio_stream_reset(guac_audio_stream* audio,
     /* Re-init encoder */
     guac_audio_stream_set_encoder(audio, encoder);
 
+    /* Attempt to assign a different encoder if the requested encoder does not
+     * support the new PCM format */
+    if (audio->encoder == NULL)
+        guac_client_foreach_user(audio->client, guac_audio_assign_encoder,
+                audio);
+
 }
 
 void guac_audio_stream_add_user(guac_audio_stream* audio, guac_user* user) {
@@ -0,0 +1,581 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "base64.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * The base64 alphabet, where the character at each index is the encoded form
+ * of the 6-bit value equal to that index.
+ */
+static const char guac_base64_characters[64] = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O',
+    'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd',
+    'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's',
+    't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', '+', '/'
+};
+
+/**
+ * The 6-bit value of every possible character, where the value at each index
+ * is the value of the character having that index as its code. Characters
+ * which are not part of the base64 alphabet have the value zero.
+ */
+static unsigned char guac_base64_values[256];
+
+/**
+ * Function which encodes as much of the given data as possible as base64,
+ * without padding, returning the number of bytes encoded. The number of
+ * characters written is always 4/3 of the number of bytes encoded.
+ */
+typedef size_t guac_base64_encode_kernel(const unsigned char* src,
+        size_t length, char* dst);
+
+/**
+ * Function which decodes as much of the given base64 data as possible,
+ * stopping before any character which is not part of the base64 alphabet,
+ * and returning the number of characters decoded. The number of characters
+ * decoded is always a multiple of four, with 3/4 as many bytes written.
+ */
+typedef size_t guac_base64_decode_kernel(const char* src, size_t length,
+        unsigned char* dst);
+
+/**
+ * The fastest available encoding kernel, or NULL if only the scalar
+ * implementation is available.
+ */
+static guac_base64_encode_kernel* guac_base64_encode_fast = NULL;
+
+/**
+ * The fastest available decoding kernel, or NULL if only the scalar
+ * implementation is available.
+ */
+static guac_base64_decode_kernel* guac_base64_decode_fast = NULL;
+
+/**
+ * Guard ensuring guac_base64_init() is invoked exactly once.
+ */
+static pthread_once_t guac_base64_init_once = PTHREAD_ONCE_INIT;
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Translates each of the given 6-bit values into the corresponding base64
+ * character.
+ *
+ * @param values
+ *     Sixteen 6-bit values, one per byte.
+ *
+ * @return
+ *     The sixteen base64 characters corresponding to the given values.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i guac_base64_ssse3_translate(__m128i values) {
+
+    /* Offsets from each value to its character, indexed by range: 0 for
+     * a-z, 1-10 for 0-9, 11 for '+', 12 for '/', 13 for A-Z */
+    const __m128i offsets = _mm_setr_epi8('a' - 26,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '+' - 62, '/' - 63, 'A', 0, 0);
+
+    __m128i range = _mm_subs_epu8(values, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+    return _mm_add_epi8(values, _mm_shuffle_epi8(offsets, range));
+
+}
+
+/**
+ * Splits each group of three bytes within the given 12 bytes of data into
+ * four 6-bit values.
+ *
+ * @param data
+ *     The data to split, stored within the lowest 12 bytes.
+ *
+ * @return
+ *     The sixteen 6-bit values within the given data, one per byte.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i guac_base64_ssse3_split(__m128i data) {
+
+    /* Arrange each group of three bytes ABC as BACB */
+    data = _mm_shuffle_epi8(data, _mm_set_epi8(
+                10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    /* Shift first and third values into place */
+    __m128i first_third = _mm_mulhi_epu16(
+            _mm_and_si128(data, _mm_set1_epi32(0x0FC0FC00)),
+            _mm_set1_epi32(0x04000040));
+
+    /* Shift second and fourth values into place */
+    __m128i second_fourth = _mm_mullo_epi16(
+            _mm_and_si128(data, _mm_set1_epi32(0x003F03F0)),
+            _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(first_third, second_fourth);
+
+}
+
+/**
+ * Translates each of the given base64 characters into its 6-bit value,
+ * additionally verifying that every character is part of the base64
+ * alphabet.
+ *
+ * @param chars
+ *     Sixteen base64 characters.
+ *
+ * @param values
+ *     Storage for the sixteen 6-bit values, one per byte.
+ *
+ * @return
+ *     Non-zero if all characters were part of the base64 alphabet, zero
+ *     otherwise.
+ */
+__attribute__((target("ssse3")))
+static inline int guac_base64_ssse3_values(__m128i chars, __m128i* values) {
+
+    /* Classification of each character by its lower and upper nibble, such
+     * that the bitwise AND of the two is non-zero only for characters
+     * outside the base64 alphabet */
+    const __m128i lower_class = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i upper_class = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04,
+            0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+
+    /* Offsets from each character to its value, indexed by upper nibble
+     * (with '/' occupying index 1 rather than 2) */
+    const __m128i offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+            0, 0, 0, 0, 0, 0, 0, 0);
+
+    __m128i upper = _mm_and_si128(_mm_srli_epi32(chars, 4),
+            _mm_set1_epi8(0x0F));
+    __m128i lower = _mm_and_si128(chars, _mm_set1_epi8(0x0F));
+
+    __m128i invalid = _mm_and_si128(
+            _mm_shuffle_epi8(lower_class, lower),
+            _mm_shuffle_epi8(upper_class, upper));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128()))
+            != 0xFFFF)
+        return 0;
+
+    __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+    *values = _mm_add_epi8(chars,
+            _mm_shuffle_epi8(offsets, _mm_add_epi8(slash, upper)));
+
+    return 1;
+
+}
+
+/**
+ * Packs the given sixteen 6-bit values into 12 bytes of data.
+ *
+ * @param values
+ *     The sixteen 6-bit values to pack, one per byte.
+ *
+ * @return
+ *     The packed data, stored within the lowest 12 bytes.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i guac_base64_ssse3_pack(__m128i values) {
+
+    /* Merge pairs of values into 12-bit values, and then pairs of 12-bit
+     * values into 24-bit values */
+    __m128i merged = _mm_madd_epi16(
+            _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)),
+            _mm_set1_epi32(0x00011000));
+
+    /* Restore original byte order, discarding unused bytes */
+    return _mm_shuffle_epi8(merged, _mm_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+}
+
+/**
+ * SSSE3 implementation of guac_base64_encode_kernel, encoding 12 bytes at a
+ * time.
+ */
+__attribute__((target("ssse3")))
+static size_t guac_base64_encode_ssse3(const unsigned char* src,
+        size_t length, char* dst) {
+
+    size_t encoded = 0;
+
+    /* Each 16-byte load uses only the first 12 bytes */
+    while (length - encoded >= 16) {
+
+        __m128i data = _mm_loadu_si128((const __m128i*) (src + encoded));
+        __m128i chars = guac_base64_ssse3_translate(
+                guac_base64_ssse3_split(data));
+
+        _mm_storeu_si128((__m128i*) dst, chars);
+
+        encoded += 12;
+        dst += 16;
+
+    }
+
+    return encoded;
+
+}
+
+/**
+ * SSSE3 implementation of guac_base64_decode_kernel, decoding 16 characters
+ * at a time.
+ */
+__attribute__((target("ssse3")))
+static size_t guac_base64_decode_ssse3(const char* src, size_t length,
+        unsigned char* dst) {
+
+    size_t decoded = 0;
+
+    /* Each 16-byte store contains only 12 bytes of data, the remainder being
+     * overwritten by the next store (or ignored) */
+    while (length - decoded >= 16) {
+
+        __m128i values;
+        __m128i chars = _mm_loadu_si128((const __m128i*) (src + decoded));
+
+        if (!guac_base64_ssse3_values(chars, &values))
+            break;
+
+        _mm_storeu_si128((__m128i*) dst, guac_base64_ssse3_pack(values));
+
+        decoded += 16;
+        dst += 12;
+
+    }
+
+    return decoded;
+
+}
+
+/**
+ * AVX2 implementation of guac_base64_encode_kernel, encoding 24 bytes at a
+ * time using the same approach as guac_base64_encode_ssse3() within each
+ * 128-bit lane.
+ */
+__attribute__((target("avx2")))
+static size_t guac_base64_encode_avx2(const unsigned char* src,
+        size_t length, char* dst) {
+
+    const __m256i arrange = _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+
+    const __m256i offsets = _mm256_setr_epi8('a' - 26,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '+' - 62, '/' - 63, 'A', 0, 0,
+            'a' - 26,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t encoded = 0;
+
+    /* Each lane loads 16 bytes and uses only the first 12, with the second
+     * lane starting 12 bytes after the first */
+    while (length - encoded >= 28) {
+
+        const unsigned char* current = src + encoded;
+        __m256i data = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                    _mm_loadu_si128((const __m128i*) current)),
+                _mm_loadu_si128((const __m128i*) (current + 12)), 1);
+
+        /* Split into 6-bit values */
+        data = _mm256_shuffle_epi8(data, arrange);
+        __m256i values = _mm256_or_si256(
+                _mm256_mulhi_epu16(
+                    _mm256_and_si256(data, _mm256_set1_epi32(0x0FC0FC00)),
+                    _mm256_set1_epi32(0x04000040)),
+                _mm256_mullo_epi16(
+                    _mm256_and_si256(data, _mm256_set1_epi32(0x003F03F0)),
+                    _mm256_set1_epi32(0x01000010)));
+
+        /* Translate into characters */
+        __m256i range = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+        range = _mm256_or_si256(range,
+                _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+        __m256i chars = _mm256_add_epi8(values,
+                _mm256_shuffle_epi8(offsets, range));
+
+        _mm256_storeu_si256((__m256i*) dst, chars);
+
+        encoded += 24;
+        dst += 32;
+
+    }
+
+    return encoded;
+
+}
+
+/**
+ * AVX2 implementation of guac_base64_decode_kernel, decoding 32 characters
+ * at a time using the same approach as guac_base64_decode_ssse3() within
+ * each 128-bit lane.
+ */
+__attribute__((target("avx2")))
+static size_t guac_base64_decode_avx2(const char* src, size_t length,
+        unsigned char* dst) {
+
+    const __m256i lower_class = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+
+    const __m256i upper_class = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+
+    const __m256i offsets = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    const __m256i arrange = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t decoded = 0;
+
+    /* Each 32-byte store contains only 24 bytes of data, the remainder being
+     * overwritten by the next store (or ignored) */
+    while (length - decoded >= 32) {
+
+        __m256i chars = _mm256_loadu_si256((const __m256i*) (src + decoded));
+
+        /* Verify all characters are within the base64 alphabet */
+        __m256i upper = _mm256_and_si256(_mm256_srli_epi32(chars, 4),
+                _mm256_set1_epi8(0x0F));
+        __m256i lower = _mm256_and_si256(chars, _mm256_set1_epi8(0x0F));
+
+        __m256i invalid = _mm256_and_si256(
+                _mm256_shuffle_epi8(lower_class, lower),
+                _mm256_shuffle_epi8(upper_class, upper));
+
+        if (!_mm256_testz_si256(invalid, invalid))
+            break;
+
+        /* Translate characters into 6-bit values */
+        __m256i slash = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('/'));
+        __m256i values = _mm256_add_epi8(chars,
+                _mm256_shuffle_epi8(offsets, _mm256_add_epi8(slash, upper)));
+
+        /* Pack values, moving the 12 bytes of each lane together */
+        __m256i merged = _mm256_madd_epi16(
+                _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+                _mm256_set1_epi32(0x00011000));
+
+        merged = _mm256_shuffle_epi8(merged, arrange);
+        merged = _mm256_permutevar8x32_epi32(merged,
+                _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        _mm256_storeu_si256((__m256i*) dst, merged);
+
+        decoded += 32;
+        dst += 24;
+
+    }
+
+    return decoded;
+
+}
+
+#endif
+
+/**
+ * Initializes the character value lookup table and selects the fastest
+ * encoding and decoding kernels supported by the current CPU. This function
+ * must be invoked exactly once, via guac_base64_init_once.
+ */
+static void guac_base64_init() {
+
+    for (int i = 0; i < 64; i++)
+        guac_base64_values[(unsigned char) guac_base64_characters[i]] = i;
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        guac_base64_encode_fast = guac_base64_encode_avx2;
+        guac_base64_decode_fast = guac_base64_decode_avx2;
+    }
+
+    else if (__builtin_cpu_supports("ssse3")) {
+        guac_base64_encode_fast = guac_base64_encode_ssse3;
+        guac_base64_decode_fast = guac_base64_decode_ssse3;
+    }
+#endif
+
+}
+
+size_t guac_base64_encode_scalar(const unsigned char* src, size_t length,
+        char* dst) {
+
+    char* output = dst;
+
+    /* Encode bytes in groups of three */
+    while (length >= 3) {
+
+        uint32_t value = (src[0] << 16) | (src[1] << 8) | src[2];
+
+        output[0] = guac_base64_characters[ value >> 18        ];
+        output[1] = guac_base64_characters[(value >> 12) & 0x3F];
+        output[2] = guac_base64_characters[(value >>  6) & 0x3F];
+        output[3] = guac_base64_characters[ value        & 0x3F];
+
+        src += 3;
+        length -= 3;
+        output += 4;
+
+    }
+
+    /* Encode final two bytes with one character of padding */
+    if (length == 2) {
+        uint32_t value = (src[0] << 16) | (src[1] << 8);
+        output[0] = guac_base64_characters[ value >> 18        ];
+        output[1] = guac_base64_characters[(value >> 12) & 0x3F];
+        output[2] = guac_base64_characters[(value >>  6) & 0x3F];
+        output[3] = '=';
+        output += 4;
+    }
+
+    /* Encode final byte with two characters of padding */
+    else if (length == 1) {
+        uint32_t value = src[0] << 16;
+        output[0] = guac_base64_characters[ value >> 18        ];
+        output[1] = guac_base64_characters[(value >> 12) & 0x3F];
+        output[2] = '=';
+        output[3] = '=';
+        output += 4;
+    }
+
+    return output - dst;
+
+}
+
+/**
+ * Decodes the given null-terminated base64 string, storing the result at the
+ * given location, which may overlap with the string provided that it does not
+ * begin after the start of the string.
+ *
+ * @param input
+ *     The base64 string to decode.
+ *
+ * @param output
+ *     The location that the decoded data should be written to.
+ *
+ * @return
+ *     The number of bytes of decoded data.
+ */
+static int guac_base64_decode_to(const char* input, unsigned char* output) {
+
+    int length = 0;
+    int bits_read = 0;
+    unsigned int value = 0;
+    unsigned char current;
+
+    /* For all characters in string */
+    while ((current = *(input++)) != 0) {
+
+        /* If we've reached padding, then we're done */
+        if (current == '=')
+            break;
+
+        /* Otherwise, shift on the latest 6 bits */
+        value = (value << 6) | guac_base64_values[current];
+        bits_read += 6;
+
+        /* If we have at least one byte, write out the latest whole byte */
+        if (bits_read >= 8) {
+            *(output++) = (value >> (bits_read % 8)) & 0xFF;
+            bits_read -= 8;
+            length++;
+        }
+
+    }
+
+    /* Return number of bytes written */
+    return length;
+
+}
+
+int guac_base64_decode_scalar(char* base64) {
+    pthread_once(&guac_base64_init_once, guac_base64_init);
+    return guac_base64_decode_to(base64, (unsigned char*) base64);
+}
+
+size_t guac_base64_encode(const unsigned char* src, size_t length,
+        char* dst) {
+
+    size_t encoded = 0;
+    size_t written = 0;
+
+    pthread_once(&guac_base64_init_once, guac_base64_init);
+
+    /* Encode as much as possible using the fastest kernel, if any */
+    if (guac_base64_encode_fast != NULL) {
+        encoded = guac_base64_encode_fast(src, length, dst);
+        written = encoded / 3 * 4;
+    }
+
+    /* Encode remaining data, including padding */
+    return written + guac_base64_encode_scalar(src + encoded,
+            length - encoded, dst + written);
+
+}
+
+int guac_base64_decode(char* base64) {
+
+    size_t decoded = 0;
+    size_t written = 0;
+
+    pthread_once(&guac_base64_init_once, guac_base64_init);
+
+    /* Decode as much as possible using the fastest kernel, if any */
+    if (guac_base64_decode_fast != NULL) {
+        decoded = guac_base64_decode_fast(base64, strlen(base64),
+                (unsigned char*) base64);
+        written = decoded / 4 * 3;
+    }
+
+    /* Decode remaining data */
+    return written + guac_base64_decode_to(base64 + decoded,
+            (unsigned char*) base64 + written);
+
+}
+
@@ -0,0 +1,118 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_BASE64_H
+#define GUAC_BASE64_H
+
+/**
+ * Base64 encoding and decoding routines used for all blob data sent or
+ * received over the Guacamole protocol. Where supported by the CPU, SSSE3 or
+ * AVX2 implementations are selected automatically at runtime, with portable
+ * scalar implementations used otherwise.
+ *
+ * @file base64.h
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+
+/**
+ * Returns the number of characters required to represent the given number of
+ * bytes in base64, including any padding.
+ *
+ * @param length
+ *     The number of bytes to be encoded.
+ *
+ * @return
+ *     The number of base64 characters required to encode the given number of
+ *     bytes.
+ */
+#define GUAC_BASE64_ENCODED_LENGTH(length) (((length) + 2) / 3 * 4)
+
+/**
+ * Encodes the given data as base64, including any necessary padding. The
+ * output is not null-terminated.
+ *
+ * @param src
+ *     The data to encode.
+ *
+ * @param length
+ *     The number of bytes of data to encode.
+ *
+ * @param dst
+ *     The buffer which should receive the base64 characters. This buffer
+ *     must be at least GUAC_BASE64_ENCODED_LENGTH(length) bytes in size.
+ *
+ * @return
+ *     The number of characters written to the output buffer.
+ */
+size_t guac_base64_encode(const unsigned char* src, size_t length, char* dst);
+
+/**
+ * Decodes the given null-terminated base64 string in-place, stopping at the
+ * first padding character or the end of the string. Characters which are not
+ * part of the base64 alphabet are treated as having the value zero.
+ *
+ * @param base64
+ *     The base64 string to decode. The decoded data will overwrite the
+ *     beginning of this string.
+ *
+ * @return
+ *     The number of bytes of decoded data.
+ */
+int guac_base64_decode(char* base64);
+
+/**
+ * Portable implementation of guac_base64_encode() which does not use any
+ * CPU-specific instructions. This function is normally invoked only via
+ * guac_base64_encode(), but is exposed for the sake of testing.
+ *
+ * @param src
+ *     The data to encode.
+ *
+ * @param length
+ *     The number of bytes of data to encode.
+ *
+ * @param dst
+ *     The buffer which should receive the base64 characters. This buffer
+ *     must be at least GUAC_BASE64_ENCODED_LENGTH(length) bytes in size.
+ *
+ * @return
+ *     The number of characters written to the output buffer.
+ */
+size_t guac_base64_encode_scalar(const unsigned char* src, size_t length,
+        char* dst);
+
+/**
+ * Portable implementation of guac_base64_decode() which does not use any
+ * CPU-specific instructions. This function is normally invoked only via
+ * guac_base64_decode(), but is exposed for the sake of testing.
+ *
+ * @param base64
+ *     The base64 string to decode. The decoded data will overwrite the
+ *     beginning of this string.
+ *
+ * @return
+ *     The number of bytes of decoded data.
+ */
+int guac_base64_decode_scalar(char* base64);
+
+#endif
+
@@ -0,0 +1,106 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "base64.h"
+#include "harness.h"
+
+#include <guacamole/socket.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The size of the data encoded and decoded by each iteration of the base64
+ * benchmarks, in bytes. This is comparable to the size of a typical image
+ * update.
+ */
+#define BENCH_BASE64_LENGTH 65536
+
+/**
+ * Arbitrary data to be encoded, and its encoded form.
+ */
+static unsigned char bench_base64_data[BENCH_BASE64_LENGTH];
+static char bench_base64_encoded[GUAC_BASE64_ENCODED_LENGTH(
+        BENCH_BASE64_LENGTH) + 1];
+
+/**
+ * Scratch buffer for decoding in-place.
+ */
+static char bench_base64_scratch[sizeof(bench_base64_encoded)];
+
+static void bench_base64_encode(void* data) {
+    guac_base64_encode(bench_base64_data, BENCH_BASE64_LENGTH,
+            bench_base64_encoded);
+}
+
+static void bench_base64_encode_scalar(void* data) {
+    guac_base64_encode_scalar(bench_base64_data, BENCH_BASE64_LENGTH,
+            bench_base64_encoded);
+}
+
+static void bench_base64_decode(void* data) {
+    memcpy(bench_base64_scratch, bench_base64_encoded,
+            sizeof(bench_base64_encoded));
+    guac_base64_decode(bench_base64_scratch);
+}
+
+static void bench_base64_decode_scalar(void* data) {
+    memcpy(bench_base64_scratch, bench_base64_encoded,
+            sizeof(bench_base64_encoded));
+    guac_base64_decode_scalar(bench_base64_scratch);
+}
+
+static void bench_base64_socket_write(void* data) {
+    guac_socket* socket = (guac_socket*) data;
+    guac_socket_write_base64(socket, bench_base64_data, BENCH_BASE64_LENGTH);
+    guac_socket_flush_base64(socket);
+    guac_socket_flush(socket);
+}
+
+void bench_base64() {
+
+    for (int i = 0; i < BENCH_BASE64_LENGTH; i++)
+        bench_base64_data[i] = rand();
+
+    size_t length = guac_base64_encode(bench_base64_data, BENCH_BASE64_LENGTH,
+            bench_base64_encoded);
+    bench_base64_encoded[length] = '\0';
+
+    guac_bench_run("base64_encode", bench_base64_encode, NULL,
+            BENCH_BASE64_LENGTH);
+    guac_bench_run("base64_encode_scalar", bench_base64_encode_scalar, NULL,
+            BENCH_BASE64_LENGTH);
+    guac_bench_run("base64_decode", bench_base64_decode, NULL,
+            BENCH_BASE64_LENGTH);
+    guac_bench_run("base64_decode_scalar", bench_base64_decode_scalar, NULL,
+            BENCH_BASE64_LENGTH);
+
+    /* Measure complete socket path, discarding output */
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd != -1) {
+        guac_socket* socket = guac_socket_open(fd);
+        guac_bench_run("guac_socket_write_base64", bench_base64_socket_write,
+                socket, BENCH_BASE64_LENGTH);
+        guac_socket_free(socket);
+    }
+
+}
+
@@ -0,0 +1,139 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Whether at least one result has been written since guac_bench_begin() was
+ * invoked.
+ */
+static int guac_bench_results_written = 0;
+
+/**
+ * Returns the current value of a monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of a monotonic clock, in nanoseconds.
+ */
+static uint64_t guac_bench_now() {
+
+    struct timespec current;
+    clock_gettime(CLOCK_MONOTONIC, &current);
+
+    return (uint64_t) current.tv_sec * 1000000000 + current.tv_nsec;
+
+}
+
+/**
+ * Invokes the given function the given number of times, returning the total
+ * time taken in nanoseconds.
+ *
+ * @param function
+ *     The function to invoke.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given function.
+ *
+ * @param iterations
+ *     The number of times to invoke the given function.
+ *
+ * @return
+ *     The total time taken, in nanoseconds.
+ */
+static uint64_t guac_bench_sample(guac_bench_function* function, void* data,
+        uint64_t iterations) {
+
+    uint64_t start = guac_bench_now();
+
+    for (uint64_t i = 0; i < iterations; i++)
+        function(data);
+
+    return guac_bench_now() - start;
+
+}
+
+/**
+ * Comparator for qsort() which orders sample durations ascending.
+ */
+static int guac_bench_compare(const void* a, const void* b) {
+
+    uint64_t value_a = *((const uint64_t*) a);
+    uint64_t value_b = *((const uint64_t*) b);
+
+    return (value_a > value_b) - (value_a < value_b);
+
+}
+
+void guac_bench_begin() {
+    guac_bench_results_written = 0;
+    printf("[");
+}
+
+void guac_bench_run(const char* name, guac_bench_function* function,
+        void* data, size_t bytes) {
+
+    uint64_t samples[GUAC_BENCH_SAMPLES];
+
+    /* Warm up, determining the number of iterations required for each sample
+     * to take roughly GUAC_BENCH_SAMPLE_DURATION */
+    uint64_t iterations = 1;
+    uint64_t duration;
+    while ((duration = guac_bench_sample(function, data, iterations))
+            < GUAC_BENCH_SAMPLE_DURATION / 10)
+        iterations *= 10;
+
+    iterations = iterations * GUAC_BENCH_SAMPLE_DURATION / (duration + 1);
+    if (iterations == 0)
+        iterations = 1;
+
+    /* Take samples */
+    for (int i = 0; i < GUAC_BENCH_SAMPLES; i++)
+        samples[i] = guac_bench_sample(function, data, iterations);
+
+    qsort(samples, GUAC_BENCH_SAMPLES, sizeof(uint64_t), guac_bench_compare);
+
+    double median_ns = (double) samples[GUAC_BENCH_SAMPLES / 2] / iterations;
+    double min_ns = (double) samples[0] / iterations;
+
+    printf("%s\n    {\"name\": \"%s\", \"iterations\": %" PRIu64 ", "
+            "\"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f",
+            guac_bench_results_written ? "," : "",
+            name, iterations, median_ns, min_ns);
+
+    if (bytes != 0)
+        printf(", \"bytes_per_op\": %zu, \"mb_per_s\": %.1f",
+                bytes, bytes * 1000.0 / median_ns);
+
+    printf("}");
+    fflush(stdout);
+
+    guac_bench_results_written = 1;
+
+}
+
+void guac_bench_end() {
+    printf("\n]\n");
+}
+
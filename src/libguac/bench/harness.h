@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_BENCH_HARNESS_H
+#define GUAC_BENCH_HARNESS_H
+
+#include <stddef.h>
+
+/**
+ * The approximate duration of each timed sample, in nanoseconds. The number
+ * of iterations per sample is chosen automatically to approach this duration.
+ */
+#define GUAC_BENCH_SAMPLE_DURATION 100000000
+
+/**
+ * The number of timed samples to take of each benchmark. The median sample is
+ * reported, reducing the influence of scheduling noise.
+ */
+#define GUAC_BENCH_SAMPLES 5
+
+/**
+ * A single operation to be timed, invoked repeatedly by guac_bench_run().
+ *
+ * @param data
+ *     Arbitrary data provided to guac_bench_run().
+ */
+typedef void guac_bench_function(void* data);
+
+/**
+ * Begins output of benchmark results. This function must be invoked before
+ * any call to guac_bench_run().
+ */
+void guac_bench_begin();
+
+/**
+ * Times the given function, writing the results to STDOUT as a JSON object
+ * within the array started by guac_bench_begin(). Each result contains the
+ * name of the benchmark, the number of iterations per sample, the median and
+ * minimum time per iteration in nanoseconds, and, if a non-zero number of
+ * bytes is given, the throughput in megabytes per second.
+ *
+ * @param name
+ *     The unique name of the benchmark.
+ *
+ * @param function
+ *     The operation to time.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given function.
+ *
+ * @param bytes
+ *     The number of bytes processed by each invocation of the given
+ *     function, or zero if throughput is not meaningful.
+ */
+void guac_bench_run(const char* name, guac_bench_function* function,
+        void* data, size_t bytes);
+
+/**
+ * Ends output of benchmark results. No further calls to guac_bench_run() may
+ * be made after this function has been invoked.
+ */
+void guac_bench_end();
+
+#endif
+
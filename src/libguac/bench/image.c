@@ -0,0 +1,214 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "encode-jpeg.h"
+#include "encode-png.h"
+#include "harness.h"
+
+#ifdef ENABLE_WEBP
+#include "encode-webp.h"
+#endif
+
+#include <cairo/cairo.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * The width and height of each image encoded, in pixels. This is comparable
+ * to the size of a typical dirty region of a remote desktop.
+ */
+#define BENCH_IMAGE_SIZE 256
+
+/**
+ * The number of bytes of raw pixel data within each image encoded.
+ */
+#define BENCH_IMAGE_BYTES (BENCH_IMAGE_SIZE * BENCH_IMAGE_SIZE * 4)
+
+/**
+ * The JPEG and WebP quality used for lossy encoding, matching the quality
+ * used by the common surface when no processing lag is present.
+ */
+#define BENCH_IMAGE_QUALITY 90
+
+/**
+ * An image to be encoded, along with the socket and stream receiving the
+ * encoded data.
+ */
+typedef struct bench_image_data {
+
+    /**
+     * The image to encode.
+     */
+    cairo_surface_t* surface;
+
+    /**
+     * The socket receiving the encoded image (output is discarded).
+     */
+    guac_socket* socket;
+
+    /**
+     * The stream along which the encoded image is sent.
+     */
+    guac_stream stream;
+
+} bench_image_data;
+
+/**
+ * Fills the given surface with content resembling a typical application
+ * window: flat background and toolbar colors with small, high-contrast
+ * details resembling text. Images like this are encoded losslessly with a
+ * palette.
+ *
+ * @param surface
+ *     The surface to fill.
+ */
+static void bench_image_fill_flat(cairo_surface_t* surface) {
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    for (int y = 0; y < BENCH_IMAGE_SIZE; y++) {
+
+        uint32_t* row = (uint32_t*) (data + y * stride);
+
+        for (int x = 0; x < BENCH_IMAGE_SIZE; x++) {
+
+            uint32_t color = (y < 32) ? 0x3C3F41 : 0xFFFFFF;
+
+            /* Sparse "glyphs" on every other line of text */
+            if ((y / 8) % 2 && (x * 7 + y * 3) % 5 == 0)
+                color = 0x202020;
+
+            row[x] = color;
+
+        }
+
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+/**
+ * Fills the given surface with content resembling a photograph or video
+ * frame: smooth gradients with a small amount of noise. Images like this
+ * have far too many colors for a palette and are typically encoded lossily.
+ *
+ * @param surface
+ *     The surface to fill.
+ */
+static void bench_image_fill_photo(cairo_surface_t* surface) {
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    for (int y = 0; y < BENCH_IMAGE_SIZE; y++) {
+
+        uint32_t* row = (uint32_t*) (data + y * stride);
+
+        for (int x = 0; x < BENCH_IMAGE_SIZE; x++) {
+
+            int noise = rand() % 16;
+            uint32_t red   = (x + noise) & 0xFF;
+            uint32_t green = (y + noise) & 0xFF;
+            uint32_t blue  = ((x + y) / 2 + noise) & 0xFF;
+
+            row[x] = (red << 16) | (green << 8) | blue;
+
+        }
+
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+static void bench_image_png(void* data) {
+    bench_image_data* image = (bench_image_data*) data;
+    guac_png_write(image->socket, &image->stream, image->surface);
+}
+
+static void bench_image_jpeg(void* data) {
+    bench_image_data* image = (bench_image_data*) data;
+    guac_jpeg_write(image->socket, &image->stream, image->surface,
+            BENCH_IMAGE_QUALITY);
+}
+
+#ifdef ENABLE_WEBP
+static void bench_image_webp(void* data) {
+    bench_image_data* image = (bench_image_data*) data;
+    guac_webp_write(image->socket, &image->stream, image->surface,
+            BENCH_IMAGE_QUALITY, 0);
+}
+
+static void bench_image_webp_lossless(void* data) {
+    bench_image_data* image = (bench_image_data*) data;
+    guac_webp_write(image->socket, &image->stream, image->surface,
+            BENCH_IMAGE_QUALITY, 1);
+}
+#endif
+
+void bench_image() {
+
+    /* Measure complete encoding path, discarding output */
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd == -1)
+        return;
+
+    bench_image_data flat = {
+        .surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        .socket = guac_socket_open(fd),
+        .stream = { .index = 1 }
+    };
+
+    bench_image_data photo = flat;
+    photo.surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+
+    bench_image_fill_flat(flat.surface);
+    bench_image_fill_photo(photo.surface);
+
+    guac_bench_run("png_encode_flat", bench_image_png, &flat,
+            BENCH_IMAGE_BYTES);
+    guac_bench_run("png_encode_photo", bench_image_png, &photo,
+            BENCH_IMAGE_BYTES);
+    guac_bench_run("jpeg_encode_photo", bench_image_jpeg, &photo,
+            BENCH_IMAGE_BYTES);
+
+#ifdef ENABLE_WEBP
+    guac_bench_run("webp_encode_photo", bench_image_webp, &photo,
+            BENCH_IMAGE_BYTES);
+    guac_bench_run("webp_encode_flat_lossless", bench_image_webp_lossless,
+            &flat, BENCH_IMAGE_BYTES);
+#endif
+
+    cairo_surface_destroy(flat.surface);
+    cairo_surface_destroy(photo.surface);
+    guac_socket_free(flat.socket);
+
+}
+
@@ -0,0 +1,71 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+
+#include <stdlib.h>
+
+/**
+ * Runs all base64 encoding and decoding benchmarks.
+ */
+void bench_base64();
+
+/**
+ * Runs all image encoding benchmarks.
+ */
+void bench_image();
+
+/**
+ * Runs all palette construction benchmarks.
+ */
+void bench_palette();
+
+/**
+ * Runs all instruction parsing benchmarks.
+ */
+void bench_parser();
+
+/**
+ * Runs all instruction formatting benchmarks.
+ */
+void bench_protocol();
+
+/**
+ * Runs all guac_socket write benchmarks.
+ */
+void bench_socket();
+
+int main() {
+
+    /* Use identical data for every run */
+    srand(0);
+
+    guac_bench_begin();
+    bench_base64();
+    bench_image();
+    bench_palette();
+    bench_parser();
+    bench_protocol();
+    bench_socket();
+    guac_bench_end();
+
+    return 0;
+
+}
+
@@ -0,0 +1,97 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+#include "palette.h"
+
+#include <cairo/cairo.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The width and height of each image for which a palette is built, in
+ * pixels.
+ */
+#define BENCH_PALETTE_SIZE 256
+
+/**
+ * The number of distinct colors present within the image having few enough
+ * colors for a palette.
+ */
+#define BENCH_PALETTE_COLORS 64
+
+static void bench_palette_alloc(void* data) {
+
+    cairo_surface_t* surface = (cairo_surface_t*) data;
+
+    guac_palette* palette = guac_palette_alloc(surface);
+    if (palette != NULL)
+        guac_palette_free(palette);
+
+}
+
+/**
+ * Fills the given surface with pixels of random colors, limiting the number
+ * of distinct colors to the given number.
+ *
+ * @param surface
+ *     The surface to fill.
+ *
+ * @param colors
+ *     The maximum number of distinct colors to use.
+ */
+static void bench_palette_fill(cairo_surface_t* surface, int colors) {
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    for (int y = 0; y < BENCH_PALETTE_SIZE; y++) {
+
+        uint32_t* row = (uint32_t*) (data + y * stride);
+
+        for (int x = 0; x < BENCH_PALETTE_SIZE; x++)
+            row[x] = (rand() % colors) * 0x010305;
+
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+void bench_palette() {
+
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            BENCH_PALETTE_SIZE, BENCH_PALETTE_SIZE);
+
+    size_t bytes = BENCH_PALETTE_SIZE * BENCH_PALETTE_SIZE * 4;
+
+    /* Palette successfully built from all pixels */
+    bench_palette_fill(surface, BENCH_PALETTE_COLORS);
+    guac_bench_run("palette_alloc", bench_palette_alloc, surface, bytes);
+
+    /* Palette abandoned once too many colors are encountered */
+    bench_palette_fill(surface, 1 << 20);
+    guac_bench_run("palette_alloc_overflow", bench_palette_alloc, surface,
+            bytes);
+
+    cairo_surface_destroy(surface);
+
+}
+
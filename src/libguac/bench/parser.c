@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+
+#include <guacamole/parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The approximate size of the instruction data parsed by each iteration of
+ * the parser benchmarks, in bytes.
+ */
+#define BENCH_PARSER_LENGTH 65536
+
+/**
+ * Instruction data to be parsed, and a scratch buffer receiving a copy of
+ * that data for each iteration (guac_parser_append() modifies the data it
+ * parses).
+ */
+typedef struct bench_parser_data {
+
+    /**
+     * The parser to use for each iteration.
+     */
+    guac_parser* parser;
+
+    /**
+     * The instruction data to parse.
+     */
+    char instructions[BENCH_PARSER_LENGTH + GUAC_INSTRUCTION_MAX_LENGTH];
+
+    /**
+     * The number of bytes of instruction data.
+     */
+    int length;
+
+    /**
+     * Scratch buffer into which the instruction data is copied prior to
+     * being parsed.
+     */
+    char scratch[BENCH_PARSER_LENGTH + GUAC_INSTRUCTION_MAX_LENGTH];
+
+} bench_parser_data;
+
+static void bench_parser_append(void* data) {
+
+    bench_parser_data* bench = (bench_parser_data*) data;
+
+    memcpy(bench->scratch, bench->instructions, bench->length);
+
+    char* current = bench->scratch;
+    int remaining = bench->length;
+
+    /* Parse all instructions, restarting the parser after each */
+    while (remaining > 0) {
+
+        int parsed = guac_parser_append(bench->parser, current, remaining);
+        current += parsed;
+        remaining -= parsed;
+
+        if (bench->parser->state == GUAC_PARSE_COMPLETE) {
+            guac_parser_free(bench->parser);
+            bench->parser = guac_parser_alloc();
+        }
+
+        else if (parsed == 0)
+            abort();
+
+    }
+
+}
+
+void bench_parser() {
+
+    bench_parser_data* bench = malloc(sizeof(bench_parser_data));
+    bench->parser = guac_parser_alloc();
+
+    /* Blob instructions such as those received during file uploads */
+    char blob[6048];
+    for (int i = 0; i < sizeof(blob) - 1; i++)
+        blob[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                  "0123456789+/"[rand() % 64];
+    blob[sizeof(blob) - 1] = '\0';
+
+    bench->length = 0;
+    while (bench->length < BENCH_PARSER_LENGTH)
+        bench->length += sprintf(bench->instructions + bench->length,
+                "4.blob,1.1,%zu.%s;", strlen(blob), blob);
+
+    guac_bench_run("parser_append_blob", bench_parser_append, bench,
+            bench->length);
+
+    /* Small instructions such as those received from user input */
+    bench->length = 0;
+    while (bench->length < BENCH_PARSER_LENGTH)
+        bench->length += sprintf(bench->instructions + bench->length,
+                "5.mouse,3.%i,3.%i,1.1,13.%lli;",
+                100 + rand() % 900, 100 + rand() % 900,
+                1700000000000LL + rand() % 1000);
+
+    guac_bench_run("parser_append_mouse", bench_parser_append, bench,
+            bench->length);
+
+    guac_parser_free(bench->parser);
+    free(bench);
+
+}
+
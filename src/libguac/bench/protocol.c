@@ -0,0 +1,107 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * The number of instructions sent by each iteration of the protocol
+ * benchmarks, prior to flushing the socket.
+ */
+#define BENCH_PROTOCOL_INSTRUCTIONS 64
+
+static void bench_protocol_send_copy(void* data) {
+
+    guac_socket* socket = (guac_socket*) data;
+
+    for (int i = 0; i < BENCH_PROTOCOL_INSTRUCTIONS; i++)
+        guac_protocol_send_copy(socket, GUAC_DEFAULT_LAYER, i * 64, 128,
+                64, 64, GUAC_COMP_OVER, GUAC_DEFAULT_LAYER, 1024, i * 64);
+
+    guac_socket_flush(socket);
+
+}
+
+static void bench_protocol_send_rect_cfill(void* data) {
+
+    guac_socket* socket = (guac_socket*) data;
+
+    for (int i = 0; i < BENCH_PROTOCOL_INSTRUCTIONS; i++) {
+        guac_protocol_send_rect(socket, GUAC_DEFAULT_LAYER, i * 16, 512,
+                16, 16);
+        guac_protocol_send_cfill(socket, GUAC_COMP_OVER, GUAC_DEFAULT_LAYER,
+                0x20, 0x40, i, 0xFF);
+    }
+
+    guac_socket_flush(socket);
+
+}
+
+static void bench_protocol_send_mouse(void* data) {
+
+    guac_socket* socket = (guac_socket*) data;
+
+    for (int i = 0; i < BENCH_PROTOCOL_INSTRUCTIONS; i++)
+        guac_protocol_send_mouse(socket, i * 8, 600, 1,
+                1700000000000LL + i);
+
+    guac_socket_flush(socket);
+
+}
+
+static void bench_protocol_send_sync(void* data) {
+
+    guac_socket* socket = (guac_socket*) data;
+
+    for (int i = 0; i < BENCH_PROTOCOL_INSTRUCTIONS; i++)
+        guac_protocol_send_sync(socket, 1700000000000LL + i, 1);
+
+    guac_socket_flush(socket);
+
+}
+
+void bench_protocol() {
+
+    /* Measure instruction formatting and socket path, discarding output */
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd == -1)
+        return;
+
+    guac_socket* socket = guac_socket_open(fd);
+
+    guac_bench_run("protocol_send_copy", bench_protocol_send_copy,
+            socket, 0);
+    guac_bench_run("protocol_send_rect_cfill", bench_protocol_send_rect_cfill,
+            socket, 0);
+    guac_bench_run("protocol_send_mouse", bench_protocol_send_mouse,
+            socket, 0);
+    guac_bench_run("protocol_send_sync", bench_protocol_send_sync,
+            socket, 0);
+
+    guac_socket_free(socket);
+
+}
+
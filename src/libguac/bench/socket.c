@@ -0,0 +1,82 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+
+#include <guacamole/socket.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * The number of bytes written by each iteration of the socket benchmarks.
+ */
+#define BENCH_SOCKET_LENGTH 65536
+
+/**
+ * The size of each write performed by the small write benchmark, in bytes.
+ * This is comparable to the size of a typical small instruction.
+ */
+#define BENCH_SOCKET_SMALL_WRITE 32
+
+/**
+ * Arbitrary data to be written.
+ */
+static char bench_socket_data[BENCH_SOCKET_LENGTH];
+
+static void bench_socket_write_large(void* data) {
+    guac_socket* socket = (guac_socket*) data;
+    guac_socket_write(socket, bench_socket_data, BENCH_SOCKET_LENGTH);
+    guac_socket_flush(socket);
+}
+
+static void bench_socket_write_small(void* data) {
+
+    guac_socket* socket = (guac_socket*) data;
+
+    for (int i = 0; i < BENCH_SOCKET_LENGTH; i += BENCH_SOCKET_SMALL_WRITE)
+        guac_socket_write(socket, bench_socket_data + i,
+                BENCH_SOCKET_SMALL_WRITE);
+
+    guac_socket_flush(socket);
+
+}
+
+void bench_socket() {
+
+    for (int i = 0; i < BENCH_SOCKET_LENGTH; i++)
+        bench_socket_data[i] = rand();
+
+    /* Measure socket write path, discarding output */
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd == -1)
+        return;
+
+    guac_socket* socket = guac_socket_open(fd);
+
+    guac_bench_run("socket_write_large", bench_socket_write_large, socket,
+            BENCH_SOCKET_LENGTH);
+    guac_bench_run("socket_write_small", bench_socket_write_small, socket,
+            BENCH_SOCKET_LENGTH);
+
+    guac_socket_free(socket);
+
+}
+
@@ -25,6 +25,7 @@
 #include "guacamole/client.h"
 #include "guacamole/error.h"
 #include "guacamole/layer.h"
+#include "guacamole/metrics.h"
 #include "guacamole/plugin.h"
 #include "guacamole/pool.h"
 #include "guacamole/protocol.h"
@@ -39,6 +40,7 @@
 #include <inttypes.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -429,6 +431,10 @@ int guac_client_end_multiple_frames(guac_client* client, int frames) {
     /* Update and send timestamp */
     client->last_sent_timestamp = guac_timestamp_current();
 
+    /* Count frame, including any logical frames combined into it */
+    if (client->metrics != NULL)
+        guac_metrics_record_frame(client->metrics, frames);
+
     /* Log received timestamp and calculated lag (at TRACE level only) */
     guac_client_log(client, GUAC_LOG_TRACE, "Server completed "
             "frame %" PRIu64 "ms (%i logical frames)", client->last_sent_timestamp, frames);
@@ -437,6 +443,15 @@ int guac_client_end_multiple_frames(guac_client* client, int frames) {
 
 }
 
+void guac_client_set_metrics(guac_client* client, guac_metrics* metrics) {
+
+    client->metrics = metrics;
+
+    /* Count all instructions broadcast to users */
+    client->socket->metrics = metrics;
+
+}
+
 int guac_client_load_plugin(guac_client* client, const char* protocol) {
 
     /* Reference to dlopen()'d plugin */
@@ -596,8 +611,15 @@ void guac_client_stream_png(guac_client* client, guac_socket* socket,
     /* Declare stream as containing image data */
     guac_protocol_send_img(socket, stream, mode, layer, "image/png", x, y);
 
-    /* Write PNG data */
-    guac_png_write(socket, stream, surface);
+    /* Write PNG data, timing encoding and sending if recording metrics */
+    if (client->metrics != NULL) {
+        uint64_t start_time = guac_metrics_current_time();
+        guac_png_write(socket, stream, surface);
+        guac_metrics_record_image(client->metrics, GUAC_METRICS_PNG,
+                start_time);
+    }
+    else
+        guac_png_write(socket, stream, surface);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -617,8 +639,15 @@ void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
     /* Declare stream as containing image data */
     guac_protocol_send_img(socket, stream, mode, layer, "image/jpeg", x, y);
 
-    /* Write JPEG data */
-    guac_jpeg_write(socket, stream, surface, quality);
+    /* Write JPEG data, timing encoding and sending if recording metrics */
+    if (client->metrics != NULL) {
+        uint64_t start_time = guac_metrics_current_time();
+        guac_jpeg_write(socket, stream, surface, quality);
+        guac_metrics_record_image(client->metrics, GUAC_METRICS_JPEG,
+                start_time);
+    }
+    else
+        guac_jpeg_write(socket, stream, surface, quality);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -639,8 +668,15 @@ void guac_client_stream_webp(guac_client* client, guac_socket* socket,
     /* Declare stream as containing image data */
     guac_protocol_send_img(socket, stream, mode, layer, "image/webp", x, y);
 
-    /* Write WebP data */
-    guac_webp_write(socket, stream, surface, quality, lossless);
+    /* Write WebP data, timing encoding and sending if recording metrics */
+    if (client->metrics != NULL) {
+        uint64_t start_time = guac_metrics_current_time();
+        guac_webp_write(socket, stream, surface, quality, lossless);
+        guac_metrics_record_image(client->metrics, GUAC_METRICS_WEBP,
+                start_time);
+    }
+    else
+        guac_webp_write(socket, stream, surface, quality, lossless);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -265,6 +265,199 @@ static void guac_png_flush_handler(png_structp png) {
 
 }
 
+/**
+ * Returns whether the current platform is little-endian, and thus whether the
+ * bytes of each 32-bit Cairo pixel are stored in blue, green, red, alpha
+ * order.
+ *
+ * @return
+ *     Non-zero if the current platform is little-endian, zero otherwise.
+ */
+static int guac_png_is_little_endian() {
+    uint32_t value = 1;
+    return *((unsigned char*) &value) == 1;
+}
+
+/**
+ * Converts a row of premultiplied ARGB32 pixels into the non-premultiplied
+ * RGBA byte order required by PNG.
+ *
+ * @param dst
+ *     The buffer to store the converted row within. This buffer must be at
+ *     least 4 * width bytes in size.
+ *
+ * @param src
+ *     The row of ARGB32 pixels to convert.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ */
+static void guac_png_unpremultiply_row(png_byte* dst, const uint32_t* src,
+        int width) {
+
+    for (int x = 0; x < width; x++) {
+
+        uint32_t color = *(src++);
+        unsigned int alpha = color >> 24;
+        unsigned int red   = (color >> 16) & 0xFF;
+        unsigned int green = (color >> 8)  & 0xFF;
+        unsigned int blue  =  color        & 0xFF;
+
+        /* Undo alpha premultiplication, rounding to nearest */
+        if (alpha != 0 && alpha != 0xFF) {
+            red   = (red   * 0xFF + alpha / 2) / alpha;
+            green = (green * 0xFF + alpha / 2) / alpha;
+            blue  = (blue  * 0xFF + alpha / 2) / alpha;
+        }
+
+        *(dst++) = red;
+        *(dst++) = green;
+        *(dst++) = blue;
+        *(dst++) = alpha;
+
+    }
+
+}
+
+/**
+ * Implementation of guac_png_write() which writes RGB24 or ARGB32 surfaces as
+ * truecolor PNG images using libpng directly. Rows are filtered and
+ * compressed using the heuristics, compression level, and strategy defined by
+ * GUAC_PNG_FILTERS, GUAC_PNG_COMPRESSION_LEVEL, and
+ * GUAC_PNG_COMPRESSION_STRATEGY, with the resulting data streamed as blobs
+ * while encoding is in progress.
+ *
+ * @param socket
+ *     The socket to send PNG blobs over.
+ *
+ * @param stream
+ *     The stream to associate with each blob.
+ *
+ * @param surface
+ *     The Cairo surface to write to the given stream and socket as PNG blobs.
+ *     The format of this surface must be CAIRO_FORMAT_RGB24 or
+ *     CAIRO_FORMAT_ARGB32.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+static int guac_png_truecolor_write(guac_socket* socket, guac_stream* stream,
+        cairo_surface_t* surface) {
+
+    png_structp png;
+    png_infop png_info;
+
+    /* Row buffer is needed only for conversion of ARGB32 data */
+    png_byte* volatile row = NULL;
+
+    guac_png_write_state write_state;
+
+    /* Get image surface properties and data */
+    cairo_format_t format = cairo_image_surface_get_format(surface);
+    int width = cairo_image_surface_get_width(surface);
+    int height = cairo_image_surface_get_height(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+
+    int alpha = (format == CAIRO_FORMAT_ARGB32);
+
+    /* Set up PNG writer */
+    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!png) {
+        guac_error = GUAC_STATUS_INTERNAL_ERROR;
+        guac_error_message = "libpng failed to create write structure";
+        return -1;
+    }
+
+    png_info = png_create_info_struct(png);
+    if (!png_info) {
+        png_destroy_write_struct(&png, NULL);
+        guac_error = GUAC_STATUS_INTERNAL_ERROR;
+        guac_error_message = "libpng failed to create info structure";
+        return -1;
+    }
+
+    /* Set error handler */
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &png_info);
+        free(row);
+        guac_error = GUAC_STATUS_IO_ERROR;
+        guac_error_message = "libpng output error";
+        return -1;
+    }
+
+    /* Init write state */
+    write_state.socket = socket;
+    write_state.stream = stream;
+    write_state.buffer_size = 0;
+
+    /* Set up writer */
+    png_set_write_fn(png, &write_state,
+            guac_png_write_handler,
+            guac_png_flush_handler);
+
+    /* Configure filtering and compression */
+    png_set_filter(png, PNG_FILTER_TYPE_BASE, GUAC_PNG_FILTERS);
+    png_set_compression_level(png, GUAC_PNG_COMPRESSION_LEVEL);
+    png_set_compression_strategy(png, GUAC_PNG_COMPRESSION_STRATEGY);
+
+    /* Write image info */
+    png_set_IHDR(
+        png,
+        png_info,
+        width,
+        height,
+        8,
+        alpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+        PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_DEFAULT,
+        PNG_FILTER_TYPE_DEFAULT
+    );
+
+    png_write_info(png, png_info);
+
+    /* ARGB32 data must be unpremultiplied into a separate buffer */
+    if (alpha) {
+
+        row = malloc(width * 4);
+
+        for (int y = 0; y < height; y++) {
+            guac_png_unpremultiply_row(row, (uint32_t*) data, width);
+            png_write_row(png, row);
+            data += stride;
+        }
+
+    }
+
+    /* RGB24 data can be passed to libpng as-is, with libpng ignoring the
+     * unused byte of each pixel and correcting the byte order */
+    else {
+
+        if (guac_png_is_little_endian()) {
+            png_set_bgr(png);
+            png_set_filler(png, 0, PNG_FILLER_AFTER);
+        }
+        else
+            png_set_filler(png, 0, PNG_FILLER_BEFORE);
+
+        for (int y = 0; y < height; y++) {
+            png_write_row(png, data);
+            data += stride;
+        }
+
+    }
+
+    /* Finish write */
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &png_info);
+    free(row);
+
+    /* Ensure all data is written */
+    guac_png_flush_data(&write_state);
+    return 0;
+
+}
+
 int guac_png_write(guac_socket* socket, guac_stream* stream,
         cairo_surface_t* surface) {
 
@@ -284,19 +477,24 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     int stride = cairo_image_surface_get_stride(surface);
     unsigned char* data = cairo_image_surface_get_data(surface);
 
-    /* If not RGB24, use Cairo PNG writer */
-    if (format != CAIRO_FORMAT_RGB24 || data == NULL)
+    /* If neither RGB24 nor ARGB32, use Cairo PNG writer */
+    if ((format != CAIRO_FORMAT_RGB24 && format != CAIRO_FORMAT_ARGB32)
+            || data == NULL)
         return guac_png_cairo_write(socket, stream, surface);
 
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
+    /* Palettes are used only for opaque images */
+    if (format != CAIRO_FORMAT_RGB24)
+        return guac_png_truecolor_write(socket, stream, surface);
+
     /* Attempt to build palette */
     guac_palette* palette = guac_palette_alloc(surface);
 
-    /* If not possible, resort to Cairo PNG writer */
+    /* If not possible, write as truecolor */
     if (palette == NULL)
-        return guac_png_cairo_write(socket, stream, surface);
+        return guac_png_truecolor_write(socket, stream, surface);
 
     /* Calculate BPP from palette size */
     if      (palette->size <= 2)  bpp = 1;
@@ -26,6 +26,30 @@
 #include "guacamole/stream.h"
 
 #include <cairo/cairo.h>
+#include <png.h>
+#include <zlib.h>
+
+/**
+ * The zlib compression level to use when encoding truecolor PNG images, from
+ * 1 (fastest) to 9 (smallest). Screen content compresses well even at low
+ * levels, while higher levels cost considerably more CPU time for little
+ * further gain.
+ */
+#define GUAC_PNG_COMPRESSION_LEVEL 3
+
+/**
+ * The zlib compression strategy to use when encoding truecolor PNG images.
+ * Z_FILTERED is tuned for data produced by PNG row filters.
+ */
+#define GUAC_PNG_COMPRESSION_STRATEGY Z_FILTERED
+
+/**
+ * The PNG row filters that may be chosen between when encoding truecolor PNG
+ * images. libpng will select the filter producing the smallest output for
+ * each row from among these.
+ */
+#define GUAC_PNG_FILTERS (PNG_FILTER_NONE | PNG_FILTER_SUB | PNG_FILTER_UP \
+        | PNG_FILTER_PAETH)
 
 /**
  * Encodes the given surface as a PNG, and sends the resulting data over the
@@ -30,6 +30,7 @@
 #include "client-types.h"
 #include "client-constants.h"
 #include "layer-types.h"
+#include "metrics-types.h"
 #include "object-types.h"
 #include "pool-types.h"
 #include "socket-types.h"
@@ -257,6 +258,13 @@ struct guac_client {
      */
     void* __plugin_handle;
 
+    /**
+     * Storage for performance metrics describing this client and its users,
+     * or NULL if no metrics are being recorded. This is NULL by default and
+     * may be assigned with guac_client_set_metrics().
+     */
+    guac_metrics* metrics;
+
 };
 
 /**
@@ -578,6 +586,22 @@ int guac_client_load_plugin(guac_client* client, const char* protocol);
  */
 int guac_client_get_processing_lag(guac_client* client);
 
+/**
+ * Begins recording performance metrics for the given client within the given
+ * storage, which must remain valid until the client is freed. The storage
+ * provided may be shared with other processes, such as to allow metrics to be
+ * exposed by the process which created the client. The storage should first
+ * be initialized with guac_metrics_init().
+ *
+ * @param client
+ *     The guac_client to record metrics for.
+ *
+ * @param metrics
+ *     The storage that should receive all metrics recorded for the given
+ *     client and its users.
+ */
+void guac_client_set_metrics(guac_client* client, guac_metrics* metrics);
+
 /**
  * Sends a request to the owner of the given guac_client for parameters required
  * to continue the connection started by the client. The function returns zero
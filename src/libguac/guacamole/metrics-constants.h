@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_METRICS_CONSTANTS_H
+#define GUAC_METRICS_CONSTANTS_H
+
+/**
+ * Constants related to the performance metrics which may be recorded for a
+ * connection.
+ *
+ * @file metrics-constants.h
+ */
+
+/**
+ * The maximum number of distinct opcodes for which instruction counts will be
+ * recorded. Instructions having opcodes beyond this limit are not counted.
+ */
+#define GUAC_METRICS_MAX_OPCODES 64
+
+/**
+ * The maximum number of bytes of any recorded opcode, including null
+ * terminator. Longer opcodes are not counted.
+ */
+#define GUAC_METRICS_OPCODE_LENGTH 16
+
+/**
+ * The maximum number of users of a single connection for which per-user
+ * metrics will be recorded. Users joining beyond this limit are not tracked
+ * individually.
+ */
+#define GUAC_METRICS_MAX_USERS 32
+
+/**
+ * The maximum number of bytes of any recorded connection or user ID,
+ * including null terminator.
+ */
+#define GUAC_METRICS_ID_LENGTH 64
+
+/**
+ * The maximum number of bytes of any recorded protocol name, including null
+ * terminator.
+ */
+#define GUAC_METRICS_PROTOCOL_LENGTH 32
+
+#endif
+
@@ -0,0 +1,76 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_METRICS_TYPES_H
+#define GUAC_METRICS_TYPES_H
+
+/**
+ * Type definitions related to the performance metrics which may be recorded
+ * for a connection.
+ *
+ * @file metrics-types.h
+ */
+
+/**
+ * The image formats for which encoding metrics are recorded.
+ */
+typedef enum guac_metrics_image_format {
+
+    /**
+     * Lossless PNG images.
+     */
+    GUAC_METRICS_PNG,
+
+    /**
+     * Lossy JPEG images.
+     */
+    GUAC_METRICS_JPEG,
+
+    /**
+     * WebP images, whether lossy or lossless.
+     */
+    GUAC_METRICS_WEBP,
+
+    /**
+     * The total number of image formats. This is not a valid format.
+     */
+    GUAC_METRICS_IMAGE_FORMATS
+
+} guac_metrics_image_format;
+
+/**
+ * The number of times instructions having a particular opcode have been
+ * sent.
+ */
+typedef struct guac_metrics_opcode guac_metrics_opcode;
+
+/**
+ * Performance metrics describing a single user of a connection.
+ */
+typedef struct guac_metrics_user guac_metrics_user;
+
+/**
+ * Performance metrics describing a single connection and its users. The
+ * contents of this structure contain no pointers and may be safely placed in
+ * memory shared with other processes.
+ */
+typedef struct guac_metrics guac_metrics;
+
+#endif
+
@@ -0,0 +1,294 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_METRICS_H
+#define GUAC_METRICS_H
+
+/**
+ * Provides functions and structures for recording performance metrics
+ * describing a connection, such as the number of frames and instructions sent
+ * and the time spent encoding and sending images. Metrics are only recorded if storage
+ * has been provided via guac_client_set_metrics().
+ *
+ * @file metrics.h
+ */
+
+#include "metrics-constants.h"
+#include "metrics-types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The state of an opcode or user slot within guac_metrics which has not yet
+ * been claimed.
+ */
+#define GUAC_METRICS_SLOT_FREE 0
+
+/**
+ * The state of an opcode or user slot within guac_metrics which has been
+ * claimed but whose contents are still being initialized.
+ */
+#define GUAC_METRICS_SLOT_CLAIMED 1
+
+/**
+ * The state of an opcode or user slot within guac_metrics which has been
+ * claimed and is fully initialized.
+ */
+#define GUAC_METRICS_SLOT_READY 2
+
+struct guac_metrics_opcode {
+
+    /**
+     * The current state of this slot. This will be GUAC_METRICS_SLOT_READY
+     * only once the opcode has been stored.
+     */
+    int state;
+
+    /**
+     * The opcode of the instructions counted, such as "sync" or "img".
+     */
+    char opcode[GUAC_METRICS_OPCODE_LENGTH];
+
+    /**
+     * The total number of instructions sent having this opcode.
+     */
+    uint64_t instructions;
+
+};
+
+struct guac_metrics_user {
+
+    /**
+     * The current state of this slot. This will be GUAC_METRICS_SLOT_READY
+     * only while the user is connected.
+     */
+    int state;
+
+    /**
+     * The ID of the user, as stored within the user_id member of guac_user.
+     */
+    char user_id[GUAC_METRICS_ID_LENGTH];
+
+    /**
+     * The total number of bytes written to the user's socket. If data sent
+     * to the user is compressed, this is the number of bytes after
+     * compression.
+     */
+    uint64_t bytes_sent;
+
+    /**
+     * The value of the frames member of the associated guac_metrics when the
+     * user joined, plus the number of frames the user has since acknowledged
+     * with "sync" instructions. The difference between this value and the
+     * total number of frames is the number of frames still pending.
+     */
+    uint64_t acknowledged_frames;
+
+    /**
+     * The most recent estimate of the network round-trip time for the user,
+     * in milliseconds.
+     */
+    int round_trip_time;
+
+    /**
+     * The most recent estimate of the amount of time the user is spending
+     * processing received frames, in milliseconds.
+     */
+    int processing_lag;
+
+};
+
+struct guac_metrics {
+
+    /**
+     * The ID of the connection, as stored within the connection_id member of
+     * guac_client.
+     */
+    char connection_id[GUAC_METRICS_ID_LENGTH];
+
+    /**
+     * The name of the protocol used by the connection, such as "vnc" or
+     * "rdp".
+     */
+    char protocol[GUAC_METRICS_PROTOCOL_LENGTH];
+
+    /**
+     * The total number of frames sent, where each frame is terminated by a
+     * "sync" instruction.
+     */
+    uint64_t frames;
+
+    /**
+     * The total number of logical frames which were combined with other
+     * logical frames rather than sent individually, as reported to
+     * guac_client_end_multiple_frames().
+     */
+    uint64_t dropped_frames;
+
+    /**
+     * The total number of images encoded, indexed by
+     * guac_metrics_image_format.
+     */
+    uint64_t images[GUAC_METRICS_IMAGE_FORMATS];
+
+    /**
+     * The total time spent encoding images and writing the resulting blobs,
+     * in microseconds, indexed by guac_metrics_image_format. As blobs are
+     * written while encoding is in progress, this includes any time spent
+     * blocked while writing to the socket.
+     */
+    uint64_t stream_time[GUAC_METRICS_IMAGE_FORMATS];
+
+    /**
+     * The number of instructions sent for each distinct opcode. Slots are
+     * claimed as new opcodes are encountered and are never released.
+     */
+    guac_metrics_opcode opcodes[GUAC_METRICS_MAX_OPCODES];
+
+    /**
+     * Metrics for each currently-connected user. Slots are claimed as users
+     * join and released as users leave.
+     */
+    guac_metrics_user users[GUAC_METRICS_MAX_USERS];
+
+};
+
+/**
+ * Initializes the given guac_metrics, clearing all counters and associating
+ * the metrics with the given connection and protocol.
+ *
+ * @param metrics
+ *     The guac_metrics to initialize.
+ *
+ * @param connection_id
+ *     The ID of the connection described by the metrics.
+ *
+ * @param protocol
+ *     The name of the protocol used by the connection.
+ */
+void guac_metrics_init(guac_metrics* metrics, const char* connection_id,
+        const char* protocol);
+
+/**
+ * Returns an arbitrary timestamp in microseconds, for use in timing
+ * operations recorded within guac_metrics. The difference between the return
+ * values of any two calls is the amount of time elapsed between those calls.
+ *
+ * @return
+ *     An arbitrary microsecond timestamp.
+ */
+uint64_t guac_metrics_current_time();
+
+/**
+ * Records that an instruction having the given opcode has been sent.
+ *
+ * @param metrics
+ *     The guac_metrics to update.
+ *
+ * @param opcode
+ *     The opcode of the instruction sent.
+ */
+void guac_metrics_record_instruction(guac_metrics* metrics,
+        const char* opcode);
+
+/**
+ * Records that a frame has been sent.
+ *
+ * @param metrics
+ *     The guac_metrics to update.
+ *
+ * @param logical_frames
+ *     The number of logical frames combined into the frame sent. Any logical
+ *     frames beyond the first are counted as dropped.
+ */
+void guac_metrics_record_frame(guac_metrics* metrics, int logical_frames);
+
+/**
+ * Records that an image has been encoded and sent in the given format.
+ *
+ * @param metrics
+ *     The guac_metrics to update.
+ *
+ * @param format
+ *     The format of the encoded image.
+ *
+ * @param start_time
+ *     The value returned by guac_metrics_current_time() just before encoding
+ *     began. The time elapsed since then, including the time spent writing
+ *     the encoded image, is recorded.
+ */
+void guac_metrics_record_image(guac_metrics* metrics,
+        guac_metrics_image_format format, uint64_t start_time);
+
+/**
+ * Claims a slot within the given guac_metrics for a newly-joined user.
+ *
+ * @param metrics
+ *     The guac_metrics to add the user to.
+ *
+ * @param user_id
+ *     The ID of the user that joined.
+ *
+ * @return
+ *     The slot claimed for the user, or NULL if the maximum number of
+ *     tracked users has been reached.
+ */
+guac_metrics_user* guac_metrics_add_user(guac_metrics* metrics,
+        const char* user_id);
+
+/**
+ * Releases the slot claimed by guac_metrics_add_user() for a user that has
+ * left.
+ *
+ * @param user
+ *     The slot to release.
+ */
+void guac_metrics_remove_user(guac_metrics_user* user);
+
+/**
+ * Records that the given number of bytes has been written to a user's
+ * socket.
+ *
+ * @param user
+ *     The guac_metrics_user to update.
+ *
+ * @param length
+ *     The number of bytes written.
+ */
+void guac_metrics_record_bytes(guac_metrics_user* user, size_t length);
+
+/**
+ * Records that a user has acknowledged a frame, along with the network
+ * round-trip time and processing lag calculated for that user.
+ *
+ * @param user
+ *     The guac_metrics_user to update.
+ *
+ * @param round_trip_time
+ *     The estimated network round-trip time, in milliseconds.
+ *
+ * @param processing_lag
+ *     The estimated processing lag, in milliseconds.
+ */
+void guac_metrics_record_sync(guac_metrics_user* user, int round_trip_time,
+        int processing_lag);
+
+#endif
+
@@ -27,10 +27,17 @@
  */
 
 /**
- * The maximum number of characters per instruction.
+ * The maximum number of characters per instruction element.
  */
 #define GUAC_INSTRUCTION_MAX_LENGTH 8192
 
+/**
+ * The number of bytes of statically-allocated storage available to each
+ * guac_parser for buffering received instructions. Instructions larger than
+ * this are buffered within dynamically-allocated memory.
+ */
+#define GUAC_INSTRUCTION_BUFFER_SIZE 32768
+
 /**
  * The maximum number of digits to allow per length prefix.
  */
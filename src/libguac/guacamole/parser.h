@@ -79,12 +79,26 @@ struct guac_parser {
      */
     char* __instructionbuf_unparsed_end;
 
+    /**
+     * Statically-allocated storage for the instruction buffer, used for all
+     * instructions which fit within this buffer.
+     */
+    char __instructionbuf_static[GUAC_INSTRUCTION_BUFFER_SIZE];
+
     /**
      * The instruction buffer. This is essentially the input buffer,
      * provided as a convenience to be used to buffer instructions until
-     * those instructions are complete and ready to be parsed.
+     * those instructions are complete and ready to be parsed. This points to
+     * __instructionbuf_static unless an instruction has been received which
+     * is too large to fit within that buffer, in which case this points to
+     * dynamically-allocated memory.
+     */
+    char* __instructionbuf;
+
+    /**
+     * The size of the instruction buffer, in bytes.
      */
-    char __instructionbuf[32768];
+    int __instructionbuf_size;
 
 };
 
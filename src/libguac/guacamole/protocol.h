@@ -324,6 +324,27 @@ int guac_protocol_send_nop(guac_socket* socket);
  */
 int guac_protocol_send_ready(guac_socket* socket, const char* id);
 
+/**
+ * Sends a compress instruction over the given guac_socket connection,
+ * confirming that all further data sent over the connection will be
+ * compressed using the given method. The compress instruction itself is not
+ * compressed. This instruction may only be sent to users that have declared
+ * support for the given method during the handshake.
+ *
+ * If an error occurs sending the instruction, a non-zero value is
+ * returned, and guac_error is set appropriately.
+ *
+ * @param socket
+ *     The guac_socket connection to use.
+ *
+ * @param method
+ *     The compression method which will be used, such as "deflate".
+ *
+ * @return
+ *     Zero on success, non-zero on error.
+ */
+int guac_protocol_send_compress(guac_socket* socket, const char* method);
+
 /**
  * Sends a set instruction over the given guac_socket connection.
  *
@@ -54,11 +54,27 @@ typedef struct guac_socket_ssl_data {
      */
     SSL* ssl;
 
+    /**
+     * Non-zero if encryption of outbound data has been offloaded to the
+     * kernel (kernel TLS), zero otherwise. If non-zero, data written directly
+     * to the file descriptor is encrypted by the kernel, bypassing OpenSSL.
+     */
+    int ktls_send;
+
+    /**
+     * Non-zero if decryption of inbound data has been offloaded to the kernel
+     * (kernel TLS), zero otherwise.
+     */
+    int ktls_recv;
+
 } guac_socket_ssl_data;
 
 /**
  * Creates a new guac_socket which will use SSL for all communication. Freeing
  * this guac_socket will automatically close the associated file descriptor.
+ * Where supported by both OpenSSL and the kernel, encryption and decryption
+ * are offloaded to the kernel (kernel TLS) once the SSL handshake completes.
+ * Otherwise, OpenSSL is used for all encryption and decryption.
  *
  * @param context
  *     The SSL_CTX structure describing the desired SSL configuration.
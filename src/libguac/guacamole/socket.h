@@ -27,6 +27,7 @@
  */
 
 #include "client-types.h"
+#include "metrics-types.h"
 #include "socket-constants.h"
 #include "socket-fntypes.h"
 #include "socket-types.h"
@@ -118,6 +119,20 @@ struct guac_socket {
      */
     pthread_t __keep_alive_thread;
 
+    /**
+     * The metrics to which each instruction written to this guac_socket
+     * should be added, or NULL if instructions written to this guac_socket
+     * should not be counted.
+     */
+    guac_metrics* metrics;
+
+    /**
+     * The per-user metrics to which the number of bytes written to this
+     * guac_socket should be added, or NULL if bytes written to this
+     * guac_socket should not be counted.
+     */
+    guac_metrics_user* user_metrics;
+
 };
 
 /**
@@ -233,6 +248,31 @@ guac_socket* guac_socket_nest(guac_socket* parent, int index);
  */
 guac_socket* guac_socket_tee(guac_socket* primary, guac_socket* secondary);
 
+/**
+ * Allocates and initializes a new guac_socket which compresses all data
+ * written using deflate (a zlib stream, as defined by RFC 1950), writing the
+ * compressed data to the given existing, open guac_socket. Compressed data
+ * is flushed such that it may be fully decompressed by the remote end
+ * whenever the returned guac_socket is flushed. Data read from the returned
+ * guac_socket is not decompressed, and all other socket operations are
+ * delegated to the given guac_socket. Freeing the returned guac_socket
+ * terminates the compressed stream but has no other effect on the given
+ * guac_socket.
+ *
+ * If an error occurs while allocating the guac_socket object, NULL is returned,
+ * and guac_error is set appropriately.
+ *
+ * @param parent
+ *     The guac_socket to which all compressed data should be written, and to
+ *     which all other socket operations should be delegated.
+ *
+ * @return
+ *     A newly allocated guac_socket object which compresses all data written
+ *     to the given guac_socket, or NULL if an error occurs while allocating
+ *     the guac_socket object.
+ */
+guac_socket* guac_socket_deflate(guac_socket* parent);
+
 /**
  * Allocates and initializes a new guac_socket which duplicates all
  * instructions written across the sockets of each connected user of the given
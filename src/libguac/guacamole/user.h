@@ -30,6 +30,7 @@
 
 #include "client-types.h"
 #include "layer-types.h"
+#include "metrics-types.h"
 #include "pool-types.h"
 #include "socket-types.h"
 #include "stream-types.h"
@@ -538,6 +539,23 @@ struct guac_user {
      */
     guac_user_touch_handler* touch_handler;
 
+    /**
+     * NULL-terminated array of compression methods which the client can
+     * decompress, such as "deflate", as declared during the handshake. If the
+     * client does not support compression at all, this will be NULL. At most
+     * one of these methods will be used to compress all data sent to the
+     * client after the handshake.
+     */
+    const char** compression_methods;
+
+    /**
+     * Storage for performance metrics describing this user, or NULL if no
+     * metrics are being recorded for this user. This is assigned
+     * automatically when the user joins a guac_client that is recording
+     * metrics.
+     */
+    guac_metrics_user* metrics;
+
 };
 
 /**
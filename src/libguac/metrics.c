@@ -0,0 +1,270 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/metrics.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+
+/**
+ * Atomically adds the given value to the given counter. As metrics may be
+ * read by other processes at any time, all counters are updated atomically,
+ * though without any ordering guarantees relative to each other.
+ *
+ * @param counter
+ *     A pointer to the counter to update.
+ *
+ * @param value
+ *     The value to add to the counter.
+ */
+#define GUAC_METRICS_ADD(counter, value) \
+    __atomic_fetch_add((counter), (value), __ATOMIC_RELAXED)
+
+/**
+ * Atomically stores the given value within the given field.
+ *
+ * @param field
+ *     A pointer to the field to update.
+ *
+ * @param value
+ *     The value to store.
+ */
+#define GUAC_METRICS_STORE(field, value) \
+    __atomic_store_n((field), (value), __ATOMIC_RELAXED)
+
+/**
+ * Returns a hash code for the given opcode, for the sake of locating its
+ * slot within the opcode table of guac_metrics.
+ *
+ * @param opcode
+ *     The opcode to hash.
+ *
+ * @return
+ *     A reasonably well-distributed hash code for the given opcode.
+ */
+static unsigned int guac_metrics_hash_opcode(const char* opcode) {
+
+    unsigned int hash_value = 0;
+    int c;
+
+    /* Apply each character in string to the hash code */
+    while ((c = *(opcode++)))
+        hash_value = hash_value * 31 + c;
+
+    return hash_value;
+
+}
+
+/**
+ * Attempts to claim the given free slot. If successful, the slot will be in
+ * the GUAC_METRICS_SLOT_CLAIMED state, and other threads (or processes) will
+ * not consider the slot usable until its contents have been initialized and
+ * its state has been set to GUAC_METRICS_SLOT_READY with
+ * guac_metrics_publish_slot().
+ *
+ * @param state
+ *     A pointer to the state of the slot being claimed.
+ *
+ * @return
+ *     Non-zero if the slot was successfully claimed, zero if the slot had
+ *     already been claimed by another thread.
+ */
+static int guac_metrics_claim_slot(int* state) {
+
+    int expected = GUAC_METRICS_SLOT_FREE;
+    return __atomic_compare_exchange_n(state, &expected,
+            GUAC_METRICS_SLOT_CLAIMED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+
+}
+
+/**
+ * Marks the given claimed slot as ready, making its contents visible to all
+ * other threads (or processes).
+ *
+ * @param state
+ *     A pointer to the state of the slot being published.
+ */
+static void guac_metrics_publish_slot(int* state) {
+    __atomic_store_n(state, GUAC_METRICS_SLOT_READY, __ATOMIC_RELEASE);
+}
+
+void guac_metrics_init(guac_metrics* metrics, const char* connection_id,
+        const char* protocol) {
+
+    memset(metrics, 0, sizeof(guac_metrics));
+
+    strncpy(metrics->connection_id, connection_id,
+            sizeof(metrics->connection_id) - 1);
+
+    strncpy(metrics->protocol, protocol, sizeof(metrics->protocol) - 1);
+
+}
+
+uint64_t guac_metrics_current_time() {
+
+#ifdef HAVE_CLOCK_GETTIME
+
+    struct timespec current;
+
+    /* Get current time, monotonically increasing */
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &current);
+#else
+    clock_gettime(CLOCK_REALTIME, &current);
+#endif
+
+    /* Calculate microseconds */
+    return (uint64_t) current.tv_sec * 1000000 + current.tv_nsec / 1000;
+
+#else
+
+    struct timeval current;
+
+    /* Get current time */
+    gettimeofday(&current, NULL);
+
+    /* Calculate microseconds */
+    return (uint64_t) current.tv_sec * 1000000 + current.tv_usec;
+
+#endif
+
+}
+
+void guac_metrics_record_instruction(guac_metrics* metrics,
+        const char* opcode) {
+
+    /* Opcodes which cannot be stored are not counted */
+    if (strlen(opcode) >= GUAC_METRICS_OPCODE_LENGTH)
+        return;
+
+    /* Search for the opcode's slot, claiming the first free slot found if
+     * the opcode has not yet been encountered */
+    unsigned int start = guac_metrics_hash_opcode(opcode);
+    for (int i = 0; i < GUAC_METRICS_MAX_OPCODES; i++) {
+
+        guac_metrics_opcode* slot =
+            &(metrics->opcodes[(start + i) % GUAC_METRICS_MAX_OPCODES]);
+
+        int state = __atomic_load_n(&(slot->state), __ATOMIC_ACQUIRE);
+
+        /* Attempt to claim free slots, rechecking the slot if another thread
+         * claims it first (it may be claiming it for this same opcode) */
+        if (state == GUAC_METRICS_SLOT_FREE) {
+
+            if (guac_metrics_claim_slot(&(slot->state))) {
+                strcpy(slot->opcode, opcode);
+                slot->instructions = 1;
+                guac_metrics_publish_slot(&(slot->state));
+                return;
+            }
+
+            state = __atomic_load_n(&(slot->state), __ATOMIC_ACQUIRE);
+
+        }
+
+        /* Wait for any in-progress claim to complete */
+        while (state == GUAC_METRICS_SLOT_CLAIMED)
+            state = __atomic_load_n(&(slot->state), __ATOMIC_ACQUIRE);
+
+        if (strcmp(slot->opcode, opcode) == 0) {
+            GUAC_METRICS_ADD(&(slot->instructions), 1);
+            return;
+        }
+
+    }
+
+    /* Table is full - opcode is not counted */
+
+}
+
+void guac_metrics_record_frame(guac_metrics* metrics, int logical_frames) {
+
+    GUAC_METRICS_ADD(&(metrics->frames), 1);
+
+    if (logical_frames > 1)
+        GUAC_METRICS_ADD(&(metrics->dropped_frames), logical_frames - 1);
+
+}
+
+void guac_metrics_record_image(guac_metrics* metrics,
+        guac_metrics_image_format format, uint64_t start_time) {
+
+    uint64_t duration = guac_metrics_current_time() - start_time;
+
+    GUAC_METRICS_ADD(&(metrics->images[format]), 1);
+    GUAC_METRICS_ADD(&(metrics->stream_time[format]), duration);
+
+}
+
+guac_metrics_user* guac_metrics_add_user(guac_metrics* metrics,
+        const char* user_id) {
+
+    for (int i = 0; i < GUAC_METRICS_MAX_USERS; i++) {
+
+        guac_metrics_user* user = &(metrics->users[i]);
+
+        /* Reset counters before the slot becomes visible as ready */
+        if (guac_metrics_claim_slot(&(user->state))) {
+
+            strncpy(user->user_id, user_id, sizeof(user->user_id) - 1);
+            user->user_id[sizeof(user->user_id) - 1] = '\0';
+
+            user->bytes_sent = 0;
+            user->acknowledged_frames =
+                __atomic_load_n(&(metrics->frames), __ATOMIC_RELAXED);
+            user->round_trip_time = 0;
+            user->processing_lag = 0;
+
+            guac_metrics_publish_slot(&(user->state));
+            return user;
+
+        }
+
+    }
+
+    /* No free slots */
+    return NULL;
+
+}
+
+void guac_metrics_remove_user(guac_metrics_user* user) {
+    __atomic_store_n(&(user->state), GUAC_METRICS_SLOT_FREE,
+            __ATOMIC_RELEASE);
+}
+
+void guac_metrics_record_bytes(guac_metrics_user* user, size_t length) {
+    GUAC_METRICS_ADD(&(user->bytes_sent), length);
+}
+
+void guac_metrics_record_sync(guac_metrics_user* user, int round_trip_time,
+        int processing_lag) {
+
+    GUAC_METRICS_ADD(&(user->acknowledged_frames), 1);
+    GUAC_METRICS_STORE(&(user->round_trip_time), round_trip_time);
+    GUAC_METRICS_STORE(&(user->processing_lag), processing_lag);
+
+}
+
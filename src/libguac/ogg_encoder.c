@@ -0,0 +1,312 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/audio.h"
+#include "guacamole/client.h"
+#include "guacamole/protocol.h"
+#include "guacamole/socket.h"
+#include "guacamole/stream.h"
+#include "guacamole/user.h"
+#include "ogg_encoder.h"
+
+#include <ogg/ogg.h>
+#include <vorbis/vorbisenc.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Appends the header and body of the given Ogg page to the given buffer,
+ * expanding the buffer as necessary.
+ *
+ * @param buffer
+ *     Pointer to the buffer to append to. If the buffer is reallocated, this
+ *     pointer is updated accordingly.
+ *
+ * @param written
+ *     Pointer to the number of bytes currently stored within the buffer. This
+ *     value is updated to include the appended page.
+ *
+ * @param length
+ *     Pointer to the number of bytes allocated for the buffer. This value is
+ *     updated if the buffer is reallocated.
+ *
+ * @param page
+ *     The Ogg page to append.
+ */
+static void ogg_encoder_append_page(unsigned char** buffer, int* written,
+        int* length, const ogg_page* page) {
+
+    int required = *written + page->header_len + page->body_len;
+
+    /* Grow buffer if necessary */
+    if (required > *length) {
+
+        int new_length = *length ? *length : GUAC_OGG_ENCODER_BUFFER_SIZE;
+        while (new_length < required)
+            new_length *= 2;
+
+        *buffer = realloc(*buffer, new_length);
+        *length = new_length;
+
+    }
+
+    memcpy(*buffer + *written, page->header, page->header_len);
+    *written += page->header_len;
+
+    memcpy(*buffer + *written, page->body, page->body_len);
+    *written += page->body_len;
+
+}
+
+/**
+ * Sends all buffered Ogg data as blobs over the broadcast socket of the
+ * client associated with the given audio stream, clearing the buffer.
+ *
+ * @param audio
+ *     The audio stream whose buffered data should be sent.
+ */
+static void ogg_encoder_send_buffer(guac_audio_stream* audio) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    guac_protocol_send_blobs(audio->client->socket, audio->stream,
+            state->buffer, state->written);
+
+    state->written = 0;
+
+}
+
+/**
+ * Moves all complete Vorbis packets out of the encoder and into the Ogg
+ * stream, appending any completed Ogg pages to the output buffer. If forced,
+ * pages are ended early such that all encoded data is buffered.
+ *
+ * @param audio
+ *     The audio stream whose encoded data should be buffered.
+ *
+ * @param force
+ *     Non-zero if all encoded data should be buffered, even if doing so
+ *     requires sending partially-filled Ogg pages, zero otherwise.
+ */
+static void ogg_encoder_buffer_pages(guac_audio_stream* audio, int force) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    ogg_packet packet;
+    ogg_page page;
+
+    /* Encode all available blocks */
+    while (vorbis_analysis_blockout(&state->vorbis_state,
+                &state->vorbis_block) == 1) {
+
+        vorbis_analysis(&state->vorbis_block, NULL);
+        vorbis_bitrate_addblock(&state->vorbis_block);
+
+        /* Add resulting packets to Ogg stream */
+        while (vorbis_bitrate_flushpacket(&state->vorbis_state, &packet))
+            ogg_stream_packetin(&state->ogg_state, &packet);
+
+    }
+
+    /* Buffer completed pages */
+    while (ogg_stream_pageout(&state->ogg_state, &page) != 0)
+        ogg_encoder_append_page(&state->buffer, &state->written,
+                &state->length, &page);
+
+    /* Buffer partial pages only if requested */
+    while (force && ogg_stream_flush(&state->ogg_state, &page) != 0)
+        ogg_encoder_append_page(&state->buffer, &state->written,
+                &state->length, &page);
+
+}
+
+/**
+ * Sends the "audio" instruction describing the given audio stream, followed
+ * by the Vorbis stream headers, over the given socket.
+ *
+ * @param audio
+ *     The audio stream to describe.
+ *
+ * @param socket
+ *     The socket over which the stream and its headers should be sent.
+ */
+static void ogg_encoder_send_audio(guac_audio_stream* audio,
+        guac_socket* socket) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    /* Associate stream */
+    guac_protocol_send_audio(socket, audio->stream, "audio/ogg");
+
+    /* Send headers required for decoding */
+    guac_protocol_send_blobs(socket, audio->stream,
+            state->header, state->header_length);
+
+}
+
+static void ogg_encoder_begin_handler(guac_audio_stream* audio) {
+
+    ogg_packet header;
+    ogg_packet header_comment;
+    ogg_packet header_codebooks;
+    ogg_page page;
+
+    /* Allocate and init encoder state */
+    ogg_encoder_state* state = calloc(1, sizeof(ogg_encoder_state));
+
+    /* Init Vorbis encoder using variable bitrate, leaving the stream without
+     * encoder state (such that another encoder is chosen) if the PCM format
+     * is not supported */
+    vorbis_info_init(&state->info);
+    if (vorbis_encode_init_vbr(&state->info, audio->channels, audio->rate,
+                GUAC_OGG_ENCODER_QUALITY) != 0) {
+        guac_client_log(audio->client, GUAC_LOG_WARNING, "Unable to "
+                "initialize Ogg Vorbis encoder for %i channel(s) at %i Hz. "
+                "Falling back to uncompressed audio.",
+                audio->channels, audio->rate);
+        vorbis_info_clear(&state->info);
+        free(state);
+        return;
+    }
+
+    audio->data = state;
+
+    vorbis_comment_init(&state->comment);
+    vorbis_analysis_init(&state->vorbis_state, &state->info);
+    vorbis_block_init(&state->vorbis_state, &state->vorbis_block);
+
+    /* Each stream within a client must have a unique serial number */
+    ogg_stream_init(&state->ogg_state, audio->stream->index);
+
+    /* Build Vorbis headers */
+    vorbis_analysis_headerout(&state->vorbis_state, &state->comment,
+            &header, &header_comment, &header_codebooks);
+
+    ogg_stream_packetin(&state->ogg_state, &header);
+    ogg_stream_packetin(&state->ogg_state, &header_comment);
+    ogg_stream_packetin(&state->ogg_state, &header_codebooks);
+
+    /* Store headers such that they can be sent to joining users */
+    int header_size = 0;
+    while (ogg_stream_flush(&state->ogg_state, &page) != 0)
+        ogg_encoder_append_page(&state->header, &state->header_length,
+                &header_size, &page);
+
+    /* Broadcast existence of stream */
+    ogg_encoder_send_audio(audio, audio->client->socket);
+
+}
+
+static void ogg_encoder_join_handler(guac_audio_stream* audio,
+        guac_user* user) {
+
+    /* Notify user of existence of stream */
+    ogg_encoder_send_audio(audio, user->socket);
+
+}
+
+static void ogg_encoder_end_handler(guac_audio_stream* audio) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    /* Encode and send any remaining data, marking end of stream */
+    vorbis_analysis_wrote(&state->vorbis_state, 0);
+    ogg_encoder_buffer_pages(audio, 1);
+    ogg_encoder_send_buffer(audio);
+
+    /* Send end of stream */
+    guac_protocol_send_end(audio->client->socket, audio->stream);
+
+    /* Clean up encoder */
+    ogg_stream_clear(&state->ogg_state);
+    vorbis_block_clear(&state->vorbis_block);
+    vorbis_dsp_clear(&state->vorbis_state);
+    vorbis_comment_clear(&state->comment);
+    vorbis_info_clear(&state->info);
+
+    /* Free state information */
+    free(state->header);
+    free(state->buffer);
+    free(state);
+
+}
+
+static void ogg_encoder_write_handler(guac_audio_stream* audio,
+        const unsigned char* pcm_data, int length) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    int frame_size = audio->channels * 2;
+    int remaining = length / frame_size;
+
+    while (remaining > 0) {
+
+        int frames = remaining;
+        if (frames > GUAC_OGG_ENCODER_FRAMES)
+            frames = GUAC_OGG_ENCODER_FRAMES;
+
+        /* Deinterleave and convert signed 16-bit little-endian samples to
+         * floating point */
+        float** buffer = vorbis_analysis_buffer(&state->vorbis_state, frames);
+        for (int i = 0; i < frames; i++) {
+            for (int channel = 0; channel < audio->channels; channel++) {
+                int16_t sample = (int16_t) (pcm_data[0] | (pcm_data[1] << 8));
+                buffer[channel][i] = sample / 32768.0f;
+                pcm_data += 2;
+            }
+        }
+
+        vorbis_analysis_wrote(&state->vorbis_state, frames);
+        remaining -= frames;
+
+        ogg_encoder_buffer_pages(audio, 0);
+
+        /* Avoid buffering excessively if the stream is not being flushed */
+        if (state->written >= GUAC_OGG_ENCODER_BUFFER_SIZE)
+            ogg_encoder_send_buffer(audio);
+
+    }
+
+}
+
+static void ogg_encoder_flush_handler(guac_audio_stream* audio) {
+
+    /* Send all data encoded thus far */
+    ogg_encoder_buffer_pages(audio, 1);
+    ogg_encoder_send_buffer(audio);
+
+}
+
+/* Ogg Vorbis encoder handlers */
+guac_audio_encoder _ogg_encoder = {
+    .mimetype      = "audio/ogg",
+    .begin_handler = ogg_encoder_begin_handler,
+    .write_handler = ogg_encoder_write_handler,
+    .flush_handler = ogg_encoder_flush_handler,
+    .join_handler  = ogg_encoder_join_handler,
+    .end_handler   = ogg_encoder_end_handler
+};
+
+/* Actual encoder definition */
+guac_audio_encoder* ogg_encoder = &_ogg_encoder;
+
@@ -0,0 +1,117 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_OGG_ENCODER_H
+#define GUAC_OGG_ENCODER_H
+
+#include "config.h"
+
+#include "guacamole/audio.h"
+
+#include <ogg/ogg.h>
+#include <vorbis/vorbisenc.h>
+
+/**
+ * The base quality of the Ogg Vorbis variable bitrate encoding, ranging from
+ * -0.1 (lowest) to 1.0 (highest). A quality of 0.4 results in roughly
+ * 128 kbit/s for 44.1 kHz stereo audio, less than one tenth of the
+ * equivalent raw PCM.
+ */
+#define GUAC_OGG_ENCODER_QUALITY 0.4
+
+/**
+ * The number of PCM frames to pass to the Vorbis encoder at once. Each frame
+ * contains one sample for each channel.
+ */
+#define GUAC_OGG_ENCODER_FRAMES 1024
+
+/**
+ * The maximum number of bytes of encoded Ogg data to buffer before that data
+ * is automatically sent, regardless of whether the audio stream has been
+ * flushed.
+ */
+#define GUAC_OGG_ENCODER_BUFFER_SIZE 8192
+
+/**
+ * The current state of the Ogg Vorbis encoder. Separate state is maintained
+ * for each audio stream.
+ */
+typedef struct ogg_encoder_state {
+
+    /**
+     * Ogg packet stream.
+     */
+    ogg_stream_state ogg_state;
+
+    /**
+     * Vorbis encoder configuration, including the number of channels and
+     * sample rate.
+     */
+    vorbis_info info;
+
+    /**
+     * User comments embedded within the Vorbis header.
+     */
+    vorbis_comment comment;
+
+    /**
+     * Vorbis encoder state.
+     */
+    vorbis_dsp_state vorbis_state;
+
+    /**
+     * The Vorbis block currently being encoded.
+     */
+    vorbis_block vorbis_block;
+
+    /**
+     * The Ogg pages containing the Vorbis stream headers, which must be sent
+     * to any user that joins after encoding has begun.
+     */
+    unsigned char* header;
+
+    /**
+     * The size of the Vorbis stream headers, in bytes.
+     */
+    int header_length;
+
+    /**
+     * Buffer of encoded Ogg data which has not yet been sent.
+     */
+    unsigned char* buffer;
+
+    /**
+     * The number of bytes currently stored within the buffer.
+     */
+    int written;
+
+    /**
+     * The total number of bytes allocated for the buffer.
+     */
+    int length;
+
+} ogg_encoder_state;
+
+/**
+ * Audio encoder which encodes 16-bit PCM as Ogg Vorbis.
+ */
+extern guac_audio_encoder* ogg_encoder;
+
+#endif
+
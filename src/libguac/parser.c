@@ -24,10 +24,15 @@
 #include "guacamole/socket.h"
 #include "guacamole/unicode.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 static void guac_parser_reset(guac_parser* parser) {
     parser->opcode = NULL;
     parser->argc = 0;
@@ -36,6 +41,116 @@ static void guac_parser_reset(guac_parser* parser) {
     parser->__element_length = 0;
 }
 
+/**
+ * Returns the number of consecutive ASCII characters (bytes less than 0x80)
+ * at the beginning of the given buffer. As ASCII characters each occupy
+ * exactly one byte in UTF-8, this is both the number of bytes and the number
+ * of characters which may be skipped without decoding UTF-8.
+ *
+ * @param buffer
+ *     The buffer to scan.
+ *
+ * @param length
+ *     The maximum number of bytes to scan.
+ *
+ * @return
+ *     The number of consecutive ASCII characters at the beginning of the
+ *     given buffer, which may be zero.
+ */
+static int guac_parser_ascii_length(const char* buffer, int length) {
+
+    int i = 0;
+
+#ifdef __SSE2__
+    /* Test 16 bytes at a time, locating the first byte having its high bit
+     * set (if any) via the byte mask */
+    for (; i + 16 <= length; i += 16) {
+        int mask = _mm_movemask_epi8(
+                _mm_loadu_si128((const __m128i*) (buffer + i)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#else
+    /* Test 8 bytes at a time, leaving the exact location of any non-ASCII
+     * byte to the loop below */
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, buffer + i, sizeof(word));
+        if (word & 0x8080808080808080ULL)
+            break;
+    }
+#endif
+
+    /* Test remaining bytes individually */
+    while (i < length && !(buffer[i] & 0x80))
+        i++;
+
+    return i;
+
+}
+
+/**
+ * Moves the in-progress instruction and any unparsed data following that
+ * instruction to the beginning of a newly-allocated instruction buffer of the
+ * given size, freeing the previous buffer if it was dynamically allocated.
+ * The new buffer may be the statically-allocated buffer of the parser if the
+ * given size is GUAC_INSTRUCTION_BUFFER_SIZE. Pointers to any elements parsed
+ * thus far are updated accordingly.
+ *
+ * @param parser
+ *     The guac_parser whose instruction buffer should be replaced.
+ *
+ * @param instr_start
+ *     Pointer to the first byte of the in-progress instruction within the
+ *     current instruction buffer.
+ *
+ * @param size
+ *     The size of the new instruction buffer, in bytes. This must be large
+ *     enough to contain all data from instr_start through the end of the
+ *     unparsed data.
+ *
+ * @return
+ *     Zero if the instruction buffer was successfully replaced, non-zero if
+ *     memory could not be allocated.
+ */
+static int guac_parser_resize(guac_parser* parser, char* instr_start,
+        int size) {
+
+    char* old_buffer = parser->__instructionbuf;
+    char* new_buffer;
+
+    /* Allocate new buffer, unless returning to static storage */
+    if (size == GUAC_INSTRUCTION_BUFFER_SIZE)
+        new_buffer = parser->__instructionbuf_static;
+    else {
+        new_buffer = malloc(size);
+        if (new_buffer == NULL)
+            return 1;
+    }
+
+    /* Copy in-progress instruction and unparsed data */
+    int length = parser->__instructionbuf_unparsed_end - instr_start;
+    memmove(new_buffer, instr_start, length);
+
+    /* Update parsed elements, if any */
+    for (int i = 0; i < parser->__elementc; i++)
+        parser->__elementv[i] = new_buffer
+                              + (parser->__elementv[i] - instr_start);
+
+    /* Update tracking pointers */
+    parser->__instructionbuf_unparsed_start = new_buffer
+            + (parser->__instructionbuf_unparsed_start - instr_start);
+    parser->__instructionbuf_unparsed_end = new_buffer + length;
+
+    if (old_buffer != parser->__instructionbuf_static)
+        free(old_buffer);
+
+    parser->__instructionbuf = new_buffer;
+    parser->__instructionbuf_size = size;
+    return 0;
+
+}
+
 guac_parser* guac_parser_alloc() {
 
     /* Allocate space for parser */
@@ -46,6 +161,10 @@ guac_parser* guac_parser_alloc() {
         return NULL;
     }
 
+    /* Use static storage for instructions until more space is needed */
+    parser->__instructionbuf = parser->__instructionbuf_static;
+    parser->__instructionbuf_size = GUAC_INSTRUCTION_BUFFER_SIZE;
+
     /* Init parse start/end markers */
     parser->__instructionbuf_unparsed_start = parser->__instructionbuf;
     parser->__instructionbuf_unparsed_end = parser->__instructionbuf;
@@ -77,9 +196,20 @@ int guac_parser_append(guac_parser* parser, void* buffer, int length) {
             char c = *(char_buffer++);
             bytes_parsed++;
 
-            /* If digit, add to length */
-            if (c >= '0' && c <= '9')
-                parsed_length = parsed_length*10 + c - '0';
+            /* If digit, add to length (characters below '0' wrap around to
+             * large unsigned values, thus one comparison suffices) */
+            unsigned int digit = (unsigned char) c - '0';
+            if (digit <= 9) {
+
+                parsed_length = parsed_length*10 + digit;
+
+                /* If too long, parse error */
+                if (parsed_length > GUAC_INSTRUCTION_MAX_LENGTH) {
+                    parser->state = GUAC_PARSE_ERROR;
+                    return 0;
+                }
+
+            }
 
             /* If period, switch to parsing content */
             else if (c == '.') {
@@ -96,12 +226,6 @@ int guac_parser_append(guac_parser* parser, void* buffer, int length) {
 
         }
 
-        /* If too long, parse error */
-        if (parsed_length > GUAC_INSTRUCTION_MAX_LENGTH) {
-            parser->state = GUAC_PARSE_ERROR;
-            return 0;
-        }
-
         /* Save length */
         parser->__element_length = parsed_length;
 
@@ -112,6 +236,27 @@ int guac_parser_append(guac_parser* parser, void* buffer, int length) {
 
         while (bytes_parsed < length && parser->__element_length >= 0) {
 
+            /* Skip past any ASCII characters within the element without
+             * decoding each character individually */
+            if (parser->__element_length > 0) {
+
+                int available = length - bytes_parsed;
+                if (available > parser->__element_length)
+                    available = parser->__element_length;
+
+                int ascii_length = guac_parser_ascii_length(char_buffer,
+                        available);
+
+                parser->__element_length -= ascii_length;
+                bytes_parsed += ascii_length;
+                char_buffer += ascii_length;
+
+                /* Stop if all available data has been parsed */
+                if (bytes_parsed == length)
+                    break;
+
+            }
+
             /* Get length of current character */
             char c = *char_buffer;
             int char_length = guac_utf8_charsize((unsigned char) c);
@@ -168,12 +313,32 @@ int guac_parser_read(guac_parser* parser, guac_socket* socket, int usec_timeout)
     char* unparsed_end   = parser->__instructionbuf_unparsed_end;
     char* unparsed_start = parser->__instructionbuf_unparsed_start;
     char* instr_start    = parser->__instructionbuf_unparsed_start;
-    char* buffer_end     = parser->__instructionbuf + sizeof(parser->__instructionbuf);
 
     /* Begin next instruction if previous was ended */
-    if (parser->state == GUAC_PARSE_COMPLETE)
+    if (parser->state == GUAC_PARSE_COMPLETE) {
+
         guac_parser_reset(parser);
 
+        /* Release any dynamically-allocated instruction buffer once the
+         * data remaining to be parsed again fits within static storage */
+        if (parser->__instructionbuf != parser->__instructionbuf_static
+                && unparsed_end - unparsed_start
+                    <= GUAC_INSTRUCTION_BUFFER_SIZE) {
+
+            guac_parser_resize(parser, instr_start,
+                    GUAC_INSTRUCTION_BUFFER_SIZE);
+
+            unparsed_end   = parser->__instructionbuf_unparsed_end;
+            unparsed_start = parser->__instructionbuf_unparsed_start;
+            instr_start    = unparsed_start;
+
+        }
+
+    }
+
+    char* buffer_end = parser->__instructionbuf
+                     + parser->__instructionbuf_size;
+
     while (parser->state != GUAC_PARSE_COMPLETE
         && parser->state != GUAC_PARSE_ERROR) {
 
@@ -185,7 +350,7 @@ int guac_parser_read(guac_parser* parser, guac_socket* socket, int usec_timeout)
 
             int retval;
 
-            /* If no space left to read, fail */
+            /* If no space left to read, make room */
             if (unparsed_end == buffer_end) {
 
                 /* Shift backward if possible */
@@ -209,11 +374,30 @@ int guac_parser_read(guac_parser* parser, guac_socket* socket, int usec_timeout)
 
                 }
 
-                /* Otherwise, no memory to read */
+                /* Otherwise, expand buffer, moving the instruction to
+                 * dynamically-allocated memory. The size of any valid
+                 * instruction is inherently limited by the maximum number
+                 * and length of its elements. */
                 else {
-                    guac_error = GUAC_STATUS_NO_MEMORY;
-                    guac_error_message = "Instruction too long";
-                    return -1;
+
+                    parser->__instructionbuf_unparsed_start = unparsed_start;
+                    parser->__instructionbuf_unparsed_end = unparsed_end;
+
+                    if (guac_parser_resize(parser, instr_start,
+                                parser->__instructionbuf_size * 2)) {
+                        guac_error = GUAC_STATUS_NO_MEMORY;
+                        guac_error_message = "Insufficient memory to buffer "
+                                             "instruction";
+                        return -1;
+                    }
+
+                    /* Update tracking pointers */
+                    unparsed_end   = parser->__instructionbuf_unparsed_end;
+                    unparsed_start = parser->__instructionbuf_unparsed_start;
+                    instr_start    = parser->__instructionbuf;
+                    buffer_end     = parser->__instructionbuf
+                                   + parser->__instructionbuf_size;
+
                 }
 
             }
@@ -313,6 +497,12 @@ int guac_parser_shift(guac_parser* parser, void* buffer, int length) {
 }
 
 void guac_parser_free(guac_parser* parser) {
+
+    /* Free instruction buffer if dynamically allocated */
+    if (parser->__instructionbuf != parser->__instructionbuf_static)
+        free(parser->__instructionbuf);
+
     free(parser);
+
 }
 
@@ -19,8 +19,10 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
 #include "guacamole/layer.h"
+#include "guacamole/metrics.h"
 #include "guacamole/object.h"
 #include "guacamole/protocol.h"
 #include "guacamole/protocol-types.h"
@@ -69,132 +71,472 @@ guac_protocol_version_mapping guac_protocol_version_table[] = {
     { GUAC_PROTOCOL_VERSION_UNKNOWN, NULL }
 };
 
-/* Output formatting functions */
+/**
+ * The number of bytes of instruction data which may be stored within a
+ * guac_protocol_builder before additional memory must be allocated. This is
+ * large enough to hold any blob instruction containing up to
+ * GUAC_PROTOCOL_BLOB_MAX_LENGTH bytes of data.
+ */
+#define GUAC_PROTOCOL_BUILDER_SIZE 8192
+
+/**
+ * The maximum number of bytes within the leading comma and length prefix of
+ * any element, including the period terminating the length prefix. Lengths
+ * are at most 20 decimal digits.
+ */
+#define GUAC_PROTOCOL_MAX_PREFIX_LENGTH 22
+
+/**
+ * A single instruction which is being built in memory prior to being written
+ * to a guac_socket in one operation. Building instructions in this way
+ * avoids acquiring the locks of the underlying socket and invoking its
+ * handlers separately for each element.
+ */
+typedef struct guac_protocol_builder {
+
+    /**
+     * The buffer containing the instruction built thus far. This will point
+     * to the statically-allocated storage of this guac_protocol_builder unless
+     * the instruction has grown larger than GUAC_PROTOCOL_BUILDER_SIZE.
+     */
+    char* buffer;
+
+    /**
+     * The number of bytes of instruction data stored within the buffer.
+     */
+    size_t length;
 
-ssize_t __guac_socket_write_length_string(guac_socket* socket, const char* str) {
+    /**
+     * The total number of bytes available within the buffer.
+     */
+    size_t size;
 
-    return
-           guac_socket_write_int(socket, guac_utf8_strlen(str))
-        || guac_socket_write_string(socket, ".")
-        || guac_socket_write_string(socket, str);
+    /**
+     * Non-zero if memory could not be allocated for the instruction, zero
+     * otherwise.
+     */
+    int failed;
+
+    /**
+     * The opcode of the instruction being built, including its length
+     * prefix, as provided to guac_protocol_builder_begin().
+     */
+    const char* opcode;
+
+    /**
+     * Statically-allocated storage for the instruction, used unless the
+     * instruction grows larger than GUAC_PROTOCOL_BUILDER_SIZE.
+     */
+    char storage[GUAC_PROTOCOL_BUILDER_SIZE];
+
+} guac_protocol_builder;
+
+/**
+ * Reserves space for the given number of additional bytes within the given
+ * guac_protocol_builder, expanding its buffer if necessary. The reserved
+ * space is not considered part of the instruction until the length of the
+ * guac_protocol_builder is explicitly updated.
+ *
+ * @param builder
+ *     The guac_protocol_builder to reserve space within.
+ *
+ * @param length
+ *     The number of bytes to reserve.
+ *
+ * @return
+ *     A pointer to the first reserved byte, or NULL if memory could not be
+ *     allocated.
+ */
+static char* guac_protocol_builder_reserve(guac_protocol_builder* builder,
+        size_t length) {
+
+    /* Fail permanently if a previous allocation has failed */
+    if (builder->failed)
+        return NULL;
+
+    size_t required = builder->length + length;
+    if (required > builder->size) {
+
+        size_t size = builder->size * 2;
+        while (size < required)
+            size *= 2;
+
+        /* Move instruction out of static storage, if necessary */
+        char* buffer;
+        if (builder->buffer == builder->storage) {
+            buffer = malloc(size);
+            if (buffer != NULL)
+                memcpy(buffer, builder->storage, builder->length);
+        }
+        else
+            buffer = realloc(builder->buffer, size);
+
+        if (buffer == NULL) {
+            builder->failed = 1;
+            return NULL;
+        }
+
+        builder->buffer = buffer;
+        builder->size = size;
+
+    }
+
+    return builder->buffer + builder->length;
 
 }
 
-ssize_t __guac_socket_write_length_int(guac_socket* socket, int64_t i) {
+/**
+ * Appends the given data to the instruction being built by the given
+ * guac_protocol_builder, without any length prefix or delimiter.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append data to.
+ *
+ * @param data
+ *     The data to append.
+ *
+ * @param length
+ *     The number of bytes of data to append.
+ */
+static void guac_protocol_builder_append(guac_protocol_builder* builder,
+        const char* data, size_t length) {
 
-    char buffer[128];
-    snprintf(buffer, sizeof(buffer), "%"PRIi64, i);
-    return __guac_socket_write_length_string(socket, buffer);
+    char* output = guac_protocol_builder_reserve(builder, length);
+    if (output == NULL)
+        return;
+
+    memcpy(output, data, length);
+    builder->length += length;
 
 }
 
-ssize_t __guac_socket_write_length_double(guac_socket* socket, double d) {
+/**
+ * Writes the decimal digits of the given value such that the final digit
+ * immediately precedes the given location.
+ *
+ * @param end
+ *     The location immediately following the last digit to be written. At
+ *     least 20 bytes must be available before this location.
+ *
+ * @param value
+ *     The value to write.
+ *
+ * @return
+ *     The location of the first digit written.
+ */
+static char* guac_protocol_format_digits(char* end, uint64_t value) {
 
-    char buffer[128];
-    snprintf(buffer, sizeof(buffer), "%.16g", d);
-    return __guac_socket_write_length_string(socket, buffer);
+    /* Produce digits from least significant to most significant */
+    char* current = end;
+    do {
+        *(--current) = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+
+    return current;
 
 }
 
 /**
- * Loop through the provided NULL-terminated array, writing the values in the
- * array to the given socket. Values are written as a series of Guacamole
- * protocol elements, including the leading comma and the value length in
- * addition to the value itself. Returns zero on success, non-zero on error.
+ * Writes the leading comma and length prefix of an element having the given
+ * length, including the period terminating the length prefix.
  *
- * @param socket
- *     The socket to which the data should be written.
+ * @param output
+ *     The buffer to write to, which must have at least
+ *     GUAC_PROTOCOL_MAX_PREFIX_LENGTH bytes available.
  *
- * @param array
- *     The NULL-terminated array of values to write.
+ * @param length
+ *     The length of the element, in Unicode codepoints.
  *
  * @return
- *     Zero on success, non-zero on error.
+ *     The number of bytes written.
  */
-static int guac_socket_write_array(guac_socket* socket, const char** array) {
+static size_t guac_protocol_format_prefix(char* output, size_t length) {
 
-    /* Loop through array, writing provided values to the socket. */
-    for (int i=0; array[i] != NULL; i++) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* current = guac_protocol_format_digits(end, length);
+    size_t digit_count = end - current;
 
-        if (guac_socket_write_string(socket, ","))
-            return -1;
+    output[0] = ',';
+    memcpy(output + 1, current, digit_count);
+    output[digit_count + 1] = '.';
 
-        if (__guac_socket_write_length_string(socket, array[i]))
-            return -1;
+    return digit_count + 2;
 
-    }
+}
 
-    return 0;
+/**
+ * Appends a complete element with the given value to the instruction being
+ * built by the given guac_protocol_builder, including the leading comma and
+ * length prefix.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append the element to.
+ *
+ * @param value
+ *     The value of the element.
+ *
+ * @param length
+ *     The number of bytes within the value.
+ *
+ * @param char_length
+ *     The number of Unicode codepoints within the value.
+ */
+static void guac_protocol_builder_element(guac_protocol_builder* builder,
+        const char* value, size_t length, size_t char_length) {
+
+    char* output = guac_protocol_builder_reserve(builder,
+            GUAC_PROTOCOL_MAX_PREFIX_LENGTH + length);
+    if (output == NULL)
+        return;
+
+    size_t prefix_length = guac_protocol_format_prefix(output, char_length);
+    memcpy(output + prefix_length, value, length);
+    builder->length += prefix_length + length;
 
 }
 
-/* Protocol functions */
+/**
+ * Initializes the given guac_protocol_builder, beginning a new instruction
+ * having the given opcode.
+ *
+ * @param builder
+ *     The guac_protocol_builder to initialize.
+ *
+ * @param opcode
+ *     The opcode of the instruction, including its length prefix, such as
+ *     "4.sync".
+ */
+static void guac_protocol_builder_begin(guac_protocol_builder* builder,
+        const char* opcode) {
 
-int guac_protocol_send_ack(guac_socket* socket, guac_stream* stream,
-        const char* error, guac_protocol_status status) {
+    builder->buffer = builder->storage;
+    builder->length = 0;
+    builder->size = sizeof(builder->storage);
+    builder->failed = 0;
+    builder->opcode = opcode;
+
+    guac_protocol_builder_append(builder, opcode, strlen(opcode));
+
+}
+
+/**
+ * Appends an element containing the decimal representation of the given
+ * integer to the instruction being built by the given guac_protocol_builder.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append the element to.
+ *
+ * @param value
+ *     The integer value of the element.
+ */
+static void guac_protocol_builder_int(guac_protocol_builder* builder,
+        int64_t value) {
+
+    char digits[24];
+    char* end = digits + sizeof(digits);
+
+    uint64_t magnitude = value < 0 ? -((uint64_t) value) : (uint64_t) value;
+    char* current = guac_protocol_format_digits(end, magnitude);
+
+    if (value < 0)
+        *(--current) = '-';
+
+    size_t length = end - current;
+    char* output = guac_protocol_builder_reserve(builder,
+            GUAC_PROTOCOL_MAX_PREFIX_LENGTH + length);
+    if (output == NULL)
+        return;
+
+    size_t prefix_length = guac_protocol_format_prefix(output, length);
+    memcpy(output + prefix_length, current, length);
+    builder->length += prefix_length + length;
+
+}
+
+/**
+ * Appends an element containing the given string to the instruction being
+ * built by the given guac_protocol_builder.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append the element to.
+ *
+ * @param value
+ *     The null-terminated string value of the element.
+ */
+static void guac_protocol_builder_string(guac_protocol_builder* builder,
+        const char* value) {
+
+    /* Determine length, noting whether any non-ASCII characters are present
+     * and the length in codepoints must be calculated separately */
+    const unsigned char* current = (const unsigned char*) value;
+    unsigned char high_bits = 0;
+    while (*current != '\0')
+        high_bits |= *(current++);
+
+    size_t length = (const char*) current - value;
+    size_t char_length = (high_bits & 0x80) ? guac_utf8_strlen(value) : length;
+
+    guac_protocol_builder_element(builder, value, length, char_length);
+
+}
+
+/**
+ * Appends an element containing the decimal representation of the given
+ * floating-point value to the instruction being built by the given
+ * guac_protocol_builder.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append the element to.
+ *
+ * @param value
+ *     The floating-point value of the element.
+ */
+static void guac_protocol_builder_double(guac_protocol_builder* builder,
+        double value) {
+
+    char buffer[128];
+    int length = snprintf(buffer, sizeof(buffer), "%.16g", value);
+    guac_protocol_builder_element(builder, buffer, length, length);
+
+}
+
+/**
+ * Appends an element for each string within the given NULL-terminated array
+ * to the instruction being built by the given guac_protocol_builder.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append the elements to.
+ *
+ * @param array
+ *     The NULL-terminated array of values to append.
+ */
+static void guac_protocol_builder_array(guac_protocol_builder* builder,
+        const char** array) {
+
+    for (int i = 0; array[i] != NULL; i++)
+        guac_protocol_builder_string(builder, array[i]);
+
+}
+
+/**
+ * Appends an element containing the given data encoded as base64 to the
+ * instruction being built by the given guac_protocol_builder.
+ *
+ * @param builder
+ *     The guac_protocol_builder to append the element to.
+ *
+ * @param data
+ *     The data to encode.
+ *
+ * @param count
+ *     The number of bytes of data to encode.
+ */
+static void guac_protocol_builder_base64(guac_protocol_builder* builder,
+        const void* data, size_t count) {
+
+    size_t length = GUAC_BASE64_ENCODED_LENGTH(count);
+
+    char* output = guac_protocol_builder_reserve(builder,
+            GUAC_PROTOCOL_MAX_PREFIX_LENGTH + length);
+    if (output == NULL)
+        return;
+
+    size_t prefix_length = guac_protocol_format_prefix(output, length);
+    guac_base64_encode(data, count, output + prefix_length);
+    builder->length += prefix_length + length;
+
+}
+
+/**
+ * Terminates the instruction being built by the given guac_protocol_builder
+ * and writes that instruction to the given guac_socket as a single operation,
+ * releasing any memory allocated by the guac_protocol_builder.
+ *
+ * @param builder
+ *     The guac_protocol_builder containing the instruction to send.
+ *
+ * @param socket
+ *     The guac_socket to write the instruction to.
+ *
+ * @return
+ *     Zero on success, non-zero on error.
+ */
+static int guac_protocol_builder_send(guac_protocol_builder* builder,
+        guac_socket* socket) {
 
     int ret_val;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.ack,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, error)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, status)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_append(builder, ";", 1);
+
+    if (builder->failed) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Could not allocate memory for instruction";
+        ret_val = -1;
+    }
+
+    else {
+        guac_socket_instruction_begin(socket);
+        ret_val = guac_socket_write(socket, builder->buffer, builder->length);
+        guac_socket_instruction_end(socket);
+
+        /* Count instruction by opcode, excluding length prefix */
+        if (socket->metrics != NULL)
+            guac_metrics_record_instruction(socket->metrics,
+                    strchr(builder->opcode, '.') + 1);
+
+    }
+
+    /* Free any memory allocated beyond static storage */
+    if (builder->buffer != builder->storage)
+        free(builder->buffer);
 
-    guac_socket_instruction_end(socket);
     return ret_val;
 
 }
 
-static int __guac_protocol_send_args(guac_socket* socket, const char** args) {
+/* Protocol functions */
 
-    if (guac_socket_write_string(socket, "4.args")) return -1;
-    
-    /* Send protocol version ahead of other args. */
-    if (guac_socket_write_string(socket, ",")
-            || __guac_socket_write_length_string(socket, GUACAMOLE_PROTOCOL_VERSION))
-        return -1;
+int guac_protocol_send_ack(guac_socket* socket, guac_stream* stream,
+        const char* error, guac_protocol_status status) {
 
-    if (guac_socket_write_array(socket, args))
-        return -1;
+    guac_protocol_builder builder;
 
-    return guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.ack");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, error);
+    guac_protocol_builder_int(&builder, status);
+
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_args(guac_socket* socket, const char** args) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val = __guac_protocol_send_args(socket, args);
-    guac_socket_instruction_end(socket);
+    guac_protocol_builder_begin(&builder, "4.args");
 
-    return ret_val;
+    /* Send protocol version ahead of other args. */
+    guac_protocol_builder_string(&builder, GUACAMOLE_PROTOCOL_VERSION);
+    guac_protocol_builder_array(&builder, args);
+
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_argv(guac_socket* socket, guac_stream* stream,
         const char* mimetype, const char* name) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.argv,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.argv");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, mimetype);
+    guac_protocol_builder_string(&builder, name);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -202,69 +544,44 @@ int guac_protocol_send_arc(guac_socket* socket, const guac_layer* layer,
         int x, int y, int radius, double startAngle, double endAngle,
         int negative) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.arc,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, radius)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, startAngle)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, endAngle)
-        || guac_socket_write_string(socket, ",")
-        || guac_socket_write_string(socket, negative ? "1.1" : "1.0")
-        || guac_socket_write_string(socket, ";");
-    guac_socket_instruction_end(socket);
+    guac_protocol_builder_begin(&builder, "3.arc");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
+    guac_protocol_builder_int(&builder, radius);
+    guac_protocol_builder_double(&builder, startAngle);
+    guac_protocol_builder_double(&builder, endAngle);
+    guac_protocol_builder_int(&builder, negative ? 1 : 0);
 
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_audio(guac_socket* socket, const guac_stream* stream,
         const char* mimetype) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val = 
-           guac_socket_write_string(socket, "5.audio,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ";");
-    guac_socket_instruction_end(socket);
+    guac_protocol_builder_begin(&builder, "5.audio");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, mimetype);
 
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_blob(guac_socket* socket, const guac_stream* stream,
         const void* data, int count) {
 
-    int base64_length = (count + 2) / 3 * 4;
+    guac_protocol_builder builder;
 
-    int ret_val;
-
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.blob,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || guac_socket_write_int(socket, base64_length)
-        || guac_socket_write_string(socket, ".")
-        || guac_socket_write_base64(socket, data, count)
-        || guac_socket_flush_base64(socket)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.blob");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_base64(&builder, data, count);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -298,22 +615,15 @@ int guac_protocol_send_blobs(guac_socket* socket, const guac_stream* stream,
 int guac_protocol_send_body(guac_socket* socket, const guac_object* object,
         const guac_stream* stream, const char* mimetype, const char* name) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.body,")
-        || __guac_socket_write_length_int(socket, object->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.body");
+    guac_protocol_builder_int(&builder, object->index);
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, mimetype);
+    guac_protocol_builder_string(&builder, name);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -321,98 +631,74 @@ int guac_protocol_send_cfill(guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer,
         int r, int g, int b, int a) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.cfill,")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, r)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, g)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, b)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, a)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.cfill");
+    guac_protocol_builder_int(&builder, mode);
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, r);
+    guac_protocol_builder_int(&builder, g);
+    guac_protocol_builder_int(&builder, b);
+    guac_protocol_builder_int(&builder, a);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_close(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.close,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.close");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
-static int __guac_protocol_send_connect(guac_socket* socket, const char** args) {
+int guac_protocol_send_connect(guac_socket* socket, const char** args) {
 
-    if (guac_socket_write_string(socket, "7.connect"))
-        return -1;
+    guac_protocol_builder builder;
 
-    if (guac_socket_write_array(socket, args))
-        return -1;
+    guac_protocol_builder_begin(&builder, "7.connect");
+    guac_protocol_builder_array(&builder, args);
 
-    return guac_socket_write_string(socket, ";");
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
-int guac_protocol_send_connect(guac_socket* socket, const char** args) {
+int guac_protocol_send_clip(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val = __guac_protocol_send_connect(socket, args);
-    guac_socket_instruction_end(socket);
+    guac_protocol_builder_begin(&builder, "4.clip");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
-int guac_protocol_send_clip(guac_socket* socket, const guac_layer* layer) {
+int guac_protocol_send_clipboard(guac_socket* socket, const guac_stream* stream,
+        const char* mimetype) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.clip,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "9.clipboard");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, mimetype);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
-int guac_protocol_send_clipboard(guac_socket* socket, const guac_stream* stream,
-        const char* mimetype) {
+int guac_protocol_send_compress(guac_socket* socket, const char* method) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "9.clipboard,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "8.compress");
+    guac_protocol_builder_string(&builder, method);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -420,32 +706,20 @@ int guac_protocol_send_copy(guac_socket* socket,
         const guac_layer* srcl, int srcx, int srcy, int w, int h,
         guac_composite_mode mode, const guac_layer* dstl, int dstx, int dsty) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.copy,")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcy)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, w)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, h)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dsty)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.copy");
+    guac_protocol_builder_int(&builder, srcl->index);
+    guac_protocol_builder_int(&builder, srcx);
+    guac_protocol_builder_int(&builder, srcy);
+    guac_protocol_builder_int(&builder, w);
+    guac_protocol_builder_int(&builder, h);
+    guac_protocol_builder_int(&builder, mode);
+    guac_protocol_builder_int(&builder, dstl->index);
+    guac_protocol_builder_int(&builder, dstx);
+    guac_protocol_builder_int(&builder, dsty);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -454,87 +728,55 @@ int guac_protocol_send_cstroke(guac_socket* socket,
         guac_line_cap_style cap, guac_line_join_style join, int thickness,
         int r, int g, int b, int a) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "7.cstroke,")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, cap)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, join)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, thickness)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, r)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, g)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, b)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, a)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "7.cstroke");
+    guac_protocol_builder_int(&builder, mode);
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, cap);
+    guac_protocol_builder_int(&builder, join);
+    guac_protocol_builder_int(&builder, thickness);
+    guac_protocol_builder_int(&builder, r);
+    guac_protocol_builder_int(&builder, g);
+    guac_protocol_builder_int(&builder, b);
+    guac_protocol_builder_int(&builder, a);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_cursor(guac_socket* socket, int x, int y,
         const guac_layer* srcl, int srcx, int srcy, int w, int h) {
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "6.cursor,")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcy)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, w)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, h)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "6.cursor");
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
+    guac_protocol_builder_int(&builder, srcl->index);
+    guac_protocol_builder_int(&builder, srcx);
+    guac_protocol_builder_int(&builder, srcy);
+    guac_protocol_builder_int(&builder, w);
+    guac_protocol_builder_int(&builder, h);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_curve(guac_socket* socket, const guac_layer* layer,
         int cp1x, int cp1y, int cp2x, int cp2y, int x, int y) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.curve,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, cp1x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, cp1y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, cp2x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, cp2y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.curve");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, cp1x);
+    guac_protocol_builder_int(&builder, cp1y);
+    guac_protocol_builder_int(&builder, cp2x);
+    guac_protocol_builder_int(&builder, cp2y);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -544,22 +786,21 @@ int guac_protocol_send_disconnect(guac_socket* socket) {
     guac_socket_instruction_begin(socket);
     ret_val = guac_socket_write_string(socket, "10.disconnect;");
     guac_socket_instruction_end(socket);
+
+    if (socket->metrics != NULL)
+        guac_metrics_record_instruction(socket->metrics, "disconnect");
     return ret_val;
 
 }
 
 int guac_protocol_send_dispose(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "7.dispose,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "7.dispose");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -567,82 +808,59 @@ int guac_protocol_send_distort(guac_socket* socket, const guac_layer* layer,
         double a, double b, double c,
         double d, double e, double f) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val = 
-           guac_socket_write_string(socket, "7.distort,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, a)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, b)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, c)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, d)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, e)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, f)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "7.distort");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_double(&builder, a);
+    guac_protocol_builder_double(&builder, b);
+    guac_protocol_builder_double(&builder, c);
+    guac_protocol_builder_double(&builder, d);
+    guac_protocol_builder_double(&builder, e);
+    guac_protocol_builder_double(&builder, f);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_end(guac_socket* socket, const guac_stream* stream) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.end,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.end");
+    guac_protocol_builder_int(&builder, stream->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_error(guac_socket* socket, const char* error,
         guac_protocol_status status) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.error,")
-        || __guac_socket_write_length_string(socket, error)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, status)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.error");
+    guac_protocol_builder_string(&builder, error);
+    guac_protocol_builder_int(&builder, status);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int vguac_protocol_send_log(guac_socket* socket, const char* format,
         va_list args) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
     /* Copy log message into buffer */
     char message[4096];
     vsnprintf(message, sizeof(message), format, args);
 
     /* Log to instruction */
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.log,")
-        || __guac_socket_write_length_string(socket, message)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.log");
+    guac_protocol_builder_string(&builder, message);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -662,88 +880,65 @@ int guac_protocol_send_log(guac_socket* socket, const char* format, ...) {
 int guac_protocol_send_msg(guac_socket* socket, guac_message_type msg,
         const char** args) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.msg,")
-        || __guac_socket_write_length_int(socket, msg)
-        || guac_socket_write_array(socket, args)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.msg");
+    guac_protocol_builder_int(&builder, msg);
+    guac_protocol_builder_array(&builder, args);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_file(guac_socket* socket, const guac_stream* stream,
         const char* mimetype, const char* name) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.file,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.file");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, mimetype);
+    guac_protocol_builder_string(&builder, name);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_filesystem(guac_socket* socket,
         const guac_object* object, const char* name) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "10.filesystem,")
-        || __guac_socket_write_length_int(socket, object->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "10.filesystem");
+    guac_protocol_builder_int(&builder, object->index);
+    guac_protocol_builder_string(&builder, name);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_identity(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "8.identity,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "8.identity");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_key(guac_socket* socket, int keysym, int pressed,
         guac_timestamp timestamp) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.key,")
-        || __guac_socket_write_length_int(socket, keysym)
-        || guac_socket_write_string(socket, pressed ? ",1.1," : ",1.0,")
-        || __guac_socket_write_length_int(socket, timestamp)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.key");
+    guac_protocol_builder_int(&builder, keysym);
+    guac_protocol_builder_int(&builder, pressed ? 1 : 0);
+    guac_protocol_builder_int(&builder, timestamp);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -751,40 +946,28 @@ int guac_protocol_send_lfill(guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer,
         const guac_layer* srcl) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.lfill,")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.lfill");
+    guac_protocol_builder_int(&builder, mode);
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, srcl->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_line(guac_socket* socket, const guac_layer* layer,
         int x, int y) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.line,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.line");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -793,48 +976,32 @@ int guac_protocol_send_lstroke(guac_socket* socket,
         guac_line_cap_style cap, guac_line_join_style join, int thickness,
         const guac_layer* srcl) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "7.lstroke,")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, cap)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, join)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, thickness)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "7.lstroke");
+    guac_protocol_builder_int(&builder, mode);
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, cap);
+    guac_protocol_builder_int(&builder, join);
+    guac_protocol_builder_int(&builder, thickness);
+    guac_protocol_builder_int(&builder, srcl->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_mouse(guac_socket* socket, int x, int y,
         int button_mask, guac_timestamp timestamp) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.mouse,")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, button_mask)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, timestamp)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.mouse");
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
+    guac_protocol_builder_int(&builder, button_mask);
+    guac_protocol_builder_int(&builder, timestamp);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -842,87 +1009,59 @@ int guac_protocol_send_touch(guac_socket* socket, int id, int x, int y,
         int x_radius, int y_radius, double angle, double force,
         guac_timestamp timestamp) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.touch,")
-        || __guac_socket_write_length_int(socket, id)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x_radius)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y_radius)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, angle)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, force)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, timestamp)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.touch");
+    guac_protocol_builder_int(&builder, id);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
+    guac_protocol_builder_int(&builder, x_radius);
+    guac_protocol_builder_int(&builder, y_radius);
+    guac_protocol_builder_double(&builder, angle);
+    guac_protocol_builder_double(&builder, force);
+    guac_protocol_builder_int(&builder, timestamp);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_move(guac_socket* socket, const guac_layer* layer,
         const guac_layer* parent, int x, int y, int z) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.move,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, parent->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, z)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.move");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, parent->index);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
+    guac_protocol_builder_int(&builder, z);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_name(guac_socket* socket, const char* name) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.name,")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.name");
+    guac_protocol_builder_string(&builder, name);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_nest(guac_socket* socket, int index,
         const char* data) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.nest,")
-        || __guac_socket_write_length_int(socket, index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, data)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.nest");
+    guac_protocol_builder_int(&builder, index);
+    guac_protocol_builder_string(&builder, data);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -934,6 +1073,9 @@ int guac_protocol_send_nop(guac_socket* socket) {
     ret_val = guac_socket_write_string(socket, "3.nop;");
     guac_socket_instruction_end(socket);
 
+    if (socket->metrics != NULL)
+        guac_metrics_record_instruction(socket->metrics, "nop");
+
     return ret_val;
 
 }
@@ -941,20 +1083,14 @@ int guac_protocol_send_nop(guac_socket* socket) {
 int guac_protocol_send_pipe(guac_socket* socket, const guac_stream* stream,
         const char* mimetype, const char* name) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.pipe,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.pipe");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_string(&builder, mimetype);
+    guac_protocol_builder_string(&builder, name);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -962,258 +1098,182 @@ int guac_protocol_send_img(guac_socket* socket, const guac_stream* stream,
         guac_composite_mode mode, const guac_layer* layer,
         const char* mimetype, int x, int y) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.img,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.img");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_int(&builder, mode);
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_string(&builder, mimetype);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_pop(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.pop,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.pop");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_push(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.push,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.push");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_ready(guac_socket* socket, const char* id) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.ready,")
-        || __guac_socket_write_length_string(socket, id)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.ready");
+    guac_protocol_builder_string(&builder, id);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_rect(guac_socket* socket,
         const guac_layer* layer, int x, int y, int width, int height) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.rect,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, width)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, height)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.rect");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
+    guac_protocol_builder_int(&builder, width);
+    guac_protocol_builder_int(&builder, height);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_required(guac_socket* socket, const char** required) {
-    
-    int ret_val;
-    
-    guac_socket_instruction_begin(socket);
 
-    ret_val = guac_socket_write_string(socket, "8.required")
-        || guac_socket_write_array(socket, required)
-        || guac_socket_write_string(socket, ";")
+    guac_protocol_builder builder;
+
+    guac_protocol_builder_begin(&builder, "8.required");
+    guac_protocol_builder_array(&builder, required);
+
+    return guac_protocol_builder_send(&builder, socket)
         || guac_socket_flush(socket);
-    
-    guac_socket_instruction_end(socket);
 
-    return ret_val;
-    
 }
 
 int guac_protocol_send_reset(guac_socket* socket, const guac_layer* layer) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.reset,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.reset");
+    guac_protocol_builder_int(&builder, layer->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_set(guac_socket* socket, const guac_layer* layer,
         const char* name, const char* value) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.set,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, value)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.set");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_string(&builder, name);
+    guac_protocol_builder_string(&builder, value);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_set_int(guac_socket* socket, const guac_layer* layer,
         const char* name, int value) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "3.set,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, name)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, value)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "3.set");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_string(&builder, name);
+    guac_protocol_builder_int(&builder, value);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_select(guac_socket* socket, const char* protocol) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "6.select,")
-        || __guac_socket_write_length_string(socket, protocol)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "6.select");
+    guac_protocol_builder_string(&builder, protocol);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_shade(guac_socket* socket, const guac_layer* layer,
         int a) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.shade,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, a)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.shade");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, a);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_size(guac_socket* socket, const guac_layer* layer,
         int w, int h) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.size,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, w)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, h)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.size");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, w);
+    guac_protocol_builder_int(&builder, h);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_start(guac_socket* socket, const guac_layer* layer,
         int x, int y) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.start,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "5.start");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_int(&builder, x);
+    guac_protocol_builder_int(&builder, y);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_sync(guac_socket* socket, guac_timestamp timestamp,
         int frames) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val = 
-           guac_socket_write_string(socket, "4.sync,")
-        || __guac_socket_write_length_int(socket, timestamp)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, frames)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "4.sync");
+    guac_protocol_builder_int(&builder, timestamp);
+    guac_protocol_builder_int(&builder, frames);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -1221,32 +1281,20 @@ int guac_protocol_send_transfer(guac_socket* socket,
         const guac_layer* srcl, int srcx, int srcy, int w, int h,
         guac_transfer_function fn, const guac_layer* dstl, int dstx, int dsty) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "8.transfer,")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcy)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, w)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, h)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, fn)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dsty)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "8.transfer");
+    guac_protocol_builder_int(&builder, srcl->index);
+    guac_protocol_builder_int(&builder, srcx);
+    guac_protocol_builder_int(&builder, srcy);
+    guac_protocol_builder_int(&builder, w);
+    guac_protocol_builder_int(&builder, h);
+    guac_protocol_builder_int(&builder, fn);
+    guac_protocol_builder_int(&builder, dstl->index);
+    guac_protocol_builder_int(&builder, dstx);
+    guac_protocol_builder_int(&builder, dsty);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
@@ -1254,124 +1302,49 @@ int guac_protocol_send_transform(guac_socket* socket, const guac_layer* layer,
         double a, double b, double c,
         double d, double e, double f) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val = 
-           guac_socket_write_string(socket, "9.transform,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, a)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, b)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, c)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, d)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, e)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_double(socket, f)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "9.transform");
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_double(&builder, a);
+    guac_protocol_builder_double(&builder, b);
+    guac_protocol_builder_double(&builder, c);
+    guac_protocol_builder_double(&builder, d);
+    guac_protocol_builder_double(&builder, e);
+    guac_protocol_builder_double(&builder, f);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_undefine(guac_socket* socket,
         const guac_object* object) {
 
-    int ret_val;
+    guac_protocol_builder builder;
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "8.undefine,")
-        || __guac_socket_write_length_int(socket, object->index)
-        || guac_socket_write_string(socket, ";");
+    guac_protocol_builder_begin(&builder, "8.undefine");
+    guac_protocol_builder_int(&builder, object->index);
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_send_video(guac_socket* socket, const guac_stream* stream,
         const guac_layer* layer, const char* mimetype) {
 
-    int ret_val;
-
-    guac_socket_instruction_begin(socket);
-    ret_val = 
-           guac_socket_write_string(socket, "5.video,")
-        || __guac_socket_write_length_int(socket, stream->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_string(socket, mimetype)
-        || guac_socket_write_string(socket, ";");
-    guac_socket_instruction_end(socket);
-
-    return ret_val;
-
-}
-
-/**
- * Returns the value of a single base64 character.
- */
-static int __guac_base64_value(char c) {
-
-    if (c >= 'A' && c <= 'Z')
-        return c - 'A';
-
-    if (c >= 'a' && c <= 'z')
-        return c - 'a' + 26;
-
-    if (c >= '0' && c <= '9')
-        return c - '0' + 52;
+    guac_protocol_builder builder;
 
-    if (c == '+')
-        return 62;
+    guac_protocol_builder_begin(&builder, "5.video");
+    guac_protocol_builder_int(&builder, stream->index);
+    guac_protocol_builder_int(&builder, layer->index);
+    guac_protocol_builder_string(&builder, mimetype);
 
-    if (c == '/')
-        return 63;
-
-    return 0;
+    return guac_protocol_builder_send(&builder, socket);
 
 }
 
 int guac_protocol_decode_base64(char* base64) {
-
-    char* input = base64;
-    char* output = base64;
-
-    int length = 0;
-    int bits_read = 0;
-    int value = 0;
-    char current;
-
-    /* For all characters in string */
-    while ((current = *(input++)) != 0) {
-
-        /* If we've reached padding, then we're done */
-        if (current == '=')
-            break;
-
-        /* Otherwise, shift on the latest 6 bits */
-        value = (value << 6) | __guac_base64_value(current);
-        bits_read += 6;
-
-        /* If we have at least one byte, write out the latest whole byte */
-        if (bits_read >= 8) {
-            *(output++) = (value >> (bits_read % 8)) & 0xFF;
-            bits_read -= 8;
-            length++;
-        }
-
-    }
-
-    /* Return number of bytes written */
-    return length;
-
+    return guac_base64_decode(base64);
 }
 
 guac_protocol_version guac_protocol_string_to_version(const char* version_string) {
@@ -0,0 +1,259 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/error.h"
+#include "guacamole/socket.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <zlib.h>
+
+/**
+ * The number of bytes of compressed data to buffer before writing that data
+ * to the underlying guac_socket.
+ */
+#define GUAC_SOCKET_DEFLATE_BUFFER_SIZE 8192
+
+/**
+ * The zlib compression level to use. Level 1 (fastest) is used, as the
+ * repetitive text of the Guacamole protocol compresses well even at low
+ * levels, while the CPU cost of higher levels is paid for every connected
+ * user.
+ */
+#define GUAC_SOCKET_DEFLATE_LEVEL 1
+
+/**
+ * Data associated with a guac_socket which compresses all data written using
+ * deflate, writing the compressed data to another guac_socket.
+ */
+typedef struct guac_socket_deflate_data {
+
+    /**
+     * The guac_socket to which all compressed data should be written, and to
+     * which all other socket operations should be delegated.
+     */
+    guac_socket* parent;
+
+    /**
+     * The zlib stream state used to compress data written to this socket.
+     */
+    z_stream stream;
+
+    /**
+     * Buffer receiving compressed data prior to that data being written to
+     * the parent socket.
+     */
+    unsigned char buffer[GUAC_SOCKET_DEFLATE_BUFFER_SIZE];
+
+    /**
+     * Lock which protects access to the compression stream, guaranteeing
+     * atomicity of writes and flushes.
+     */
+    pthread_mutex_t stream_lock;
+
+} guac_socket_deflate_data;
+
+/**
+ * Compresses all input currently provided to the zlib stream of the given
+ * socket, writing the compressed data to the parent socket as the output
+ * buffer fills. If flush is other than Z_NO_FLUSH, all pending compressed
+ * data is written to the parent socket. This function must ONLY be called if
+ * the stream lock has already been acquired.
+ *
+ * @param socket
+ *     The guac_socket whose zlib stream should be processed.
+ *
+ * @param flush
+ *     The zlib flush mode to pass to deflate(), such as Z_NO_FLUSH,
+ *     Z_SYNC_FLUSH, or Z_FINISH.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guac_socket_deflate_process(guac_socket* socket, int flush) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+    z_stream* stream = &(data->stream);
+
+    do {
+
+        stream->next_out = data->buffer;
+        stream->avail_out = sizeof(data->buffer);
+
+        int result = deflate(stream, flush);
+        if (result == Z_STREAM_ERROR) {
+            guac_error = GUAC_STATUS_INTERNAL_ERROR;
+            guac_error_message = "Unable to compress data written to socket";
+            return 1;
+        }
+
+        /* Write any compressed data produced */
+        size_t length = sizeof(data->buffer) - stream->avail_out;
+        if (length > 0 && guac_socket_write(data->parent, data->buffer,
+                    length))
+            return 1;
+
+    /* Continue until deflate() stops producing full buffers (all input has
+     * been consumed and, if flushing, all pending output written) */
+    } while (stream->avail_out == 0);
+
+    return 0;
+
+}
+
+static ssize_t guac_socket_deflate_read_handler(guac_socket* socket,
+        void* buf, size_t count) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+
+    /* Data read is not compressed */
+    return guac_socket_read(data->parent, buf, count);
+
+}
+
+static ssize_t guac_socket_deflate_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+    int retval;
+
+    pthread_mutex_lock(&(data->stream_lock));
+
+    data->stream.next_in = (Bytef*) buf;
+    data->stream.avail_in = count;
+    retval = guac_socket_deflate_process(socket, Z_NO_FLUSH);
+
+    pthread_mutex_unlock(&(data->stream_lock));
+
+    if (retval)
+        return -1;
+
+    return count;
+
+}
+
+static ssize_t guac_socket_deflate_flush_handler(guac_socket* socket) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+    int retval;
+
+    /* Force all data written thus far to be decompressible by the remote
+     * end without waiting for further data */
+    pthread_mutex_lock(&(data->stream_lock));
+    retval = guac_socket_deflate_process(socket, Z_SYNC_FLUSH);
+    pthread_mutex_unlock(&(data->stream_lock));
+
+    if (retval)
+        return retval;
+
+    return guac_socket_flush(data->parent);
+
+}
+
+static int guac_socket_deflate_select_handler(guac_socket* socket,
+        int usec_timeout) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+
+    /* Data read is not compressed */
+    return guac_socket_select(data->parent, usec_timeout);
+
+}
+
+static void guac_socket_deflate_lock_handler(guac_socket* socket) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+
+    /* Delegate lock to wrapped socket */
+    guac_socket_instruction_begin(data->parent);
+
+}
+
+static void guac_socket_deflate_unlock_handler(guac_socket* socket) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+
+    /* Delegate unlock to wrapped socket */
+    guac_socket_instruction_end(data->parent);
+
+}
+
+static int guac_socket_deflate_free_handler(guac_socket* socket) {
+
+    guac_socket_deflate_data* data = (guac_socket_deflate_data*) socket->data;
+
+    /* Properly terminate compressed stream, ignoring errors (the parent
+     * socket may already be closed) */
+    data->stream.avail_in = 0;
+    if (!guac_socket_deflate_process(socket, Z_FINISH))
+        guac_socket_flush(data->parent);
+
+    deflateEnd(&(data->stream));
+    pthread_mutex_destroy(&(data->stream_lock));
+
+    free(data);
+    return 0;
+
+}
+
+guac_socket* guac_socket_deflate(guac_socket* parent) {
+
+    /* Allocate socket and associated data */
+    guac_socket* socket = guac_socket_alloc();
+    if (socket == NULL)
+        return NULL;
+
+    guac_socket_deflate_data* data = calloc(1,
+            sizeof(guac_socket_deflate_data));
+    if (data == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Could not allocate memory for socket";
+        guac_socket_free(socket);
+        return NULL;
+    }
+
+    /* Init zlib stream, producing a zlib-wrapped deflate stream */
+    if (deflateInit(&(data->stream), GUAC_SOCKET_DEFLATE_LEVEL) != Z_OK) {
+        guac_error = GUAC_STATUS_INTERNAL_ERROR;
+        guac_error_message = "Unable to initialize compression";
+        free(data);
+        guac_socket_free(socket);
+        return NULL;
+    }
+
+    data->parent = parent;
+    pthread_mutex_init(&(data->stream_lock), NULL);
+    socket->data = data;
+
+    /* Set relevant handlers */
+    socket->read_handler   = guac_socket_deflate_read_handler;
+    socket->write_handler  = guac_socket_deflate_write_handler;
+    socket->flush_handler  = guac_socket_deflate_flush_handler;
+    socket->select_handler = guac_socket_deflate_select_handler;
+    socket->lock_handler   = guac_socket_deflate_lock_handler;
+    socket->unlock_handler = guac_socket_deflate_unlock_handler;
+    socket->free_handler   = guac_socket_deflate_free_handler;
+
+    return socket;
+
+}
+
@@ -33,6 +33,11 @@
 
 #ifdef ENABLE_WINSOCK
 #include <winsock2.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
 /**
@@ -52,10 +57,27 @@ typedef struct guac_socket_fd_data {
 
     /**
      * The main write buffer. Bytes written go here before being flushed
-     * to the open file descriptor.
+     * to the open file descriptor. Data which does not fit within the space
+     * remaining in this buffer is written directly, without first being
+     * copied into this buffer.
      */
     char out_buf[GUAC_SOCKET_OUTPUT_BUFFER_SIZE];
 
+    /**
+     * Non-zero if the file descriptor is a TCP socket which supports
+     * corking (delaying transmission of partial segments until uncorked),
+     * zero otherwise.
+     */
+    int cork_supported;
+
+    /**
+     * Non-zero if the file descriptor is currently corked, zero otherwise.
+     * The file descriptor is corked while data is written directly (bypassing
+     * the write buffer) and uncorked upon the next flush, such that large
+     * writes within a single frame are sent as full-sized segments.
+     */
+    int corked;
+
     /**
      * Lock which is acquired when an instruction is being written, and
      * released when the instruction is finished being written.
@@ -125,6 +147,165 @@ ssize_t guac_socket_fd_write(guac_socket* socket,
 
 }
 
+#ifndef ENABLE_WINSOCK
+/**
+ * Writes the entire contents of the given buffers to the file descriptor
+ * associated with the given socket using a single writev() call where
+ * possible, retrying as necessary until all buffers are written, and aborting
+ * if an error occurs. The contents of the given iovec array are modified to
+ * track progress across partial writes.
+ *
+ * @param socket
+ *     The guac_socket associated with the file descriptor to which the given
+ *     buffers should be written.
+ *
+ * @param iov
+ *     The array of buffers to write to the given guac_socket, in order.
+ *
+ * @param iovcnt
+ *     The number of buffers within the given array.
+ *
+ * @return
+ *     Zero if all buffers were written successfully, or a negative value if
+ *     an error occurs.
+ */
+static ssize_t guac_socket_fd_write_vector(guac_socket* socket,
+        struct iovec* iov, int iovcnt) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    /* Write until completely written */
+    while (iovcnt > 0) {
+
+        /* Skip any buffers which have been completely written */
+        if (iov->iov_len == 0) {
+            iov++;
+            iovcnt--;
+            continue;
+        }
+
+        ssize_t retval = writev(data->fd, iov, iovcnt);
+
+        /* Record errors in guac_error */
+        if (retval < 0) {
+            guac_error = GUAC_STATUS_SEE_ERRNO;
+            guac_error_message = "Error writing data to socket";
+            return retval;
+        }
+
+        /* Advance past written data, which may end partway through any
+         * buffer */
+        while (retval > 0) {
+
+            size_t chunk_size = iov->iov_len;
+            if (chunk_size > retval)
+                chunk_size = retval;
+
+            iov->iov_base = (char*) iov->iov_base + chunk_size;
+            iov->iov_len -= chunk_size;
+            retval -= chunk_size;
+
+            if (iov->iov_len == 0) {
+                iov++;
+                iovcnt--;
+            }
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Sets whether the file descriptor associated with the given socket is
+ * corked. While corked, the kernel will not transmit partial TCP segments.
+ * Uncorking the file descriptor immediately transmits any pending data. This
+ * function has no effect if the file descriptor does not support corking.
+ *
+ * @param socket
+ *     The guac_socket associated with the file descriptor to cork or uncork.
+ *
+ * @param corked
+ *     Non-zero if the file descriptor should be corked, zero if it should be
+ *     uncorked.
+ */
+static void guac_socket_fd_set_corked(guac_socket* socket, int corked) {
+
+#ifdef TCP_CORK
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    if (data->cork_supported && data->corked != corked) {
+
+        /* Stop attempting to cork if the file descriptor refuses */
+        if (setsockopt(data->fd, IPPROTO_TCP, TCP_CORK,
+                    &corked, sizeof(corked)))
+            data->cork_supported = 0;
+
+        else
+            data->corked = corked;
+
+    }
+#endif
+
+}
+#endif
+
+/**
+ * Writes the current contents of the output buffer of the given socket,
+ * followed by the contents of the given buffer, to the underlying file
+ * descriptor. The given buffer is written directly, without first being
+ * copied into the output buffer. This function must ONLY be called if the
+ * buffer lock has already been acquired.
+ *
+ * @param socket
+ *     The guac_socket to write the given buffer to.
+ *
+ * @param buf
+ *     The buffer to write to the given socket.
+ *
+ * @param count
+ *     The number of bytes in the given buffer.
+ *
+ * @return
+ *     Zero if all data was written successfully, or a negative value if an
+ *     error occurs.
+ */
+static ssize_t guac_socket_fd_write_through(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+#ifdef ENABLE_WINSOCK
+    /* WSA only works with send(), thus the buffer and provided data must be
+     * written separately */
+    if (data->written > 0) {
+        if (guac_socket_fd_write(socket, data->out_buf, data->written))
+            return -1;
+        data->written = 0;
+    }
+
+    return guac_socket_fd_write(socket, buf, count);
+#else
+    /* Hold back partial segments until the end of the frame */
+    guac_socket_fd_set_corked(socket, 1);
+
+    /* Gather buffered data and provided data into a single write */
+    struct iovec iov[2] = {
+        { .iov_base = data->out_buf,  .iov_len = data->written },
+        { .iov_base = (void*) buf,    .iov_len = count }
+    };
+
+    if (guac_socket_fd_write_vector(socket, iov, 2))
+        return -1;
+
+    data->written = 0;
+    return 0;
+#endif
+
+}
+
 /**
  * Attempts to read from the underlying file descriptor of the given
  * guac_socket, populating the given buffer.
@@ -191,6 +372,11 @@ static ssize_t guac_socket_fd_flush(guac_socket* socket) {
         data->written = 0;
     }
 
+#ifndef ENABLE_WINSOCK
+    /* Send any data held back since the last flush */
+    guac_socket_fd_set_corked(socket, 0);
+#endif
+
     return 0;
 
 }
@@ -245,45 +431,25 @@ static ssize_t guac_socket_fd_flush_handler(guac_socket* socket) {
 static ssize_t guac_socket_fd_write_buffered(guac_socket* socket,
         const void* buf, size_t count) {
 
-    size_t original_count = count;
-    const char* current = buf;
     guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
 
-    /* Append to buffer, flush if necessary */
-    while (count > 0) {
-
-        int chunk_size;
-        int remaining = sizeof(data->out_buf) - data->written;
-
-        /* If no space left in buffer, flush and retry */
-        if (remaining == 0) {
+    /* Write data directly if it does not fit within the buffer, rather than
+     * copying and writing the data in buffer-sized chunks */
+    if (count > sizeof(data->out_buf) - data->written) {
 
-            /* Abort if error occurs during flush */
-            if (guac_socket_fd_flush(socket))
-                return -1;
+        if (guac_socket_fd_write_through(socket, buf, count))
+            return -1;
 
-            /* Retry buffer append */
-            continue;
-
-        }
-
-        /* Calculate size of chunk to be written to buffer */
-        chunk_size = count;
-        if (chunk_size > remaining)
-            chunk_size = remaining;
-
-        /* Update output buffer */
-        memcpy(data->out_buf + data->written, current, chunk_size);
-        data->written += chunk_size;
-
-        /* Update provided buffer */
-        current += chunk_size;
-        count   -= chunk_size;
+        return count;
 
     }
 
-    /* All bytes have been written, possibly some to the internal buffer */
-    return original_count;
+    /* Otherwise, append to buffer */
+    memcpy(data->out_buf + data->written, buf, count);
+    data->written += count;
+
+    /* All bytes have been written to the internal buffer */
+    return count;
 
 }
 
@@ -428,8 +594,18 @@ guac_socket* guac_socket_open(int fd) {
     /* Store file descriptor as socket data */
     data->fd = fd;
     data->written = 0;
+    data->cork_supported = 0;
+    data->corked = 0;
     socket->data = data;
 
+#ifdef TCP_CORK
+    /* Cork only TCP sockets (the option is rejected for anything else) */
+    int corked;
+    socklen_t corked_length = sizeof(corked);
+    if (!getsockopt(fd, IPPROTO_TCP, TCP_CORK, &corked, &corked_length))
+        data->cork_supported = 1;
+#endif
+
     pthread_mutexattr_init(&lock_attributes);
     pthread_mutexattr_setpshared(&lock_attributes, PTHREAD_PROCESS_SHARED);
 
@@ -23,6 +23,7 @@
 #include "guacamole/socket.h"
 #include "guacamole/unicode.h"
 
+#include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
@@ -274,6 +275,8 @@ static int guac_socket_nest_free_handler(guac_socket* socket) {
 
     /* Free associated data */
     guac_socket_nest_data* data = (guac_socket_nest_data*) socket->data;
+    pthread_mutex_destroy(&(data->socket_lock));
+    pthread_mutex_destroy(&(data->buffer_lock));
     free(data);
 
     return 0;
@@ -319,8 +322,13 @@ guac_socket* guac_socket_nest(guac_socket* parent, int index) {
     /* Store nested socket details as socket data */
     data->parent = parent;
     data->index = index;
+    data->written = 0;
     socket->data = data;
 
+    /* Init locks */
+    pthread_mutex_init(&(data->socket_lock), NULL);
+    pthread_mutex_init(&(data->buffer_lock), NULL);
+
     /* Set relevant handlers */
     socket->write_handler  = guac_socket_nest_write_handler;
     socket->lock_handler   = guac_socket_nest_lock_handler;
@@ -25,7 +25,9 @@
 #include "wait-fd.h"
 
 #include <stdlib.h>
+#include <unistd.h>
 
+#include <openssl/bio.h>
 #include <openssl/ssl.h>
 
 static ssize_t __guac_socket_ssl_read_handler(guac_socket* socket,
@@ -54,7 +56,11 @@ static ssize_t __guac_socket_ssl_write_handler(guac_socket* socket,
     guac_socket_ssl_data* data = (guac_socket_ssl_data*) socket->data;
     int retval;
 
-    retval = SSL_write(data->ssl, buf, count);
+    /* Bypass OpenSSL entirely if the kernel is handling encryption */
+    if (data->ktls_send)
+        retval = write(data->fd, buf, count);
+    else
+        retval = SSL_write(data->ssl, buf, count);
 
     /* Record errors in guac_error */
     if (retval <= 0) {
@@ -116,6 +122,11 @@ guac_socket* guac_socket_open_secure(SSL_CTX* context, int fd) {
     data->ssl = ssl;
     SSL_set_fd(data->ssl, fd);
 
+#ifdef SSL_OP_ENABLE_KTLS
+    /* Offload encryption to the kernel after the handshake, if possible */
+    SSL_set_options(data->ssl, SSL_OP_ENABLE_KTLS);
+#endif
+
     /* Accept SSL connection, handle errors */
     if (SSL_accept(ssl) <= 0) {
 
@@ -132,6 +143,16 @@ guac_socket* guac_socket_open_secure(SSL_CTX* context, int fd) {
     data->fd = fd;
     socket->data = data;
 
+#ifdef BIO_get_ktls_send
+    /* Determine whether OpenSSL was able to offload each direction to the
+     * kernel (these are always zero if kernel TLS is unsupported) */
+    data->ktls_send = BIO_get_ktls_send(SSL_get_wbio(ssl));
+    data->ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+#else
+    data->ktls_send = 0;
+    data->ktls_recv = 0;
+#endif
+
     /* Set read/write handlers */
     socket->read_handler   = __guac_socket_ssl_read_handler;
     socket->write_handler  = __guac_socket_ssl_write_handler;
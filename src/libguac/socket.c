@@ -19,7 +19,9 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
+#include "guacamole/metrics.h"
 #include "guacamole/protocol.h"
 #include "guacamole/socket.h"
 #include "guacamole/timestamp.h"
@@ -86,8 +88,17 @@ static ssize_t __guac_socket_write(guac_socket* socket,
     socket->last_write_timestamp = guac_timestamp_current();
 
     /* If handler defined, call it. */
-    if (socket->write_handler)
-        return socket->write_handler(socket, buf, count);
+    if (socket->write_handler) {
+
+        ssize_t written = socket->write_handler(socket, buf, count);
+
+        /* Count bytes sent to the associated user, if any */
+        if (written > 0 && socket->user_metrics != NULL)
+            guac_metrics_record_bytes(socket->user_metrics, written);
+
+        return written;
+
+    }
 
     /* Otherwise, pretend everything was written. */
     return count;
@@ -155,6 +166,10 @@ guac_socket* guac_socket_alloc() {
     socket->state = GUAC_SOCKET_OPEN;
     socket->last_write_timestamp = guac_timestamp_current();
 
+    /* No metrics by default */
+    socket->metrics = NULL;
+    socket->user_metrics = NULL;
+
     /* No keep alive ping by default */
     socket->__keep_alive_enabled = 0;
 
@@ -312,29 +327,10 @@ ssize_t __guac_socket_encode_base64(int a, int b, int c, char* output) {
 }
 
 ssize_t guac_socket_flush_base64(guac_socket* socket) {
-    const unsigned char* src = socket->__ready_buf;
 
-    int encodedCount = 0;
-    int remaining = socket->__ready;
-
-    /* Encode bytes in groups of three */
-    while (remaining > 2) {
-        __guac_socket_encode_base64(src[0], src[1], src[2], socket->__encoded_buf + encodedCount);
-
-        remaining -= 3;
-        src += 3;
-        encodedCount += 4;
-    }
-
-    /* Take care of partial remnants */
-    if (remaining == 2) {
-        __guac_socket_encode_base64(src[0], src[1], -1, socket->__encoded_buf + encodedCount);
-        encodedCount += 4;
-    }
-    else if (remaining == 1) {
-        __guac_socket_encode_base64(src[0], -1, -1, socket->__encoded_buf + encodedCount);
-        encodedCount += 4;
-    }
+    /* Encode all bytes within ready buffer, including any padding */
+    int encodedCount = guac_base64_encode(socket->__ready_buf,
+            socket->__ready, socket->__encoded_buf);
 
     /* Write buffer to socket */
     int retval = guac_socket_write(socket, socket->__encoded_buf, encodedCount);
@@ -355,6 +351,25 @@ ssize_t guac_socket_write_base64(guac_socket* socket, const void* buf, size_t co
     int retval;
 
     while (remaining > 0) {
+
+        /* Encode full blocks directly from source if nothing is pending */
+        if (socket->__ready == 0
+                && remaining >= GUAC_SOCKET_BASE64_READY_BUFFER_SIZE) {
+
+            int encoded = guac_base64_encode(src,
+                    GUAC_SOCKET_BASE64_READY_BUFFER_SIZE,
+                    socket->__encoded_buf);
+
+            retval = guac_socket_write(socket, socket->__encoded_buf, encoded);
+            if (retval < 0)
+                return retval;
+
+            src += GUAC_SOCKET_BASE64_READY_BUFFER_SIZE;
+            remaining -= GUAC_SOCKET_BASE64_READY_BUFFER_SIZE;
+            continue;
+
+        }
+
         /* Fill ready buffer as much as possible */
         len = GUAC_SOCKET_BASE64_READY_BUFFER_SIZE - socket->__ready;
         if (remaining < len)
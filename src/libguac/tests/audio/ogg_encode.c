@@ -0,0 +1,219 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "ogg_encoder.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/audio.h>
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The sample rate of the test audio, in Hz.
+ */
+#define TEST_RATE 44100
+
+/**
+ * The number of channels within the test audio.
+ */
+#define TEST_CHANNELS 2
+
+/**
+ * The number of PCM frames written to the audio stream at a time.
+ */
+#define TEST_FRAMES 4410
+
+/**
+ * The number of times TEST_FRAMES frames are written to the audio stream.
+ */
+#define TEST_WRITES 10
+
+/**
+ * The period of the test tone, in PCM frames.
+ */
+#define TEST_PERIOD 100
+
+/**
+ * Replaces the broadcast socket of the given client with a socket which
+ * writes to the given file, such that all data sent by the audio encoder can
+ * be inspected.
+ *
+ * @param client
+ *     The client whose socket should be replaced.
+ *
+ * @param file
+ *     The file that all data sent via the client's socket should be written
+ *     to.
+ */
+static void redirect_client(guac_client* client, FILE* file) {
+    guac_socket_free(client->socket);
+    client->socket = guac_socket_open(dup(fileno(file)));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client->socket);
+}
+
+/**
+ * Reads the entire contents of the given file into a newly-allocated,
+ * null-terminated string.
+ *
+ * @param file
+ *     The file to read.
+ *
+ * @return
+ *     A newly-allocated string containing the contents of the file, which
+ *     must be freed with free().
+ */
+static char* read_all(FILE* file) {
+
+    struct stat file_stat;
+    CU_ASSERT_EQUAL_FATAL(fstat(fileno(file), &file_stat), 0);
+
+    size_t length = file_stat.st_size;
+    CU_ASSERT_FATAL(length > 0);
+
+    char* contents = malloc(length + 1);
+    rewind(file);
+    CU_ASSERT_EQUAL_FATAL(fread(contents, 1, length, file), length);
+    contents[length] = '\0';
+
+    return contents;
+
+}
+
+/**
+ * Counts the number of non-overlapping occurrences of the given substring
+ * within the given string.
+ *
+ * @param str
+ *     The string to search.
+ *
+ * @param substr
+ *     The substring to count.
+ *
+ * @return
+ *     The number of occurrences of substr within str.
+ */
+static int count(const char* str, const char* substr) {
+
+    int occurrences = 0;
+    while ((str = strstr(str, substr)) != NULL) {
+        occurrences++;
+        str += strlen(substr);
+    }
+
+    return occurrences;
+
+}
+
+/**
+ * Test which verifies that PCM written to an audio stream using the Ogg
+ * Vorbis encoder is sent as an "audio/ogg" stream consisting of several blobs
+ * of encoded data, terminated with an "end" instruction.
+ */
+void test_audio__ogg_encode() {
+
+    FILE* file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    redirect_client(client, file);
+
+    guac_audio_stream* audio = guac_audio_stream_alloc(client, ogg_encoder,
+            TEST_RATE, TEST_CHANNELS, 16);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(audio);
+    CU_ASSERT_PTR_EQUAL_FATAL(audio->encoder, ogg_encoder);
+
+    /* Write a 441 Hz triangle wave as signed 16-bit little-endian PCM */
+    unsigned char pcm[TEST_FRAMES * TEST_CHANNELS * 2];
+    int frame = 0;
+    for (int i = 0; i < TEST_WRITES; i++) {
+
+        unsigned char* current = pcm;
+        for (int j = 0; j < TEST_FRAMES; j++, frame++) {
+            int phase = frame % TEST_PERIOD;
+            int sample = 256 * (phase < TEST_PERIOD / 2 ?
+                    phase : TEST_PERIOD - phase) - 6400;
+            for (int channel = 0; channel < TEST_CHANNELS; channel++) {
+                *(current++) = sample & 0xFF;
+                *(current++) = (sample >> 8) & 0xFF;
+            }
+        }
+
+        guac_audio_stream_write_pcm(audio, pcm, sizeof(pcm));
+        guac_audio_stream_flush(audio);
+
+    }
+
+    guac_audio_stream_free(audio);
+    guac_socket_flush(client->socket);
+
+    char* contents = read_all(file);
+
+    /* Stream must be declared exactly once and ended exactly once */
+    CU_ASSERT_EQUAL(count(contents, "9.audio/ogg;"), 1);
+    CU_ASSERT_EQUAL(count(contents, "3.end,"), 1);
+
+    /* Headers plus one second of encoded audio must span several blobs, all
+     * smaller than the equivalent raw PCM */
+    CU_ASSERT(count(contents, "4.blob,") > 2);
+    CU_ASSERT(strlen(contents) < sizeof(pcm) * TEST_WRITES);
+
+    free(contents);
+    guac_client_free(client);
+    fclose(file);
+
+}
+
+/**
+ * Test which verifies that the Ogg Vorbis encoder is not assigned to an audio
+ * stream whose PCM format cannot be encoded, and that no stream is declared
+ * in that case.
+ */
+void test_audio__ogg_unsupported() {
+
+    FILE* file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    redirect_client(client, file);
+
+    /* A sample rate of zero is rejected by the Vorbis encoder */
+    guac_audio_stream* audio = guac_audio_stream_alloc(client, ogg_encoder,
+            0, TEST_CHANNELS, 16);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(audio);
+    CU_ASSERT_PTR_NULL(audio->encoder);
+
+    guac_audio_stream_free(audio);
+    guac_socket_flush(client->socket);
+
+    struct stat file_stat;
+    CU_ASSERT_EQUAL_FATAL(fstat(fileno(file), &file_stat), 0);
+    CU_ASSERT_EQUAL(file_stat.st_size, 0);
+
+    guac_client_free(client);
+    fclose(file);
+
+}
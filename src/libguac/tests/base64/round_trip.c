@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "base64.h"
+
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The largest amount of data to test, in bytes. This must be large enough
+ * to exercise every vectorized code path, including the handling of partial
+ * blocks.
+ */
+#define TEST_MAX_LENGTH 256
+
+/**
+ * Fills the given buffer with data that depends on the given seed, such that
+ * every possible byte value is eventually covered.
+ *
+ * @param data
+ *     The buffer to fill.
+ *
+ * @param length
+ *     The number of bytes to write to the buffer.
+ *
+ * @param seed
+ *     Arbitrary value controlling the data produced.
+ */
+static void fill_data(unsigned char* data, int length, int seed) {
+    for (int i = 0; i < length; i++)
+        data[i] = (unsigned char) (i * 131 + seed * 17 + (i >> 3) * seed);
+}
+
+/**
+ * Test which verifies that the encoded form of data of every length up to
+ * TEST_MAX_LENGTH matches that produced by the scalar implementation, and
+ * that decoding that encoded form produces the original data.
+ */
+void test_base64__round_trip() {
+
+    unsigned char data[TEST_MAX_LENGTH];
+    char expected[GUAC_BASE64_ENCODED_LENGTH(TEST_MAX_LENGTH) + 1];
+    char encoded[GUAC_BASE64_ENCODED_LENGTH(TEST_MAX_LENGTH) + 1];
+
+    for (int seed = 0; seed < 8; seed++) {
+        for (int length = 0; length <= TEST_MAX_LENGTH; length++) {
+
+            fill_data(data, length, seed);
+
+            size_t expected_length = guac_base64_encode_scalar(data, length,
+                    expected);
+            size_t encoded_length = guac_base64_encode(data, length, encoded);
+
+            CU_ASSERT_EQUAL_FATAL(expected_length,
+                    GUAC_BASE64_ENCODED_LENGTH(length));
+            CU_ASSERT_EQUAL_FATAL(encoded_length, expected_length);
+            CU_ASSERT_FATAL(memcmp(encoded, expected, encoded_length) == 0);
+
+            /* Decoding must restore the original data */
+            encoded[encoded_length] = '\0';
+            CU_ASSERT_EQUAL_FATAL(guac_base64_decode(encoded), length);
+            CU_ASSERT_FATAL(memcmp(encoded, data, length) == 0);
+
+            /* Decoding must not depend on implementation */
+            expected[expected_length] = '\0';
+            CU_ASSERT_EQUAL_FATAL(guac_base64_decode_scalar(expected), length);
+            CU_ASSERT_FATAL(memcmp(expected, data, length) == 0);
+
+        }
+    }
+
+}
+
+/**
+ * Test which verifies that every possible 6-bit value is encoded to the
+ * expected character and decoded back again.
+ */
+void test_base64__alphabet() {
+
+    const char* alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    /* 48 bytes containing each 6-bit value in order */
+    unsigned char data[48];
+    for (int i = 0; i < 16; i++) {
+        int a = i * 4, b = a + 1, c = a + 2, d = a + 3;
+        data[i * 3    ] = (a << 2) | (b >> 4);
+        data[i * 3 + 1] = ((b & 0x0F) << 4) | (c >> 2);
+        data[i * 3 + 2] = ((c & 0x03) << 6) | d;
+    }
+
+    char encoded[65];
+    CU_ASSERT_EQUAL_FATAL(guac_base64_encode(data, sizeof(data), encoded), 64);
+    CU_ASSERT_NSTRING_EQUAL(encoded, alphabet, 64);
+
+    encoded[64] = '\0';
+    CU_ASSERT_EQUAL_FATAL(guac_base64_decode(encoded), 48);
+    CU_ASSERT(memcmp(encoded, data, sizeof(data)) == 0);
+
+}
+
+/**
+ * Test which verifies that decoding stops at padding regardless of its
+ * position, and that characters outside the base64 alphabet are decoded
+ * identically by all implementations.
+ */
+void test_base64__decode_invalid() {
+
+    char input[TEST_MAX_LENGTH + 1];
+    char expected[TEST_MAX_LENGTH + 1];
+
+    /* Insert an unusual character at every position of a long string */
+    const char unusual[] = { '=', '-', '_', ' ', '\n', '\x80', '\xFF' };
+    for (int u = 0; u < (int) sizeof(unusual); u++) {
+        for (int position = 0; position < TEST_MAX_LENGTH; position++) {
+
+            for (int i = 0; i < TEST_MAX_LENGTH; i++)
+                input[i] = "QUJDREVGR0hJSktMTU5PUFFSU1RVVldY"[i % 32];
+
+            input[position] = unusual[u];
+            input[TEST_MAX_LENGTH] = '\0';
+            memcpy(expected, input, sizeof(input));
+
+            int expected_length = guac_base64_decode_scalar(expected);
+            CU_ASSERT_EQUAL_FATAL(guac_base64_decode(input), expected_length);
+            CU_ASSERT_FATAL(memcmp(input, expected, expected_length) == 0);
+
+            /* Padding must terminate decoding */
+            if (unusual[u] == '=')
+                CU_ASSERT_EQUAL_FATAL(expected_length, position * 6 / 8);
+
+        }
+    }
+
+}
+
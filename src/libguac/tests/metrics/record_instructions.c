@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/metrics.h>
+#include <guacamole/protocol.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Returns the number of instructions having the given opcode which have been
+ * counted within the given guac_metrics.
+ *
+ * @param metrics
+ *     The guac_metrics to search.
+ *
+ * @param opcode
+ *     The opcode to look for.
+ *
+ * @return
+ *     The number of instructions counted having the given opcode, or zero if
+ *     no such instructions have been counted.
+ */
+static uint64_t get_instruction_count(guac_metrics* metrics,
+        const char* opcode) {
+
+    for (int i = 0; i < GUAC_METRICS_MAX_OPCODES; i++) {
+
+        guac_metrics_opcode* slot = &(metrics->opcodes[i]);
+
+        if (slot->state == GUAC_METRICS_SLOT_READY
+                && strcmp(slot->opcode, opcode) == 0)
+            return slot->instructions;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Test which verifies that instructions and frames sent by a guac_client are
+ * counted within the guac_metrics assigned with guac_client_set_metrics(),
+ * including logical frames that were combined into a single frame.
+ */
+void test_metrics__record_instructions() {
+
+    guac_metrics* metrics = malloc(sizeof(guac_metrics));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(metrics);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    guac_metrics_init(metrics, client->connection_id, "test");
+    guac_client_set_metrics(client, metrics);
+
+    CU_ASSERT_STRING_EQUAL(metrics->connection_id, client->connection_id);
+    CU_ASSERT_STRING_EQUAL(metrics->protocol, "test");
+
+    /* Send a few instructions to all (zero) users */
+    for (int i = 0; i < 5; i++)
+        CU_ASSERT_FALSE(guac_protocol_send_nop(client->socket));
+
+    CU_ASSERT_FALSE(guac_protocol_send_name(client->socket, "metrics"));
+
+    /* Send one frame which combines three logical frames */
+    CU_ASSERT_FALSE(guac_client_end_multiple_frames(client, 3));
+
+    CU_ASSERT_EQUAL(get_instruction_count(metrics, "nop"), 5);
+    CU_ASSERT_EQUAL(get_instruction_count(metrics, "name"), 1);
+    CU_ASSERT_EQUAL(get_instruction_count(metrics, "sync"), 1);
+    CU_ASSERT_EQUAL(get_instruction_count(metrics, "img"), 0);
+
+    CU_ASSERT_EQUAL(metrics->frames, 1);
+    CU_ASSERT_EQUAL(metrics->dropped_frames, 2);
+
+    guac_client_free(client);
+    free(metrics);
+
+}
+
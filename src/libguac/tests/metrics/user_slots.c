@@ -0,0 +1,76 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/metrics.h>
+
+#include <stdlib.h>
+
+/**
+ * Test which verifies that per-user slots within guac_metrics are claimed
+ * until exhausted, that released slots are reused, and that per-user counters
+ * are reset whenever a slot is claimed.
+ */
+void test_metrics__user_slots() {
+
+    guac_metrics_user* users[GUAC_METRICS_MAX_USERS];
+
+    guac_metrics* metrics = malloc(sizeof(guac_metrics));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(metrics);
+
+    guac_metrics_init(metrics, "$connection", "test");
+
+    /* Claim all available slots */
+    for (int i = 0; i < GUAC_METRICS_MAX_USERS; i++) {
+        users[i] = guac_metrics_add_user(metrics, "@user");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(users[i]);
+        CU_ASSERT_STRING_EQUAL(users[i]->user_id, "@user");
+    }
+
+    /* No further users can be tracked */
+    CU_ASSERT_PTR_NULL(guac_metrics_add_user(metrics, "@extra"));
+
+    /* Record activity for a user, including a frame they acknowledge */
+    guac_metrics_record_frame(metrics, 1);
+    guac_metrics_record_frame(metrics, 1);
+    guac_metrics_record_bytes(users[3], 1024);
+    guac_metrics_record_sync(users[3], 50, 10);
+
+    CU_ASSERT_EQUAL(users[3]->bytes_sent, 1024);
+    CU_ASSERT_EQUAL(users[3]->acknowledged_frames, 1);
+    CU_ASSERT_EQUAL(users[3]->round_trip_time, 50);
+    CU_ASSERT_EQUAL(users[3]->processing_lag, 10);
+
+    /* A released slot is reused with counters reset, considering all frames
+     * sent prior to joining as already acknowledged */
+    guac_metrics_remove_user(users[3]);
+    CU_ASSERT_EQUAL(users[3]->state, GUAC_METRICS_SLOT_FREE);
+
+    guac_metrics_user* user = guac_metrics_add_user(metrics, "@replacement");
+    CU_ASSERT_PTR_EQUAL(user, users[3]);
+    CU_ASSERT_STRING_EQUAL(user->user_id, "@replacement");
+    CU_ASSERT_EQUAL(user->bytes_sent, 0);
+    CU_ASSERT_EQUAL(user->acknowledged_frames, 2);
+    CU_ASSERT_EQUAL(user->round_trip_time, 0);
+    CU_ASSERT_EQUAL(user->processing_lag, 0);
+
+    free(metrics);
+
+}
+
@@ -0,0 +1,190 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Test string which contains exactly four Unicode characters encoded in UTF-8.
+ * This particular test string uses several characters which encode to multiple
+ * bytes in UTF-8.
+ */
+#define UTF8_4 "\xe7\x8a\xac\xf0\x90\xac\x80z\xc3\xa1"
+
+/**
+ * The number of ASCII elements within the large instruction written by
+ * write_instructions(). Each element is GUAC_INSTRUCTION_MAX_LENGTH
+ * characters long, such that the instruction as a whole is far larger than
+ * GUAC_INSTRUCTION_BUFFER_SIZE.
+ */
+#define LARGE_ELEMENTS 64
+
+/**
+ * Writes all bytes within the given buffer to the given file descriptor,
+ * stopping early only if a write fails.
+ *
+ * @param fd
+ *     The file descriptor to write to.
+ *
+ * @param buffer
+ *     The data to write.
+ *
+ * @param length
+ *     The number of bytes of data to write.
+ */
+static void write_all(int fd, const char* buffer, int length) {
+
+    while (length > 0) {
+
+        /* Bail out immediately if write fails (test will fail in parent
+         * process due to failure to read) */
+        int written = write(fd, buffer, length);
+        if (written <= 0)
+            break;
+
+        buffer += written;
+        length -= written;
+
+    }
+
+}
+
+/**
+ * Writes a Guacamole instruction larger than GUAC_INSTRUCTION_BUFFER_SIZE,
+ * including a maximum-length element consisting entirely of multibyte UTF-8
+ * characters, followed by a small instruction, as raw bytes to the given file
+ * descriptor. The instructions written correspond to the instructions
+ * verified by read_expected_instructions(). The given file descriptor is
+ * automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write instructions to.
+ */
+static void write_instructions(int fd) {
+
+    char element[GUAC_INSTRUCTION_MAX_LENGTH];
+    memset(element, 'A', sizeof(element));
+
+    write_all(fd, "5.large", 7);
+
+    /* Write maximum-length ASCII elements */
+    for (int i = 0; i < LARGE_ELEMENTS; i++) {
+        write_all(fd, ",8192.", 6);
+        write_all(fd, element, sizeof(element));
+    }
+
+    /* Write maximum-length element of multibyte characters */
+    write_all(fd, ",8192.", 6);
+    for (int i = 0; i < GUAC_INSTRUCTION_MAX_LENGTH / 4; i++)
+        write_all(fd, UTF8_4, sizeof(UTF8_4) - 1);
+
+    write_all(fd, ";5.small,2.ok;", 14);
+
+    /* Done writing */
+    close(fd);
+
+}
+
+/**
+ * Reads and parses instructions from the given file descriptor using a
+ * guac_socket and guac_parser, verifying that those instructions match the
+ * Guacamole instructions expected to be written by write_instructions(). The
+ * given file descriptor is automatically closed as a result of calling this
+ * function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_instructions(int fd) {
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    /* Allocate parser */
+    guac_parser* parser = guac_parser_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(parser);
+
+    /* Read and validate large instruction */
+    CU_ASSERT_EQUAL_FATAL(guac_parser_read(parser, socket, 1000000), 0);
+    CU_ASSERT_STRING_EQUAL(parser->opcode, "large");
+    CU_ASSERT_EQUAL_FATAL(parser->argc, LARGE_ELEMENTS + 1);
+
+    for (int i = 0; i < LARGE_ELEMENTS; i++) {
+        CU_ASSERT_EQUAL(strlen(parser->argv[i]), GUAC_INSTRUCTION_MAX_LENGTH);
+        CU_ASSERT_EQUAL(strspn(parser->argv[i], "A"),
+                GUAC_INSTRUCTION_MAX_LENGTH);
+    }
+
+    /* Each group of four characters is encoded with ten bytes */
+    char* utf8_element = parser->argv[LARGE_ELEMENTS];
+    CU_ASSERT_EQUAL_FATAL(strlen(utf8_element),
+            GUAC_INSTRUCTION_MAX_LENGTH / 4 * (sizeof(UTF8_4) - 1));
+    CU_ASSERT_EQUAL(memcmp(utf8_element, UTF8_4, sizeof(UTF8_4) - 1), 0);
+
+    /* Read and validate following instruction */
+    CU_ASSERT_EQUAL_FATAL(guac_parser_read(parser, socket, 1000000), 0);
+    CU_ASSERT_STRING_EQUAL(parser->opcode, "small");
+    CU_ASSERT_EQUAL_FATAL(parser->argc, 1);
+    CU_ASSERT_STRING_EQUAL(parser->argv[0], "ok");
+
+    /* Done */
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Tests that guac_parser_read() correctly reads and parses instructions
+ * which are larger than the parser's statically-allocated instruction
+ * buffer. A child process is forked to write the instructions which are
+ * read and verified by the parent process.
+ */
+void test_parser__read_large() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write the instructions within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_instructions(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected instructions within the parent process */
+    close(write_fd);
+    read_expected_instructions(read_fd);
+
+}
+
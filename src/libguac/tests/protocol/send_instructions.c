@@ -0,0 +1,185 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Test string which contains exactly four Unicode characters encoded in UTF-8.
+ * This particular test string uses several characters which encode to multiple
+ * bytes in UTF-8.
+ */
+#define UTF8_4 "\xe7\x8a\xac\xf0\x90\xac\x80z\xc3\xa1"
+
+/**
+ * The number of bytes of data sent within the large blob instruction written
+ * by write_instructions(). This is chosen such that the resulting instruction
+ * cannot be built entirely within statically-allocated storage.
+ */
+#define LARGE_BLOB_LENGTH 7500
+
+/**
+ * Writes a series of Guacamole instructions covering each type of instruction
+ * element using a normal guac_socket wrapping the given file descriptor. The
+ * instructions written correspond to the instructions verified by
+ * read_expected_instructions(). The given file descriptor is automatically
+ * closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write instructions to.
+ */
+static void write_instructions(int fd) {
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    guac_layer layer = { .index = -1 };
+    guac_stream stream = { .index = 3 };
+
+    const char* args[] = { "hostname", "x" UTF8_4, "", NULL };
+
+    /* Blob data which encodes to a long series of "A" characters */
+    char* blob = calloc(1, LARGE_BLOB_LENGTH);
+
+    /* Write instructions */
+    guac_protocol_send_rect(socket, &layer, -5, 0, 1024, 768);
+    guac_protocol_send_distort(socket, &layer, 1.5, 0, 0, 1, -2.25, 0.1);
+    guac_protocol_send_key(socket, 65307, 1, 1234567890123LL);
+    guac_protocol_send_args(socket, args);
+    guac_protocol_send_blob(socket, &stream, "guacamole", 9);
+    guac_protocol_send_blob(socket, &stream, blob, LARGE_BLOB_LENGTH);
+    guac_protocol_send_sync(socket, 12345, 1);
+    guac_socket_flush(socket);
+
+    /* Close and free socket */
+    guac_socket_free(socket);
+    free(blob);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes represent the series of Guacamole
+ * instructions expected to be written by write_instructions(). The given
+ * file descriptor is automatically closed as a result of calling this
+ * function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_instructions(int fd) {
+
+    char expected_start[] =
+        "4.rect,2.-1,2.-5,1.0,4.1024,3.768;"
+        "7.distort,2.-1,3.1.5,1.0,1.0,1.1,5.-2.25,3.0.1;"
+        "3.key,5.65307,1.1,13.1234567890123;"
+        "4.args,13.VERSION_1_5_0,8.hostname,5.x" UTF8_4 ",0.;"
+        "4.blob,1.3,12.Z3VhY2Ftb2xl;"
+        "4.blob,1.3,10000.";
+
+    char expected_end[] = ";4.sync,5.12345,1.1;";
+
+    /* The large blob is entirely "A" characters once encoded */
+    size_t expected_length = strlen(expected_start) + 10000
+                           + strlen(expected_end);
+
+    int numread;
+    char* buffer = malloc(expected_length + 1024);
+    size_t offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(buffer[offset]),
+                    expected_length + 1024 - offset)) > 0) {
+        offset += numread;
+    }
+
+    /* Verify length of read data */
+    CU_ASSERT_EQUAL_FATAL(offset, expected_length);
+
+    /* Verify leading instructions */
+    CU_ASSERT_EQUAL(memcmp(buffer, expected_start,
+                strlen(expected_start)), 0);
+
+    /* Verify contents of large blob */
+    for (int i = 0; i < 10000; i++) {
+        if (buffer[strlen(expected_start) + i] != 'A') {
+            CU_FAIL("Large blob contains unexpected base64 data");
+            break;
+        }
+    }
+
+    /* Verify trailing instructions */
+    CU_ASSERT_EQUAL(memcmp(buffer + expected_length - strlen(expected_end),
+                expected_end, strlen(expected_end)), 0);
+
+    /* File descriptor is no longer needed */
+    free(buffer);
+    close(fd);
+
+}
+
+/**
+ * Tests that each element type within Guacamole instructions (integers,
+ * floating-point values, strings, arrays and base64 data) is properly
+ * formatted by the guac_protocol_send_*() functions, including instructions
+ * too large to be built within statically-allocated storage. A child process
+ * is forked to write a series of instructions which are read and verified by
+ * the parent process.
+ */
+void test_protocol__send_instructions() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write a series of instructions within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_instructions(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected instructions within the parent process */
+    close(write_fd);
+    read_expected_instructions(read_fd);
+
+}
+
@@ -0,0 +1,179 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/**
+ * The number of times each instruction is repeated by write_instructions().
+ */
+#define REPEAT_COUNT 1000
+
+/**
+ * The data expected to be written by each repetition of the instructions
+ * written by write_instructions().
+ */
+#define EXPECTED_INSTRUCTIONS "4.name,9.guacamole;4.sync,5.12345,1.1;"
+
+/**
+ * Writes a highly-repetitive series of Guacamole instructions using a
+ * compressing guac_socket wrapping another guac_socket which writes to the
+ * given file descriptor. The instructions written correspond to the
+ * instructions verified by read_expected_instructions(). The given file
+ * descriptor is automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write instructions to.
+ */
+static void write_instructions(int fd) {
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    /* Compress socket */
+    guac_socket* compressed_socket = guac_socket_deflate(socket);
+
+    /* Write nothing if compressed socket cannot be allocated (test will fail
+     * in parent process due to failure to read) */
+    if (compressed_socket == NULL) {
+        guac_socket_free(socket);
+        return;
+    }
+
+    /* Write instructions */
+    for (int i = 0; i < REPEAT_COUNT; i++) {
+        guac_protocol_send_name(compressed_socket, "guacamole");
+        guac_protocol_send_sync(compressed_socket, 12345, 1);
+        guac_socket_flush(compressed_socket);
+    }
+
+    /* Close and free sockets */
+    guac_socket_free(compressed_socket);
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes are a complete zlib stream which
+ * decompresses to the series of Guacamole instructions expected to be
+ * written by write_instructions(), and that the stream is significantly
+ * smaller than the uncompressed instructions. The given file descriptor is
+ * automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_instructions(int fd) {
+
+    int expected_length = strlen(EXPECTED_INSTRUCTIONS) * REPEAT_COUNT;
+
+    int numread;
+    unsigned char* compressed = malloc(expected_length);
+    int offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(compressed[offset]),
+                    expected_length - offset)) > 0) {
+        offset += numread;
+    }
+
+    /* Verify data was actually compressed */
+    CU_ASSERT_FATAL(offset > 0);
+    CU_ASSERT(offset < expected_length / 3);
+
+    /* Decompress everything read */
+    char* buffer = malloc(expected_length + 1);
+
+    z_stream stream = { 0 };
+    CU_ASSERT_EQUAL_FATAL(inflateInit(&stream), Z_OK);
+
+    stream.next_in = compressed;
+    stream.avail_in = offset;
+    stream.next_out = (unsigned char*) buffer;
+    stream.avail_out = expected_length + 1;
+
+    /* The entire stream should decompress to the expected length */
+    CU_ASSERT_EQUAL(inflate(&stream, Z_FINISH), Z_STREAM_END);
+    CU_ASSERT_EQUAL_FATAL(stream.total_out, expected_length);
+    inflateEnd(&stream);
+
+    /* Each repetition should be identical to the expected instructions */
+    for (int i = 0; i < REPEAT_COUNT; i++) {
+        int length = strlen(EXPECTED_INSTRUCTIONS);
+        if (memcmp(buffer + i * length, EXPECTED_INSTRUCTIONS, length)) {
+            CU_FAIL("Decompressed data does not match written data");
+            break;
+        }
+    }
+
+    /* File descriptor is no longer needed */
+    free(buffer);
+    free(compressed);
+    close(fd);
+
+}
+
+/**
+ * Tests that the compressing implementation of guac_socket properly
+ * compresses written instructions into a single zlib stream, flushing that
+ * stream such that it remains decompressible. A child process is forked to
+ * write a series of instructions which are read and verified by the parent
+ * process.
+ */
+void test_socket__deflate_send_instruction() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write a series of instructions within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_instructions(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected instructions within the parent process */
+    close(write_fd);
+    read_expected_instructions(read_fd);
+
+}
+
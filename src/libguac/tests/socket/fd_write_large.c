@@ -0,0 +1,164 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The size of the large write performed by write_data(), in bytes. This is
+ * chosen to be significantly larger than both the output buffer of the
+ * guac_socket and the buffer of a typical pipe, such that the data must be
+ * written in several partial writes.
+ */
+#define LARGE_WRITE_LENGTH (1024 * 1024)
+
+/**
+ * Returns the byte expected at the given offset within the large write
+ * performed by write_data().
+ *
+ * @param offset
+ *     The offset of the byte within the large write.
+ *
+ * @return
+ *     The byte expected at the given offset.
+ */
+static char large_write_byte(int offset) {
+    return 'A' + (offset * 7 + offset / 4096) % 26;
+}
+
+/**
+ * Writes a small amount of data, followed by a single write of
+ * LARGE_WRITE_LENGTH bytes, followed by another small amount of data, using a
+ * normal guac_socket wrapping the given file descriptor. The data written
+ * corresponds to the data verified by read_expected_data(). The given file
+ * descriptor is automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write data to.
+ */
+static void write_data(int fd) {
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    char* large = malloc(LARGE_WRITE_LENGTH);
+    for (int i = 0; i < LARGE_WRITE_LENGTH; i++)
+        large[i] = large_write_byte(i);
+
+    /* Write data surrounding large write */
+    guac_socket_write_string(socket, "start;");
+    guac_socket_write(socket, large, LARGE_WRITE_LENGTH);
+    guac_socket_write_string(socket, "end;");
+    guac_socket_flush(socket);
+
+    /* Close and free socket */
+    guac_socket_free(socket);
+    free(large);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes are exactly the bytes expected to be
+ * written by write_data(), in order. The given file descriptor is
+ * automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_data(int fd) {
+
+    int expected_length = LARGE_WRITE_LENGTH + strlen("start;end;");
+
+    int numread;
+    char* buffer = malloc(expected_length + 1024);
+    int offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(buffer[offset]),
+                    expected_length + 1024 - offset)) > 0) {
+        offset += numread;
+    }
+
+    /* Verify length of read data */
+    CU_ASSERT_EQUAL_FATAL(offset, expected_length);
+
+    /* Verify data surrounding large write */
+    CU_ASSERT_EQUAL(memcmp(buffer, "start;", 6), 0);
+    CU_ASSERT_EQUAL(memcmp(buffer + expected_length - 4, "end;", 4), 0);
+
+    /* Verify large write */
+    for (int i = 0; i < LARGE_WRITE_LENGTH; i++) {
+        if (buffer[6 + i] != large_write_byte(i)) {
+            CU_FAIL("Large write was not received intact");
+            break;
+        }
+    }
+
+    /* File descriptor is no longer needed */
+    free(buffer);
+    close(fd);
+
+}
+
+/**
+ * Tests that the file descriptor implementation of guac_socket properly
+ * handles writes which are larger than its internal buffer, including when
+ * the underlying file descriptor accepts only part of the data at a time. A
+ * child process is forked to write the data, which is read and verified by
+ * the parent process.
+ */
+void test_socket__fd_write_large() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write data within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_data(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected data within the parent process */
+    close(write_fd);
+    read_expected_data(read_fd);
+
+}
+
@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include "guacamole/client.h"
+#include "guacamole/metrics.h"
 #include "guacamole/object.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
@@ -65,6 +66,7 @@ __guac_instruction_handler_mapping __guac_handshake_handler_map[] = {
     {"image",    __guac_handshake_image_handler},
     {"timezone", __guac_handshake_timezone_handler},
     {"name",     __guac_handshake_name_handler},
+    {"compress", __guac_handshake_compress_handler},
     {NULL,       NULL}
 };
 
@@ -147,6 +149,11 @@ int __guac_handle_sync(guac_user* user, int argc, char** argv) {
 
         user->processing_lag = processing_lag;
 
+        /* Record acknowledgement of frame in metrics */
+        if (user->metrics != NULL)
+            guac_metrics_record_sync(user->metrics, estimated_rtt,
+                    processing_lag);
+
     }
 
     /* Log received timestamp and calculated lag (at TRACE level only) */
@@ -718,6 +725,19 @@ int __guac_handshake_timezone_handler(guac_user* user, int argc, char** argv) {
     
 }
 
+int __guac_handshake_compress_handler(guac_user* user, int argc,
+        char** argv) {
+
+    guac_free_mimetypes((char **) user->compression_methods);
+
+    /* Store compression methods */
+    user->compression_methods =
+        (const char**) guac_copy_mimetypes(argv, argc);
+
+    return 0;
+
+}
+
 char** guac_copy_mimetypes(char** mimetypes, int count) {
 
     int i;
@@ -232,6 +232,13 @@ __guac_instruction_handler __guac_handshake_name_handler;
  */
 __guac_instruction_handler __guac_handshake_timezone_handler;
 
+/**
+ * Internal handler function that is called when the compress instruction is
+ * received during the handshake process, specifying the compression methods
+ * supported by the client.
+ */
+__guac_instruction_handler __guac_handshake_compress_handler;
+
 /**
  * Instruction handler mapping table. This is a NULL-terminated array of
  * __guac_instruction_handler_mapping structures, each mapping an opcode
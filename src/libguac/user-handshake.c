@@ -21,6 +21,7 @@
 
 #include "guacamole/client.h"
 #include "guacamole/error.h"
+#include "guacamole/metrics.h"
 #include "guacamole/parser.h"
 #include "guacamole/protocol.h"
 #include "guacamole/socket.h"
@@ -288,6 +289,36 @@ static int __guac_user_handshake(guac_user* user, guac_parser* parser,
     return 1;
 }
 
+/**
+ * Returns whether the given user declared support for the given compression
+ * method during the handshake.
+ *
+ * @param user
+ *     The user to check.
+ *
+ * @param method
+ *     The compression method to look for, such as "deflate".
+ *
+ * @return
+ *     Non-zero if the given user supports the given compression method, zero
+ *     otherwise.
+ */
+static int guac_user_supports_compression(guac_user* user,
+        const char* method) {
+
+    const char** current = user->compression_methods;
+    if (current == NULL)
+        return 0;
+
+    for (; *current != NULL; current++) {
+        if (strcmp(*current, method) == 0)
+            return 1;
+    }
+
+    return 0;
+
+}
+
 int guac_user_handle_connection(guac_user* user, int usec_timeout) {
 
     guac_socket* socket = user->socket;
@@ -298,6 +329,11 @@ int guac_user_handle_connection(guac_user* user, int usec_timeout) {
     user->info.video_mimetypes = NULL;
     user->info.name = NULL;
     user->info.timezone = NULL;
+    user->compression_methods = NULL;
+
+    /* Socket compressing all data sent to the user, if compression has been
+     * negotiated */
+    guac_socket* compressed_socket = NULL;
     
     /* Count number of arguments. */
     int num_args;
@@ -334,6 +370,40 @@ int guac_user_handle_connection(guac_user* user, int usec_timeout) {
         return 1;
     }
     
+    /* Compress all further data sent to the user if the user supports
+     * compression, confirming this with an uncompressed "compress"
+     * instruction. This must occur before the user is added to the connection
+     * and thus able to receive broadcast data. */
+    if (guac_user_supports_compression(user, "deflate")) {
+
+        compressed_socket = guac_socket_deflate(socket);
+        if (compressed_socket != NULL) {
+
+            guac_protocol_send_compress(socket, "deflate");
+            guac_socket_flush(socket);
+
+            user->socket = compressed_socket;
+            guac_client_log(client, GUAC_LOG_DEBUG, "Compressing all data "
+                    "sent to user \"%s\" using deflate.", user->user_id);
+
+        }
+
+        else
+            guac_client_log(client, GUAC_LOG_WARNING, "Unable to compress "
+                    "data sent to user \"%s\": %s", user->user_id,
+                    guac_status_string(guac_error));
+
+    }
+
+    /* Record metrics for the user if recording metrics for the connection,
+     * counting all bytes written to the underlying (possibly compressed)
+     * socket and all instructions written specifically to this user */
+    if (client->metrics != NULL) {
+        user->metrics = guac_metrics_add_user(client->metrics, user->user_id);
+        socket->user_metrics = user->metrics;
+        user->socket->metrics = client->metrics;
+    }
+
     /* Attempt to join user to connection. */
     if (guac_client_add_user(client, user, (parser->argc - 1), parser->argv + 1))
         guac_client_log(client, GUAC_LOG_ERROR, "User \"%s\" could NOT "
@@ -374,6 +444,23 @@ int guac_user_handle_connection(guac_user* user, int usec_timeout) {
     /* Free name and timezone info. */
     free((char *) user->info.name);
     free((char *) user->info.timezone);
+
+    /* Stop recording metrics for the user */
+    if (user->metrics != NULL) {
+        guac_metrics_remove_user(user->metrics);
+        socket->user_metrics = NULL;
+        user->metrics = NULL;
+    }
+
+    user->socket->metrics = NULL;
+
+    /* Terminate compression, if any, restoring the original socket */
+    if (compressed_socket != NULL) {
+        user->socket = socket;
+        guac_socket_free(compressed_socket);
+    }
+
+    guac_free_mimetypes((char **) user->compression_methods);
     
     guac_parser_free(parser);
 
@@ -26,6 +26,7 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
 
 void guac_kubernetes_receive_data(guac_client* client,
         const char* buffer, size_t length) {
@@ -54,6 +55,44 @@ void guac_kubernetes_receive_data(guac_client* client,
 
 }
 
+/**
+ * Waits until space is available within the outbound message buffer of the
+ * given Kubernetes client, or until the connection is closing. The outbound
+ * message lock must be held.
+ *
+ * @param client
+ *     The guac_client associated with the Kubernetes connection.
+ *
+ * @return
+ *     Zero if space is available within the outbound message buffer,
+ *     non-zero if the connection is closing.
+ */
+static int guac_kubernetes_wait_for_space(guac_client* client) {
+
+    guac_kubernetes_client* kubernetes_client =
+        (guac_kubernetes_client*) client->data;
+
+    while (kubernetes_client->outbound_messages_waiting
+            >= GUAC_KUBERNETES_MAX_OUTBOUND_MESSAGES) {
+
+        if (client->state != GUAC_CLIENT_RUNNING)
+            return 1;
+
+        /* Wake periodically to recheck connection state, in case the
+         * connection closes without the buffer being drained */
+        struct timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_sec += GUAC_KUBERNETES_SERVICE_INTERVAL / 1000;
+
+        pthread_cond_timedwait(&(kubernetes_client->outbound_message_sent),
+                &(kubernetes_client->outbound_message_lock), &timeout);
+
+    }
+
+    return 0;
+
+}
+
 void guac_kubernetes_send_message(guac_client* client,
         int channel, const char* data, int length) {
 
@@ -62,26 +101,64 @@ void guac_kubernetes_send_message(guac_client* client,
 
     pthread_mutex_lock(&(kubernetes_client->outbound_message_lock));
 
-    /* Add message to buffer if space is available */
-    if (kubernetes_client->outbound_messages_waiting
-            < GUAC_KUBERNETES_MAX_OUTBOUND_MESSAGES) {
+    while (length > 0) {
 
-        /* Calculate storage position of next message */
-        int index = (kubernetes_client->outbound_messages_top
-                  + kubernetes_client->outbound_messages_waiting)
-                  % GUAC_KUBERNETES_MAX_OUTBOUND_MESSAGES;
+        guac_kubernetes_message* message = NULL;
 
-        /* Obtain pointer to message slot at calculated position */
-        guac_kubernetes_message* message =
-            &(kubernetes_client->outbound_messages[index]);
+        /* Merge STDIN data into the newest waiting message, if that message
+         * is also STDIN and has room */
+        if (channel == GUAC_KUBERNETES_CHANNEL_STDIN
+                && kubernetes_client->outbound_messages_waiting > 0) {
+
+            int index = (kubernetes_client->outbound_messages_top
+                      + kubernetes_client->outbound_messages_waiting - 1)
+                      % GUAC_KUBERNETES_MAX_OUTBOUND_MESSAGES;
+
+            guac_kubernetes_message* newest =
+                &(kubernetes_client->outbound_messages[index]);
+
+            if (newest->channel == channel
+                    && newest->length < GUAC_KUBERNETES_MAX_MESSAGE_SIZE)
+                message = newest;
+
+        }
+
+        /* Otherwise, wait for an empty slot */
+        if (message == NULL) {
+
+            /* Drop data only if the connection is closing, as the buffer
+             * will never drain */
+            if (guac_kubernetes_wait_for_space(client)) {
+                guac_client_log(client, GUAC_LOG_DEBUG, "Connection closing. "
+                        "%i bytes of outbound data dropped.", length);
+                break;
+            }
+
+            /* Calculate storage position of next message */
+            int index = (kubernetes_client->outbound_messages_top
+                      + kubernetes_client->outbound_messages_waiting)
+                      % GUAC_KUBERNETES_MAX_OUTBOUND_MESSAGES;
 
-        /* Copy details of message into buffer */
-        message->channel = channel;
-        memcpy(message->data, data, length);
-        message->length = length;
+            /* Obtain pointer to message slot at calculated position */
+            message = &(kubernetes_client->outbound_messages[index]);
+            message->channel = channel;
+            message->length = 0;
 
-        /* One more message is now waiting */
-        kubernetes_client->outbound_messages_waiting++;
+            /* One more message is now waiting */
+            kubernetes_client->outbound_messages_waiting++;
+
+        }
+
+        /* Copy as much data as will fit into the message */
+        int block_size = GUAC_KUBERNETES_MAX_MESSAGE_SIZE - message->length;
+        if (block_size > length)
+            block_size = length;
+
+        memcpy(message->data + message->length, data, block_size);
+        message->length += block_size;
+
+        data += block_size;
+        length -= block_size;
 
         /* Notify libwebsockets that we need a callback to send pending
          * messages */
@@ -90,12 +167,6 @@ void guac_kubernetes_send_message(guac_client* client,
 
     }
 
-    /* Warn if data has to be dropped */
-    else
-        guac_client_log(client, GUAC_LOG_WARNING, "Send buffer could not be "
-                "flushed in time to handle additional data. Outbound "
-                "message dropped.");
-
     pthread_mutex_unlock(&(kubernetes_client->outbound_message_lock));
 
 }
@@ -108,7 +179,9 @@ bool guac_kubernetes_write_pending_message(guac_client* client) {
 
     pthread_mutex_lock(&(kubernetes_client->outbound_message_lock));
 
-    /* Send one message from top of buffer */
+    /* Send one message from top of buffer, as libwebsockets permits only one
+     * write per writable callback (consecutive STDIN data has already been
+     * merged into a single message by guac_kubernetes_send_message()) */
     if (kubernetes_client->outbound_messages_waiting > 0) {
 
         /* Obtain pointer to message at top */
@@ -131,6 +204,9 @@ bool guac_kubernetes_write_pending_message(guac_client* client) {
 
     }
 
+    /* Wake any senders waiting for space within the buffer */
+    pthread_cond_broadcast(&(kubernetes_client->outbound_message_sent));
+
     /* Record whether messages remained at time of completion */
     messages_remain = (kubernetes_client->outbound_messages_waiting > 0);
 
@@ -140,4 +216,3 @@ bool guac_kubernetes_write_pending_message(guac_client* client) {
 
 }
 
-
@@ -29,9 +29,10 @@
 /**
  * The maximum amount of data to include in any particular WebSocket message
  * to Kubernetes. This excludes the storage space required for the channel
- * index.
+ * index. Consecutive writes to STDIN are merged into messages of up to this
+ * size.
  */
-#define GUAC_KUBERNETES_MAX_MESSAGE_SIZE 1024
+#define GUAC_KUBERNETES_MAX_MESSAGE_SIZE 8192
 
 /**
  * The index of the Kubernetes channel used for STDIN.
@@ -103,9 +104,11 @@ void guac_kubernetes_receive_data(guac_client* client,
 /**
  * Requests that the given data be sent along the given channel to the
  * Kubernetes server when the WebSocket connection is next available for
- * writing. If the WebSocket connection has not been available for writing for
- * long enough that the outbound message buffer is full, the request to send
- * this particular message will be dropped.
+ * writing. Data sent along GUAC_KUBERNETES_CHANNEL_STDIN is appended to any
+ * STDIN message that is already waiting, such that consecutive writes are
+ * sent as a single message. If the outbound message buffer is full, this
+ * function blocks until space is available. Data is dropped only if the
+ * connection is closing.
  *
  * @param client
  *     The guac_client associated with the Kubernetes connection.
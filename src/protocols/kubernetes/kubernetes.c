@@ -334,6 +334,7 @@ void* guac_kubernetes_client_thread(void* data) {
 
     /* Init outbound message buffer */
     pthread_mutex_init(&(kubernetes_client->outbound_message_lock), NULL);
+    pthread_cond_init(&(kubernetes_client->outbound_message_sent), NULL);
 
     /* Start input thread */
     if (pthread_create(&(input_thread), NULL, guac_kubernetes_input_thread, (void*) client)) {
@@ -356,9 +357,15 @@ void* guac_kubernetes_client_thread(void* data) {
 
     }
 
-    /* Kill client and Wait for input thread to die */
+    /* Kill client and Wait for input thread to die, waking the input thread
+     * if it is waiting for the outbound message buffer to drain */
     guac_terminal_stop(kubernetes_client->term);
     guac_client_stop(client);
+
+    pthread_mutex_lock(&(kubernetes_client->outbound_message_lock));
+    pthread_cond_broadcast(&(kubernetes_client->outbound_message_sent));
+    pthread_mutex_unlock(&(kubernetes_client->outbound_message_lock));
+
     pthread_join(input_thread, NULL);
 
 fail:
@@ -39,8 +39,8 @@
 
 /**
  * The maximum number of messages to allow within the outbound message buffer.
- * If messages are sent despite the buffer being full, those messages will be
- * dropped.
+ * If messages are sent despite the buffer being full, the sender will block
+ * until space is available.
  */
 #define GUAC_KUBERNETES_MAX_OUTBOUND_MESSAGES 8
 
@@ -97,6 +97,13 @@ typedef struct guac_kubernetes_client {
      */
     pthread_mutex_t outbound_message_lock;
 
+    /**
+     * Condition which is signalled whenever messages are removed from the
+     * outbound message buffer, freeing space for senders that are waiting
+     * for the buffer to drain.
+     */
+    pthread_cond_t outbound_message_sent;
+
     /**
      * The Kubernetes client thread.
      */
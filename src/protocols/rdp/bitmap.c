@@ -18,6 +18,7 @@
  */
 
 #include "bitmap.h"
+#include "cache.h"
 #include "common/display.h"
 #include "common/surface.h"
 #include "config.h"
@@ -31,6 +32,29 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/**
+ * Evicts the cached image data of the guac_rdp_bitmap associated with the
+ * given cache entry, freeing the buffer containing that data. The bitmap will
+ * be cached again from its original image data if used again.
+ *
+ * @param cache
+ *     The cache from which the entry is being evicted.
+ *
+ * @param entry
+ *     The cache entry of the bitmap being evicted.
+ */
+static void guac_rdp_bitmap_evict(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) cache->client->data;
+    guac_rdp_bitmap* bitmap = (guac_rdp_bitmap*) entry->data;
+
+    guac_common_display_free_buffer(rdp_client->display, bitmap->layer);
+    bitmap->layer = NULL;
+
+}
 
 void guac_rdp_cache_bitmap(rdpContext* context, rdpBitmap* bitmap) {
 
@@ -41,6 +65,13 @@ void guac_rdp_cache_bitmap(rdpContext* context, rdpBitmap* bitmap) {
     guac_common_display_layer* buffer = guac_common_display_alloc_buffer(
             rdp_client->display, bitmap->width, bitmap->height);
 
+    /* Account for buffer within cache memory limit, evicting older bitmaps
+     * and glyphs if necessary */
+    guac_rdp_cache_add(rdp_client->cache,
+            &((guac_rdp_bitmap*) bitmap)->cache_entry,
+            (size_t) bitmap->width * bitmap->height * 4,
+            guac_rdp_bitmap_evict, bitmap);
+
     /* Cache image data if present */
     if (bitmap->data != NULL) {
 
@@ -70,6 +101,10 @@ BOOL guac_rdp_bitmap_new(rdpContext* context, rdpBitmap* bitmap) {
     /* Start at zero usage */
     ((guac_rdp_bitmap*) bitmap)->used = 0;
 
+    /* Not yet within cache */
+    memset(&((guac_rdp_bitmap*) bitmap)->cache_entry, 0,
+            sizeof(guac_rdp_cache_entry));
+
     return TRUE;
 
 }
@@ -84,6 +119,13 @@ BOOL guac_rdp_bitmap_paint(rdpContext* context, rdpBitmap* bitmap) {
     int width = bitmap->right - bitmap->left + 1;
     int height = bitmap->bottom - bitmap->top + 1;
 
+    /* Track cache efficiency */
+    if (buffer != NULL)
+        guac_rdp_cache_touch(rdp_client->cache,
+                &((guac_rdp_bitmap*) bitmap)->cache_entry);
+    else
+        guac_rdp_cache_miss(rdp_client->cache);
+
     /* If not cached, cache if necessary */
     if (buffer == NULL && ((guac_rdp_bitmap*) bitmap)->used >= 1)
         guac_rdp_cache_bitmap(context, bitmap);
@@ -125,8 +167,11 @@ void guac_rdp_bitmap_free(rdpContext* context, rdpBitmap* bitmap) {
     guac_common_display_layer* buffer = ((guac_rdp_bitmap*) bitmap)->layer;
 
     /* If cached, free buffer */
-    if (buffer != NULL)
+    if (buffer != NULL) {
+        guac_rdp_cache_remove(rdp_client->cache,
+                &((guac_rdp_bitmap*) bitmap)->cache_entry);
         guac_common_display_free_buffer(rdp_client->display, buffer);
+    }
 
 #ifndef FREERDP_BITMAP_FREE_FREES_BITMAP
     /* NOTE: Except in FreeRDP 2.0.0-rc0 and earlier, FreeRDP-allocated memory
@@ -159,6 +204,11 @@ BOOL guac_rdp_bitmap_setsurface(rdpContext* context, rdpBitmap* bitmap, BOOL pri
         if (((guac_rdp_bitmap*) bitmap)->layer == NULL)
             guac_rdp_cache_bitmap(context, bitmap);
 
+        /* Once drawn to, the contents of the bitmap can no longer be
+         * recreated from its original image data, and must not be evicted */
+        guac_rdp_cache_pin(rdp_client->cache,
+                &((guac_rdp_bitmap*) bitmap)->cache_entry);
+
         rdp_client->current_surface =
             ((guac_rdp_bitmap*) bitmap)->layer->surface;
 
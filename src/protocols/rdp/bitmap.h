@@ -20,6 +20,7 @@
 #ifndef GUAC_RDP_BITMAP_H
 #define GUAC_RDP_BITMAP_H
 
+#include "cache.h"
 #include "config.h"
 #include "common/display.h"
 
@@ -48,6 +49,12 @@ typedef struct guac_rdp_bitmap {
      */
     int used;
 
+    /**
+     * The memory usage of the cached image data within the layer, if any,
+     * as tracked by the bitmap/glyph cache of the RDP connection.
+     */
+    guac_rdp_cache_entry cache_entry;
+
 } guac_rdp_bitmap;
 
 /**
@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "cache.h"
+
+#include <guacamole/client.h>
+
+#include <stdlib.h>
+
+/**
+ * Removes the given entry from the least-recently-used list of the given
+ * cache. The entry continues to count towards the memory consumed by the
+ * cache. If the entry is not within the list, this function has no effect.
+ *
+ * @param cache
+ *     The cache containing the entry.
+ *
+ * @param entry
+ *     The entry to unlink.
+ */
+static void guac_rdp_cache_unlink(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry) {
+
+    /* Update previous element, if it exists */
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+
+    /* Otherwise update the list head, if the entry is the head */
+    else if (cache->head == entry)
+        cache->head = entry->next;
+
+    /* Update next element, if it exists */
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+
+    /* Otherwise update the list tail, if the entry is the tail */
+    else if (cache->tail == entry)
+        cache->tail = entry->prev;
+
+    entry->prev = NULL;
+    entry->next = NULL;
+
+}
+
+/**
+ * Inserts the given entry at the head of the least-recently-used list of the
+ * given cache, marking it as the most recently used entry. The entry must not
+ * already be within the list.
+ *
+ * @param cache
+ *     The cache to insert the entry into.
+ *
+ * @param entry
+ *     The entry to insert.
+ */
+static void guac_rdp_cache_link(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry) {
+
+    entry->prev = NULL;
+    entry->next = cache->head;
+
+    if (cache->head != NULL)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+
+    cache->head = entry;
+
+}
+
+guac_rdp_cache* guac_rdp_cache_alloc(guac_client* client, size_t limit) {
+
+    guac_rdp_cache* cache = calloc(1, sizeof(guac_rdp_cache));
+    cache->client = client;
+    cache->limit = limit;
+
+    return cache;
+
+}
+
+void guac_rdp_cache_free(guac_rdp_cache* cache) {
+
+    unsigned long total = cache->hits + cache->misses;
+
+    if (cache->client != NULL)
+        guac_client_log(cache->client, GUAC_LOG_DEBUG, "Bitmap/glyph cache: "
+                "%lu hits, %lu misses (%lu%% hit rate), %lu evictions.",
+                cache->hits, cache->misses,
+                total ? cache->hits * 100 / total : 0, cache->evictions);
+
+    free(cache);
+
+}
+
+void guac_rdp_cache_add(guac_rdp_cache* cache, guac_rdp_cache_entry* entry,
+        size_t size, guac_rdp_cache_evict_handler* evict, void* data) {
+
+    /* Replace any previous size of the entry */
+    guac_rdp_cache_remove(cache, entry);
+
+    entry->size = size;
+    entry->pinned = 0;
+    entry->evict = evict;
+    entry->data = data;
+
+    /* Evict least recently used entries until the new entry fits */
+    while (cache->limit != 0 && cache->tail != NULL
+            && cache->size + size > cache->limit) {
+
+        guac_rdp_cache_entry* evicted = cache->tail;
+        guac_rdp_cache_remove(cache, evicted);
+        cache->evictions++;
+
+        evicted->evict(cache, evicted);
+
+    }
+
+    cache->size += size;
+    entry->cached = 1;
+    guac_rdp_cache_link(cache, entry);
+
+}
+
+void guac_rdp_cache_remove(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry) {
+
+    /* Ignore entries not within the cache */
+    if (!entry->cached)
+        return;
+
+    guac_rdp_cache_unlink(cache, entry);
+
+    cache->size -= entry->size;
+    entry->cached = 0;
+    entry->pinned = 0;
+
+}
+
+void guac_rdp_cache_touch(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry) {
+
+    cache->hits++;
+
+    /* Pinned entries are not tracked for eviction */
+    if (!entry->cached || entry->pinned)
+        return;
+
+    /* Move to head of list */
+    guac_rdp_cache_unlink(cache, entry);
+    guac_rdp_cache_link(cache, entry);
+
+}
+
+void guac_rdp_cache_miss(guac_rdp_cache* cache) {
+    cache->misses++;
+}
+
+void guac_rdp_cache_pin(guac_rdp_cache* cache, guac_rdp_cache_entry* entry) {
+
+    /* Entries must be within the cache to be pinned */
+    if (!entry->cached || entry->pinned)
+        return;
+
+    guac_rdp_cache_unlink(cache, entry);
+    entry->pinned = 1;
+
+}
+
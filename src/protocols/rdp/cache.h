@@ -0,0 +1,257 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_RDP_CACHE_H
+#define GUAC_RDP_CACHE_H
+
+#include <guacamole/client.h>
+
+#include <stddef.h>
+
+/**
+ * The default maximum amount of memory which may be consumed by cached
+ * bitmaps and glyphs within a single RDP connection, in megabytes.
+ */
+#define GUAC_RDP_CACHE_DEFAULT_LIMIT 64
+
+typedef struct guac_rdp_cache guac_rdp_cache;
+
+typedef struct guac_rdp_cache_entry guac_rdp_cache_entry;
+
+/**
+ * Handler which is invoked when a cached object must be evicted to remain
+ * within the memory limit of the cache. The handler must release the memory
+ * represented by the given entry, such that the object will be recreated
+ * (and re-added to the cache) if needed again. The entry has already been
+ * removed from the cache when this handler is invoked.
+ *
+ * @param cache
+ *     The cache from which the entry is being evicted.
+ *
+ * @param entry
+ *     The entry being evicted.
+ */
+typedef void guac_rdp_cache_evict_handler(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry);
+
+/**
+ * An object whose memory usage is tracked by a guac_rdp_cache. Each entry is
+ * expected to be embedded within the structure of the object it represents,
+ * such as a guac_rdp_bitmap or guac_rdp_glyph.
+ */
+struct guac_rdp_cache_entry {
+
+    /**
+     * Non-zero if this entry is currently within the cache, zero otherwise.
+     */
+    int cached;
+
+    /**
+     * The number of bytes of memory consumed by the cached object.
+     */
+    size_t size;
+
+    /**
+     * Non-zero if this entry may not be evicted, zero otherwise. Pinned
+     * entries still count towards the memory used by the cache.
+     */
+    int pinned;
+
+    /**
+     * The handler to invoke if this entry is evicted.
+     */
+    guac_rdp_cache_evict_handler* evict;
+
+    /**
+     * Arbitrary data associated with this entry, typically the cached object
+     * itself.
+     */
+    void* data;
+
+    /**
+     * The next most recently used entry, or NULL if this is the most recently
+     * used entry or the entry is not evictable.
+     */
+    guac_rdp_cache_entry* prev;
+
+    /**
+     * The next least recently used entry, or NULL if this is the least
+     * recently used entry or the entry is not evictable.
+     */
+    guac_rdp_cache_entry* next;
+
+};
+
+/**
+ * The memory budget of cached bitmaps and glyphs within an RDP connection.
+ * Evictable entries are tracked in least-recently-used order, with the least
+ * recently used entries evicted first whenever the total memory consumed
+ * would exceed the limit.
+ */
+struct guac_rdp_cache {
+
+    /**
+     * The client associated with the RDP connection using this cache.
+     */
+    guac_client* client;
+
+    /**
+     * The maximum number of bytes of memory which may be consumed by cached
+     * objects, or zero if there is no limit.
+     */
+    size_t limit;
+
+    /**
+     * The number of bytes of memory currently consumed by cached objects.
+     */
+    size_t size;
+
+    /**
+     * The most recently used evictable entry, or NULL if there are no
+     * evictable entries.
+     */
+    guac_rdp_cache_entry* head;
+
+    /**
+     * The least recently used evictable entry, or NULL if there are no
+     * evictable entries.
+     */
+    guac_rdp_cache_entry* tail;
+
+    /**
+     * The number of times a cached object was used while still cached.
+     */
+    unsigned long hits;
+
+    /**
+     * The number of times an object had to be drawn or recreated because it
+     * was not cached.
+     */
+    unsigned long misses;
+
+    /**
+     * The number of entries evicted to remain within the memory limit.
+     */
+    unsigned long evictions;
+
+};
+
+/**
+ * Allocates a new cache which will evict cached objects as necessary to
+ * remain within the given memory limit.
+ *
+ * @param client
+ *     The client associated with the RDP connection that will use the cache,
+ *     or NULL if cache statistics should not be logged when the cache is
+ *     freed.
+ *
+ * @param limit
+ *     The maximum number of bytes of memory which may be consumed by cached
+ *     objects, or zero if there is no limit.
+ *
+ * @return
+ *     A newly-allocated cache, which must eventually be freed with
+ *     guac_rdp_cache_free().
+ */
+guac_rdp_cache* guac_rdp_cache_alloc(guac_client* client, size_t limit);
+
+/**
+ * Frees the given cache, logging its hit, miss, and eviction counts if the
+ * cache is associated with a client. Any
+ * remaining entries are NOT evicted, and must be removed by their owners
+ * before the cache is freed.
+ *
+ * @param cache
+ *     The cache to free.
+ */
+void guac_rdp_cache_free(guac_rdp_cache* cache);
+
+/**
+ * Adds the given entry to the cache as the most recently used entry,
+ * evicting the least recently used entries as needed to remain within the
+ * memory limit of the cache. The given entry will never be evicted by this
+ * call. If the entry is already within the cache, its size is updated.
+ *
+ * @param cache
+ *     The cache to add the entry to.
+ *
+ * @param entry
+ *     The entry to add.
+ *
+ * @param size
+ *     The number of bytes of memory consumed by the cached object.
+ *
+ * @param evict
+ *     The handler to invoke if the entry is evicted.
+ *
+ * @param data
+ *     Arbitrary data to associate with the entry.
+ */
+void guac_rdp_cache_add(guac_rdp_cache* cache, guac_rdp_cache_entry* entry,
+        size_t size, guac_rdp_cache_evict_handler* evict, void* data);
+
+/**
+ * Removes the given entry from the cache without invoking its eviction
+ * handler. If the entry is not within the cache, this function has no effect.
+ *
+ * @param cache
+ *     The cache to remove the entry from.
+ *
+ * @param entry
+ *     The entry to remove.
+ */
+void guac_rdp_cache_remove(guac_rdp_cache* cache, guac_rdp_cache_entry* entry);
+
+/**
+ * Records a use of the object represented by the given entry, counting the
+ * use as a cache hit and marking the entry as the most recently used.
+ *
+ * @param cache
+ *     The cache containing the entry.
+ *
+ * @param entry
+ *     The entry of the object which was used.
+ */
+void guac_rdp_cache_touch(guac_rdp_cache* cache, guac_rdp_cache_entry* entry);
+
+/**
+ * Records a use of an object which was not cached, counting the use as a
+ * cache miss.
+ *
+ * @param cache
+ *     The cache which did not contain the object.
+ */
+void guac_rdp_cache_miss(guac_rdp_cache* cache);
+
+/**
+ * Prevents the given entry from being evicted. The entry continues to count
+ * towards the memory consumed by the cache until removed. This is necessary
+ * for objects whose contents cannot be recreated, such as bitmaps which have
+ * been used as the target of drawing operations.
+ *
+ * @param cache
+ *     The cache containing the entry.
+ *
+ * @param entry
+ *     The entry to pin.
+ */
+void guac_rdp_cache_pin(guac_rdp_cache* cache, guac_rdp_cache_entry* entry);
+
+#endif
+
@@ -18,6 +18,7 @@
  */
 
 #include "channels/audio-input/audio-buffer.h"
+#include "channels/audio-input/audio-resampler.h"
 #include "rdp.h"
 
 #include <guacamole/client.h>
@@ -27,7 +28,6 @@
 #include <guacamole/timestamp.h>
 #include <guacamole/user.h>
 
-#include <assert.h>
 #include <errno.h>
 #include <pthread.h>
 #include <stdint.h>
@@ -266,6 +266,7 @@ guac_rdp_audio_buffer* guac_rdp_audio_buffer_alloc(guac_client* client) {
     pthread_mutex_init(&(buffer->lock), NULL);
     pthread_cond_init(&(buffer->modified), NULL);
     buffer->client = client;
+    buffer->resampler = guac_rdp_audio_resampler_alloc();
 
     /* Begin automated, throttled flush of future data */
     pthread_create(&(buffer->flush_thread), NULL,
@@ -353,6 +354,10 @@ void guac_rdp_audio_buffer_set_stream(guac_rdp_audio_buffer* audio_buffer,
     audio_buffer->in_format.channels = channels;
     audio_buffer->in_format.bps = bps;
 
+    /* Begin conversion of new stream */
+    guac_rdp_audio_resampler_reset(audio_buffer->resampler,
+            &audio_buffer->in_format, &audio_buffer->out_format);
+
     /* Acknowledge stream creation (if buffer is ready to receive) */
     guac_rdp_audio_buffer_ack_params ack_params = { audio_buffer, "OK", GUAC_PROTOCOL_STATUS_SUCCESS };
     guac_client_for_user(audio_buffer->client, user, guac_rdp_audio_buffer_ack, &ack_params);
@@ -394,6 +399,10 @@ void guac_rdp_audio_buffer_begin(guac_rdp_audio_buffer* audio_buffer,
     audio_buffer->flush_handler = flush_handler;
     audio_buffer->data = data;
 
+    /* Restart conversion using current output format */
+    guac_rdp_audio_resampler_reset(audio_buffer->resampler,
+            &audio_buffer->in_format, &audio_buffer->out_format);
+
     /* Calculate size of each packet in bytes */
     audio_buffer->packet_size = packet_frames
                               * audio_buffer->out_format.channels
@@ -429,101 +438,9 @@ void guac_rdp_audio_buffer_begin(guac_rdp_audio_buffer* audio_buffer,
 
 }
 
-/**
- * Reads a single sample from the given buffer of data, using the input
- * format defined within the given audio buffer. Each read sample is
- * translated to a signed 16-bit value, even if the input format is 8-bit.
- * The offset into the given buffer will be determined according to the
- * input and output formats, the number of bytes sent thus far, and the
- * number of bytes received (excluding the contents of the buffer).
- *
- * IMPORTANT: The guac_rdp_audio_buffer's lock MUST already be held when
- * invoking this function.
- *
- * @param audio_buffer
- *     The audio buffer dictating the format of the given data buffer, as
- *     well as the offset from which the sample should be read.
- *
- * @param buffer
- *     The buffer of raw PCM audio data from which the sample should be read.
- *     This buffer MUST NOT contain data already taken into account by the
- *     audio buffer's total_bytes_received counter.
- *
- * @param length
- *     The number of bytes within the given buffer of PCM data.
- *
- * @param sample
- *     A pointer to the int16_t in which the read sample should be stored. If
- *     the input format is 8-bit, the sample will be shifted left by 8 bits
- *     to produce a 16-bit sample.
- *
- * @return
- *     Non-zero if a sample was successfully read, zero if no data remains
- *     within the given buffer that has not already been mapped to an
- *     output sample.
- */
-static int guac_rdp_audio_buffer_read_sample(
-        guac_rdp_audio_buffer* audio_buffer, const char* buffer, int length,
-        int16_t* sample) {
-
-    int in_bps = audio_buffer->in_format.bps;
-    int in_rate = audio_buffer->in_format.rate;
-    int in_channels = audio_buffer->in_format.channels;
-
-    int out_bps = audio_buffer->out_format.bps;
-    int out_rate = audio_buffer->out_format.rate;
-    int out_channels = audio_buffer->out_format.channels;
-
-    /* Calculate position within audio output */
-    int current_sample  = audio_buffer->total_bytes_sent / out_bps;
-    int current_frame   = current_sample / out_channels;
-    int current_channel = current_sample % out_channels;
-
-    /* Map output channel to input channel */
-    if (current_channel >= in_channels)
-        current_channel = in_channels - 1;
-
-    /* Transform output position to input position */
-    current_frame = (int) current_frame * ((double) in_rate / out_rate);
-    current_sample = current_frame * in_channels + current_channel;
-
-    /* Calculate offset within given buffer from absolute input position */
-    int offset = current_sample * in_bps
-               - audio_buffer->total_bytes_received;
-
-    /* It should be impossible for the offset to ever go negative */
-    assert(offset >= 0);
-
-    /* Apply offset to buffer */
-    buffer += offset;
-    length -= offset;
-
-    /* Read only if sufficient data is present in the given buffer */
-    if (length < in_bps)
-        return 0;
-
-    /* Simply read sample directly if input is 16-bit */
-    if (in_bps == 2) {
-        *sample = *((int16_t*) buffer);
-        return 1;
-    }
-
-    /* Translate to 16-bit if input is 8-bit */
-    if (in_bps == 1) {
-        *sample = *buffer << 8;
-        return 1;
-    }
-
-    /* Accepted audio formats are required to be 8- or 16-bit */
-    return 0;
-
-}
-
 void guac_rdp_audio_buffer_write(guac_rdp_audio_buffer* audio_buffer,
         char* buffer, int length) {
 
-    int16_t sample;
-
     pthread_mutex_lock(&(audio_buffer->lock));
 
     guac_client_log(audio_buffer->client, GUAC_LOG_TRACE, "Received %i bytes (%i ms) of audio data",
@@ -537,38 +454,23 @@ void guac_rdp_audio_buffer_write(guac_rdp_audio_buffer* audio_buffer,
         return;
     }
 
-    /* Truncate received samples if exceeding size of buffer */
+    /* Convert received data directly into the remaining buffer space */
     int available = audio_buffer->packet_buffer_size - audio_buffer->bytes_written;
-    if (length > available) {
+    int converted = guac_rdp_audio_resampler_convert(audio_buffer->resampler,
+            buffer, length, audio_buffer->packet + audio_buffer->bytes_written,
+            available);
+
+    /* Truncate converted samples if exceeding size of buffer */
+    if (converted > available) {
         guac_client_log(audio_buffer->client, GUAC_LOG_DEBUG, "Truncating %i "
-                "bytes of received audio data to %i bytes (insufficient space "
-                "in buffer).", length, available);
-        length = available;
+                "bytes of converted audio data to %i bytes (insufficient "
+                "space in buffer).", converted, available);
+        converted = available;
     }
 
-    int out_bps = audio_buffer->out_format.bps;
-
-    /* Continuously write packets until no data remains */
-    while (guac_rdp_audio_buffer_read_sample(audio_buffer,
-                buffer, length, &sample) > 0) {
-
-        char* current = audio_buffer->packet + audio_buffer->bytes_written;
-
-        /* Store as 16-bit or 8-bit, depending on output format */
-        if (out_bps == 2)
-            *((int16_t*) current) = sample;
-        else if (out_bps == 1)
-            *current = sample >> 8;
-
-        /* Accepted audio formats are required to be 8- or 16-bit */
-        else
-            assert(0);
-
-        /* Update byte counters */
-        audio_buffer->bytes_written += out_bps;
-        audio_buffer->total_bytes_sent += out_bps;
-
-    } /* end packet write loop */
+    /* Update byte counters */
+    audio_buffer->bytes_written += converted;
+    audio_buffer->total_bytes_sent += converted;
 
     /* Track current position in audio stream */
     audio_buffer->total_bytes_received += length;
@@ -630,6 +532,7 @@ void guac_rdp_audio_buffer_free(guac_rdp_audio_buffer* audio_buffer) {
     /* Clean up flush thread */
     pthread_join(audio_buffer->flush_thread, NULL);
 
+    guac_rdp_audio_resampler_free(audio_buffer->resampler);
     pthread_mutex_destroy(&(audio_buffer->lock));
     pthread_cond_destroy(&(audio_buffer->modified));
     free(audio_buffer);
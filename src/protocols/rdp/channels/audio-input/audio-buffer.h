@@ -156,6 +156,12 @@ struct guac_rdp_audio_buffer {
      */
     int total_bytes_sent;
 
+    /**
+     * Converter which translates received audio data from in_format to
+     * out_format as it is written to the packet buffer.
+     */
+    struct guac_rdp_audio_resampler* resampler;
+
     /**
      * All audio data being prepared for sending to the AUDIO_INPUT channel.
      */
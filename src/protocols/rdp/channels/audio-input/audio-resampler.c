@@ -0,0 +1,356 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "channels/audio-input/audio-buffer.h"
+#include "channels/audio-input/audio-resampler.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The fixed-point representation of a single whole input frame.
+ */
+#define GUAC_RDP_AUDIO_RESAMPLER_ONE \
+    ((uint64_t) 1 << GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS)
+
+/**
+ * Ensures the given scratch array can store at least the given number of
+ * samples, reallocating the array if necessary. Existing contents are
+ * preserved.
+ *
+ * @param buffer
+ *     A pointer to the scratch array, which will be updated if the array is
+ *     reallocated.
+ *
+ * @param size
+ *     A pointer to the number of samples which may be stored within the
+ *     scratch array, which will be updated if the array is reallocated.
+ *
+ * @param needed
+ *     The number of samples that the scratch array must be able to store.
+ */
+static void guac_rdp_audio_resampler_reserve(int16_t** buffer, int* size,
+        int needed) {
+
+    if (*buffer != NULL && needed <= *size)
+        return;
+
+    /* Grow geometrically to avoid reallocating for every packet */
+    *size = needed * 2;
+    *buffer = realloc(*buffer, sizeof(int16_t) * *size);
+
+}
+
+/**
+ * Widens the given 8- or 16-bit samples to signed 16-bit samples.
+ *
+ * @param data
+ *     The raw PCM samples to widen.
+ *
+ * @param count
+ *     The number of samples to widen.
+ *
+ * @param bps
+ *     The size of each raw sample, in bytes. This must be 1 or 2.
+ *
+ * @param samples
+ *     The array in which the widened samples should be stored.
+ */
+static void guac_rdp_audio_resampler_widen(const char* data, int count,
+        int bps, int16_t* samples) {
+
+    if (bps == 2) {
+        memcpy(samples, data, count * sizeof(int16_t));
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+        samples[i] = (int16_t) (((int8_t) data[i]) * 256);
+
+}
+
+/**
+ * Remaps the channels of the given frames of 16-bit samples. If the output is
+ * monaural, all input channels are mixed together. Otherwise, each output
+ * channel takes its samples from the input channel having the same index,
+ * with any output channels beyond those present in the input duplicating the
+ * last input channel.
+ *
+ * @param samples
+ *     The frames to remap.
+ *
+ * @param count
+ *     The number of frames to remap.
+ *
+ * @param in_channels
+ *     The number of channels within each input frame.
+ *
+ * @param frames
+ *     The array in which the remapped frames should be stored.
+ *
+ * @param out_channels
+ *     The number of channels within each output frame.
+ */
+static void guac_rdp_audio_resampler_map(const int16_t* samples, int count,
+        int in_channels, int16_t* frames, int out_channels) {
+
+    if (in_channels == out_channels) {
+        memcpy(frames, samples, count * in_channels * sizeof(int16_t));
+        return;
+    }
+
+    /* Mix down to mono */
+    if (out_channels == 1) {
+        for (int i = 0; i < count; i++) {
+            int sum = 0;
+            for (int channel = 0; channel < in_channels; channel++)
+                sum += samples[i * in_channels + channel];
+            frames[i] = sum / in_channels;
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        for (int channel = 0; channel < out_channels; channel++) {
+            int source = channel < in_channels ? channel : in_channels - 1;
+            frames[i * out_channels + channel] =
+                samples[i * in_channels + source];
+        }
+    }
+
+}
+
+/**
+ * Produces the given number of output frames by linearly interpolating
+ * between the given input frames, starting at the given position.
+ *
+ * @param frames
+ *     The input frames to interpolate between. The position of each output
+ *     frame, including the fractional part, must be less than the index of
+ *     the last of these frames.
+ *
+ * @param channels
+ *     The number of channels within each frame.
+ *
+ * @param position
+ *     The position of the first output frame within the input frames, as a
+ *     fixed-point value having GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS bits
+ *     after the binary point.
+ *
+ * @param step
+ *     The distance between consecutive output frames, in the same
+ *     fixed-point representation as position.
+ *
+ * @param resampled
+ *     The array in which the output frames should be stored.
+ *
+ * @param count
+ *     The number of output frames to produce.
+ */
+static void guac_rdp_audio_resampler_interpolate(const int16_t* frames,
+        int channels, uint64_t position, uint64_t step, int16_t* resampled,
+        int count) {
+
+    for (int i = 0; i < count; i++) {
+
+        const int16_t* a = frames
+            + (position >> GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS) * channels;
+        const int16_t* b = a + channels;
+
+        /* Use the top 15 bits of the fractional part as the weight, such
+         * that the product below cannot overflow 32 bits */
+        int32_t weight = (position
+                >> (GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS - 15)) & 0x7FFF;
+
+        for (int channel = 0; channel < channels; channel++)
+            resampled[channel] = a[channel]
+                + (((b[channel] - a[channel]) * weight) >> 15);
+
+        resampled += channels;
+        position += step;
+
+    }
+
+}
+
+guac_rdp_audio_resampler* guac_rdp_audio_resampler_alloc() {
+    return calloc(1, sizeof(guac_rdp_audio_resampler));
+}
+
+/**
+ * Returns whether the given format is supported by guac_rdp_audio_resampler.
+ *
+ * @param format
+ *     The format to test.
+ *
+ * @return
+ *     Non-zero if the format is supported, zero otherwise.
+ */
+static int guac_rdp_audio_resampler_supported(
+        const guac_rdp_audio_format* format) {
+    return format->rate > 0
+        && format->channels > 0
+        && format->channels <= GUAC_RDP_AUDIO_RESAMPLER_MAX_CHANNELS
+        && (format->bps == 1 || format->bps == 2);
+}
+
+int guac_rdp_audio_resampler_reset(guac_rdp_audio_resampler* resampler,
+        const guac_rdp_audio_format* in_format,
+        const guac_rdp_audio_format* out_format) {
+
+    resampler->in_format = *in_format;
+    resampler->out_format = *out_format;
+    resampler->partial_length = 0;
+
+    resampler->valid = guac_rdp_audio_resampler_supported(in_format)
+                    && guac_rdp_audio_resampler_supported(out_format);
+
+    if (!resampler->valid)
+        return 1;
+
+    resampler->step = ((uint64_t) in_format->rate
+            << GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS) / out_format->rate;
+
+    /* The first output frame is the first input frame, with the silent frame
+     * preceding it being the "last frame of the previous packet" */
+    resampler->position = GUAC_RDP_AUDIO_RESAMPLER_ONE;
+    guac_rdp_audio_resampler_reserve(&resampler->frames,
+            &resampler->frames_size, out_format->channels);
+    memset(resampler->frames, 0, sizeof(int16_t) * out_format->channels);
+
+    return 0;
+
+}
+
+int guac_rdp_audio_resampler_convert(guac_rdp_audio_resampler* resampler,
+        const char* data, int length, char* output, int available) {
+
+    if (!resampler->valid)
+        return 0;
+
+    int in_channels = resampler->in_format.channels;
+    int in_frame_size = in_channels * resampler->in_format.bps;
+
+    int out_bps = resampler->out_format.bps;
+    int out_channels = resampler->out_format.channels;
+    int out_frame_size = out_channels * out_bps;
+
+    /* Count complete input frames, including any partial frame remaining
+     * from the previous packet */
+    int frames = (resampler->partial_length + length) / in_frame_size;
+
+    guac_rdp_audio_resampler_reserve(&resampler->samples,
+            &resampler->samples_size, frames * in_channels);
+    guac_rdp_audio_resampler_reserve(&resampler->frames,
+            &resampler->frames_size, (frames + 2) * out_channels);
+
+    int16_t* samples = resampler->samples;
+    int remaining = frames;
+
+    /* Complete any partial frame from the previous packet */
+    if (resampler->partial_length > 0 && frames > 0) {
+
+        int needed = in_frame_size - resampler->partial_length;
+        memcpy(resampler->partial + resampler->partial_length, data, needed);
+        guac_rdp_audio_resampler_widen(resampler->partial, in_channels,
+                resampler->in_format.bps, samples);
+
+        data += needed;
+        length -= needed;
+        resampler->partial_length = 0;
+
+        samples += in_channels;
+        remaining--;
+
+    }
+
+    /* Widen all remaining complete frames */
+    guac_rdp_audio_resampler_widen(data, remaining * in_channels,
+            resampler->in_format.bps, samples);
+
+    data += remaining * in_frame_size;
+    length -= remaining * in_frame_size;
+
+    /* Retain any trailing partial frame for the next packet */
+    memcpy(resampler->partial + resampler->partial_length, data, length);
+    resampler->partial_length += length;
+
+    /* Remap channels, following the last frame of the previous packet */
+    guac_rdp_audio_resampler_map(resampler->samples, frames, in_channels,
+            resampler->frames + out_channels, out_channels);
+
+    /* An output frame landing exactly on the final input frame has zero
+     * weight for the following frame, which must still be readable */
+    memset(resampler->frames + (frames + 1) * out_channels, 0,
+            out_channels * sizeof(int16_t));
+
+    /* Determine how many output frames fall within the received input, and
+     * how many of those can actually be stored */
+    uint64_t end = (uint64_t) frames << GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS;
+    int count = 0;
+    if (resampler->position <= end)
+        count = (end - resampler->position) / resampler->step + 1;
+
+    int stored = available / out_frame_size;
+    if (stored > count)
+        stored = count;
+
+    guac_rdp_audio_resampler_reserve(&resampler->resampled,
+            &resampler->resampled_size, stored * out_channels);
+
+    /* Input frames map directly to output frames if rates are identical */
+    if (resampler->in_format.rate == resampler->out_format.rate)
+        memcpy(resampler->resampled, resampler->frames + out_channels,
+                stored * out_channels * sizeof(int16_t));
+
+    else
+        guac_rdp_audio_resampler_interpolate(resampler->frames, out_channels,
+                resampler->position, resampler->step, resampler->resampled,
+                stored);
+
+    /* Advance past all output frames, including any dropped */
+    resampler->position += count * resampler->step;
+    resampler->position -= end;
+
+    /* Retain final input frame for interpolation within next packet */
+    memmove(resampler->frames, resampler->frames + frames * out_channels,
+            out_channels * sizeof(int16_t));
+
+    /* Store as 16-bit or 8-bit, depending on output format */
+    int stored_samples = stored * out_channels;
+    if (out_bps == 2)
+        memcpy(output, resampler->resampled,
+                stored_samples * sizeof(int16_t));
+
+    else {
+        for (int i = 0; i < stored_samples; i++)
+            output[i] = (char) (resampler->resampled[i] >> 8);
+    }
+
+    return count * out_frame_size;
+
+}
+
+void guac_rdp_audio_resampler_free(guac_rdp_audio_resampler* resampler) {
+    free(resampler->samples);
+    free(resampler->frames);
+    free(resampler->resampled);
+    free(resampler);
+}
+
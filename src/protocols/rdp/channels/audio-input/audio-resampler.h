@@ -0,0 +1,199 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef GUAC_RDP_CHANNELS_AUDIO_INPUT_AUDIO_RESAMPLER_H
+#define GUAC_RDP_CHANNELS_AUDIO_INPUT_AUDIO_RESAMPLER_H
+
+#include "channels/audio-input/audio-buffer.h"
+
+#include <stdint.h>
+
+/**
+ * The maximum number of channels supported by guac_rdp_audio_resampler, for
+ * either input or output.
+ */
+#define GUAC_RDP_AUDIO_RESAMPLER_MAX_CHANNELS 8
+
+/**
+ * The position of the binary point within the fixed-point input positions
+ * tracked by guac_rdp_audio_resampler.
+ */
+#define GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS 32
+
+/**
+ * Block-based converter which translates received PCM audio into the PCM
+ * format expected by the RDP server, remapping channels, widening or
+ * narrowing samples, and converting sample rate with linear interpolation.
+ * Each call converts an entire received packet through a series of tight
+ * loops over contiguous arrays of 16-bit samples, carrying just enough state
+ * between packets (the final input frame and any partial frame) for the
+ * result to be identical regardless of how the input is split.
+ */
+typedef struct guac_rdp_audio_resampler {
+
+    /**
+     * The format of the audio data being converted.
+     */
+    guac_rdp_audio_format in_format;
+
+    /**
+     * The format that audio data should be converted to.
+     */
+    guac_rdp_audio_format out_format;
+
+    /**
+     * Whether the input and output formats are both supported. If either is
+     * unsupported, all received audio is dropped.
+     */
+    int valid;
+
+    /**
+     * The distance between consecutive output frames, in input frames, as a
+     * fixed-point value having GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS bits
+     * after the binary point.
+     */
+    uint64_t step;
+
+    /**
+     * The position of the next output frame relative to the last input frame
+     * of the previous packet, in input frames, as a fixed-point value having
+     * GUAC_RDP_AUDIO_RESAMPLER_FRACTION_BITS bits after the binary point.
+     */
+    uint64_t position;
+
+    /**
+     * The bytes of any incomplete input frame at the end of the previous
+     * packet.
+     */
+    char partial[GUAC_RDP_AUDIO_RESAMPLER_MAX_CHANNELS * 2];
+
+    /**
+     * The number of bytes stored within partial.
+     */
+    int partial_length;
+
+    /**
+     * Scratch space for received samples after widening to 16 bits, but
+     * prior to channel mapping.
+     */
+    int16_t* samples;
+
+    /**
+     * The number of samples which may be stored within the samples array.
+     */
+    int samples_size;
+
+    /**
+     * Scratch space for received frames after channel mapping, having the
+     * same number of channels as the output format. The first frame is always
+     * the last frame of the previous packet, such that interpolation can span
+     * packet boundaries, and the received frames are followed by a single
+     * silent frame.
+     */
+    int16_t* frames;
+
+    /**
+     * The number of samples which may be stored within the frames array.
+     */
+    int frames_size;
+
+    /**
+     * Scratch space for converted frames prior to being narrowed (if
+     * necessary) and stored in the output buffer.
+     */
+    int16_t* resampled;
+
+    /**
+     * The number of samples which may be stored within the resampled array.
+     */
+    int resampled_size;
+
+} guac_rdp_audio_resampler;
+
+/**
+ * Allocates a new audio resampler. The resampler will drop all data until
+ * configured with guac_rdp_audio_resampler_reset().
+ *
+ * @return
+ *     A newly-allocated guac_rdp_audio_resampler, which must eventually be
+ *     freed with guac_rdp_audio_resampler_free().
+ */
+guac_rdp_audio_resampler* guac_rdp_audio_resampler_alloc();
+
+/**
+ * Resets the given resampler to the beginning of a new stream, converting
+ * between the given formats. Only 8- and 16-bit samples are supported, and
+ * no more than GUAC_RDP_AUDIO_RESAMPLER_MAX_CHANNELS channels.
+ *
+ * @param resampler
+ *     The resampler to reset.
+ *
+ * @param in_format
+ *     The format of the audio data that will be received.
+ *
+ * @param out_format
+ *     The format that received audio data should be converted to.
+ *
+ * @return
+ *     Zero if both formats are supported, non-zero otherwise.
+ */
+int guac_rdp_audio_resampler_reset(guac_rdp_audio_resampler* resampler,
+        const guac_rdp_audio_format* in_format,
+        const guac_rdp_audio_format* out_format);
+
+/**
+ * Converts the given block of received audio data, storing as much of the
+ * result as fits within the given output buffer. Any data that does not fit
+ * is dropped, but is still taken into account, such that subsequent calls
+ * continue from the correct point in the stream.
+ *
+ * @param resampler
+ *     The resampler to use to convert the audio data.
+ *
+ * @param data
+ *     The received audio data, in the input format given to
+ *     guac_rdp_audio_resampler_reset(). This need not contain a whole number
+ *     of frames.
+ *
+ * @param length
+ *     The number of bytes of audio data to convert.
+ *
+ * @param output
+ *     The buffer in which converted data should be stored, in the output
+ *     format given to guac_rdp_audio_resampler_reset().
+ *
+ * @param available
+ *     The number of bytes available within the output buffer.
+ *
+ * @return
+ *     The number of bytes of converted data produced, which may exceed the
+ *     number of bytes available (and thus stored) if data was dropped.
+ */
+int guac_rdp_audio_resampler_convert(guac_rdp_audio_resampler* resampler,
+        const char* data, int length, char* output, int available);
+
+/**
+ * Frees the given audio resampler and all associated scratch space.
+ *
+ * @param resampler
+ *     The resampler to free.
+ */
+void guac_rdp_audio_resampler_free(guac_rdp_audio_resampler* resampler);
+
+#endif
+
@@ -357,7 +357,6 @@ static UINT guac_rdp_cliprdr_format_data_request(CliprdrClientContext* cliprdr,
     guac_client_log(client, GUAC_LOG_TRACE, "CLIPRDR: Received format data request.");
 
     guac_iconv_write* remote_writer;
-    const char* input = clipboard->clipboard->buffer;
     char* output = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
 
     /* Map requested clipboard format to a guac_iconv writer */
@@ -388,8 +387,11 @@ static UINT guac_rdp_cliprdr_format_data_request(CliprdrClientContext* cliprdr,
      * requested */
     BYTE* start = (BYTE*) output;
     guac_iconv_read* local_reader = settings->normalize_clipboard ? GUAC_READ_UTF8_NORMALIZED : GUAC_READ_UTF8;
+    pthread_mutex_lock(&(clipboard->clipboard->lock));
+    const char* input = clipboard->clipboard->buffer;
     guac_iconv(local_reader, &input, clipboard->clipboard->length,
             remote_writer, &output, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+    pthread_mutex_unlock(&(clipboard->clipboard->lock));
 
     CLIPRDR_FORMAT_DATA_RESPONSE data_response = {
         .requestedFormatData = (BYTE*) start,
@@ -449,11 +451,8 @@ static UINT guac_rdp_cliprdr_format_data_response(CliprdrClientContext* cliprdr,
         return CHANNEL_RC_OK;
     }
 
-    char received_data[GUAC_COMMON_CLIPBOARD_MAX_LENGTH];
-
     guac_iconv_read* remote_reader;
     const char* input = (char*) format_data_response->requestedFormatData;
-    char* output = received_data;
 
     /* Find correct source encoding */
     switch (clipboard->requested_format) {
@@ -481,16 +480,20 @@ static UINT guac_rdp_cliprdr_format_data_response(CliprdrClientContext* cliprdr,
 
     }
 
+    char* received_data = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+    char* output = received_data;
+
     /* Convert, store, and forward the clipboard data received from RDP
      * server */
     if (guac_iconv(remote_reader, &input, format_data_response->dataLen,
-            GUAC_WRITE_UTF8, &output, sizeof(received_data))) {
-        int length = strnlen(received_data, sizeof(received_data));
+            GUAC_WRITE_UTF8, &output, GUAC_COMMON_CLIPBOARD_MAX_LENGTH)) {
+        int length = strnlen(received_data, output - received_data);
         guac_common_clipboard_reset(clipboard->clipboard, "text/plain");
         guac_common_clipboard_append(clipboard->clipboard, received_data, length);
         guac_common_clipboard_send(clipboard->clipboard, client);
     }
 
+    free(received_data);
     return CHANNEL_RC_OK;
 
 }
@@ -22,6 +22,7 @@
 #include "channels/rdpdr/rdpdr-fs-messages-file-info.h"
 #include "channels/rdpdr/rdpdr-fs-messages-vol-info.h"
 #include "channels/rdpdr/rdpdr-fs-messages.h"
+#include "channels/rdpdr/rdpdr-io-pool.h"
 #include "channels/rdpdr/rdpdr.h"
 #include "download.h"
 #include "fs.h"
@@ -133,16 +134,160 @@ void guac_rdpdr_fs_process_create(guac_rdp_common_svc* svc,
 
 }
 
+/**
+ * A single read from or write to an open file, which may be performed by a
+ * thread of the device's I/O pool rather than by the RDPDR channel thread.
+ */
+typedef struct guac_rdpdr_fs_io {
+
+    /**
+     * The guac_rdp_common_svc representing the static virtual channel being
+     * used for RDPDR.
+     */
+    guac_rdp_common_svc* svc;
+
+    /**
+     * The device owning the file being read or written.
+     */
+    guac_rdpdr_device* device;
+
+    /**
+     * The ID of the file being read or written.
+     */
+    int file_id;
+
+    /**
+     * The completion ID of the I/O request that requested the read or write.
+     */
+    int completion_id;
+
+    /**
+     * The offset within the file at which to read or write.
+     */
+    uint64_t offset;
+
+    /**
+     * The number of bytes to read or write.
+     */
+    int length;
+
+    /**
+     * The buffer receiving the data read, or containing a copy of the data
+     * to be written.
+     */
+    char* buffer;
+
+} guac_rdpdr_fs_io;
+
+/**
+ * Submits the given read or write to the device's I/O pool, performing it
+ * immediately on the current thread if the device has no I/O pool or the
+ * read or write cannot be submitted.
+ *
+ * @param io
+ *     The read or write to perform.
+ *
+ * @param handler
+ *     The function which performs the read or write, sends the resulting
+ *     I/O completion, and frees the given guac_rdpdr_fs_io.
+ */
+static void guac_rdpdr_fs_submit_io(guac_rdpdr_fs_io* io,
+        guac_rdpdr_io_job_handler* handler) {
+
+    guac_rdpdr_io_pool* pool = io->device->io_pool;
+    if (pool == NULL
+            || guac_rdpdr_io_pool_submit(pool, io->file_id, handler, io))
+        handler(io);
+
+}
+
+/**
+ * Performs a read previously requested with a Server Drive Read Request,
+ * sending the corresponding I/O completion. The given guac_rdpdr_fs_io is
+ * freed.
+ *
+ * @param data
+ *     The guac_rdpdr_fs_io describing the read.
+ */
+static void guac_rdpdr_fs_perform_read(void* data) {
+
+    guac_rdpdr_fs_io* io = (guac_rdpdr_fs_io*) data;
+    guac_rdpdr_device* device = io->device;
+
+    wStream* output_stream;
+
+    /* Attempt read */
+    int bytes_read = guac_rdp_fs_read((guac_rdp_fs*) device->data,
+            io->file_id, io->offset, io->buffer, io->length);
+
+    /* If error, return invalid parameter */
+    if (bytes_read < 0) {
+        output_stream = guac_rdpdr_new_io_completion(device,
+                io->completion_id, guac_rdp_fs_get_status(bytes_read), 4);
+        Stream_Write_UINT32(output_stream, 0); /* Length */
+    }
+
+    /* Otherwise, send bytes read */
+    else {
+        output_stream = guac_rdpdr_new_io_completion(device,
+                io->completion_id, STATUS_SUCCESS, 4+bytes_read);
+        Stream_Write_UINT32(output_stream, bytes_read);  /* Length */
+        Stream_Write(output_stream, io->buffer, bytes_read); /* ReadData */
+    }
+
+    guac_rdp_common_svc_write(io->svc, output_stream);
+    free(io->buffer);
+    free(io);
+
+}
+
+/**
+ * Performs a write previously requested with a Server Drive Write Request,
+ * sending the corresponding I/O completion. The given guac_rdpdr_fs_io is
+ * freed.
+ *
+ * @param data
+ *     The guac_rdpdr_fs_io describing the write.
+ */
+static void guac_rdpdr_fs_perform_write(void* data) {
+
+    guac_rdpdr_fs_io* io = (guac_rdpdr_fs_io*) data;
+    guac_rdpdr_device* device = io->device;
+
+    wStream* output_stream;
+
+    /* Attempt write */
+    int bytes_written = guac_rdp_fs_write((guac_rdp_fs*) device->data,
+            io->file_id, io->offset, io->buffer, io->length);
+
+    /* If error, return invalid parameter */
+    if (bytes_written < 0) {
+        output_stream = guac_rdpdr_new_io_completion(device,
+                io->completion_id, guac_rdp_fs_get_status(bytes_written), 5);
+        Stream_Write_UINT32(output_stream, 0); /* Length */
+        Stream_Write_UINT8(output_stream, 0);  /* Padding */
+    }
+
+    /* Otherwise, send success */
+    else {
+        output_stream = guac_rdpdr_new_io_completion(device,
+                io->completion_id, STATUS_SUCCESS, 5);
+        Stream_Write_UINT32(output_stream, bytes_written); /* Length */
+        Stream_Write_UINT8(output_stream, 0);              /* Padding */
+    }
+
+    guac_rdp_common_svc_write(io->svc, output_stream);
+    free(io->buffer);
+    free(io);
+
+}
+
 void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
         wStream* input_stream) {
 
     UINT32 length;
     UINT64 offset;
-    char* buffer;
-    int bytes_read;
-
-    wStream* output_stream;
 
     /* Check remaining bytes before reading stream. */
     if (Stream_GetRemainingLength(input_stream) < 12) {
@@ -164,30 +309,17 @@ void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
     if (length > GUAC_RDP_MAX_READ_BUFFER)
         length = GUAC_RDP_MAX_READ_BUFFER;
 
-    /* Allocate buffer */
-    buffer = malloc(length);
+    guac_rdpdr_fs_io* io = malloc(sizeof(guac_rdpdr_fs_io));
+    io->svc = svc;
+    io->device = device;
+    io->file_id = iorequest->file_id;
+    io->completion_id = iorequest->completion_id;
+    io->offset = offset;
+    io->length = length;
+    io->buffer = malloc(length);
 
-    /* Attempt read */
-    bytes_read = guac_rdp_fs_read((guac_rdp_fs*) device->data,
-            iorequest->file_id, offset, buffer, length);
-
-    /* If error, return invalid parameter */
-    if (bytes_read < 0) {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, guac_rdp_fs_get_status(bytes_read), 4);
-        Stream_Write_UINT32(output_stream, 0); /* Length */
-    }
-
-    /* Otherwise, send bytes read */
-    else {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, STATUS_SUCCESS, 4+bytes_read);
-        Stream_Write_UINT32(output_stream, bytes_read);  /* Length */
-        Stream_Write(output_stream, buffer, bytes_read); /* ReadData */
-    }
-
-    guac_rdp_common_svc_write(svc, output_stream);
-    free(buffer);
+    /* Read without blocking other I/O requests, if possible */
+    guac_rdpdr_fs_submit_io(io, guac_rdpdr_fs_perform_read);
 
 }
 
@@ -197,9 +329,6 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
 
     UINT32 length;
     UINT64 offset;
-    int bytes_written;
-
-    wStream* output_stream;
 
     /* Check remaining length. */
     if (Stream_GetRemainingLength(input_stream) < 32) {
@@ -225,28 +354,22 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
                 "Drive redirection may not work as expected.");
         return;
     }
-    
-    /* Attempt write */
-    bytes_written = guac_rdp_fs_write((guac_rdp_fs*) device->data,
-            iorequest->file_id, offset, Stream_Pointer(input_stream), length);
 
-    /* If error, return invalid parameter */
-    if (bytes_written < 0) {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, guac_rdp_fs_get_status(bytes_written), 5);
-        Stream_Write_UINT32(output_stream, 0); /* Length */
-        Stream_Write_UINT8(output_stream, 0);  /* Padding */
-    }
+    guac_rdpdr_fs_io* io = malloc(sizeof(guac_rdpdr_fs_io));
+    io->svc = svc;
+    io->device = device;
+    io->file_id = iorequest->file_id;
+    io->completion_id = iorequest->completion_id;
+    io->offset = offset;
+    io->length = length;
 
-    /* Otherwise, send success */
-    else {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, STATUS_SUCCESS, 5);
-        Stream_Write_UINT32(output_stream, bytes_written); /* Length */
-        Stream_Write_UINT8(output_stream, 0);              /* Padding */
-    }
+    /* Data must be copied, as the received PDU will be freed once this
+     * request has been handled */
+    io->buffer = malloc(length);
+    memcpy(io->buffer, Stream_Pointer(input_stream), length);
 
-    guac_rdp_common_svc_write(svc, output_stream);
+    /* Write without blocking other I/O requests, if possible */
+    guac_rdpdr_fs_submit_io(io, guac_rdpdr_fs_perform_write);
 
 }
 
@@ -260,6 +383,11 @@ void guac_rdpdr_fs_process_close(guac_rdp_common_svc* svc,
     guac_client_log(svc->client, GUAC_LOG_DEBUG, "%s: [file_id=%i]",
             __func__, iorequest->file_id);
 
+    /* Finish any reads/writes of this file still in progress, such that the
+     * file is not closed while in use */
+    if (device->io_pool != NULL)
+        guac_rdpdr_io_pool_wait(device->io_pool, iorequest->file_id);
+
     /* Get file */
     file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, iorequest->file_id);
     if (file == NULL)
@@ -469,7 +597,7 @@ void guac_rdpdr_fs_process_query_directory(guac_rdp_common_svc* svc,
     int fs_information_class, initial_query;
     int path_length;
 
-    const char* entry_name;
+    const guac_rdp_fs_entry* entry;
 
     /* Get file */
     file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, iorequest->file_id);
@@ -514,60 +642,55 @@ void guac_rdpdr_fs_process_query_directory(guac_rdp_common_svc* svc,
             "initial_query=%i, dir_pattern=\"%s\"", __func__,
             iorequest->file_id, initial_query, file->dir_pattern);
 
+    /* Restart enumeration with a current listing if requested */
+    if (initial_query)
+        guac_rdp_fs_rewind_dir((guac_rdp_fs*) device->data,
+                iorequest->file_id);
+
     /* Find first matching entry in directory */
-    while ((entry_name = guac_rdp_fs_read_dir((guac_rdp_fs*) device->data,
+    while ((entry = guac_rdp_fs_read_dir_entry((guac_rdp_fs*) device->data,
                     iorequest->file_id)) != NULL) {
 
         /* Convert to absolute path */
         char entry_path[GUAC_RDP_FS_MAX_PATH];
         if (guac_rdp_fs_convert_path(file->absolute_path,
-                    entry_name, entry_path) == 0) {
-
-            int entry_file_id;
+                    entry->name, entry_path) == 0) {
 
             /* Pattern defined and match fails, continue with next file */
             if (guac_rdp_fs_matches(entry_path, file->dir_pattern))
                 continue;
 
-            /* Open directory entry */
-            entry_file_id = guac_rdp_fs_open((guac_rdp_fs*) device->data,
-                    entry_path, FILE_READ_DATA, 0, FILE_OPEN, 0);
-
-            if (entry_file_id >= 0) {
-
-                /* Dispatch to appropriate class-specific handler */
-                switch (fs_information_class) {
-
-                    case FileDirectoryInformation:
-                        guac_rdpdr_fs_process_query_directory_info(svc, device,
-                                iorequest, entry_name, entry_file_id);
-                        break;
-
-                    case FileFullDirectoryInformation:
-                        guac_rdpdr_fs_process_query_full_directory_info(svc,
-                                device, iorequest, entry_name, entry_file_id);
-                        break;
-
-                    case FileBothDirectoryInformation:
-                        guac_rdpdr_fs_process_query_both_directory_info(svc,
-                                device, iorequest, entry_name, entry_file_id);
-                        break;
-
-                    case FileNamesInformation:
-                        guac_rdpdr_fs_process_query_names_info(svc, device,
-                                iorequest, entry_name, entry_file_id);
-                        break;
-
-                    default:
-                        guac_client_log(svc->client, GUAC_LOG_DEBUG,
-                                "Unknown dir information class: 0x%x",
-                                fs_information_class);
-                }
+            /* Dispatch to appropriate class-specific handler */
+            switch (fs_information_class) {
+
+                case FileDirectoryInformation:
+                    guac_rdpdr_fs_process_query_directory_info(svc, device,
+                            iorequest, entry);
+                    break;
+
+                case FileFullDirectoryInformation:
+                    guac_rdpdr_fs_process_query_full_directory_info(svc,
+                            device, iorequest, entry);
+                    break;
+
+                case FileBothDirectoryInformation:
+                    guac_rdpdr_fs_process_query_both_directory_info(svc,
+                            device, iorequest, entry);
+                    break;
+
+                case FileNamesInformation:
+                    guac_rdpdr_fs_process_query_names_info(svc, device,
+                            iorequest, entry);
+                    break;
+
+                default:
+                    guac_client_log(svc->client, GUAC_LOG_DEBUG,
+                            "Unknown dir information class: 0x%x",
+                            fs_information_class);
+            }
 
-                guac_rdp_fs_close((guac_rdp_fs*) device->data, entry_file_id);
-                return;
+            return;
 
-            } /* end if file exists */
         } /* end if path valid */
     } /* end if entry exists */
 
@@ -44,12 +44,16 @@ guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_create;
 guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_close;
 
 /**
- * Handles a Server Drive Read Request. This request reads from a file.
+ * Handles a Server Drive Read Request. This request reads from a file. If the
+ * device has an I/O pool, the read is performed and completed asynchronously
+ * by a thread of that pool.
  */
 guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_read;
 
 /**
- * Handles a Server Drive Write Request. This request writes to a file.
+ * Handles a Server Drive Write Request. This request writes to a file. If the
+ * device has an I/O pool, the write is performed and completed asynchronously
+ * by a thread of that pool.
  */
 guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_write;
 
@@ -111,6 +111,10 @@ void guac_rdpdr_device_fs_iorequest_handler(guac_rdp_common_svc* svc,
 void guac_rdpdr_device_fs_free_handler(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device) {
 
+    /* Finish any outstanding reads/writes */
+    if (device->io_pool != NULL)
+        guac_rdpdr_io_pool_free(device->io_pool);
+
     Stream_Free(device->device_announce, 1);
     
 }
@@ -150,5 +154,12 @@ void guac_rdpdr_register_fs(guac_rdp_common_svc* svc, char* drive_name) {
     /* Init data */
     device->data = rdp_client->filesystem;
 
+    /* Read and write files without blocking the RDPDR channel, falling back
+     * to synchronous I/O if threads cannot be created */
+    device->io_pool = guac_rdpdr_io_pool_alloc(GUAC_RDPDR_FS_IO_THREADS);
+    if (device->io_pool == NULL)
+        guac_client_log(client, GUAC_LOG_WARNING, "Unable to create threads "
+                "for drive I/O. Drive I/O will be performed synchronously.");
+
 }
 
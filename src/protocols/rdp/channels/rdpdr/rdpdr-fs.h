@@ -46,6 +46,13 @@
  */
 #define GUAC_FILESYSTEM_LABEL_LENGTH 16
 
+/**
+ * The number of threads reading from and writing to files on behalf of each
+ * filesystem device, and thus the maximum number of reads and writes which
+ * may be in progress at once.
+ */
+#define GUAC_RDPDR_FS_IO_THREADS 4
+
 /**
  * Registers a new filesystem device within the RDPDR plugin. This must be done
  * before RDPDR connection finishes.
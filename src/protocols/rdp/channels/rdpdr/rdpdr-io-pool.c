@@ -0,0 +1,221 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "channels/rdpdr/rdpdr-io-pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * Removes the given job from the list of jobs being performed by the given
+ * pool. The pool lock must be held.
+ *
+ * @param pool
+ *     The pool performing the job.
+ *
+ * @param job
+ *     The job to remove.
+ */
+static void guac_rdpdr_io_pool_remove_running(guac_rdpdr_io_pool* pool,
+        guac_rdpdr_io_job* job) {
+
+    guac_rdpdr_io_job** current = &(pool->running);
+    while (*current != job)
+        current = &((*current)->next);
+
+    *current = job->next;
+
+}
+
+/**
+ * Returns whether any job with the given key has been submitted to the given
+ * pool but has not yet finished. The pool lock must be held.
+ *
+ * @param pool
+ *     The pool to check.
+ *
+ * @param key
+ *     The key of the jobs to look for.
+ *
+ * @return
+ *     Non-zero if any such job exists, zero otherwise.
+ */
+static int guac_rdpdr_io_pool_has_key(guac_rdpdr_io_pool* pool, int key) {
+
+    for (guac_rdpdr_io_job* job = pool->head; job != NULL; job = job->next) {
+        if (job->key == key)
+            return 1;
+    }
+
+    for (guac_rdpdr_io_job* job = pool->running; job != NULL; job = job->next) {
+        if (job->key == key)
+            return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Performs jobs submitted to the given pool until the pool is being freed
+ * and no jobs remain. This function is the start routine of each thread of
+ * the pool.
+ *
+ * @param data
+ *     The guac_rdpdr_io_pool that the thread belongs to.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_rdpdr_io_pool_thread(void* data) {
+
+    guac_rdpdr_io_pool* pool = (guac_rdpdr_io_pool*) data;
+
+    pthread_mutex_lock(&(pool->lock));
+
+    for (;;) {
+
+        /* Wait for a job to be submitted */
+        while (pool->head == NULL && !pool->stopping)
+            pthread_cond_wait(&(pool->job_submitted), &(pool->lock));
+
+        /* Jobs are always finished before the pool stops */
+        guac_rdpdr_io_job* job = pool->head;
+        if (job == NULL)
+            break;
+
+        pool->head = job->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+
+        job->next = pool->running;
+        pool->running = job;
+
+        /* Perform job without holding the lock */
+        pthread_mutex_unlock(&(pool->lock));
+        job->handler(job->data);
+        pthread_mutex_lock(&(pool->lock));
+
+        guac_rdpdr_io_pool_remove_running(pool, job);
+        free(job);
+
+        pool->pending--;
+        pthread_cond_broadcast(&(pool->job_finished));
+
+    }
+
+    pthread_mutex_unlock(&(pool->lock));
+    return NULL;
+
+}
+
+guac_rdpdr_io_pool* guac_rdpdr_io_pool_alloc(int thread_count) {
+
+    guac_rdpdr_io_pool* pool = calloc(1, sizeof(guac_rdpdr_io_pool));
+    if (pool == NULL)
+        return NULL;
+
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->job_submitted), NULL);
+    pthread_cond_init(&(pool->job_finished), NULL);
+
+    /* Start threads, stopping any already started if one fails */
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&(pool->threads[i]), NULL,
+                    guac_rdpdr_io_pool_thread, pool)) {
+            guac_rdpdr_io_pool_free(pool);
+            return NULL;
+        }
+        pool->thread_count++;
+    }
+
+    return pool;
+
+}
+
+int guac_rdpdr_io_pool_submit(guac_rdpdr_io_pool* pool, int key,
+        guac_rdpdr_io_job_handler* handler, void* data) {
+
+    guac_rdpdr_io_job* job = malloc(sizeof(guac_rdpdr_io_job));
+    if (job == NULL)
+        return 1;
+
+    job->key = key;
+    job->handler = handler;
+    job->data = data;
+    job->next = NULL;
+
+    pthread_mutex_lock(&(pool->lock));
+
+    /* Add job to end of queue */
+    if (pool->tail != NULL)
+        pool->tail->next = job;
+    else
+        pool->head = job;
+
+    pool->tail = job;
+    pool->pending++;
+
+    pthread_cond_signal(&(pool->job_submitted));
+    pthread_mutex_unlock(&(pool->lock));
+
+    return 0;
+
+}
+
+void guac_rdpdr_io_pool_flush(guac_rdpdr_io_pool* pool) {
+
+    pthread_mutex_lock(&(pool->lock));
+
+    while (pool->pending > 0)
+        pthread_cond_wait(&(pool->job_finished), &(pool->lock));
+
+    pthread_mutex_unlock(&(pool->lock));
+
+}
+
+void guac_rdpdr_io_pool_wait(guac_rdpdr_io_pool* pool, int key) {
+
+    pthread_mutex_lock(&(pool->lock));
+
+    while (guac_rdpdr_io_pool_has_key(pool, key))
+        pthread_cond_wait(&(pool->job_finished), &(pool->lock));
+
+    pthread_mutex_unlock(&(pool->lock));
+
+}
+
+void guac_rdpdr_io_pool_free(guac_rdpdr_io_pool* pool) {
+
+    /* Signal all threads to stop once the queue is empty */
+    pthread_mutex_lock(&(pool->lock));
+    pool->stopping = 1;
+    pthread_cond_broadcast(&(pool->job_submitted));
+    pthread_mutex_unlock(&(pool->lock));
+
+    for (int i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&(pool->job_finished));
+    pthread_cond_destroy(&(pool->job_submitted));
+    pthread_mutex_destroy(&(pool->lock));
+    free(pool);
+
+}
+
@@ -0,0 +1,214 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_RDP_RDPDR_IO_POOL_H
+#define GUAC_RDP_RDPDR_IO_POOL_H
+
+/**
+ * A pool of threads which perform slow device I/O on behalf of an RDPDR
+ * device, allowing the RDPDR channel to continue handling other I/O requests
+ * while that I/O is in progress. Each I/O request handled by the pool is
+ * completed by the pool thread performing it, and thus I/O requests may
+ * complete in a different order than received, as RDPDR allows.
+ *
+ * @file rdpdr-io-pool.h
+ */
+
+#include <pthread.h>
+
+/**
+ * The maximum number of threads within any guac_rdpdr_io_pool.
+ */
+#define GUAC_RDPDR_IO_POOL_MAX_THREADS 16
+
+/**
+ * Handler which performs a single job submitted to a guac_rdpdr_io_pool,
+ * including sending any I/O completion. This handler is invoked within one
+ * of the threads of the pool.
+ *
+ * @param data
+ *     The arbitrary data provided when the job was submitted.
+ */
+typedef void guac_rdpdr_io_job_handler(void* data);
+
+/**
+ * A single job awaiting a thread within a guac_rdpdr_io_pool.
+ */
+typedef struct guac_rdpdr_io_job guac_rdpdr_io_job;
+
+struct guac_rdpdr_io_job {
+
+    /**
+     * Arbitrary value identifying the resource affected by this job, such as
+     * the ID of the file being read or written, allowing jobs affecting that
+     * resource to be awaited with guac_rdpdr_io_pool_wait().
+     */
+    int key;
+
+    /**
+     * The handler which performs this job.
+     */
+    guac_rdpdr_io_job_handler* handler;
+
+    /**
+     * The arbitrary data to provide to the handler.
+     */
+    void* data;
+
+    /**
+     * The job submitted immediately after this job, or NULL if this is the
+     * most recently submitted job. Once the job is being performed, this is
+     * instead the next job being performed, or NULL if there are no other
+     * such jobs.
+     */
+    guac_rdpdr_io_job* next;
+
+};
+
+/**
+ * A fixed-size pool of threads performing I/O jobs in the order submitted.
+ */
+typedef struct guac_rdpdr_io_pool {
+
+    /**
+     * Lock which is held while the queue of jobs, the list of jobs being
+     * performed, or the number of pending jobs is being modified.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled when a job is added to the queue or when
+     * the pool is being freed.
+     */
+    pthread_cond_t job_submitted;
+
+    /**
+     * Condition which is signalled whenever a job finishes.
+     */
+    pthread_cond_t job_finished;
+
+    /**
+     * The oldest job within the queue, or NULL if the queue is empty.
+     */
+    guac_rdpdr_io_job* head;
+
+    /**
+     * The newest job within the queue, or NULL if the queue is empty.
+     */
+    guac_rdpdr_io_job* tail;
+
+    /**
+     * All jobs currently being performed by threads of the pool, or NULL if
+     * no jobs are being performed.
+     */
+    guac_rdpdr_io_job* running;
+
+    /**
+     * The number of jobs which have been submitted but have not yet
+     * finished, including jobs currently being performed.
+     */
+    int pending;
+
+    /**
+     * Non-zero if the pool is being freed and its threads should exit once
+     * the queue is empty, zero otherwise.
+     */
+    int stopping;
+
+    /**
+     * The number of threads within the pool.
+     */
+    int thread_count;
+
+    /**
+     * All threads within the pool.
+     */
+    pthread_t threads[GUAC_RDPDR_IO_POOL_MAX_THREADS];
+
+} guac_rdpdr_io_pool;
+
+/**
+ * Allocates a new pool containing the given number of threads.
+ *
+ * @param thread_count
+ *     The number of threads to create, which must be no greater than
+ *     GUAC_RDPDR_IO_POOL_MAX_THREADS.
+ *
+ * @return
+ *     A newly-allocated pool, or NULL if the pool or its threads cannot be
+ *     created.
+ */
+guac_rdpdr_io_pool* guac_rdpdr_io_pool_alloc(int thread_count);
+
+/**
+ * Submits a job to the given pool. The job will be performed by the next
+ * available thread, concurrently with any other jobs already submitted.
+ *
+ * @param pool
+ *     The pool to submit the job to.
+ *
+ * @param key
+ *     Arbitrary value identifying the resource affected by the job, such as
+ *     the ID of the file being read or written.
+ *
+ * @param handler
+ *     The handler which performs the job.
+ *
+ * @param data
+ *     Arbitrary data to provide to the handler.
+ *
+ * @return
+ *     Zero if the job was submitted successfully, non-zero if the job could
+ *     not be submitted, in which case the caller must perform the job itself.
+ */
+int guac_rdpdr_io_pool_submit(guac_rdpdr_io_pool* pool, int key,
+        guac_rdpdr_io_job_handler* handler, void* data);
+
+/**
+ * Waits for all jobs submitted to the given pool with the given key to
+ * finish. Jobs with other keys are not waited for.
+ *
+ * @param pool
+ *     The pool to wait for.
+ *
+ * @param key
+ *     The key of the jobs to wait for, as provided to
+ *     guac_rdpdr_io_pool_submit().
+ */
+void guac_rdpdr_io_pool_wait(guac_rdpdr_io_pool* pool, int key);
+
+/**
+ * Waits for all jobs submitted to the given pool to finish.
+ *
+ * @param pool
+ *     The pool to wait for.
+ */
+void guac_rdpdr_io_pool_flush(guac_rdpdr_io_pool* pool);
+
+/**
+ * Waits for all jobs submitted to the given pool to finish, stops all
+ * threads within the pool, and frees the pool.
+ *
+ * @param pool
+ *     The pool to free.
+ */
+void guac_rdpdr_io_pool_free(guac_rdpdr_io_pool* pool);
+
+#endif
+
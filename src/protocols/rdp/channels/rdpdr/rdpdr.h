@@ -21,6 +21,7 @@
 #define GUAC_RDP_CHANNELS_RDPDR_H
 
 #include "channels/common-svc.h"
+#include "channels/rdpdr/rdpdr-io-pool.h"
 
 #include <freerdp/freerdp.h>
 #include <guacamole/client.h>
@@ -164,6 +165,12 @@ struct guac_rdpdr_device {
      */
     void* data;
 
+    /**
+     * Pool of threads performing slow I/O on behalf of this device, or NULL
+     * if all I/O requests are handled synchronously.
+     */
+    guac_rdpdr_io_pool* io_pool;
+
 };
 
 /**
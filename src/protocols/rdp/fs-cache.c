@@ -0,0 +1,322 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "config.h"
+
+#include "fs.h"
+#include "fs-cache.h"
+
+#include <guacamole/timestamp.h>
+#include <winpr/file.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The inotify events which invalidate a cached directory listing. Watching a
+ * directory for IN_MODIFY and IN_ATTRIB also reports changes to the contents
+ * and metadata of the files within that directory.
+ */
+#define GUAC_RDP_FS_CACHE_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM \
+        | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/**
+ * The number of entries to initially allocate for each listing. The array of
+ * entries is doubled in size as needed.
+ */
+#define GUAC_RDP_FS_CACHE_INITIAL_ENTRIES 16
+
+guac_rdp_fs_cache* guac_rdp_fs_cache_alloc() {
+
+    guac_rdp_fs_cache* cache = calloc(1, sizeof(guac_rdp_fs_cache));
+
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    return cache;
+
+}
+
+/**
+ * Frees the given listing and all entries within it.
+ *
+ * @param listing
+ *     The listing to free.
+ */
+static void guac_rdp_fs_listing_free(guac_rdp_fs_listing* listing) {
+
+    for (int i = 0; i < listing->entry_count; i++)
+        free(listing->entries[i].name);
+
+    free(listing->entries);
+    free(listing->path);
+    free(listing);
+
+}
+
+/**
+ * Drops the reference held by the cache on the listing in the given slot,
+ * removing that listing from the cache. If no other listing shares the same
+ * inotify watch (as happens when two paths refer to the same directory), the
+ * watch is removed, too. The cache must be locked.
+ *
+ * @param cache
+ *     The cache to remove the listing from.
+ *
+ * @param index
+ *     The index of the slot containing the listing to remove.
+ */
+static void guac_rdp_fs_cache_evict(guac_rdp_fs_cache* cache, int index) {
+
+    guac_rdp_fs_listing* listing = cache->listings[index];
+    cache->listings[index] = NULL;
+
+    /* Stop watching the directory only if no other listing needs the watch */
+    int watch = listing->watch;
+    listing->watch = -1;
+    if (watch != -1) {
+
+        int shared = 0;
+        for (int i = 0; i < GUAC_RDP_FS_CACHE_MAX_LISTINGS; i++) {
+            if (cache->listings[i] != NULL
+                    && cache->listings[i]->watch == watch) {
+                shared = 1;
+                break;
+            }
+        }
+
+        if (!shared)
+            inotify_rm_watch(cache->inotify_fd, watch);
+
+    }
+
+    if (--listing->refcount == 0)
+        guac_rdp_fs_listing_free(listing);
+
+}
+
+/**
+ * Reads all pending inotify events, removing from the cache each listing
+ * whose directory has changed. The cache must be locked.
+ *
+ * @param cache
+ *     The cache to update.
+ */
+static void guac_rdp_fs_cache_drain(guac_rdp_fs_cache* cache) {
+
+    char buffer[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t length;
+    while ((length = read(cache->inotify_fd, buffer, sizeof(buffer))) > 0) {
+
+        char* current = buffer;
+        while (current < buffer + length) {
+
+            struct inotify_event* event = (struct inotify_event*) current;
+            current += sizeof(struct inotify_event) + event->len;
+
+            /* Events may have been lost, so nothing can be trusted */
+            if (event->mask & IN_Q_OVERFLOW) {
+                for (int i = 0; i < GUAC_RDP_FS_CACHE_MAX_LISTINGS; i++) {
+                    if (cache->listings[i] != NULL)
+                        guac_rdp_fs_cache_evict(cache, i);
+                }
+                continue;
+            }
+
+            for (int i = 0; i < GUAC_RDP_FS_CACHE_MAX_LISTINGS; i++) {
+                if (cache->listings[i] != NULL
+                        && cache->listings[i]->watch == event->wd)
+                    guac_rdp_fs_cache_evict(cache, i);
+            }
+
+        }
+
+    }
+
+}
+
+/**
+ * Reads the directory at the given real path, producing a new listing
+ * containing the name and metadata of each entry. Entries which cannot be
+ * stat'd (such as dangling symbolic links) are omitted, just as they would
+ * fail to be opened. If possible, an inotify watch is added for the directory
+ * before it is read, such that any change made while reading is not missed.
+ *
+ * @param cache
+ *     The cache that will own the new listing.
+ *
+ * @param path
+ *     The real path of the directory on the local filesystem.
+ *
+ * @return
+ *     A newly-allocated listing having a single reference, or NULL if the
+ *     directory cannot be read.
+ */
+static guac_rdp_fs_listing* guac_rdp_fs_cache_read(guac_rdp_fs_cache* cache,
+        const char* path) {
+
+    int watch = -1;
+    if (cache->inotify_fd != -1)
+        watch = inotify_add_watch(cache->inotify_fd, path,
+                GUAC_RDP_FS_CACHE_EVENTS | IN_ONLYDIR);
+
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        if (watch != -1)
+            inotify_rm_watch(cache->inotify_fd, watch);
+        return NULL;
+    }
+
+    guac_rdp_fs_listing* listing = calloc(1, sizeof(guac_rdp_fs_listing));
+    listing->path = strdup(path);
+    listing->watch = watch;
+    listing->refcount = 1;
+
+    int capacity = GUAC_RDP_FS_CACHE_INITIAL_ENTRIES;
+    listing->entries = malloc(sizeof(guac_rdp_fs_entry) * capacity);
+
+    struct dirent* dirent;
+    while ((dirent = readdir(dir)) != NULL) {
+
+        struct stat file_stat;
+        if (fstatat(dirfd(dir), dirent->d_name, &file_stat, 0))
+            continue;
+
+        if (listing->entry_count == capacity) {
+            capacity *= 2;
+            listing->entries = realloc(listing->entries,
+                    sizeof(guac_rdp_fs_entry) * capacity);
+        }
+
+        guac_rdp_fs_entry* entry = &(listing->entries[listing->entry_count++]);
+        entry->name  = strdup(dirent->d_name);
+        entry->size  = file_stat.st_size;
+        entry->ctime = WINDOWS_TIME(file_stat.st_ctime);
+        entry->mtime = WINDOWS_TIME(file_stat.st_mtime);
+        entry->atime = WINDOWS_TIME(file_stat.st_atime);
+
+        if (S_ISDIR(file_stat.st_mode))
+            entry->attributes = FILE_ATTRIBUTE_DIRECTORY;
+        else
+            entry->attributes = FILE_ATTRIBUTE_NORMAL;
+
+    }
+
+    closedir(dir);
+
+    listing->loaded = guac_timestamp_current();
+    return listing;
+
+}
+
+guac_rdp_fs_listing* guac_rdp_fs_cache_get(guac_rdp_fs_cache* cache,
+        const char* path) {
+
+    pthread_mutex_lock(&cache->lock);
+
+    if (cache->inotify_fd != -1)
+        guac_rdp_fs_cache_drain(cache);
+
+    guac_timestamp now = guac_timestamp_current();
+
+    /* Reuse cached listing if still valid, dropping it if expired */
+    for (int i = 0; i < GUAC_RDP_FS_CACHE_MAX_LISTINGS; i++) {
+
+        guac_rdp_fs_listing* listing = cache->listings[i];
+        if (listing == NULL || strcmp(listing->path, path) != 0)
+            continue;
+
+        if (now - listing->loaded <= GUAC_RDP_FS_CACHE_TTL) {
+            listing->refcount++;
+            pthread_mutex_unlock(&cache->lock);
+            return listing;
+        }
+
+        guac_rdp_fs_cache_evict(cache, i);
+        break;
+
+    }
+
+    guac_rdp_fs_listing* listing = guac_rdp_fs_cache_read(cache, path);
+
+    /* Listings which cannot be watched for changes are never cached */
+    if (listing == NULL || listing->watch == -1) {
+        pthread_mutex_unlock(&cache->lock);
+        return listing;
+    }
+
+    /* Store within first free slot, evicting the oldest listing if full */
+    int slot = 0;
+    for (int i = 0; i < GUAC_RDP_FS_CACHE_MAX_LISTINGS; i++) {
+
+        if (cache->listings[i] == NULL) {
+            slot = i;
+            break;
+        }
+
+        if (cache->listings[i]->loaded < cache->listings[slot]->loaded)
+            slot = i;
+
+    }
+
+    if (cache->listings[slot] != NULL)
+        guac_rdp_fs_cache_evict(cache, slot);
+
+    listing->refcount++;
+    cache->listings[slot] = listing;
+
+    pthread_mutex_unlock(&cache->lock);
+    return listing;
+
+}
+
+void guac_rdp_fs_cache_release(guac_rdp_fs_cache* cache,
+        guac_rdp_fs_listing* listing) {
+
+    pthread_mutex_lock(&cache->lock);
+
+    if (--listing->refcount == 0)
+        guac_rdp_fs_listing_free(listing);
+
+    pthread_mutex_unlock(&cache->lock);
+
+}
+
+void guac_rdp_fs_cache_free(guac_rdp_fs_cache* cache) {
+
+    for (int i = 0; i < GUAC_RDP_FS_CACHE_MAX_LISTINGS; i++) {
+        if (cache->listings[i] != NULL)
+            guac_rdp_fs_cache_evict(cache, i);
+    }
+
+    if (cache->inotify_fd != -1)
+        close(cache->inotify_fd);
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+
+}
+
@@ -0,0 +1,207 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef GUAC_RDP_FS_CACHE_H
+#define GUAC_RDP_FS_CACHE_H
+
+/**
+ * Cache of directory listings for the RDP virtual drive. Each listing is a
+ * snapshot of the names and metadata of all entries within a single
+ * directory, allowing repeated directory queries from the RDP server to be
+ * answered without opening and stat'ing every file each time. Listings are
+ * invalidated through inotify as soon as the underlying directory changes,
+ * and otherwise expire after a short period.
+ *
+ * @file fs-cache.h
+ */
+
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * The number of milliseconds that a cached directory listing remains valid
+ * after being read, regardless of whether any change has been observed.
+ */
+#define GUAC_RDP_FS_CACHE_TTL 5000
+
+/**
+ * The maximum number of directory listings which may be cached at any one
+ * time. If this limit is reached, the oldest listing is evicted.
+ */
+#define GUAC_RDP_FS_CACHE_MAX_LISTINGS 32
+
+/**
+ * The name and metadata of a single entry within a directory.
+ */
+typedef struct guac_rdp_fs_entry {
+
+    /**
+     * The filename of this entry, without any leading path components.
+     */
+    char* name;
+
+    /**
+     * Bitwise OR of all associated Windows file attributes.
+     */
+    int attributes;
+
+    /**
+     * The size of this entry, in bytes.
+     */
+    uint64_t size;
+
+    /**
+     * The time this entry was created, as a Windows timestamp.
+     */
+    uint64_t ctime;
+
+    /**
+     * The time this entry was last modified, as a Windows timestamp.
+     */
+    uint64_t mtime;
+
+    /**
+     * The time this entry was last accessed, as a Windows timestamp.
+     */
+    uint64_t atime;
+
+} guac_rdp_fs_entry;
+
+/**
+ * A snapshot of the contents of a single directory. Listings are shared
+ * between all files enumerating the same directory and are reference counted,
+ * such that a listing which is invalidated while still being enumerated is
+ * only freed once its last reference is released.
+ */
+typedef struct guac_rdp_fs_listing {
+
+    /**
+     * The real path of the directory on the local filesystem.
+     */
+    char* path;
+
+    /**
+     * The inotify watch descriptor monitoring the directory for changes, or
+     * -1 if the listing is no longer being watched.
+     */
+    int watch;
+
+    /**
+     * The time at which the directory was read.
+     */
+    guac_timestamp loaded;
+
+    /**
+     * The number of references to this listing, including the reference held
+     * by the cache itself while the listing remains valid.
+     */
+    int refcount;
+
+    /**
+     * The number of entries within the entries array.
+     */
+    int entry_count;
+
+    /**
+     * All entries within the directory, in the order returned by readdir().
+     */
+    guac_rdp_fs_entry* entries;
+
+} guac_rdp_fs_listing;
+
+/**
+ * A cache of directory listings associated with a single guac_rdp_fs.
+ */
+typedef struct guac_rdp_fs_cache {
+
+    /**
+     * Lock which guards all access to the cache, as directory queries and
+     * the Guacamole filesystem object may read listings concurrently.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Non-blocking inotify file descriptor receiving change events for all
+     * cached directories, or -1 if inotify is unavailable. If inotify is
+     * unavailable, listings are never reused, as there would be no way to
+     * observe changes made to the directory.
+     */
+    int inotify_fd;
+
+    /**
+     * All currently-valid listings. Unused slots are NULL.
+     */
+    guac_rdp_fs_listing* listings[GUAC_RDP_FS_CACHE_MAX_LISTINGS];
+
+} guac_rdp_fs_cache;
+
+/**
+ * Allocates a new, empty directory listing cache.
+ *
+ * @return
+ *     A newly-allocated guac_rdp_fs_cache, which must eventually be freed
+ *     with guac_rdp_fs_cache_free().
+ */
+guac_rdp_fs_cache* guac_rdp_fs_cache_alloc();
+
+/**
+ * Frees the given cache, along with all listings that are not still
+ * referenced. Any references to listings must be released prior to freeing
+ * the cache.
+ *
+ * @param cache
+ *     The cache to free.
+ */
+void guac_rdp_fs_cache_free(guac_rdp_fs_cache* cache);
+
+/**
+ * Returns a listing of the directory at the given real path, reading the
+ * directory only if no valid listing is already cached. The returned listing
+ * is referenced on behalf of the caller and must be released with
+ * guac_rdp_fs_cache_release() once no longer needed.
+ *
+ * @param cache
+ *     The cache to retrieve the listing from.
+ *
+ * @param path
+ *     The real path of the directory on the local filesystem.
+ *
+ * @return
+ *     A listing of the given directory, or NULL if the directory cannot be
+ *     read.
+ */
+guac_rdp_fs_listing* guac_rdp_fs_cache_get(guac_rdp_fs_cache* cache,
+        const char* path);
+
+/**
+ * Releases a reference to a listing previously returned by
+ * guac_rdp_fs_cache_get(), freeing the listing if it is no longer referenced.
+ *
+ * @param cache
+ *     The cache which provided the listing.
+ *
+ * @param listing
+ *     The listing to release.
+ */
+void guac_rdp_fs_cache_release(guac_rdp_fs_cache* cache,
+        guac_rdp_fs_listing* listing);
+
+#endif
+
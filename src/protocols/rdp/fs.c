@@ -64,15 +64,25 @@ guac_rdp_fs* guac_rdp_fs_alloc(guac_client* client, const char* drive_path,
     fs->client = client;
     fs->drive_path = strdup(drive_path);
     fs->file_id_pool = guac_pool_alloc(0);
+    fs->cache = guac_rdp_fs_cache_alloc();
     fs->open_files = 0;
     fs->disable_download = disable_download;
     fs->disable_upload = disable_upload;
 
+    for (int i = 0; i < GUAC_RDP_FS_MAX_FILES; i++)
+        fs->files[i].listing = NULL;
+
     return fs;
 
 }
 
 void guac_rdp_fs_free(guac_rdp_fs* fs) {
+
+    /* Release any listings still being enumerated */
+    for (int i = 0; i < GUAC_RDP_FS_MAX_FILES; i++)
+        guac_rdp_fs_rewind_dir(fs, i);
+
+    guac_rdp_fs_cache_free(fs->cache);
     guac_pool_free(fs->file_id_pool);
     free(fs->drive_path);
     free(fs);
@@ -369,6 +379,8 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
     file->absolute_path = strdup(normalized_path);
     file->real_path = strdup(real_path);
     file->bytes_written = 0;
+    file->listing = NULL;
+    file->listing_index = 0;
 
     guac_client_log(fs->client, GUAC_LOG_DEBUG,
             "%s: Opened \"%s\" as file_id=%i",
@@ -421,9 +433,9 @@ int guac_rdp_fs_read(guac_rdp_fs* fs, int file_id, uint64_t offset,
         return GUAC_RDP_FS_EINVAL;
     }
 
-    /* Attempt read */
-    lseek(file->fd, offset, SEEK_SET);
-    bytes_read = read(file->fd, buffer, length);
+    /* Attempt read without affecting the file offset, such that concurrent
+     * reads/writes do not interfere */
+    bytes_read = pread(file->fd, buffer, length, offset);
 
     /* Translate errno on error */
     if (bytes_read < 0)
@@ -445,15 +457,15 @@ int guac_rdp_fs_write(guac_rdp_fs* fs, int file_id, uint64_t offset,
         return GUAC_RDP_FS_EINVAL;
     }
 
-    /* Attempt write */
-    lseek(file->fd, offset, SEEK_SET);
-    bytes_written = write(file->fd, buffer, length);
+    /* Attempt write without affecting the file offset, such that concurrent
+     * reads/writes do not interfere */
+    bytes_written = pwrite(file->fd, buffer, length, offset);
 
     /* Translate errno on error */
     if (bytes_written < 0)
         return guac_rdp_fs_get_errorcode(errno);
 
-    file->bytes_written += bytes_written;
+    __atomic_add_fetch(&file->bytes_written, bytes_written, __ATOMIC_RELAXED);
     return bytes_written;
 
 }
@@ -570,6 +582,9 @@ void guac_rdp_fs_close(guac_rdp_fs* fs, int file_id) {
     if (file->dir != NULL)
         closedir(file->dir);
 
+    /* Release cached listing, if any */
+    guac_rdp_fs_rewind_dir(fs, file_id);
+
     /* Close file */
     close(file->fd);
 
@@ -611,6 +626,48 @@ const char* guac_rdp_fs_read_dir(guac_rdp_fs* fs, int file_id) {
 
 }
 
+const guac_rdp_fs_entry* guac_rdp_fs_read_dir_entry(guac_rdp_fs* fs,
+        int file_id) {
+
+    guac_rdp_fs_file* file;
+
+    /* Only read if file ID is valid */
+    if (file_id < 0 || file_id >= GUAC_RDP_FS_MAX_FILES)
+        return NULL;
+
+    file = &(fs->files[file_id]);
+
+    /* Retrieve listing if not yet retrieved, stop if error */
+    if (file->listing == NULL) {
+        file->listing = guac_rdp_fs_cache_get(fs->cache, file->real_path);
+        file->listing_index = 0;
+        if (file->listing == NULL)
+            return NULL;
+    }
+
+    /* Stop if no more entries */
+    if (file->listing_index >= file->listing->entry_count)
+        return NULL;
+
+    return &(file->listing->entries[file->listing_index++]);
+
+}
+
+void guac_rdp_fs_rewind_dir(guac_rdp_fs* fs, int file_id) {
+
+    /* Only rewind if file ID is valid */
+    if (file_id < 0 || file_id >= GUAC_RDP_FS_MAX_FILES)
+        return;
+
+    guac_rdp_fs_file* file = &(fs->files[file_id]);
+
+    if (file->listing != NULL) {
+        guac_rdp_fs_cache_release(fs->cache, file->listing);
+        file->listing = NULL;
+    }
+
+}
+
 const char* guac_rdp_fs_basename(const char* path) {
 
     for (const char* c = path; *c != '\0'; c++) {
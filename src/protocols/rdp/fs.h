@@ -31,6 +31,8 @@
  * @file fs.h 
  */
 
+#include "fs-cache.h"
+
 #include <guacamole/client.h>
 #include <guacamole/object.h>
 #include <guacamole/pool.h>
@@ -180,6 +182,18 @@ typedef struct guac_rdp_fs_file {
      */
     uint64_t bytes_written;
 
+    /**
+     * The cached listing being enumerated by directory queries against this
+     * file, or NULL if no such query has yet been made.
+     */
+    guac_rdp_fs_listing* listing;
+
+    /**
+     * The index of the next entry within listing to be returned by
+     * guac_rdp_fs_read_dir_entry().
+     */
+    int listing_index;
+
 } guac_rdp_fs_file;
 
 /**
@@ -211,6 +225,12 @@ typedef struct guac_rdp_fs {
      * All available file structures.
      */
     guac_rdp_fs_file files[GUAC_RDP_FS_MAX_FILES];
+
+    /**
+     * Cache of directory listings, shared by all directory queries against
+     * this filesystem.
+     */
+    guac_rdp_fs_cache* cache;
     
     /**
      * If downloads from the remote server to the browser should be disabled.
@@ -412,7 +432,9 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
 /**
  * Reads up to the given length of bytes from the given offset within the
  * file having the given ID. Returns the number of bytes read, zero on EOF,
- * and an error code if an error occurs.
+ * and an error code if an error occurs. Reads and writes of the same file may
+ * be performed concurrently, as the file offset of the underlying file
+ * descriptor is neither used nor changed.
  *
  * @param fs
  *     The filesystem containing the file from which data is to be read.
@@ -440,7 +462,9 @@ int guac_rdp_fs_read(guac_rdp_fs* fs, int file_id, uint64_t offset,
 /**
  * Writes up to the given length of bytes from the given offset within the
  * file having the given ID. Returns the number of bytes written, and an
- * error code if an error occurs.
+ * error code if an error occurs. Reads and writes of the same file may be
+ * performed concurrently, as the file offset of the underlying file
+ * descriptor is neither used nor changed.
  *
  * @param fs
  *     The filesystem containing the file to which data is to be written.
@@ -603,6 +627,43 @@ int guac_rdp_fs_convert_path(const char* parent, const char* rel_path,
  */
 const char* guac_rdp_fs_read_dir(guac_rdp_fs* fs, int file_id);
 
+/**
+ * Returns the name and metadata of the next entry within the directory having
+ * the given file ID, or NULL if no more entries. Unlike
+ * guac_rdp_fs_read_dir(), entries are read from a cached listing of the
+ * directory, such that their metadata is available without opening each
+ * entry, and such that repeated enumeration of an unchanged directory does
+ * not touch the underlying filesystem.
+ *
+ * @param fs
+ *     The filesystem containing the file to read directory entries from.
+ *
+ * @param file_id
+ *     The ID of the file to read directory entries from, as returned by
+ *     guac_rdp_fs_open().
+ *
+ * @return
+ *     The next entry within the directory, or NULL if the last entry in the
+ *     directory has already been returned by a previous call. The returned
+ *     entry remains valid until the file is closed or
+ *     guac_rdp_fs_rewind_dir() is invoked.
+ */
+const guac_rdp_fs_entry* guac_rdp_fs_read_dir_entry(guac_rdp_fs* fs,
+        int file_id);
+
+/**
+ * Restarts enumeration of the directory having the given file ID, such that
+ * the next call to guac_rdp_fs_read_dir_entry() returns the first entry of a
+ * current listing of that directory.
+ *
+ * @param fs
+ *     The filesystem containing the directory.
+ *
+ * @param file_id
+ *     The ID of the directory, as returned by guac_rdp_fs_open().
+ */
+void guac_rdp_fs_rewind_dir(guac_rdp_fs* fs, int file_id);
+
 /**
  * Returns the file having the given ID, or NULL if no such file exists.
  *
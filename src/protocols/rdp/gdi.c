@@ -18,6 +18,7 @@
  */
 
 #include "bitmap.h"
+#include "cache.h"
 #include "color.h"
 #include "common/display.h"
 #include "common/surface.h"
@@ -236,7 +237,8 @@ BOOL guac_rdp_gdi_scrblt(rdpContext* context, const SCRBLT_ORDER* scrblt) {
 BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
 
     guac_client* client = ((rdp_freerdp_context*) context)->client;
-    guac_common_surface* current_surface = ((guac_rdp_client*) client->data)->current_surface;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_common_surface* current_surface = rdp_client->current_surface;
     guac_rdp_bitmap* bitmap = (guac_rdp_bitmap*) memblt->bitmap;
 
     int x = memblt->nLeftRect;
@@ -268,6 +270,12 @@ BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
         /* If operation is just SRC, simply copy */
         case 0xCC: 
 
+            /* Track cache efficiency */
+            if (bitmap->layer != NULL)
+                guac_rdp_cache_touch(rdp_client->cache, &bitmap->cache_entry);
+            else
+                guac_rdp_cache_miss(rdp_client->cache);
+
             /* If not cached, cache if necessary */
             if (bitmap->layer == NULL && bitmap->used >= 1)
                 guac_rdp_cache_bitmap(context, memblt->bitmap);
@@ -310,8 +318,13 @@ BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
         default:
 
             /* If not available as a surface, make available. */
-            if (bitmap->layer == NULL)
+            if (bitmap->layer == NULL) {
+                guac_rdp_cache_miss(rdp_client->cache);
                 guac_rdp_cache_bitmap(context, memblt->bitmap);
+            }
+
+            else
+                guac_rdp_cache_touch(rdp_client->cache, &bitmap->cache_entry);
 
             guac_common_surface_transfer(bitmap->layer->surface,
                     x_src, y_src, w, h,
@@ -433,6 +446,52 @@ BOOL guac_rdp_gdi_begin_paint(rdpContext* context) {
 
 }
 
+/**
+ * Copies the given rectangle of the GDI primary buffer into the default
+ * surface of the Guacamole display. Only the portions of the rectangle which
+ * actually differ from the current contents of that surface will be sent to
+ * connected users.
+ *
+ * @param rdp_client
+ *     The guac_rdp_client associated with the current RDP session.
+ *
+ * @param gdi
+ *     The rdpGdi instance containing the primary buffer to copy from.
+ *
+ * @param region
+ *     The rectangle of the primary buffer to copy.
+ */
+static void guac_rdp_gdi_draw_region(guac_rdp_client* rdp_client,
+        rdpGdi* gdi, const GDI_RGN* region) {
+
+    INT32 x = region->x;
+    INT32 y = region->y;
+    INT32 w = region->w;
+    INT32 h = region->h;
+
+    /* Clip region to bounds of primary buffer */
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > gdi->width)  w = gdi->width  - x;
+    if (y + h > gdi->height) h = gdi->height - y;
+
+    /* Ignore empty regions */
+    if (region->null || w <= 0 || h <= 0)
+        return;
+
+    /* Create surface from image data */
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(
+        gdi->primary_buffer + 4*x + y*gdi->stride,
+        CAIRO_FORMAT_RGB24, w, h, gdi->stride);
+
+    /* Send surface to buffer */
+    guac_common_surface_draw(rdp_client->display->default_surface, x, y, surface);
+
+    /* Free surface */
+    cairo_surface_destroy(surface);
+
+}
+
 BOOL guac_rdp_gdi_end_paint(rdpContext* context) {
 
     guac_client* client = ((rdp_freerdp_context*) context)->client;
@@ -448,25 +507,23 @@ BOOL guac_rdp_gdi_end_paint(rdpContext* context) {
     if (gdi->suppressOutput)
         return TRUE;
 
+    HGDI_WND hwnd = gdi->primary->hdc->hwnd;
+
     /* Ignore paint if nothing has been done (empty rect) */
-    if (gdi->primary->hdc->hwnd->invalid->null)
+    if (hwnd->invalid->null)
         return TRUE;
 
-    INT32 x = gdi->primary->hdc->hwnd->invalid->x;
-    INT32 y = gdi->primary->hdc->hwnd->invalid->y;
-    UINT32 w = gdi->primary->hdc->hwnd->invalid->w;
-    UINT32 h = gdi->primary->hdc->hwnd->invalid->h;
-
-    /* Create surface from image data */
-    cairo_surface_t* surface = cairo_image_surface_create_for_data(
-        gdi->primary_buffer + 4*x + y*gdi->stride,
-        CAIRO_FORMAT_RGB24, w, h, gdi->stride);
-
-    /* Send surface to buffer */
-    guac_common_surface_draw(rdp_client->display->default_surface, x, y, surface);
+    /* Copy each individual invalidated region, rather than their overall
+     * bounding box, such that small updates at opposite sides of the screen
+     * do not require comparing everything in between */
+    if (hwnd->ninvalid > 0 && hwnd->cinvalid != NULL) {
+        for (int i = 0; i < hwnd->ninvalid; i++)
+            guac_rdp_gdi_draw_region(rdp_client, gdi, &hwnd->cinvalid[i]);
+    }
 
-    /* Free surface */
-    cairo_surface_destroy(surface);
+    /* Fall back to bounding box if individual regions are not available */
+    else
+        guac_rdp_gdi_draw_region(rdp_client, gdi, hwnd->invalid);
 
     /* Next frame */
     if (gdi->inGfxFrame) {
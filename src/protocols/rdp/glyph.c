@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include "cache.h"
 #include "color.h"
 #include "common/surface.h"
 #include "config.h"
@@ -29,22 +30,75 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* Define cairo_format_stride_for_width() if missing */
 #ifndef HAVE_CAIRO_FORMAT_STRIDE_FOR_WIDTH
 #define cairo_format_stride_for_width(format, width) (width*4)
 #endif
 
-BOOL guac_rdp_glyph_new(rdpContext* context, const rdpGlyph* glyph) {
+/**
+ * Frees the cached image data of the given glyph, if any. The cache entry of
+ * the glyph is not updated.
+ *
+ * @param glyph
+ *     The glyph whose cached image data should be freed.
+ */
+static void guac_rdp_glyph_free_surface(guac_rdp_glyph* glyph) {
+
+    if (glyph->surface == NULL)
+        return;
+
+    unsigned char* image_buffer = cairo_image_surface_get_data(glyph->surface);
+
+    /* Free surface */
+    cairo_surface_destroy(glyph->surface);
+    free(image_buffer);
+
+    glyph->surface = NULL;
+
+}
+
+/**
+ * Evicts the cached image data of the guac_rdp_glyph associated with the
+ * given cache entry. The image data will be recreated from the original glyph
+ * data if the glyph is drawn again.
+ *
+ * @param cache
+ *     The cache from which the entry is being evicted.
+ *
+ * @param entry
+ *     The cache entry of the glyph being evicted.
+ */
+static void guac_rdp_glyph_evict(guac_rdp_cache* cache,
+        guac_rdp_cache_entry* entry) {
+    guac_rdp_glyph_free_surface((guac_rdp_glyph*) entry->data);
+}
+
+/**
+ * Converts the 1-bit image data of the given glyph into an ARGB32 Cairo
+ * surface which can be used as a stencil, storing that surface within the
+ * glyph and adding it to the bitmap/glyph cache.
+ *
+ * @param context
+ *     The rdpContext associated with the current RDP session.
+ *
+ * @param glyph
+ *     The glyph whose image data should be converted.
+ */
+static void guac_rdp_glyph_render(rdpContext* context, guac_rdp_glyph* glyph) {
+
+    guac_client* client = ((rdp_freerdp_context*) context)->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
 
     int x, y, i;
     int stride;
     unsigned char* image_buffer;
     unsigned char* image_buffer_row;
 
-    unsigned char* data = glyph->aj;
-    int width  = glyph->cx;
-    int height = glyph->cy;
+    unsigned char* data = glyph->glyph.aj;
+    int width  = glyph->glyph.cx;
+    int height = glyph->glyph.cy;
 
     /* Init Cairo buffer */
     stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
@@ -83,9 +137,24 @@ BOOL guac_rdp_glyph_new(rdpContext* context, const rdpGlyph* glyph) {
     }
 
     /* Store glyph surface */
-    ((guac_rdp_glyph*) glyph)->surface = cairo_image_surface_create_for_data(
+    glyph->surface = cairo_image_surface_create_for_data(
             image_buffer, CAIRO_FORMAT_ARGB32, width, height, stride);
 
+    /* Account for surface within cache memory limit, evicting older bitmaps
+     * and glyphs if necessary */
+    guac_rdp_cache_add(rdp_client->cache, &glyph->cache_entry,
+            (size_t) height * stride, guac_rdp_glyph_evict, glyph);
+
+}
+
+BOOL guac_rdp_glyph_new(rdpContext* context, const rdpGlyph* glyph) {
+
+    guac_rdp_glyph* guac_glyph = (guac_rdp_glyph*) glyph;
+
+    /* Not yet within cache */
+    memset(&guac_glyph->cache_entry, 0, sizeof(guac_rdp_cache_entry));
+
+    guac_rdp_glyph_render(context, guac_glyph);
     return TRUE;
 
 }
@@ -101,8 +170,19 @@ BOOL guac_rdp_glyph_draw(rdpContext* context, const rdpGlyph* glyph,
     guac_common_surface* current_surface = rdp_client->current_surface;
     uint32_t fgcolor = rdp_client->glyph_color;
 
+    guac_rdp_glyph* guac_glyph = (guac_rdp_glyph*) glyph;
+
+    /* Recreate image data if evicted from cache */
+    if (guac_glyph->surface == NULL) {
+        guac_rdp_cache_miss(rdp_client->cache);
+        guac_rdp_glyph_render(context, guac_glyph);
+    }
+
+    else
+        guac_rdp_cache_touch(rdp_client->cache, &guac_glyph->cache_entry);
+
     /* Paint with glyph as mask */
-    guac_common_surface_paint(current_surface, x, y, ((guac_rdp_glyph*) glyph)->surface,
+    guac_common_surface_paint(current_surface, x, y, guac_glyph->surface,
                                (fgcolor & 0xFF0000) >> 16,
                                (fgcolor & 0x00FF00) >> 8,
                                 fgcolor & 0x0000FF);
@@ -113,12 +193,14 @@ BOOL guac_rdp_glyph_draw(rdpContext* context, const rdpGlyph* glyph,
 
 void guac_rdp_glyph_free(rdpContext* context, rdpGlyph* glyph) {
 
-    unsigned char* image_buffer = cairo_image_surface_get_data(
-            ((guac_rdp_glyph*) glyph)->surface);
+    guac_client* client = ((rdp_freerdp_context*) context)->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+
+    guac_rdp_glyph* guac_glyph = (guac_rdp_glyph*) glyph;
 
     /* Free surface */
-    cairo_surface_destroy(((guac_rdp_glyph*) glyph)->surface);
-    free(image_buffer);
+    guac_rdp_cache_remove(rdp_client->cache, &guac_glyph->cache_entry);
+    guac_rdp_glyph_free_surface(guac_glyph);
 
     /* NOTE: FreeRDP-allocated memory for the rdpGlyph will NOT be
      * automatically released after this free handler is invoked, thus we must
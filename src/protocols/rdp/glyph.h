@@ -20,6 +20,7 @@
 #ifndef GUAC_RDP_GLYPH_H
 #define GUAC_RDP_GLYPH_H
 
+#include "cache.h"
 #include "config.h"
 
 #include <cairo/cairo.h>
@@ -52,10 +53,17 @@ typedef struct guac_rdp_glyph {
     rdpGlyph glyph;
 
     /**
-     * Cairo surface layer containing cached image data.
+     * Cairo surface layer containing cached image data, or NULL if that data
+     * has been evicted from the cache and must be recreated.
      */
     cairo_surface_t* surface;
 
+    /**
+     * The memory usage of the cached image data, as tracked by the
+     * bitmap/glyph cache of the RDP connection.
+     */
+    guac_rdp_cache_entry cache_entry;
+
 } guac_rdp_glyph;
 
 /**
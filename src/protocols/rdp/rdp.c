@@ -491,6 +491,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
 
     rdp_client->current_surface = rdp_client->display->default_surface;
 
+    /* Limit memory used by cached bitmaps and glyphs */
+    rdp_client->cache = guac_rdp_cache_alloc(client,
+            (size_t) settings->cache_memory_limit * 1024 * 1024);
+
     rdp_client->available_svc = guac_common_list_alloc();
 
     /* Init client */
@@ -661,6 +665,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
     guac_common_display_free(rdp_client->display);
     rdp_client->display = NULL;
 
+    /* Free bitmap/glyph cache (all cached objects were freed above) */
+    guac_rdp_cache_free(rdp_client->cache);
+    rdp_client->cache = NULL;
+
     pthread_rwlock_unlock(&(rdp_client->lock));
 
     /* Client is now disconnected */
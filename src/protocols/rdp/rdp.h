@@ -20,6 +20,7 @@
 #ifndef GUAC_RDP_H
 #define GUAC_RDP_H
 
+#include "cache.h"
 #include "channels/audio-input/audio-buffer.h"
 #include "channels/cliprdr.h"
 #include "channels/disp.h"
@@ -85,6 +86,12 @@ typedef struct guac_rdp_client {
      */
     guac_common_display* display;
 
+    /**
+     * The memory budget and usage statistics of all cached bitmaps and
+     * glyphs.
+     */
+    guac_rdp_cache* cache;
+
     /**
      * The surface that GDI operations should draw to. RDP messages exist which
      * change this surface to allow drawing to occur off-screen.
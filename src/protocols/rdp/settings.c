@@ -18,6 +18,7 @@
  */
 
 #include "argv.h"
+#include "cache.h"
 #include "common/defaults.h"
 #include "common/string.h"
 #include "config.h"
@@ -91,6 +92,7 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
     "disable-bitmap-caching",
     "disable-offscreen-caching",
     "disable-glyph-caching",
+    "cache-memory-limit",
     "disable-gfx",
     "preconnection-id",
     "preconnection-blob",
@@ -383,6 +385,13 @@ enum RDP_ARGS_IDX {
      */
     IDX_DISABLE_GLYPH_CACHING,
 
+    /**
+     * The maximum amount of memory, in megabytes, which may be consumed by
+     * cached bitmaps and glyphs. If "0", no limit is applied. If blank, a
+     * default limit of GUAC_RDP_CACHE_DEFAULT_LIMIT megabytes is used.
+     */
+    IDX_CACHE_MEMORY_LIMIT,
+
     /**
      * "true" if the RDP Graphics Pipeline Extension should not be used, and
      * traditional RDP graphics should be used instead, "false" or blank if the
@@ -942,6 +951,19 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
                 GUAC_RDP_CLIENT_ARGS[IDX_DISABLE_GLYPH_CACHING]);
     }
 
+    /* Memory limit for cached bitmaps and glyphs */
+    settings->cache_memory_limit =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_CACHE_MEMORY_LIMIT, GUAC_RDP_CACHE_DEFAULT_LIMIT);
+
+    /* Use default limit if specified limit is invalid */
+    if (settings->cache_memory_limit < 0) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Ignoring invalid cache memory "
+                "limit: %i. Using default limit of %i megabytes instead.",
+                settings->cache_memory_limit, GUAC_RDP_CACHE_DEFAULT_LIMIT);
+        settings->cache_memory_limit = GUAC_RDP_CACHE_DEFAULT_LIMIT;
+    }
+
     /* Preconnection ID */
     settings->preconnection_id = -1;
     if (argv[IDX_PRECONNECTION_ID][0] != '\0') {
@@ -400,6 +400,12 @@ typedef struct guac_rdp_settings {
      */
     int disable_glyph_caching;
 
+    /**
+     * The maximum amount of memory, in megabytes, which may be consumed by
+     * cached bitmaps and glyphs, or zero if no limit should be applied.
+     */
+    int cache_memory_limit;
+
     /**
      * The preconnection ID to send within the preconnection PDU when
      * initiating an RDP connection, if any. If no preconnection ID is
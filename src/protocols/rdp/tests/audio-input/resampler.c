@@ -0,0 +1,161 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "channels/audio-input/audio-buffer.h"
+#include "channels/audio-input/audio-resampler.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Test which verifies that audio already in the output format passes through
+ * the resampler unmodified, even if split at arbitrary byte boundaries.
+ */
+void test_resampler__passthrough() {
+
+    guac_rdp_audio_format format = { 44100, 2, 2 };
+    int16_t input[] = { 1, -1, 1000, -1000, 32767, -32768, 0, 5 };
+    int16_t output[8];
+
+    guac_rdp_audio_resampler* resampler = guac_rdp_audio_resampler_alloc();
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_reset(resampler,
+                &format, &format), 0);
+
+    /* Split input partway through the second frame */
+    const char* data = (const char*) input;
+    int first = guac_rdp_audio_resampler_convert(resampler, data, 7,
+            (char*) output, sizeof(output));
+    int second = guac_rdp_audio_resampler_convert(resampler, data + 7,
+            sizeof(input) - 7, ((char*) output) + first,
+            sizeof(output) - first);
+
+    CU_ASSERT_EQUAL(first, 4);
+    CU_ASSERT_EQUAL(first + second, sizeof(input));
+    CU_ASSERT_EQUAL(memcmp(input, output, sizeof(input)), 0);
+
+    guac_rdp_audio_resampler_free(resampler);
+
+}
+
+/**
+ * Test which verifies that 8-bit monaural audio is widened to 16 bits and
+ * duplicated across both channels of stereo output.
+ */
+void test_resampler__widen_mono_to_stereo() {
+
+    guac_rdp_audio_format in_format = { 8000, 1, 1 };
+    guac_rdp_audio_format out_format = { 8000, 2, 2 };
+    char input[] = { 0, 1, -1, 127, -128 };
+    int16_t output[10];
+
+    guac_rdp_audio_resampler* resampler = guac_rdp_audio_resampler_alloc();
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_reset(resampler,
+                &in_format, &out_format), 0);
+
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_convert(resampler, input,
+                sizeof(input), (char*) output, sizeof(output)),
+            sizeof(output));
+
+    int16_t expected[] = { 0, 0, 256, 256, -256, -256, 32512, 32512,
+        -32768, -32768 };
+    CU_ASSERT_EQUAL(memcmp(expected, output, sizeof(expected)), 0);
+
+    guac_rdp_audio_resampler_free(resampler);
+
+}
+
+/**
+ * Test which verifies that doubling the sample rate linearly interpolates
+ * between input frames, including across packet boundaries.
+ */
+void test_resampler__upsample() {
+
+    guac_rdp_audio_format in_format = { 8000, 1, 2 };
+    guac_rdp_audio_format out_format = { 16000, 1, 2 };
+    int16_t input[] = { 0, 100, 200, 300 };
+    int16_t output[8];
+
+    guac_rdp_audio_resampler* resampler = guac_rdp_audio_resampler_alloc();
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_reset(resampler,
+                &in_format, &out_format), 0);
+
+    int first = guac_rdp_audio_resampler_convert(resampler,
+            (const char*) input, 4, (char*) output, sizeof(output));
+    int second = guac_rdp_audio_resampler_convert(resampler,
+            (const char*) (input + 2), 4, ((char*) output) + first,
+            sizeof(output) - first);
+
+    CU_ASSERT_EQUAL(first, 6);
+    CU_ASSERT_EQUAL(second, 8);
+
+    int16_t expected[] = { 0, 50, 100, 150, 200, 250, 300 };
+    CU_ASSERT_EQUAL(memcmp(expected, output, sizeof(expected)), 0);
+
+    guac_rdp_audio_resampler_free(resampler);
+
+}
+
+/**
+ * Test which verifies that stereo input is mixed down for monaural output
+ * and that output beyond the available space is dropped.
+ */
+void test_resampler__downmix_truncate() {
+
+    guac_rdp_audio_format in_format = { 8000, 2, 2 };
+    guac_rdp_audio_format out_format = { 8000, 1, 2 };
+    int16_t input[] = { 100, 300, -100, -300, 7, 7 };
+    int16_t output[2];
+
+    guac_rdp_audio_resampler* resampler = guac_rdp_audio_resampler_alloc();
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_reset(resampler,
+                &in_format, &out_format), 0);
+
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_convert(resampler,
+                (const char*) input, sizeof(input), (char*) output,
+                sizeof(output)), 6);
+
+    CU_ASSERT_EQUAL(output[0], 200);
+    CU_ASSERT_EQUAL(output[1], -200);
+
+    guac_rdp_audio_resampler_free(resampler);
+
+}
+
+/**
+ * Test which verifies that unsupported formats are rejected and that all
+ * audio is then dropped.
+ */
+void test_resampler__unsupported() {
+
+    guac_rdp_audio_format in_format = { 8000, 1, 3 };
+    guac_rdp_audio_format out_format = { 8000, 1, 2 };
+    char input[6] = { 0 };
+    char output[6];
+
+    guac_rdp_audio_resampler* resampler = guac_rdp_audio_resampler_alloc();
+    CU_ASSERT_NOT_EQUAL(guac_rdp_audio_resampler_reset(resampler,
+                &in_format, &out_format), 0);
+
+    CU_ASSERT_EQUAL(guac_rdp_audio_resampler_convert(resampler, input,
+                sizeof(input), output, sizeof(output)), 0);
+
+    guac_rdp_audio_resampler_free(resampler);
+
+}
+
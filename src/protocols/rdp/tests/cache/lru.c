@@ -0,0 +1,160 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "cache.h"
+
+#include <CUnit/CUnit.h>
+#include <string.h>
+
+/**
+ * The number of times test_evict() has been invoked since the counter was
+ * last reset.
+ */
+static int evict_count;
+
+/**
+ * The entry most recently passed to test_evict().
+ */
+static guac_rdp_cache_entry* last_evicted;
+
+/**
+ * Evict handler which records the entry being evicted within the
+ * evict_count and last_evicted variables.
+ *
+ * @param cache
+ *     The cache from which the entry is being evicted.
+ *
+ * @param entry
+ *     The entry being evicted.
+ */
+static void test_evict(guac_rdp_cache* cache, guac_rdp_cache_entry* entry) {
+    evict_count++;
+    last_evicted = entry;
+}
+
+/**
+ * Test which verifies that the least-recently-used entry is evicted when the
+ * memory limit of the cache is exceeded, and that touching an entry protects
+ * it from eviction.
+ */
+void test_cache__lru_eviction() {
+
+    guac_rdp_cache_entry a, b, c, d;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&c, 0, sizeof(c));
+    memset(&d, 0, sizeof(d));
+
+    evict_count = 0;
+    last_evicted = NULL;
+
+    guac_rdp_cache* cache = guac_rdp_cache_alloc(NULL, 300);
+
+    guac_rdp_cache_add(cache, &a, 100, test_evict, NULL);
+    guac_rdp_cache_add(cache, &b, 100, test_evict, NULL);
+    guac_rdp_cache_add(cache, &c, 100, test_evict, NULL);
+    CU_ASSERT_EQUAL(cache->size, 300);
+    CU_ASSERT_EQUAL(evict_count, 0);
+
+    /* A is now the most recently used, leaving B as the oldest */
+    guac_rdp_cache_touch(cache, &a);
+
+    guac_rdp_cache_add(cache, &d, 100, test_evict, NULL);
+    CU_ASSERT_EQUAL(evict_count, 1);
+    CU_ASSERT_PTR_EQUAL(last_evicted, &b);
+    CU_ASSERT_FALSE(b.cached);
+    CU_ASSERT_EQUAL(cache->size, 300);
+
+    /* Removal releases memory without invoking the evict handler */
+    guac_rdp_cache_remove(cache, &c);
+    CU_ASSERT_EQUAL(evict_count, 1);
+    CU_ASSERT_EQUAL(cache->size, 200);
+
+    /* Removing an entry which is not cached has no effect */
+    guac_rdp_cache_remove(cache, &b);
+    CU_ASSERT_EQUAL(cache->size, 200);
+
+    CU_ASSERT_EQUAL(cache->hits, 1);
+    CU_ASSERT_EQUAL(cache->evictions, 1);
+
+    guac_rdp_cache_free(cache);
+
+}
+
+/**
+ * Test which verifies that pinned entries count towards the memory used by
+ * the cache but are never evicted.
+ */
+void test_cache__pinned() {
+
+    guac_rdp_cache_entry a, b, c;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&c, 0, sizeof(c));
+
+    evict_count = 0;
+    last_evicted = NULL;
+
+    guac_rdp_cache* cache = guac_rdp_cache_alloc(NULL, 200);
+
+    guac_rdp_cache_add(cache, &a, 100, test_evict, NULL);
+    guac_rdp_cache_pin(cache, &a);
+    guac_rdp_cache_add(cache, &b, 100, test_evict, NULL);
+
+    /* Only B may be evicted to make room for C */
+    guac_rdp_cache_add(cache, &c, 100, test_evict, NULL);
+    CU_ASSERT_EQUAL(evict_count, 1);
+    CU_ASSERT_PTR_EQUAL(last_evicted, &b);
+    CU_ASSERT_TRUE(a.cached);
+    CU_ASSERT_EQUAL(cache->size, 200);
+
+    /* Pinned entries are released only when explicitly removed */
+    guac_rdp_cache_remove(cache, &a);
+    CU_ASSERT_EQUAL(cache->size, 100);
+
+    guac_rdp_cache_free(cache);
+
+}
+
+/**
+ * Test which verifies that a limit of zero allows the cache to grow without
+ * bound.
+ */
+void test_cache__unlimited() {
+
+    guac_rdp_cache_entry entries[16];
+    memset(entries, 0, sizeof(entries));
+
+    evict_count = 0;
+
+    guac_rdp_cache* cache = guac_rdp_cache_alloc(NULL, 0);
+
+    for (int i = 0; i < 16; i++)
+        guac_rdp_cache_add(cache, &entries[i], 1024 * 1024, test_evict, NULL);
+
+    CU_ASSERT_EQUAL(evict_count, 0);
+    CU_ASSERT_EQUAL(cache->size, 16 * 1024 * 1024);
+
+    guac_rdp_cache_miss(cache);
+    CU_ASSERT_EQUAL(cache->misses, 1);
+
+    guac_rdp_cache_free(cache);
+
+}
+
@@ -0,0 +1,137 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "fs-cache.h"
+
+#include <CUnit/CUnit.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Returns whether the given listing contains an entry having the given name.
+ *
+ * @param listing
+ *     The listing to search.
+ *
+ * @param name
+ *     The name of the entry to search for.
+ *
+ * @return
+ *     Non-zero if the listing contains the named entry, zero otherwise.
+ */
+static int test_listing_contains(guac_rdp_fs_listing* listing,
+        const char* name) {
+
+    for (int i = 0; i < listing->entry_count; i++) {
+        if (strcmp(listing->entries[i].name, name) == 0)
+            return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Creates an empty file having the given name within the given directory.
+ *
+ * @param dir
+ *     The directory to create the file within.
+ *
+ * @param name
+ *     The name of the file to create.
+ */
+static void test_create_file(const char* dir, const char* name) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    close(open(path, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR));
+}
+
+/**
+ * Test which verifies that an unchanged directory is listed only once, while
+ * any change to that directory results in a fresh listing.
+ */
+void test_fs__cache_invalidation() {
+
+    char dir[] = "/tmp/guac-fs-cache-XXXXXX";
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+
+    test_create_file(dir, "a");
+
+    guac_rdp_fs_cache* cache = guac_rdp_fs_cache_alloc();
+
+    guac_rdp_fs_listing* first = guac_rdp_fs_cache_get(cache, dir);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(first);
+    CU_ASSERT_TRUE(test_listing_contains(first, "a"));
+    CU_ASSERT_FALSE(test_listing_contains(first, "b"));
+
+    /* Unchanged directories must be served from the cache when watched */
+    guac_rdp_fs_listing* second = guac_rdp_fs_cache_get(cache, dir);
+    if (cache->inotify_fd != -1)
+        CU_ASSERT_PTR_EQUAL(second, first);
+    guac_rdp_fs_cache_release(cache, second);
+
+    /* Existing references remain usable after the directory changes */
+    test_create_file(dir, "b");
+    guac_rdp_fs_listing* third = guac_rdp_fs_cache_get(cache, dir);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(third);
+    CU_ASSERT_TRUE(test_listing_contains(third, "b"));
+    CU_ASSERT_FALSE(test_listing_contains(first, "b"));
+
+    guac_rdp_fs_cache_release(cache, first);
+    guac_rdp_fs_cache_release(cache, third);
+
+    /* Metadata must reflect writes to files within the directory */
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/a", dir);
+    int fd = open(path, O_WRONLY);
+    CU_ASSERT_EQUAL(write(fd, "test", 4), 4);
+    close(fd);
+
+    guac_rdp_fs_listing* fourth = guac_rdp_fs_cache_get(cache, dir);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fourth);
+    for (int i = 0; i < fourth->entry_count; i++) {
+        if (strcmp(fourth->entries[i].name, "a") == 0)
+            CU_ASSERT_EQUAL(fourth->entries[i].size, 4);
+    }
+    guac_rdp_fs_cache_release(cache, fourth);
+
+    guac_rdp_fs_cache_free(cache);
+
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/b", dir);
+    unlink(path);
+    rmdir(dir);
+
+}
+
+/**
+ * Test which verifies that listing a directory which does not exist fails.
+ */
+void test_fs__cache_missing() {
+
+    guac_rdp_fs_cache* cache = guac_rdp_fs_cache_alloc();
+    CU_ASSERT_PTR_NULL(guac_rdp_fs_cache_get(cache,
+                "/tmp/guac-fs-cache-does-not-exist"));
+    guac_rdp_fs_cache_free(cache);
+
+}
+
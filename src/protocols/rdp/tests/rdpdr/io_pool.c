@@ -0,0 +1,227 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "channels/rdpdr/rdpdr-io-pool.h"
+
+#include <CUnit/CUnit.h>
+#include <pthread.h>
+
+/**
+ * The number of threads within each pool tested.
+ */
+#define TEST_THREADS 4
+
+/**
+ * The number of jobs submitted by tests which submit many jobs.
+ */
+#define TEST_JOBS 64
+
+/**
+ * A gate which jobs may wait on, along with a count of finished jobs.
+ */
+typedef struct test_gate {
+
+    /**
+     * Lock guarding all other members.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition signalled whenever the gate is opened.
+     */
+    pthread_cond_t opened;
+
+    /**
+     * Non-zero if jobs waiting on the gate may proceed, zero otherwise.
+     */
+    int open;
+
+    /**
+     * The number of jobs which have finished.
+     */
+    int finished;
+
+} test_gate;
+
+/**
+ * Initializes the given gate as closed, with no finished jobs.
+ *
+ * @param gate
+ *     The gate to initialize.
+ */
+static void test_gate_init(test_gate* gate) {
+    pthread_mutex_init(&(gate->lock), NULL);
+    pthread_cond_init(&(gate->opened), NULL);
+    gate->open = 0;
+    gate->finished = 0;
+}
+
+/**
+ * Opens the given gate, allowing all jobs waiting on it to finish.
+ *
+ * @param gate
+ *     The gate to open.
+ */
+static void test_gate_open(test_gate* gate) {
+    pthread_mutex_lock(&(gate->lock));
+    gate->open = 1;
+    pthread_cond_broadcast(&(gate->opened));
+    pthread_mutex_unlock(&(gate->lock));
+}
+
+/**
+ * Returns the number of jobs which have finished.
+ *
+ * @param gate
+ *     The gate tracking the finished jobs.
+ *
+ * @return
+ *     The number of jobs which have finished.
+ */
+static int test_gate_finished(test_gate* gate) {
+    pthread_mutex_lock(&(gate->lock));
+    int finished = gate->finished;
+    pthread_mutex_unlock(&(gate->lock));
+    return finished;
+}
+
+/**
+ * Job handler which records that the job has finished without waiting.
+ *
+ * @param data
+ *     The test_gate tracking finished jobs.
+ */
+static void test_job_immediate(void* data) {
+    test_gate* gate = (test_gate*) data;
+    pthread_mutex_lock(&(gate->lock));
+    gate->finished++;
+    pthread_mutex_unlock(&(gate->lock));
+}
+
+/**
+ * Job handler which waits for the given gate to open before recording that
+ * the job has finished.
+ *
+ * @param data
+ *     The test_gate to wait on.
+ */
+static void test_job_gated(void* data) {
+    test_gate* gate = (test_gate*) data;
+    pthread_mutex_lock(&(gate->lock));
+    while (!gate->open)
+        pthread_cond_wait(&(gate->opened), &(gate->lock));
+    gate->finished++;
+    pthread_mutex_unlock(&(gate->lock));
+}
+
+/**
+ * Verifies that jobs submitted to a pool are performed, and that
+ * guac_rdpdr_io_pool_flush() returns only once all submitted jobs have
+ * finished.
+ */
+void test_rdpdr__io_pool_flush() {
+
+    test_gate gate;
+    test_gate_init(&gate);
+
+    guac_rdpdr_io_pool* pool = guac_rdpdr_io_pool_alloc(TEST_THREADS);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(pool);
+
+    for (int i = 0; i < TEST_JOBS; i++)
+        CU_ASSERT_EQUAL(guac_rdpdr_io_pool_submit(pool, i % 3,
+                    test_job_immediate, &gate), 0);
+
+    guac_rdpdr_io_pool_flush(pool);
+    CU_ASSERT_EQUAL(test_gate_finished(&gate), TEST_JOBS);
+
+    guac_rdpdr_io_pool_free(pool);
+
+}
+
+/**
+ * Verifies that guac_rdpdr_io_pool_wait() waits for jobs with the given key
+ * without waiting for jobs with other keys, even if those jobs are blocked
+ * indefinitely.
+ */
+void test_rdpdr__io_pool_wait() {
+
+    test_gate blocked;
+    test_gate_init(&blocked);
+
+    test_gate immediate;
+    test_gate_init(&immediate);
+
+    guac_rdpdr_io_pool* pool = guac_rdpdr_io_pool_alloc(TEST_THREADS);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(pool);
+
+    /* Occupy all but one thread with jobs that cannot finish */
+    for (int i = 0; i < TEST_THREADS - 1; i++)
+        CU_ASSERT_EQUAL(guac_rdpdr_io_pool_submit(pool, 1,
+                    test_job_gated, &blocked), 0);
+
+    for (int i = 0; i < TEST_JOBS; i++)
+        CU_ASSERT_EQUAL(guac_rdpdr_io_pool_submit(pool, 2,
+                    test_job_immediate, &immediate), 0);
+
+    /* Waiting on the unblocked key must not wait on the blocked jobs */
+    guac_rdpdr_io_pool_wait(pool, 2);
+    CU_ASSERT_EQUAL(test_gate_finished(&immediate), TEST_JOBS);
+    CU_ASSERT_EQUAL(test_gate_finished(&blocked), 0);
+
+    /* Waiting on a key with no jobs returns immediately */
+    guac_rdpdr_io_pool_wait(pool, 3);
+
+    /* Waiting on the blocked key returns once those jobs finish */
+    test_gate_open(&blocked);
+    guac_rdpdr_io_pool_wait(pool, 1);
+    CU_ASSERT_EQUAL(test_gate_finished(&blocked), TEST_THREADS - 1);
+
+    guac_rdpdr_io_pool_free(pool);
+
+}
+
+/**
+ * Verifies that freeing a pool performs all jobs still queued before
+ * stopping the threads of the pool.
+ */
+void test_rdpdr__io_pool_drain() {
+
+    test_gate gate;
+    test_gate_init(&gate);
+
+    guac_rdpdr_io_pool* pool = guac_rdpdr_io_pool_alloc(TEST_THREADS);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(pool);
+
+    /* Queue more jobs than threads behind jobs that cannot yet finish */
+    for (int i = 0; i < TEST_THREADS; i++)
+        CU_ASSERT_EQUAL(guac_rdpdr_io_pool_submit(pool, i,
+                    test_job_gated, &gate), 0);
+
+    for (int i = 0; i < TEST_JOBS; i++)
+        CU_ASSERT_EQUAL(guac_rdpdr_io_pool_submit(pool, i,
+                    test_job_immediate, &gate), 0);
+
+    CU_ASSERT_EQUAL(test_gate_finished(&gate), 0);
+
+    test_gate_open(&gate);
+    guac_rdpdr_io_pool_free(pool);
+
+    CU_ASSERT_EQUAL(test_gate_finished(&gate), TEST_THREADS + TEST_JOBS);
+
+}
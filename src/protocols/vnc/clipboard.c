@@ -31,6 +31,9 @@
 #include <rfb/rfbclient.h>
 #include <rfb/rfbproto.h>
 
+#include <pthread.h>
+#include <stdlib.h>
+
 int guac_vnc_set_clipboard_encoding(guac_client* client,
         const char* name) {
 
@@ -103,20 +106,23 @@ int guac_vnc_clipboard_end_handler(guac_user* user, guac_stream* stream) {
     guac_vnc_client* vnc_client = (guac_vnc_client*) user->client->data;
     rfbClient* rfb_client = vnc_client->rfb_client;
 
-    char output_data[GUAC_COMMON_CLIPBOARD_MAX_LENGTH];
+    char* output_data = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
 
-    const char* input = vnc_client->clipboard->buffer;
     char* output = output_data;
     guac_iconv_write* writer = vnc_client->clipboard_writer;
 
     /* Convert clipboard contents */
+    pthread_mutex_lock(&(vnc_client->clipboard->lock));
+    const char* input = vnc_client->clipboard->buffer;
     guac_iconv(GUAC_READ_UTF8, &input, vnc_client->clipboard->length,
-               writer, &output, sizeof(output_data));
+               writer, &output, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+    pthread_mutex_unlock(&(vnc_client->clipboard->lock));
 
     /* Send via VNC only if finished connecting */
     if (rfb_client != NULL)
         SendClientCutText(rfb_client, output_data, output - output_data);
 
+    free(output_data);
     return 0;
 }
 
@@ -129,7 +135,7 @@ void guac_vnc_cut_text(rfbClient* client, const char* text, int textlen) {
     if (vnc_client->settings->disable_copy)
         return;
 
-    char received_data[GUAC_COMMON_CLIPBOARD_MAX_LENGTH];
+    char* received_data = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
 
     const char* input = text;
     char* output = received_data;
@@ -137,12 +143,14 @@ void guac_vnc_cut_text(rfbClient* client, const char* text, int textlen) {
 
     /* Convert clipboard contents */
     guac_iconv(reader, &input, textlen,
-               GUAC_WRITE_UTF8, &output, sizeof(received_data));
+               GUAC_WRITE_UTF8, &output, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
 
     /* Send converted data */
     guac_common_clipboard_reset(vnc_client->clipboard, "text/plain");
     guac_common_clipboard_append(vnc_client->clipboard, received_data, output - received_data);
     guac_common_clipboard_send(vnc_client->clipboard, gc);
 
+    free(received_data);
+
 }
 
@@ -0,0 +1,152 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "harness.h"
+#include "terminal/terminal.h"
+
+#include <guacamole/client.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The width of the terminal display, in pixels.
+ */
+#define BENCH_TERMINAL_WIDTH 1024
+
+/**
+ * The height of the terminal display, in pixels.
+ */
+#define BENCH_TERMINAL_HEIGHT 768
+
+/**
+ * The DPI of the terminal display.
+ */
+#define BENCH_TERMINAL_DPI 96
+
+/**
+ * The number of bytes written to the terminal by each iteration of the
+ * terminal benchmarks. This is comparable to the output of a command listing
+ * a large directory.
+ */
+#define BENCH_TERMINAL_LENGTH 65536
+
+/**
+ * Output to be written to the terminal.
+ */
+typedef struct bench_terminal_output {
+
+    /**
+     * The terminal receiving the output.
+     */
+    guac_terminal* terminal;
+
+    /**
+     * The output to write.
+     */
+    char data[BENCH_TERMINAL_LENGTH];
+
+    /**
+     * The number of bytes of output to write.
+     */
+    int length;
+
+} bench_terminal_output;
+
+static void bench_terminal_write(void* data) {
+    bench_terminal_output* output = (bench_terminal_output*) data;
+    guac_terminal_write(output->terminal, output->data, output->length);
+}
+
+/**
+ * Fills the given output with lines of text resembling a directory listing,
+ * stopping before the capacity of the output would be exceeded.
+ *
+ * @param output
+ *     The output to fill.
+ *
+ * @param color
+ *     Non-zero if each line should use ANSI escape sequences to color its
+ *     contents, zero if each line should be plain text.
+ */
+static void bench_terminal_fill(bench_terminal_output* output, int color) {
+
+    char line[256];
+    output->length = 0;
+
+    for (int i = 0;; i++) {
+
+        int length;
+
+        /* Lines resembling the output of "ls -l", optionally colorized */
+        if (color)
+            length = snprintf(line, sizeof(line), "-rw-r--r-- 1 guacd guacd "
+                    "%8i Jan  1 00:00 \x1B[01;3%im%08x.dat\x1B[0m\r\n",
+                    rand() % 100000, 1 + i % 7, rand());
+        else
+            length = snprintf(line, sizeof(line), "-rw-r--r-- 1 guacd guacd "
+                    "%8i Jan  1 00:00 %08x.dat\r\n",
+                    rand() % 100000, rand());
+
+        if (output->length + length > sizeof(output->data))
+            break;
+
+        memcpy(output->data + output->length, line, length);
+        output->length += length;
+
+    }
+
+}
+
+void bench_terminal() {
+
+    /* Output is broadcast to zero users and thus discarded */
+    guac_client* client = guac_client_alloc();
+    if (client == NULL)
+        return;
+
+    guac_terminal_options* options = guac_terminal_options_create(
+            BENCH_TERMINAL_WIDTH, BENCH_TERMINAL_HEIGHT, BENCH_TERMINAL_DPI);
+
+    guac_terminal* terminal = guac_terminal_create(client, options);
+    free(options);
+
+    if (terminal == NULL) {
+        guac_client_free(client);
+        return;
+    }
+
+    bench_terminal_output* output = malloc(sizeof(bench_terminal_output));
+    output->terminal = terminal;
+
+    bench_terminal_fill(output, 0);
+    guac_bench_run("terminal_write_plain", bench_terminal_write, output,
+            output->length);
+
+    bench_terminal_fill(output, 1);
+    guac_bench_run("terminal_write_color", bench_terminal_write, output,
+            output->length);
+
+    free(output);
+    guac_terminal_free(terminal);
+    guac_client_free(client);
+
+}
+
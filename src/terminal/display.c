@@ -257,6 +257,11 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     display->width = 0;
     display->height = 0;
     display->operations = NULL;
+    display->dirty_rows = NULL;
+    display->rects = NULL;
+    display->rects_available = 0;
+    display->open_rects = NULL;
+    display->next_open_rects = NULL;
 
     /* Initially nothing selected */
     display->text_selected = false;
@@ -283,6 +288,10 @@ void guac_terminal_display_free(guac_terminal_display* display) {
 
     /* Free operations buffers */
     free(display->operations);
+    free(display->dirty_rows);
+    free(display->rects);
+    free(display->open_rects);
+    free(display->next_open_rects);
 
     /* Free display */
     free(display);
@@ -345,6 +354,46 @@ int guac_terminal_display_lookup_color(guac_terminal_display* display,
 
 }
 
+/**
+ * Marks the given range of rows as having pending operations, such that they
+ * will be considered during the next flush.
+ *
+ * @param display
+ *     The display containing the rows.
+ *
+ * @param start_row
+ *     The first row to mark.
+ *
+ * @param end_row
+ *     The last row to mark, inclusive.
+ */
+static void __guac_terminal_display_mark_dirty(guac_terminal_display* display,
+        int start_row, int end_row) {
+
+    for (int row = start_row; row <= end_row; row++)
+        display->dirty_rows[row / 64] |= UINT64_C(1) << (row % 64);
+
+}
+
+/**
+ * Returns whether the given row has been marked as having pending
+ * operations since the last flush.
+ *
+ * @param display
+ *     The display containing the row.
+ *
+ * @param row
+ *     The row to test.
+ *
+ * @return
+ *     Non-zero if the row may contain pending operations, zero if the row
+ *     contains only GUAC_CHAR_NOP operations.
+ */
+static int __guac_terminal_display_is_dirty(guac_terminal_display* display,
+        int row) {
+    return (display->dirty_rows[row / 64] >> (row % 64)) & 1;
+}
+
 void guac_terminal_display_copy_columns(guac_terminal_display* display, int row,
         int start_column, int end_column, int offset) {
 
@@ -369,6 +418,8 @@ void guac_terminal_display_copy_columns(guac_terminal_display* display, int row,
     memmove(current, src_current,
         (end_column - start_column + 1) * sizeof(guac_terminal_operation));
 
+    __guac_terminal_display_mark_dirty(display, row, row);
+
     /* Update operations */
     for (i=start_column; i<=end_column; i++) {
 
@@ -406,6 +457,9 @@ void guac_terminal_display_copy_rows(guac_terminal_display* display,
     memmove(current_row, src_current_row,
         (end_row - start_row + 1) * sizeof(guac_terminal_operation) * display->width);
 
+    __guac_terminal_display_mark_dirty(display,
+            start_row + offset, end_row + offset);
+
     /* Update operations */
     for (row=start_row; row<=end_row; row++) {
 
@@ -450,6 +504,7 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
     end_column   = guac_terminal_fit_to_range(end_column,   0, display->width - 1);
 
     current = &(display->operations[row * display->width + start_column]);
+    __guac_terminal_display_mark_dirty(display, row, row);
 
     /* For each column in range */
     for (i = start_column; i <= end_column; i += character->width) {
@@ -492,6 +547,16 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
     display->operations = malloc(width * height *
             sizeof(guac_terminal_operation));
 
+    /* All rows must be considered at least once after resize */
+    free(display->dirty_rows);
+    display->dirty_rows = calloc((height + 63) / 64, sizeof(uint64_t));
+
+    /* Reallocate storage for merging, which is indexed by column */
+    free(display->open_rects);
+    free(display->next_open_rects);
+    display->open_rects = malloc(width * sizeof(int));
+    display->next_open_rects = malloc(width * sizeof(int));
+
     /* Init each operation buffer row */
     current = display->operations;
     for (y=0; y<height; y++) {
@@ -519,6 +584,8 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
     display->width = width;
     display->height = height;
 
+    __guac_terminal_display_mark_dirty(display, 0, height - 1);
+
     /* Send display size */
     guac_common_surface_resize(
             display->display_surface,
@@ -532,261 +599,369 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
 
 }
 
-void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
-
-    guac_terminal_operation* current = display->operations;
-    int row, col;
+/**
+ * The state of a merge of horizontal runs of identical operations into
+ * rectangles, performed in a single pass over the rows of a display.
+ */
+typedef struct guac_terminal_display_merge {
+
+    /**
+     * The display whose operations are being merged. The rectangles found are
+     * stored within the rects array of this display.
+     */
+    guac_terminal_display* display;
+
+    /**
+     * The number of rectangles found so far, in order of their top-left
+     * corner.
+     */
+    int count;
+
+    /**
+     * The number of rectangles which include the previous row.
+     */
+    int open_count;
+
+    /**
+     * The index within open_rects of the first rectangle which has not yet
+     * been compared against a run within the current row.
+     */
+    int open_position;
+
+    /**
+     * The number of rectangles which include the current row.
+     */
+    int next_open_count;
+
+} guac_terminal_display_merge;
 
-    /* For each operation */
-    for (row=0; row<display->height; row++) {
-        for (col=0; col<display->width; col++) {
+/**
+ * Returns whether the given rectangle and run of operations describe the
+ * same drawing operation, such that the run may extend the rectangle
+ * downward if it is positioned appropriately.
+ *
+ * @param rect
+ *     The rectangle which may be extended.
+ *
+ * @param run
+ *     The run of operations within a single row.
+ *
+ * @param type
+ *     The type of operations being merged, either GUAC_CHAR_COPY or
+ *     GUAC_CHAR_SET.
+ *
+ * @return
+ *     Non-zero if the rectangle and run describe the same drawing operation,
+ *     zero otherwise.
+ */
+static int __guac_terminal_display_rect_matches(
+        const guac_terminal_display_rect* rect,
+        const guac_terminal_display_rect* run,
+        guac_terminal_operation_type type) {
 
-            /* If operation is a copy operation */
-            if (current->type == GUAC_CHAR_COPY) {
+    if (type == GUAC_CHAR_COPY)
+        return rect->row_offset == run->row_offset
+            && rect->column_offset == run->column_offset;
 
-                /* The determined bounds of the rectangle of contiguous
-                 * operations */
-                int detected_right = -1;
-                int detected_bottom = row;
+    return guac_terminal_colorcmp(&rect->color, &run->color) == 0;
 
-                /* The current row or column within a rectangle */
-                int rect_row, rect_col;
+}
 
-                /* The dimensions of the rectangle as determined */
-                int rect_width, rect_height;
+/**
+ * Begins a new rectangle covering the given columns of the given run of
+ * operations within the current row.
+ *
+ * @param merge
+ *     The in-progress merge.
+ *
+ * @param run
+ *     The run of operations containing the columns.
+ *
+ * @param left
+ *     The leftmost column of the new rectangle.
+ *
+ * @param right
+ *     The rightmost column of the new rectangle, inclusive.
+ */
+static void __guac_terminal_display_merge_begin(
+        guac_terminal_display_merge* merge,
+        const guac_terminal_display_rect* run, int left, int right) {
 
-                /* The expected row and column source for the next copy
-                 * operation (if adjacent to current) */
-                int expected_row, expected_col;
+    guac_terminal_display* display = merge->display;
 
-                /* Current row within a subrect */
-                guac_terminal_operation* rect_current_row;
+    /* Grow storage as necessary */
+    if (merge->count == display->rects_available) {
+        display->rects_available = display->rects_available * 2 + 64;
+        display->rects = realloc(display->rects, display->rects_available
+                * sizeof(guac_terminal_display_rect));
+    }
 
-                /* Determine bounds of rectangle */
-                rect_current_row = current;
-                expected_row = current->row;
-                for (rect_row=row; rect_row<display->height; rect_row++) {
+    guac_terminal_display_rect* rect = &(display->rects[merge->count]);
+    *rect = *run;
+    rect->left = left;
+    rect->right = right;
 
-                    guac_terminal_operation* rect_current = rect_current_row;
-                    expected_col = current->column;
+    display->next_open_rects[merge->next_open_count++] = merge->count++;
 
-                    /* Find width */
-                    for (rect_col=col; rect_col<display->width; rect_col++) {
+}
 
-                        /* If not identical operation, stop */
-                        if (rect_current->type != GUAC_CHAR_COPY
-                                || rect_current->row != expected_row
-                                || rect_current->column != expected_col)
-                            break;
+/**
+ * Adds the given run of operations within the current row. Each rectangle
+ * including the previous row which describes the same drawing operation and
+ * lies entirely within the run is extended downward to include the current
+ * row. New rectangles are begun for any remaining portions of the run. Runs
+ * must be added in order of column.
+ *
+ * This produces the same rectangles as growing each rectangle downward from
+ * its top-left corner for as long as the row below continues the operation
+ * for at least the rectangle's width, but without rescanning any row.
+ *
+ * @param merge
+ *     The in-progress merge.
+ *
+ * @param run
+ *     The run of operations to add. The top and bottom of the run must both
+ *     be the current row.
+ *
+ * @param type
+ *     The type of operations being merged, either GUAC_CHAR_COPY or
+ *     GUAC_CHAR_SET.
+ */
+static void __guac_terminal_display_merge_run(guac_terminal_display_merge* merge,
+        const guac_terminal_display_rect* run,
+        guac_terminal_operation_type type) {
 
-                        /* Next column */
-                        rect_current++;
-                        expected_col++;
+    guac_terminal_display* display = merge->display;
+    int left = run->left;
 
-                    }
+    /* Skip rectangles which begin to the left of this run */
+    while (merge->open_position < merge->open_count
+            && display->rects[display->open_rects[merge->open_position]].left
+                < run->left)
+        merge->open_position++;
 
-                    /* If too small, cannot append row */
-                    if (rect_col-1 < detected_right)
-                        break;
+    /* Extend all matching rectangles which lie within this run */
+    while (merge->open_position < merge->open_count) {
 
-                    /* As row has been accepted, update rect_row of rect */
-                    detected_bottom = rect_row;
+        int index = display->open_rects[merge->open_position];
+        guac_terminal_display_rect* rect = &(display->rects[index]);
 
-                    /* For now, only set rect_col bound if uninitialized */
-                    if (detected_right == -1)
-                        detected_right = rect_col - 1;
+        /* Remaining rectangles are beyond this run */
+        if (rect->right > run->right)
+            break;
 
-                    /* Next row */
-                    rect_current_row += display->width;
-                    expected_row++;
+        merge->open_position++;
 
-                }
+        if (!__guac_terminal_display_rect_matches(rect, run, type))
+            continue;
 
-                /* Calculate dimensions */
-                rect_width  = detected_right  - col + 1;
-                rect_height = detected_bottom - row + 1;
+        /* Cover any portion of the run left of the rectangle separately */
+        if (left < rect->left)
+            __guac_terminal_display_merge_begin(merge, run,
+                    left, rect->left - 1);
 
-                /* Mark rect as NOP (as it has been handled) */
-                rect_current_row = current;
-                expected_row = current->row;
-                for (rect_row=0; rect_row<rect_height; rect_row++) {
-                    
-                    guac_terminal_operation* rect_current = rect_current_row;
-                    expected_col = current->column;
+        rect->bottom = run->bottom;
+        display->next_open_rects[merge->next_open_count++] = index;
+        left = rect->right + 1;
 
-                    for (rect_col=0; rect_col<rect_width; rect_col++) {
+    }
 
-                        /* Mark copy operations as NOP */
-                        if (rect_current->type == GUAC_CHAR_COPY
-                                && rect_current->row == expected_row
-                                && rect_current->column == expected_col)
-                            rect_current->type = GUAC_CHAR_NOP;
+    /* Cover any remaining portion of the run */
+    if (left <= run->right)
+        __guac_terminal_display_merge_begin(merge, run, left, run->right);
 
-                        /* Next column */
-                        rect_current++;
-                        expected_col++;
+}
 
-                    }
+/**
+ * Completes the current row of the given merge, such that only rectangles
+ * including the current row may be extended by runs within the next row.
+ *
+ * @param merge
+ *     The in-progress merge.
+ */
+static void __guac_terminal_display_merge_next_row(
+        guac_terminal_display_merge* merge) {
 
-                    /* Next row */
-                    rect_current_row += display->width;
-                    expected_row++;
+    guac_terminal_display* display = merge->display;
 
-                }
+    int* open_rects = display->open_rects;
+    display->open_rects = display->next_open_rects;
+    display->next_open_rects = open_rects;
 
-                /* Send copy */
-                guac_common_surface_copy(
+    merge->open_count = merge->next_open_count;
+    merge->open_position = 0;
+    merge->next_open_count = 0;
 
-                        display->display_surface,
-                        current->column * display->char_width,
-                        current->row * display->char_height,
-                        rect_width * display->char_width,
-                        rect_height * display->char_height,
+}
 
-                        display->display_surface,
-                        col * display->char_width,
-                        row * display->char_height);
+void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
 
-            } /* end if copy operation */
+    guac_terminal_display_merge merge = { .display = display };
+    int row, col;
 
-            /* Next operation */
-            current++;
+    /* Find runs of copies from contiguous source cells in each row */
+    for (row=0; row<display->height; row++) {
 
+        /* Rows without changes can neither contain nor extend a copy */
+        if (!__guac_terminal_display_is_dirty(display, row)) {
+            __guac_terminal_display_merge_next_row(&merge);
+            continue;
         }
-    }
 
-}
+        guac_terminal_operation* current =
+            &(display->operations[row * display->width]);
 
-void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
+        for (col=0; col<display->width;) {
 
-    guac_terminal_operation* current = display->operations;
-    int row, col;
+            /* Skip anything other than a copy */
+            if (current[col].type != GUAC_CHAR_COPY) {
+                col++;
+                continue;
+            }
 
-    /* For each operation */
-    for (row=0; row<display->height; row++) {
-        for (col=0; col<display->width; col++) {
+            guac_terminal_display_rect run = {
+                .left = col,
+                .top = row,
+                .bottom = row,
+                .row_offset = current[col].row - row,
+                .column_offset = current[col].column - col
+            };
+
+            /* Consume all copies having the same source offset, marking
+             * each as NOP (as it will be handled) */
+            while (col < display->width
+                    && current[col].type == GUAC_CHAR_COPY
+                    && current[col].row - row == run.row_offset
+                    && current[col].column - col == run.column_offset) {
+                current[col].type = GUAC_CHAR_NOP;
+                col++;
+            }
 
-            /* If operation is a cler operation (set to space) */
-            if (current->type == GUAC_CHAR_SET &&
-                    !guac_terminal_has_glyph(current->character.value)) {
+            run.right = col - 1;
+            __guac_terminal_display_merge_run(&merge, &run, GUAC_CHAR_COPY);
 
-                /* The determined bounds of the rectangle of contiguous
-                 * operations */
-                int detected_right = -1;
-                int detected_bottom = row;
+        }
 
-                /* The current row or column within a rectangle */
-                int rect_row, rect_col;
+        __guac_terminal_display_merge_next_row(&merge);
 
-                /* The dimensions of the rectangle as determined */
-                int rect_width, rect_height;
+    }
 
-                /* Color of the rectangle to draw */
-                guac_terminal_color color;
-                if (current->character.attributes.reverse != current->character.attributes.cursor)
-                   color = current->character.attributes.foreground;
-                else
-                   color = current->character.attributes.background;
+    /* Send copies in order of their top-left corner */
+    for (int i = 0; i < merge.count; i++) {
 
-                /* Rely only on palette index if defined */
-                guac_terminal_display_lookup_color(display,
-                        color.palette_index, &color);
+        guac_terminal_display_rect* rect = &(display->rects[i]);
 
-                /* Current row within a subrect */
-                guac_terminal_operation* rect_current_row;
+        guac_common_surface_copy(
 
-                /* Determine bounds of rectangle */
-                rect_current_row = current;
-                for (rect_row=row; rect_row<display->height; rect_row++) {
+                display->display_surface,
+                (rect->left + rect->column_offset) * display->char_width,
+                (rect->top + rect->row_offset) * display->char_height,
+                (rect->right - rect->left + 1) * display->char_width,
+                (rect->bottom - rect->top + 1) * display->char_height,
 
-                    guac_terminal_operation* rect_current = rect_current_row;
+                display->display_surface,
+                rect->left * display->char_width,
+                rect->top * display->char_height);
 
-                    /* Find width */
-                    for (rect_col=col; rect_col<display->width; rect_col++) {
+    }
 
-                        const guac_terminal_color* joining_color;
-                        if (rect_current->character.attributes.reverse != rect_current->character.attributes.cursor)
-                           joining_color = &rect_current->character.attributes.foreground;
-                        else
-                           joining_color = &rect_current->character.attributes.background;
+}
 
-                        /* If not identical operation, stop */
-                        if (rect_current->type != GUAC_CHAR_SET
-                                || guac_terminal_has_glyph(rect_current->character.value)
-                                || guac_terminal_colorcmp(joining_color, &color) != 0)
-                            break;
+/**
+ * Returns the color that would be visible within the given cell if its
+ * character were blank, taking into account reverse video and the cursor.
+ *
+ * @param operation
+ *     The GUAC_CHAR_SET operation whose color should be returned.
+ *
+ * @return
+ *     The color of the cell, which may be specified only by palette index.
+ */
+static const guac_terminal_color* __guac_terminal_display_clear_color(
+        const guac_terminal_operation* operation) {
 
-                        /* Next column */
-                        rect_current++;
+    const guac_terminal_attributes* attributes =
+        &(operation->character.attributes);
 
-                    }
+    if (attributes->reverse != attributes->cursor)
+        return &(attributes->foreground);
 
-                    /* If too small, cannot append row */
-                    if (rect_col-1 < detected_right)
-                        break;
+    return &(attributes->background);
 
-                    /* As row has been accepted, update rect_row of rect */
-                    detected_bottom = rect_row;
+}
 
-                    /* For now, only set rect_col bound if uninitialized */
-                    if (detected_right == -1)
-                        detected_right = rect_col - 1;
+void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 
-                    /* Next row */
-                    rect_current_row += display->width;
+    guac_terminal_display_merge merge = { .display = display };
+    int row, col;
 
-                }
+    /* Find runs of same-colored clears (sets to space) in each row */
+    for (row=0; row<display->height; row++) {
 
-                /* Calculate dimensions */
-                rect_width  = detected_right  - col + 1;
-                rect_height = detected_bottom - row + 1;
+        /* Rows without changes can neither contain nor extend a clear */
+        if (!__guac_terminal_display_is_dirty(display, row)) {
+            __guac_terminal_display_merge_next_row(&merge);
+            continue;
+        }
 
-                /* Mark rect as NOP (as it has been handled) */
-                rect_current_row = current;
-                for (rect_row=0; rect_row<rect_height; rect_row++) {
-                    
-                    guac_terminal_operation* rect_current = rect_current_row;
+        guac_terminal_operation* current =
+            &(display->operations[row * display->width]);
 
-                    for (rect_col=0; rect_col<rect_width; rect_col++) {
+        for (col=0; col<display->width;) {
 
-                        const guac_terminal_color* joining_color;
-                        if (rect_current->character.attributes.reverse != rect_current->character.attributes.cursor)
-                           joining_color = &rect_current->character.attributes.foreground;
-                        else
-                           joining_color = &rect_current->character.attributes.background;
+            /* Skip anything other than a clear */
+            if (current[col].type != GUAC_CHAR_SET
+                    || guac_terminal_has_glyph(current[col].character.value)) {
+                col++;
+                continue;
+            }
 
-                        /* Mark clear operations as NOP */
-                        if (rect_current->type == GUAC_CHAR_SET
-                                && !guac_terminal_has_glyph(rect_current->character.value)
-                                && guac_terminal_colorcmp(joining_color, &color) == 0)
-                            rect_current->type = GUAC_CHAR_NOP;
+            guac_terminal_display_rect run = {
+                .left = col,
+                .top = row,
+                .bottom = row,
+                .color = *__guac_terminal_display_clear_color(&current[col])
+            };
+
+            /* Rely only on palette index if defined */
+            guac_terminal_display_lookup_color(display,
+                    run.color.palette_index, &run.color);
+
+            /* Consume all clears of the same color, marking each as NOP (as
+             * it will be handled) */
+            while (col < display->width
+                    && current[col].type == GUAC_CHAR_SET
+                    && !guac_terminal_has_glyph(current[col].character.value)
+                    && guac_terminal_colorcmp(
+                        __guac_terminal_display_clear_color(&current[col]),
+                        &run.color) == 0) {
+                current[col].type = GUAC_CHAR_NOP;
+                col++;
+            }
 
-                        /* Next column */
-                        rect_current++;
+            run.right = col - 1;
+            __guac_terminal_display_merge_run(&merge, &run, GUAC_CHAR_SET);
 
-                    }
+        }
 
-                    /* Next row */
-                    rect_current_row += display->width;
+        __guac_terminal_display_merge_next_row(&merge);
 
-                }
+    }
 
-                /* Send rect */
-                guac_common_surface_set(
-                        display->display_surface,
-                        col * display->char_width,
-                        row * display->char_height,
-                        rect_width * display->char_width,
-                        rect_height * display->char_height,
-                        color.red, color.green, color.blue,
-                        0xFF);
+    /* Send rects in order of their top-left corner */
+    for (int i = 0; i < merge.count; i++) {
 
-            } /* end if clear operation */
+        guac_terminal_display_rect* rect = &(display->rects[i]);
 
-            /* Next operation */
-            current++;
+        guac_common_surface_set(
+                display->display_surface,
+                rect->left * display->char_width,
+                rect->top * display->char_height,
+                (rect->right - rect->left + 1) * display->char_width,
+                (rect->bottom - rect->top + 1) * display->char_height,
+                rect->color.red, rect->color.green, rect->color.blue,
+                0xFF);
 
-        }
     }
 
 }
@@ -799,6 +974,13 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 
     /* For each operation */
     for (row=0; row<display->height; row++) {
+
+        /* Skip rows without changes */
+        if (!__guac_terminal_display_is_dirty(display, row)) {
+            current += display->width;
+            continue;
+        }
+
         for (col=0; col<display->width; col++) {
 
             /* Perform given operation */
@@ -837,6 +1019,11 @@ void guac_terminal_display_flush(guac_terminal_display* display) {
     __guac_terminal_display_flush_clear(display);
     __guac_terminal_display_flush_set(display);
 
+    /* All operations have now been handled */
+    if (display->dirty_rows != NULL)
+        memset(display->dirty_rows, 0,
+                (display->height + 63) / 64 * sizeof(uint64_t));
+
     /* Flush surface */
     guac_common_surface_flush(display->display_surface);
 
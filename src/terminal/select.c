@@ -374,9 +374,10 @@ void guac_terminal_select_end(guac_terminal* terminal) {
 
     }
 
-    /* Send data */
+    /* Send data without waiting for acknowledgements, as the terminal is
+     * locked for the duration */
     if (!terminal->disable_copy) {
-        guac_common_clipboard_send(terminal->clipboard, client);
+        guac_common_clipboard_send_unpaced(terminal->clipboard, client);
         guac_socket_flush(socket);
     }
 
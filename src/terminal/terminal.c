@@ -49,6 +49,7 @@
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
 #include <guacamole/timestamp.h>
+#include <guacamole/user.h>
 
 /**
  * Sets the given range of columns to the given character.
@@ -468,6 +469,7 @@ guac_terminal* guac_terminal_create(guac_client* client,
 
     /* Init modified flag and conditional */
     term->modified = 0;
+    term->echo_state = 0;
     pthread_cond_init(&(term->modified_cond), NULL);
     pthread_mutex_init(&(term->modified_lock), NULL);
 
@@ -731,6 +733,107 @@ wait_complete:
 
 }
 
+/**
+ * Callback for guac_client_foreach_user() which determines how far the given
+ * user has fallen behind the stream of frames, beyond what is explained by
+ * network latency, updating the maximum lag accordingly.
+ *
+ * @param user
+ *     The user whose lag should be considered.
+ *
+ * @param data
+ *     A pointer to an int containing the largest lag found so far, in
+ *     milliseconds.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __guac_terminal_calculate_lag(guac_user* user, void* data) {
+
+    int* lag = (int*) data;
+
+    /* Time spent processing frames which have been received */
+    if (user->processing_lag > *lag)
+        *lag = user->processing_lag;
+
+    /* Frames sent but not yet acknowledged, beyond the estimated round trip
+     * time, are still queued for the user */
+    int unacknowledged = user->client->last_sent_timestamp
+        - user->last_received_timestamp - user->last_frame_duration;
+
+    if (unacknowledged > *lag)
+        *lag = unacknowledged;
+
+    return NULL;
+
+}
+
+/**
+ * Returns the duration that the current frame should have, given the
+ * current echo state of the terminal and how far connected users have
+ * fallen behind. Frames which may contain the echo of a key press are kept
+ * short, while other frames are stretched to match the lag of the slowest
+ * user.
+ *
+ * @param terminal
+ *     The terminal whose frame duration should be determined.
+ *
+ * @param echo
+ *     Non-zero if the frame may contain the echo of a key press, zero
+ *     otherwise.
+ *
+ * @return
+ *     The desired duration of the current frame, in milliseconds.
+ */
+static int guac_terminal_frame_duration(guac_terminal* terminal, int echo) {
+
+    /* Send echo of user input immediately, regardless of lag */
+    if (echo)
+        return GUAC_TERMINAL_ECHO_FRAME_DURATION;
+
+    /* Give lagging users time to catch up */
+    int lag = 0;
+    guac_client_foreach_user(terminal->client,
+            __guac_terminal_calculate_lag, &lag);
+
+    if (lag > GUAC_TERMINAL_MAX_FRAME_DURATION)
+        return GUAC_TERMINAL_MAX_FRAME_DURATION;
+
+    if (lag > GUAC_TERMINAL_FRAME_DURATION)
+        return lag;
+
+    return GUAC_TERMINAL_FRAME_DURATION;
+
+}
+
+/**
+ * Returns whether output likely containing the echo of a key press has been
+ * received, clearing that state if requested.
+ *
+ * @param terminal
+ *     The terminal to check.
+ *
+ * @param clear
+ *     Non-zero if the received echo is about to be flushed and should no
+ *     longer be considered, zero otherwise.
+ *
+ * @return
+ *     Non-zero if output has been received since a key was pressed and has
+ *     not yet been flushed, zero otherwise.
+ */
+static int guac_terminal_echo_received(guac_terminal* terminal, int clear) {
+
+    pthread_mutex_lock(&(terminal->modified_lock));
+
+    int received = (terminal->echo_state == GUAC_TERMINAL_ECHO_RECEIVED);
+    if (received && clear)
+        terminal->echo_state = 0;
+
+    pthread_mutex_unlock(&(terminal->modified_lock));
+    return received;
+
+}
+
 int guac_terminal_render_frame(guac_terminal* terminal) {
 
     guac_client* client = terminal->client;
@@ -745,21 +848,38 @@ int guac_terminal_render_frame(guac_terminal* terminal) {
 
         do {
 
+            /* Output continues to be parsed while the frame is extended, with
+             * only the final state being flushed */
+            int echo = guac_terminal_echo_received(terminal, 0);
+            int frame_duration = guac_terminal_frame_duration(terminal, echo);
+
             /* Calculate time remaining in frame */
             guac_timestamp frame_end = guac_timestamp_current();
-            int frame_remaining = frame_start + GUAC_TERMINAL_FRAME_DURATION
-                                - frame_end;
+            int frame_remaining = frame_start + frame_duration - frame_end;
 
-            /* Wait again if frame remaining */
-            if (frame_remaining > 0 || !terminal->started)
+            /* Frame is complete if no time remains */
+            if (frame_remaining <= 0 && terminal->started)
+                break;
+
+            /* Wait out the remainder of frames stretched due to lag, even if
+             * output pauses */
+            if (frame_duration > GUAC_TERMINAL_FRAME_DURATION) {
+                wait_result = guac_terminal_wait(terminal, frame_remaining);
+                if (wait_result == 0)
+                    wait_result = 1;
+            }
+
+            /* Otherwise, end the frame as soon as output pauses */
+            else
                 wait_result = guac_terminal_wait(terminal,
                         GUAC_TERMINAL_FRAME_TIMEOUT);
-            else
-                break;
 
         } while (client->state == GUAC_CLIENT_RUNNING
                 && (wait_result > 0 || !terminal->started));
 
+        /* Any received echo is included in this flush */
+        guac_terminal_echo_received(terminal, 1);
+
         /* Flush terminal */
         guac_terminal_lock(terminal);
         guac_terminal_flush(terminal);
@@ -941,21 +1061,28 @@ void guac_terminal_commit_cursor(guac_terminal* term) {
 int guac_terminal_write(guac_terminal* term, const char* buffer, int length) {
 
     guac_terminal_lock(term);
+
+    /* Write all data to typescript, if any */
+    if (term->typescript != NULL)
+        guac_terminal_typescript_append(term->typescript, buffer, length);
+
     for (int written = 0; written < length; written++) {
 
         /* Read and advance to next character */
         char current = *(buffer++);
 
-        /* Write character to typescript, if any */
-        if (term->typescript != NULL)
-            guac_terminal_typescript_write(term->typescript, current);
-
         /* Handle character and its meaning */
         term->char_handler(term, current);
 
     }
     guac_terminal_unlock(term);
 
+    /* Output following a key press likely contains the echo of that key */
+    pthread_mutex_lock(&(term->modified_lock));
+    if (term->echo_state == GUAC_TERMINAL_ECHO_AWAITED)
+        term->echo_state = GUAC_TERMINAL_ECHO_RECEIVED;
+    pthread_mutex_unlock(&(term->modified_lock));
+
     guac_terminal_notify(term);
     return length;
 
@@ -1558,6 +1685,32 @@ int guac_terminal_send_string(guac_terminal* term, const char* data) {
 
 }
 
+/**
+ * Sends the current contents of the terminal clipboard as input to the
+ * terminal. The contents are referenced for the duration of the write, which
+ * may block, such that the clipboard may be modified concurrently.
+ *
+ * @param term
+ *     The terminal receiving the clipboard contents.
+ *
+ * @return
+ *     The number of bytes written, or a negative value if an error occurs.
+ */
+static int __guac_terminal_paste(guac_terminal* term) {
+
+    const char* buffer;
+    int length;
+
+    guac_common_clipboard_storage* storage =
+        guac_common_clipboard_acquire(term->clipboard, &buffer, &length);
+
+    int result = guac_terminal_send_data(term, buffer, length);
+
+    guac_common_clipboard_release(term->clipboard, storage);
+    return result;
+
+}
+
 static int __guac_terminal_send_key(guac_terminal* term, int keysym, int pressed) {
 
     /* Ignore user input if terminal is not started */
@@ -1567,6 +1720,13 @@ static int __guac_terminal_send_key(guac_terminal* term, int keysym, int pressed
         return 0;
     }
 
+    /* Send the echo of this key as soon as it is received */
+    if (pressed) {
+        pthread_mutex_lock(&(term->modified_lock));
+        term->echo_state = GUAC_TERMINAL_ECHO_AWAITED;
+        pthread_mutex_unlock(&(term->modified_lock));
+    }
+
     /* Hide mouse cursor if not already hidden */
     if (term->current_cursor != GUAC_TERMINAL_CURSOR_BLANK) {
         term->current_cursor = GUAC_TERMINAL_CURSOR_BLANK;
@@ -1589,7 +1749,7 @@ static int __guac_terminal_send_key(guac_terminal* term, int keysym, int pressed
 
         /* Ctrl+Shift+V or Cmd+v (mac style) shortcuts for paste */
         if ((keysym == 'V' && term->mod_ctrl) || (keysym == 'v' && term->mod_meta))
-            return guac_terminal_send_data(term, term->clipboard->buffer, term->clipboard->length);
+            return __guac_terminal_paste(term);
 
         /*
          * Ctrl+Shift+C and Cmd+c shortcuts for copying are not handled, as
@@ -1791,7 +1951,7 @@ static int __guac_terminal_send_mouse(guac_terminal* term, guac_user* user,
 
     /* Paste contents of clipboard on right or middle mouse button up */
     if ((released_mask & GUAC_CLIENT_MOUSE_RIGHT) || (released_mask & GUAC_CLIENT_MOUSE_MIDDLE))
-        return guac_terminal_send_data(term, term->clipboard->buffer, term->clipboard->length);
+        return __guac_terminal_paste(term);
 
     /* If left mouse button was just released, stop selection */
     if (released_mask & GUAC_CLIENT_MOUSE_LEFT)
@@ -2178,15 +2338,18 @@ void guac_terminal_clipboard_reset(guac_terminal* terminal,
 void guac_terminal_clipboard_append(guac_terminal* terminal,
         const char* data, int length) {
 
-    /* Allocate and clear space for the converted data */
-    char output_data[GUAC_COMMON_CLIPBOARD_MAX_LENGTH];
+    /* Allocate space for the converted data, allowing for each input byte
+     * to be replaced with a multibyte character */
+    int output_length = length * 4;
+    char* output_data = malloc(output_length);
     char* output = output_data;
 
     /* Convert clipboard contents */
     guac_iconv(GUAC_READ_UTF8_NORMALIZED, &data, length,
-            GUAC_WRITE_UTF8, &output, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+            GUAC_WRITE_UTF8, &output, output_length);
 
     guac_common_clipboard_append(terminal->clipboard, output_data, output - output_data);
+    free(output_data);
 }
 
 void guac_terminal_remove_user(guac_terminal* terminal, guac_user* user) {
@@ -108,6 +108,53 @@ typedef struct guac_terminal_operation {
 
 } guac_terminal_operation;
 
+/**
+ * A rectangle of character cells which can be updated with a single drawing
+ * operation, built from horizontal runs of identical operations within
+ * consecutive rows.
+ */
+typedef struct guac_terminal_display_rect {
+
+    /**
+     * The leftmost column of the rectangle.
+     */
+    int left;
+
+    /**
+     * The rightmost column of the rectangle, inclusive.
+     */
+    int right;
+
+    /**
+     * The topmost row of the rectangle.
+     */
+    int top;
+
+    /**
+     * The bottommost row of the rectangle, inclusive.
+     */
+    int bottom;
+
+    /**
+     * The number of rows between each cell and the cell it copies from. This
+     * is only applicable to rectangles of GUAC_CHAR_COPY operations.
+     */
+    int row_offset;
+
+    /**
+     * The number of columns between each cell and the cell it copies from.
+     * This is only applicable to rectangles of GUAC_CHAR_COPY operations.
+     */
+    int column_offset;
+
+    /**
+     * The color to fill the rectangle with. This is only applicable to
+     * rectangles of GUAC_CHAR_SET operations which clear cells.
+     */
+    guac_terminal_color color;
+
+} guac_terminal_display_rect;
+
 /**
  * Set of all pending operations for the currently-visible screen area, and the
  * contextual information necessary to interpret and render those changes.
@@ -124,6 +171,39 @@ typedef struct guac_terminal_display {
      */
     guac_terminal_operation* operations;
 
+    /**
+     * Bitmap of all rows having pending operations, one bit per row. Rows
+     * whose bits are clear contain only GUAC_CHAR_NOP operations and are
+     * skipped entirely when flushing.
+     */
+    uint64_t* dirty_rows;
+
+    /**
+     * Storage for the rectangles found while merging pending operations
+     * during a flush.
+     */
+    guac_terminal_display_rect* rects;
+
+    /**
+     * The number of rectangles which may be stored within the rects array
+     * before it must be grown.
+     */
+    int rects_available;
+
+    /**
+     * Indices of the rectangles which include the previous row and may be
+     * extended to include the current row, in order of column, while
+     * merging pending operations. This array holds one entry per column.
+     */
+    int* open_rects;
+
+    /**
+     * Indices of the rectangles which include the current row, in order of
+     * column, while merging pending operations. This array holds one entry
+     * per column.
+     */
+    int* next_open_rects;
+
     /**
      * The width of the screen, in characters.
      */
@@ -29,6 +29,19 @@
 #include "terminal.h"
 #include "typescript.h"
 
+/**
+ * Value of the echo_state member of guac_terminal indicating that a user has
+ * pressed a key, but no output has since been received.
+ */
+#define GUAC_TERMINAL_ECHO_AWAITED 1
+
+/**
+ * Value of the echo_state member of guac_terminal indicating that output has
+ * been received since a user pressed a key, and that output has not yet been
+ * flushed.
+ */
+#define GUAC_TERMINAL_ECHO_RECEIVED 2
+
 /**
  * Handler for characters printed to the terminal. When a character is printed,
  * the current char handler for the terminal is called and given that
@@ -105,6 +118,17 @@ struct guac_terminal {
      */
     pthread_cond_t modified_cond;
 
+    /**
+     * The state of the echo of the most recent key pressed by a user: zero if
+     * no echo is awaited, GUAC_TERMINAL_ECHO_AWAITED if a key has been pressed
+     * but no output has yet been received, or GUAC_TERMINAL_ECHO_RECEIVED if
+     * output has been received since the key was pressed but has not yet
+     * been flushed. Frames are kept short while an echo is awaited or
+     * received. The modified_lock will always be acquired before this value
+     * is altered.
+     */
+    int echo_state;
+
     /**
      * Pipe which will be the source of user input. When a terminal code
      * generates synthesized user input, that data will be written to
@@ -87,6 +87,19 @@
  */
 #define GUAC_TERMINAL_FRAME_TIMEOUT 10
 
+/**
+ * The maximum duration of a frame containing output received after the user
+ * pressed a key, in milliseconds. Such frames likely contain the echo of that
+ * key and are sent as soon as possible, regardless of lag.
+ */
+#define GUAC_TERMINAL_ECHO_FRAME_DURATION 5
+
+/**
+ * The maximum duration of a single frame when the frame has been stretched
+ * because connected users are lagging, in milliseconds.
+ */
+#define GUAC_TERMINAL_MAX_FRAME_DURATION 1000
+
 /**
  * The maximum number of custom tab stops.
  */
@@ -31,6 +31,9 @@
 
 #include <guacamole/timestamp.h>
 
+#include <pthread.h>
+#include <stddef.h>
+
 /**
  * A NULL-terminated string of raw bytes which should be written at the
  * beginning of any typescript.
@@ -76,6 +79,49 @@
  */
 #define GUAC_TERMINAL_TYPESCRIPT_TIMING_SUFFIX "timing"
 
+/**
+ * The number of bytes of raw terminal output which may be buffered while
+ * waiting to be written to the data file. This must be a power of two.
+ */
+#define GUAC_TERMINAL_TYPESCRIPT_DATA_BUFFER_SIZE 1048576
+
+/**
+ * The number of bytes of timing information which may be buffered while
+ * waiting to be written to the timing file. This must be a power of two.
+ */
+#define GUAC_TERMINAL_TYPESCRIPT_TIMING_BUFFER_SIZE 65536
+
+/**
+ * A ring buffer of bytes awaiting being written to a file by the writer
+ * thread of a typescript.
+ */
+typedef struct guac_terminal_typescript_ring {
+
+    /**
+     * The buffered bytes.
+     */
+    char* buffer;
+
+    /**
+     * The size of the buffer, in bytes. This must be a power of two.
+     */
+    size_t size;
+
+    /**
+     * The total number of bytes ever added to this ring. The next byte added
+     * is stored at this position modulo the size of the buffer.
+     */
+    size_t head;
+
+    /**
+     * The total number of bytes ever removed from this ring. The oldest byte
+     * not yet written is stored at this position modulo the size of the
+     * buffer.
+     */
+    size_t tail;
+
+} guac_terminal_typescript_ring;
+
 /**
  * An active typescript, consisting of a data file (raw terminal output) and
  * timing file (related timestamps and byte counts).
@@ -83,16 +129,51 @@
 typedef struct guac_terminal_typescript {
 
     /**
-     * Buffer of raw terminal output which has not yet been written to the
-     * data file.
+     * Raw terminal output which has not yet been written to the data file.
+     */
+    guac_terminal_typescript_ring data;
+
+    /**
+     * Timing information which has not yet been written to the timing file.
      */
-    char buffer[4096];
+    guac_terminal_typescript_ring timing;
 
     /**
-     * The number of bytes currently stored in the buffer.
+     * The number of bytes of raw terminal output received since the last
+     * flush, and thus not yet accounted for within the timing information.
      */
     int length;
 
+    /**
+     * The thread which writes buffered output and timing information to the
+     * data and timing files, such that terminal output is not delayed by
+     * slow storage.
+     */
+    pthread_t writer_thread;
+
+    /**
+     * Lock which guards the data and timing buffers and the stopping flag.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled when the writer thread has data to write
+     * or should stop.
+     */
+    pthread_cond_t pending;
+
+    /**
+     * Condition which is signalled when the writer thread has freed space
+     * within the data or timing buffers.
+     */
+    pthread_cond_t written;
+
+    /**
+     * Non-zero if the writer thread should write all buffered data and then
+     * stop, zero otherwise.
+     */
+    int stopping;
+
     /**
      * The full path to the file which will contain the raw terminal output for
      * this typescript.
@@ -154,8 +235,26 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
         const char* name, int create_path);
 
 /**
- * Writes a single byte of terminal data to the typescript, flushing and
- * writing a new timestamp if necessary.
+ * Writes the given terminal data to the typescript. The data is written to
+ * the data file in the background. If the writer thread has fallen so far
+ * behind that the data buffer is full, this function blocks until space is
+ * available.
+ *
+ * @param typescript
+ *     The typescript that the given raw terminal data should be written to.
+ *
+ * @param data
+ *     The raw terminal data to write to the typescript.
+ *
+ * @param length
+ *     The number of bytes of raw terminal data to write.
+ */
+void guac_terminal_typescript_append(guac_terminal_typescript* typescript,
+        const char* data, int length);
+
+/**
+ * Writes a single byte of terminal data to the typescript. This is equivalent
+ * to guac_terminal_typescript_append() with a length of one byte.
  *
  * @param typescript
  *     The typescript that the given byte of raw terminal data should be
@@ -168,8 +267,9 @@ void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
         char c);
 
 /**
- * Flushes any pending data to the typescript, writing a new timestamp to the
- * timing file if any data was flushed.
+ * Records a new timestamp for any data written since the last flush. The
+ * timing entry is written to the timing file in the background, and the
+ * writer thread is woken to write all buffered data.
  *
  * @param typescript
  *     The typescript which should be flushed.
@@ -178,8 +278,9 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript);
 
 /**
  * Frees all resources associated with the given typescript, flushing and
- * closing the data and timing files and freeing all related memory. If the
- * provided typescript is NULL, this function has no effect.
+ * closing the data and timing files and freeing all related memory. This
+ * function blocks until the writer thread has written all buffered data. If
+ * the provided typescript is NULL, this function has no effect.
  *
  * @param typescript
  *     The typescript to free.
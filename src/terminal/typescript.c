@@ -23,8 +23,10 @@
 #include <guacamole/timestamp.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/types.h>
@@ -107,6 +109,194 @@ static int guac_terminal_typescript_open_data_file(const char* path,
 
 }
 
+/**
+ * Returns the number of bytes that can be read from the given ring starting
+ * at its tail without wrapping around the end of its buffer.
+ *
+ * @param ring
+ *     The ring to check.
+ *
+ * @return
+ *     The number of bytes which can be read contiguously from the tail of the
+ *     ring.
+ */
+static size_t guac_terminal_typescript_ring_readable(
+        guac_terminal_typescript_ring* ring) {
+
+    size_t offset = ring->tail & (ring->size - 1);
+    size_t readable = ring->head - ring->tail;
+
+    if (readable > ring->size - offset)
+        readable = ring->size - offset;
+
+    return readable;
+
+}
+
+/**
+ * Copies as much of the given data as will fit into the given ring, without
+ * blocking. The typescript lock must be held.
+ *
+ * @param ring
+ *     The ring to copy data into.
+ *
+ * @param data
+ *     The data to copy.
+ *
+ * @param length
+ *     The number of bytes of data to copy.
+ *
+ * @return
+ *     The number of bytes actually copied, which may be less than the
+ *     requested length if the ring is full.
+ */
+static size_t guac_terminal_typescript_ring_write(
+        guac_terminal_typescript_ring* ring, const char* data, size_t length) {
+
+    size_t available = ring->size - (ring->head - ring->tail);
+    if (length > available)
+        length = available;
+
+    /* Copy data in up to two parts, wrapping around the end of the buffer */
+    size_t offset = ring->head & (ring->size - 1);
+    size_t first = ring->size - offset;
+    if (first > length)
+        first = length;
+
+    memcpy(ring->buffer + offset, data, first);
+    memcpy(ring->buffer, data + first, length - first);
+
+    ring->head += length;
+    return length;
+
+}
+
+/**
+ * Copies all of the given data into the given ring, waiting for the writer
+ * thread to free space within the ring as necessary. The typescript lock must
+ * be held.
+ *
+ * @param typescript
+ *     The typescript that owns the given ring.
+ *
+ * @param ring
+ *     The ring to copy data into.
+ *
+ * @param data
+ *     The data to copy.
+ *
+ * @param length
+ *     The number of bytes of data to copy.
+ */
+static void guac_terminal_typescript_enqueue(
+        guac_terminal_typescript* typescript,
+        guac_terminal_typescript_ring* ring, const char* data, size_t length) {
+
+    for (;;) {
+
+        size_t written = guac_terminal_typescript_ring_write(ring, data,
+                length);
+
+        data += written;
+        length -= written;
+
+        /* Wake the writer thread if a substantial amount of data is waiting,
+         * rather than waiting for the next flush */
+        if (ring->head - ring->tail >= ring->size / 2)
+            pthread_cond_signal(&(typescript->pending));
+
+        if (length == 0)
+            break;
+
+        /* Storage has fallen far behind. Wait rather than lose output. */
+        pthread_cond_wait(&(typescript->written), &(typescript->lock));
+
+    }
+
+}
+
+/**
+ * Writes as much data as can be read contiguously from the given ring to the
+ * given file, advancing the tail of the ring accordingly. The typescript lock
+ * must be held, and is released while the data is being written.
+ *
+ * @param typescript
+ *     The typescript that owns the given ring.
+ *
+ * @param ring
+ *     The ring to write data from.
+ *
+ * @param fd
+ *     The file descriptor of the file to write the data to.
+ *
+ * @return
+ *     The number of bytes removed from the ring.
+ */
+static size_t guac_terminal_typescript_ring_drain(
+        guac_terminal_typescript* typescript,
+        guac_terminal_typescript_ring* ring, int fd) {
+
+    size_t length = guac_terminal_typescript_ring_readable(ring);
+    if (length == 0)
+        return 0;
+
+    /* Only the writer thread advances the tail, so the region being written
+     * cannot be overwritten while unlocked */
+    char* data = ring->buffer + (ring->tail & (ring->size - 1));
+
+    pthread_mutex_unlock(&(typescript->lock));
+    guac_common_write(fd, data, length);
+    pthread_mutex_lock(&(typescript->lock));
+
+    /* Data is discarded even if the write failed, as there is nowhere else
+     * for it to go */
+    ring->tail += length;
+    pthread_cond_broadcast(&(typescript->written));
+
+    return length;
+
+}
+
+/**
+ * Thread which writes all buffered data and timing information to the data
+ * and timing files of a typescript, until the typescript is freed.
+ *
+ * @param data
+ *     The guac_terminal_typescript whose buffers should be written.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_terminal_typescript_writer_thread(void* data) {
+
+    guac_terminal_typescript* typescript = (guac_terminal_typescript*) data;
+
+    pthread_mutex_lock(&(typescript->lock));
+
+    for (;;) {
+
+        /* Write everything currently buffered */
+        size_t written = guac_terminal_typescript_ring_drain(typescript,
+                &(typescript->data), typescript->data_fd);
+        written += guac_terminal_typescript_ring_drain(typescript,
+                &(typescript->timing), typescript->timing_fd);
+
+        if (written > 0)
+            continue;
+
+        /* Stop only once everything has been written */
+        if (typescript->stopping)
+            break;
+
+        pthread_cond_wait(&(typescript->pending), &(typescript->lock));
+
+    }
+
+    pthread_mutex_unlock(&(typescript->lock));
+    return NULL;
+
+}
+
 guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
         const char* name, int create_path) {
 
@@ -156,20 +346,53 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
     guac_common_write(typescript->data_fd, GUAC_TERMINAL_TYPESCRIPT_HEADER,
             sizeof(GUAC_TERMINAL_TYPESCRIPT_HEADER) - 1);
 
+    /* Allocate buffers for output awaiting the writer thread */
+    typescript->data.buffer = malloc(GUAC_TERMINAL_TYPESCRIPT_DATA_BUFFER_SIZE);
+    typescript->data.size = GUAC_TERMINAL_TYPESCRIPT_DATA_BUFFER_SIZE;
+    typescript->data.head = typescript->data.tail = 0;
+
+    typescript->timing.buffer = malloc(GUAC_TERMINAL_TYPESCRIPT_TIMING_BUFFER_SIZE);
+    typescript->timing.size = GUAC_TERMINAL_TYPESCRIPT_TIMING_BUFFER_SIZE;
+    typescript->timing.head = typescript->timing.tail = 0;
+
+    typescript->stopping = 0;
+    pthread_mutex_init(&(typescript->lock), NULL);
+    pthread_cond_init(&(typescript->pending), NULL);
+    pthread_cond_init(&(typescript->written), NULL);
+
+    /* Start writer thread */
+    if (pthread_create(&(typescript->writer_thread), NULL,
+                guac_terminal_typescript_writer_thread, typescript)) {
+        pthread_cond_destroy(&(typescript->written));
+        pthread_cond_destroy(&(typescript->pending));
+        pthread_mutex_destroy(&(typescript->lock));
+        free(typescript->timing.buffer);
+        free(typescript->data.buffer);
+        close(typescript->timing_fd);
+        close(typescript->data_fd);
+        free(typescript);
+        return NULL;
+    }
+
     return typescript;
 
 }
 
-void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
-        char c) {
+void guac_terminal_typescript_append(guac_terminal_typescript* typescript,
+        const char* data, int length) {
+
+    pthread_mutex_lock(&(typescript->lock));
+    guac_terminal_typescript_enqueue(typescript, &(typescript->data),
+            data, length);
+    pthread_mutex_unlock(&(typescript->lock));
 
-    /* Flush buffer if no space is available */
-    if (typescript->length == sizeof(typescript->buffer))
-        guac_terminal_typescript_flush(typescript);
+    typescript->length += length;
 
-    /* Append single byte to buffer */
-    typescript->buffer[typescript->length++] = c;
+}
 
+void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
+        char c) {
+    guac_terminal_typescript_append(typescript, &c, 1);
 }
 
 void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
@@ -196,13 +419,13 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
     if (timestamp_length > sizeof(timestamp_buffer))
         timestamp_length = sizeof(timestamp_buffer);
 
-    /* Write timestamp to timing file */
-    guac_common_write(typescript->timing_fd,
+    /* Queue timestamp for the timing file, waking the writer thread to write
+     * all pending data */
+    pthread_mutex_lock(&(typescript->lock));
+    guac_terminal_typescript_enqueue(typescript, &(typescript->timing),
             timestamp_buffer, timestamp_length);
-
-    /* Empty buffer into data file */
-    guac_common_write(typescript->data_fd,
-            typescript->buffer, typescript->length);
+    pthread_cond_signal(&(typescript->pending));
+    pthread_mutex_unlock(&(typescript->lock));
 
     /* Buffer is now flushed */
     typescript->length = 0;
@@ -219,6 +442,14 @@ void guac_terminal_typescript_free(guac_terminal_typescript* typescript) {
     /* Flush any pending data */
     guac_terminal_typescript_flush(typescript);
 
+    /* Wait for writer thread to write everything buffered */
+    pthread_mutex_lock(&(typescript->lock));
+    typescript->stopping = 1;
+    pthread_cond_signal(&(typescript->pending));
+    pthread_mutex_unlock(&(typescript->lock));
+
+    pthread_join(typescript->writer_thread, NULL);
+
     /* Write footer */
     guac_common_write(typescript->data_fd, GUAC_TERMINAL_TYPESCRIPT_FOOTER,
             sizeof(GUAC_TERMINAL_TYPESCRIPT_FOOTER) - 1);
@@ -227,8 +458,14 @@ void guac_terminal_typescript_free(guac_terminal_typescript* typescript) {
     close(typescript->data_fd);
     close(typescript->timing_fd);
 
+    /* Free buffers and synchronization primitives */
+    pthread_cond_destroy(&(typescript->written));
+    pthread_cond_destroy(&(typescript->pending));
+    pthread_mutex_destroy(&(typescript->lock));
+    free(typescript->timing.buffer);
+    free(typescript->data.buffer);
+
     /* Free allocated typescript data */
     free(typescript);
 
 }
-